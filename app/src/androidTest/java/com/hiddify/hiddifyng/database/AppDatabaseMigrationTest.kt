@@ -0,0 +1,145 @@
+package com.hiddify.hiddifyng.database
+
+import android.content.Context
+import androidx.room.Room
+import androidx.room.migration.Migration
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import com.hiddify.hiddifyng.database.entity.Server
+import kotlinx.coroutines.runBlocking
+import org.junit.After
+import org.junit.Assert.assertArrayEquals
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertNotNull
+import org.junit.Assert.assertNull
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+
+/**
+ * MIGRATION_4_5 and MIGRATION_5_6 against a database rolled back to the
+ * older schema: Room only opens it if the migrated tables match the
+ * entities exactly, and the existing rows have to survive with the new
+ * columns empty
+ */
+@RunWith(AndroidJUnit4::class)
+class AppDatabaseMigrationTest {
+    
+    private lateinit var context: Context
+    
+    @Before
+    fun setUp() {
+        context = InstrumentationRegistry.getInstrumentation().targetContext
+        context.deleteDatabase(TEST_DB)
+    }
+    
+    @After
+    fun tearDown() {
+        context.deleteDatabase(TEST_DB)
+    }
+    
+    @Test
+    fun migrate4To6() {
+        val id = createAt(4, listOf("udpLossPercent", "udpJitterMs", "urlTestMs"))
+        
+        val server = openWith(AppDatabase.MIGRATION_4_5, AppDatabase.MIGRATION_5_6)
+        assertKept(server)
+        assertEquals(id, server.id)
+        assertNull(server.udpLossPercent)
+        assertNull(server.udpJitterMs)
+        assertNull(server.urlTestMs)
+    }
+    
+    @Test
+    fun migrate5To6() {
+        createAt(5, listOf("urlTestMs"))
+        
+        val server = openWith(AppDatabase.MIGRATION_5_6)
+        assertKept(server)
+        assertEquals(3, server.udpLossPercent)
+        assertEquals(12, server.udpJitterMs)
+        assertNull(server.urlTestMs)
+    }
+    
+    /**
+     * Let Room create the current schema with one server in it, then drop
+     * the columns added after [version] by rebuilding the servers table from
+     * its own DDL and stamp the file with the old version
+     */
+    private fun createAt(version: Int, newerColumns: List<String>): Long {
+        val database = Room.databaseBuilder(context, AppDatabase::class.java, TEST_DB).build()
+        val id = runBlocking { database.serverDao().insert(sample()) }
+        
+        val db = database.openHelper.writableDatabase
+        var ddl = db.query("SELECT sql FROM sqlite_master WHERE type = 'table' AND name = 'servers'").use {
+            it.moveToFirst()
+            it.getString(0)
+        }
+        for (column in newerColumns) {
+            val definition = ", `$column` INTEGER"
+            check(definition in ddl) { "servers has no $column" }
+            ddl = ddl.replace(definition, "")
+        }
+        val kept = db.query("PRAGMA table_info(servers)").use { cursor ->
+            val names = mutableListOf<String>()
+            while (cursor.moveToNext()) {
+                val name = cursor.getString(cursor.getColumnIndexOrThrow("name"))
+                if (name !in newerColumns) names += "`$name`"
+            }
+            names.joinToString(", ")
+        }
+        
+        db.execSQL("ALTER TABLE servers RENAME TO servers_current")
+        db.execSQL(ddl)
+        db.execSQL("INSERT INTO servers ($kept) SELECT $kept FROM servers_current")
+        db.execSQL("DROP TABLE servers_current")
+        db.version = version
+        database.close()
+        return id
+    }
+    
+    /** Open with only [migrations] registered; anything missing or wrong throws */
+    private fun openWith(vararg migrations: Migration): Server {
+        val database = Room.databaseBuilder(context, AppDatabase::class.java, TEST_DB)
+            .addMigrations(*migrations)
+            .build()
+        try {
+            val servers = runBlocking { database.serverDao().getAllServersSync() }
+            assertEquals(1, servers.size)
+            return servers[0]
+        } finally {
+            database.close()
+        }
+    }
+    
+    private fun sample() = Server(
+        name = "Frankfurt",
+        protocol = "vless",
+        address = "de.example.com",
+        port = 443,
+        userId = "b831381d-6324-4d53-ad4f-8cda48b30811",
+        tls = true,
+        avgPing = 48,
+        latencySketch = byteArrayOf(1, 2, 3),
+        bandwidthKbps = 25000,
+        udpLossPercent = 3,
+        udpJitterMs = 12,
+        urlTestMs = 310
+    )
+    
+    private fun assertKept(server: Server) {
+        val expected = sample()
+        assertEquals(expected.name, server.name)
+        assertEquals(expected.address, server.address)
+        assertEquals(expected.port, server.port)
+        assertEquals(expected.userId, server.userId)
+        assertEquals(expected.avgPing, server.avgPing)
+        assertEquals(expected.bandwidthKbps, server.bandwidthKbps)
+        assertNotNull(server.latencySketch)
+        assertArrayEquals(expected.latencySketch, server.latencySketch)
+    }
+    
+    companion object {
+        private const val TEST_DB = "migration-test"
+    }
+}
@@ -0,0 +1,95 @@
+package com.hiddify.hiddifyng.database
+
+import androidx.room.Room
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import com.hiddify.hiddifyng.database.entity.Server
+import kotlinx.coroutines.runBlocking
+import org.junit.After
+import org.junit.Assert.assertArrayEquals
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertNull
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+
+/**
+ * ProbeResultWriter against an in-memory database: results wait in memory
+ * until a flush, later results of a kind replace earlier ones, kinds that
+ * were not reported leave their columns alone, and flushIfDue only writes
+ * once the interval has passed
+ */
+@RunWith(AndroidJUnit4::class)
+class ProbeResultWriterTest {
+    
+    private lateinit var database: AppDatabase
+    private var first = 0L
+    private var second = 0L
+    
+    @Before
+    fun setUp() = runBlocking {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        database = Room.inMemoryDatabaseBuilder(context, AppDatabase::class.java).build()
+        val dao = database.serverDao()
+        first = dao.insert(Server(name = "first", address = "a.example.com", urlTestMs = 250))
+        second = dao.insert(Server(name = "second", address = "b.example.com"))
+    }
+    
+    @After
+    fun tearDown() {
+        database.close()
+    }
+    
+    private fun stored(id: Long): Server = runBlocking { database.serverDao().getServerByIdSync(id)!! }
+    
+    @Test
+    fun flushWritesEveryServerOnceWithTheLatestResults() = runBlocking {
+        val writer = ProbeResultWriter(database)
+        writer.ping(first, 80)
+        writer.ping(first, 60)
+        writer.latencySketch(first, byteArrayOf(4, 5, 6))
+        writer.tlsTiming(first, 20, 35, null)
+        writer.ping(second, 120)
+        writer.udpStats(second, 5, 9)
+        
+        // Nothing reaches the database before the flush
+        assertNull(stored(first).avgPing)
+        
+        assertEquals(2, writer.flush())
+        with(stored(first)) {
+            assertEquals(60, avgPing)
+            assertArrayEquals(byteArrayOf(4, 5, 6), latencySketch)
+            assertEquals(20, tlsConnectMs)
+            assertEquals(35, tlsHelloMs)
+            assertNull(tlsHandshakeMs)
+            // Not reported this sweep, so kept
+            assertEquals(250, urlTestMs)
+        }
+        with(stored(second)) {
+            assertEquals(120, avgPing)
+            assertEquals(5, udpLossPercent)
+            assertEquals(9, udpJitterMs)
+        }
+        
+        // The batch is gone once written
+        assertEquals(0, writer.flush())
+    }
+    
+    @Test
+    fun flushIfDueWaitsForTheInterval() = runBlocking {
+        val patient = ProbeResultWriter(database, flushIntervalMs = 60_000L)
+        patient.urlTest(second, 400)
+        patient.flushIfDue()
+        assertNull(stored(second).urlTestMs)
+        patient.flush()
+        assertEquals(400, stored(second).urlTestMs)
+        
+        val eager = ProbeResultWriter(database, flushIntervalMs = 0L)
+        eager.bandwidth(second, 30_000, 1_700_000_000_000L)
+        eager.flushIfDue()
+        with(stored(second)) {
+            assertEquals(30_000, bandwidthKbps)
+            assertEquals(1_700_000_000_000L, bandwidthMeasuredAt)
+        }
+    }
+}
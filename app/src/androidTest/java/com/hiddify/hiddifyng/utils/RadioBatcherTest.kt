@@ -0,0 +1,69 @@
+package com.hiddify.hiddifyng.utils
+
+import android.content.Context
+import android.os.SystemClock
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertNotEquals
+import org.junit.Assert.assertSame
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+
+/**
+ * RadioBatcher's window coalescing: overlapping tasks and tasks starting within the radio
+ * tail share one window, the window is published only when its last task ends, and a task
+ * starting after the tail opens a new one. RadioBatcher is process-wide, so checks look at
+ * the tasks this test added rather than the whole window
+ */
+@RunWith(AndroidJUnit4::class)
+class RadioBatcherTest {
+    
+    private val context: Context = InstrumentationRegistry.getInstrumentation().targetContext
+    
+    @Test
+    fun overlappingAndTailTasksShareOneWindow() {
+        RadioBatcher.begin(context, "coalesce-a")
+        RadioBatcher.begin(context, "coalesce-b")
+        val before = RadioBatcher.lastWindow
+        RadioBatcher.end("coalesce-a")
+        // coalesce-b is still running
+        assertSame(before, RadioBatcher.lastWindow)
+        RadioBatcher.end("coalesce-b")
+        
+        val first = RadioBatcher.lastWindow!!
+        assertEquals(listOf("coalesce-a", "coalesce-b"), first.tasks.takeLast(2))
+        
+        // Within the tail the radio is still up, so the window is extended
+        SystemClock.sleep(200)
+        RadioBatcher.begin(context, "coalesce-c")
+        RadioBatcher.end("coalesce-c")
+        val extended = RadioBatcher.lastWindow!!
+        assertEquals(listOf("coalesce-a", "coalesce-b", "coalesce-c"), extended.tasks.takeLast(3))
+        assertTrue(extended.activeMs >= first.activeMs + 200)
+        assertEquals(extended.activeMs + RadioBatcher.RADIO_TAIL_MS, extended.radioMs)
+        
+        // An end without a begin is ignored
+        RadioBatcher.end("coalesce-unknown")
+        assertSame(extended, RadioBatcher.lastWindow)
+        
+        assertTrue(RadioBatcher.lastRunAt(context, "coalesce-c") > 0L)
+    }
+    
+    @Test
+    fun taskAfterTheTailOpensANewWindow() {
+        RadioBatcher.begin(context, "tail-a")
+        RadioBatcher.end("tail-a")
+        val first = RadioBatcher.lastWindow!!
+        
+        SystemClock.sleep(RadioBatcher.RADIO_TAIL_MS + 500)
+        RadioBatcher.begin(context, "tail-b")
+        RadioBatcher.end("tail-b")
+        val second = RadioBatcher.lastWindow!!
+        
+        assertEquals(listOf("tail-b"), second.tasks)
+        assertNotEquals(first.startedAt, second.startedAt)
+        assertTrue(second.activeMs < RadioBatcher.RADIO_TAIL_MS)
+    }
+}
@@ -0,0 +1,951 @@
+#include <jni.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(__aarch64__)
+#include <sys/auxv.h>
+#if defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO)
+#include <arm_neon.h>
+#define AEAD_BENCH_ARM_CRYPTO 1
+#endif
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#define AEAD_BENCH_X86_CRYPTO 1
+#endif
+
+#include "aead_bench.h"
+#include "native_log.h"
+
+namespace aead_bench {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+inline uint32_t load32_be(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline void store32_be(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+}
+
+inline uint64_t load64_be(const uint8_t* p) {
+    return (static_cast<uint64_t>(load32_be(p)) << 32) | load32_be(p + 4);
+}
+
+inline void store64_be(uint8_t* p, uint64_t v) {
+    store32_be(p, static_cast<uint32_t>(v >> 32));
+    store32_be(p + 4, static_cast<uint32_t>(v));
+}
+
+inline uint32_t load32_le(const uint8_t* p) {
+    return p[0] | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline void store32_le(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+inline void store64_le(uint8_t* p, uint64_t v) {
+    store32_le(p, static_cast<uint32_t>(v));
+    store32_le(p + 4, static_cast<uint32_t>(v >> 32));
+}
+
+inline uint32_t rotl32(uint32_t v, int n) {
+    return (v << n) | (v >> (32 - n));
+}
+
+inline uint32_t rotr32(uint32_t v, int n) {
+    return (v >> n) | (v << (32 - n));
+}
+
+// ---- AES (FIPS-197), table-based ----
+
+inline uint8_t xtime(uint8_t x) {
+    return static_cast<uint8_t>((x << 1) ^ ((x & 0x80) ? 0x1b : 0));
+}
+
+struct AesTables {
+    uint8_t sbox[256];
+    uint32_t te[4][256];
+
+    AesTables() {
+        // Walk the multiplicative group with generator 3 to get inverses
+        uint8_t p = 1;
+        uint8_t q = 1;
+        do {
+            p = static_cast<uint8_t>(p ^ xtime(p));
+            q ^= static_cast<uint8_t>(q << 1);
+            q ^= static_cast<uint8_t>(q << 2);
+            q ^= static_cast<uint8_t>(q << 4);
+            if (q & 0x80) q ^= 0x09;
+            uint8_t x = q;
+            for (int i = 1; i < 5; i++) {
+                x ^= static_cast<uint8_t>((q << i) | (q >> (8 - i)));
+            }
+            sbox[p] = x ^ 0x63;
+        } while (p != 1);
+        sbox[0] = 0x63;
+
+        for (int i = 0; i < 256; i++) {
+            uint8_t s = sbox[i];
+            uint8_t s2 = xtime(s);
+            uint8_t s3 = s2 ^ s;
+            uint32_t word = (static_cast<uint32_t>(s2) << 24) | (static_cast<uint32_t>(s) << 16) |
+                            (static_cast<uint32_t>(s) << 8) | s3;
+            te[0][i] = word;
+            te[1][i] = rotr32(word, 8);
+            te[2][i] = rotr32(word, 16);
+            te[3][i] = rotr32(word, 24);
+        }
+    }
+};
+
+const AesTables& aes_tables() {
+    static const AesTables tables;
+    return tables;
+}
+
+struct AesKey {
+    uint32_t rk[60];
+    alignas(16) uint8_t rk_bytes[240]; // the same schedule in byte order, for AES instructions
+    int rounds;
+};
+
+void aes_expand(const uint8_t* key, size_t key_len, AesKey& out) {
+    const uint8_t* sbox = aes_tables().sbox;
+    int nk = static_cast<int>(key_len / 4);
+    int total = 4 * (nk + 7);
+    out.rounds = nk + 6;
+
+    for (int i = 0; i < nk; i++) out.rk[i] = load32_be(key + 4 * i);
+
+    uint8_t rcon = 1;
+    for (int i = nk; i < total; i++) {
+        uint32_t t = out.rk[i - 1];
+        if (i % nk == 0 || (nk > 6 && i % nk == 4)) {
+            if (i % nk == 0) t = rotl32(t, 8);
+            t = (static_cast<uint32_t>(sbox[t >> 24]) << 24) |
+                (static_cast<uint32_t>(sbox[(t >> 16) & 0xff]) << 16) |
+                (static_cast<uint32_t>(sbox[(t >> 8) & 0xff]) << 8) | sbox[t & 0xff];
+            if (i % nk == 0) {
+                t ^= static_cast<uint32_t>(rcon) << 24;
+                rcon = xtime(rcon);
+            }
+        }
+        out.rk[i] = out.rk[i - nk] ^ t;
+    }
+    for (int i = 0; i < total; i++) store32_be(out.rk_bytes + 4 * i, out.rk[i]);
+}
+
+void aes_encrypt_block(const AesKey& key, const uint8_t in[16], uint8_t out[16]) {
+    const AesTables& t = aes_tables();
+    const uint32_t* rk = key.rk;
+
+    uint32_t s0 = load32_be(in) ^ rk[0];
+    uint32_t s1 = load32_be(in + 4) ^ rk[1];
+    uint32_t s2 = load32_be(in + 8) ^ rk[2];
+    uint32_t s3 = load32_be(in + 12) ^ rk[3];
+
+    for (int round = 1; round < key.rounds; round++) {
+        rk += 4;
+        uint32_t t0 = t.te[0][s0 >> 24] ^ t.te[1][(s1 >> 16) & 0xff] ^
+                      t.te[2][(s2 >> 8) & 0xff] ^ t.te[3][s3 & 0xff] ^ rk[0];
+        uint32_t t1 = t.te[0][s1 >> 24] ^ t.te[1][(s2 >> 16) & 0xff] ^
+                      t.te[2][(s3 >> 8) & 0xff] ^ t.te[3][s0 & 0xff] ^ rk[1];
+        uint32_t t2 = t.te[0][s2 >> 24] ^ t.te[1][(s3 >> 16) & 0xff] ^
+                      t.te[2][(s0 >> 8) & 0xff] ^ t.te[3][s1 & 0xff] ^ rk[2];
+        uint32_t t3 = t.te[0][s3 >> 24] ^ t.te[1][(s0 >> 16) & 0xff] ^
+                      t.te[2][(s1 >> 8) & 0xff] ^ t.te[3][s2 & 0xff] ^ rk[3];
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+    }
+    rk += 4;
+
+    const uint8_t* sbox = t.sbox;
+    auto last = [sbox](uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+        return (static_cast<uint32_t>(sbox[a >> 24]) << 24) |
+               (static_cast<uint32_t>(sbox[(b >> 16) & 0xff]) << 16) |
+               (static_cast<uint32_t>(sbox[(c >> 8) & 0xff]) << 8) | sbox[d & 0xff];
+    };
+    store32_be(out, last(s0, s1, s2, s3) ^ rk[0]);
+    store32_be(out + 4, last(s1, s2, s3, s0) ^ rk[1]);
+    store32_be(out + 8, last(s2, s3, s0, s1) ^ rk[2]);
+    store32_be(out + 12, last(s3, s0, s1, s2) ^ rk[3]);
+}
+
+// ---- GCM (NIST SP 800-38D) ----
+
+struct GcmKey {
+    AesKey aes;
+    bool hardware;
+    uint64_t h_hi;        // hash key as a big-endian 128-bit value
+    uint64_t h_lo;
+    uint64_t table_hi[16]; // 4-bit multiples of the hash key (Shoup's method)
+    uint64_t table_lo[16];
+};
+
+inline void increment32(uint8_t counter[16]) {
+    store32_be(counter + 12, load32_be(counter + 12) + 1);
+}
+
+void ghash_init_table(GcmKey& key) {
+    uint64_t vh = key.h_hi;
+    uint64_t vl = key.h_lo;
+
+    key.table_hi[0] = 0;
+    key.table_lo[0] = 0;
+    key.table_hi[8] = vh;
+    key.table_lo[8] = vl;
+    for (int i = 4; i > 0; i >>= 1) {
+        uint64_t carry = (vl & 1) * 0xe100000000000000ULL;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ carry;
+        key.table_hi[i] = vh;
+        key.table_lo[i] = vl;
+    }
+    for (int i = 2; i <= 8; i *= 2) {
+        for (int j = 1; j < i; j++) {
+            key.table_hi[i + j] = key.table_hi[i] ^ key.table_hi[j];
+            key.table_lo[i + j] = key.table_lo[i] ^ key.table_lo[j];
+        }
+    }
+}
+
+const uint64_t kGhashReduce4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0,
+};
+
+/** y = y * H, four bits at a time */
+void ghash_mult_table(const GcmKey& key, uint8_t y[16]) {
+    uint8_t low = y[15] & 0x0f;
+    uint64_t zh = key.table_hi[low];
+    uint64_t zl = key.table_lo[low];
+
+    for (int i = 15; i >= 0; i--) {
+        low = y[i] & 0x0f;
+        uint8_t high = y[i] >> 4;
+        if (i != 15) {
+            uint8_t rem = static_cast<uint8_t>(zl & 0x0f);
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ (kGhashReduce4[rem] << 48) ^ key.table_hi[low];
+            zl ^= key.table_lo[low];
+        }
+        uint8_t rem = static_cast<uint8_t>(zl & 0x0f);
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ (kGhashReduce4[rem] << 48) ^ key.table_hi[high];
+        zl ^= key.table_lo[high];
+    }
+    store64_be(y, zh);
+    store64_be(y + 8, zl);
+}
+
+/**
+ * Reduce a 256-bit carry-less product of byte-reflected operands modulo the
+ * GCM polynomial (Gueron and Kounavis, Intel carry-less multiplication guide)
+ */
+inline void ghash_reduce(uint64_t x0, uint64_t x1, uint64_t x2, uint64_t x3,
+                         uint64_t& hi, uint64_t& lo) {
+    // Bit-reflected operands leave the product one bit short
+    x3 = (x3 << 1) | (x2 >> 63);
+    x2 = (x2 << 1) | (x1 >> 63);
+    x1 = (x1 << 1) | (x0 >> 63);
+    x0 <<= 1;
+
+    uint64_t d = x1 ^ (x0 << 63) ^ (x0 << 62) ^ (x0 << 57);
+    uint64_t e1 = d >> 1, e0 = (x0 >> 1) | (d << 63);
+    uint64_t f1 = d >> 2, f0 = (x0 >> 2) | (d << 62);
+    uint64_t g1 = d >> 7, g0 = (x0 >> 7) | (d << 57);
+    hi = x3 ^ d ^ e1 ^ f1 ^ g1;
+    lo = x2 ^ x0 ^ e0 ^ f0 ^ g0;
+}
+
+#if defined(AEAD_BENCH_ARM_CRYPTO)
+
+bool detect_aes_hardware() {
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+#ifndef HWCAP_PMULL
+#define HWCAP_PMULL (1 << 4)
+#endif
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    return (hwcap & HWCAP_AES) && (hwcap & HWCAP_PMULL);
+}
+
+inline void clmul64(uint64_t a, uint64_t b, uint64_t& lo, uint64_t& hi) {
+    uint64x2_t product = vreinterpretq_u64_p128(
+            vmull_p64(static_cast<poly64_t>(a), static_cast<poly64_t>(b)));
+    lo = vgetq_lane_u64(product, 0);
+    hi = vgetq_lane_u64(product, 1);
+}
+
+inline uint8x16_t aes_rounds(const uint8x16_t* rk, int rounds, uint8x16_t block) {
+    for (int i = 0; i < rounds - 1; i++) block = vaesmcq_u8(vaeseq_u8(block, rk[i]));
+    return veorq_u8(vaeseq_u8(block, rk[rounds - 1]), rk[rounds]);
+}
+
+/** Counter mode four blocks at a time so the AES pipeline stays full */
+void aes_ctr_hardware(const AesKey& key, uint8_t counter[16], const uint8_t* in,
+                      uint8_t* out, size_t len) {
+    uint8x16_t rk[15];
+    for (int i = 0; i <= key.rounds; i++) rk[i] = vld1q_u8(key.rk_bytes + 16 * i);
+
+    uint8_t blocks[64];
+    while (len >= 64) {
+        for (int b = 0; b < 4; b++) {
+            memcpy(blocks + 16 * b, counter, 16);
+            increment32(counter);
+        }
+        uint8x16_t b0 = vld1q_u8(blocks), b1 = vld1q_u8(blocks + 16);
+        uint8x16_t b2 = vld1q_u8(blocks + 32), b3 = vld1q_u8(blocks + 48);
+        for (int i = 0; i < key.rounds - 1; i++) {
+            b0 = vaesmcq_u8(vaeseq_u8(b0, rk[i]));
+            b1 = vaesmcq_u8(vaeseq_u8(b1, rk[i]));
+            b2 = vaesmcq_u8(vaeseq_u8(b2, rk[i]));
+            b3 = vaesmcq_u8(vaeseq_u8(b3, rk[i]));
+        }
+        int r = key.rounds;
+        vst1q_u8(out, veorq_u8(vld1q_u8(in), veorq_u8(vaeseq_u8(b0, rk[r - 1]), rk[r])));
+        vst1q_u8(out + 16, veorq_u8(vld1q_u8(in + 16), veorq_u8(vaeseq_u8(b1, rk[r - 1]), rk[r])));
+        vst1q_u8(out + 32, veorq_u8(vld1q_u8(in + 32), veorq_u8(vaeseq_u8(b2, rk[r - 1]), rk[r])));
+        vst1q_u8(out + 48, veorq_u8(vld1q_u8(in + 48), veorq_u8(vaeseq_u8(b3, rk[r - 1]), rk[r])));
+        in += 64;
+        out += 64;
+        len -= 64;
+    }
+    while (len > 0) {
+        vst1q_u8(blocks, aes_rounds(rk, key.rounds, vld1q_u8(counter)));
+        increment32(counter);
+        size_t n = len < 16 ? len : 16;
+        for (size_t i = 0; i < n; i++) out[i] = in[i] ^ blocks[i];
+        in += n;
+        out += n;
+        len -= n;
+    }
+}
+
+#define AEAD_BENCH_HW_TARGET
+
+#elif defined(AEAD_BENCH_X86_CRYPTO)
+
+bool detect_aes_hardware() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    return (ecx & bit_AES) && (ecx & bit_PCLMUL);
+}
+
+#define AEAD_BENCH_HW_TARGET __attribute__((target("aes,pclmul,sse2")))
+
+AEAD_BENCH_HW_TARGET
+inline void clmul64(uint64_t a, uint64_t b, uint64_t& lo, uint64_t& hi) {
+    __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<long long>(a)),
+                                           _mm_set_epi64x(0, static_cast<long long>(b)), 0x00);
+    alignas(16) uint64_t words[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(words), product);
+    lo = words[0];
+    hi = words[1];
+}
+
+/** Counter mode four blocks at a time so the AES pipeline stays full */
+AEAD_BENCH_HW_TARGET
+void aes_ctr_hardware(const AesKey& key, uint8_t counter[16], const uint8_t* in,
+                      uint8_t* out, size_t len) {
+    __m128i rk[15];
+    for (int i = 0; i <= key.rounds; i++) {
+        rk[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(key.rk_bytes + 16 * i));
+    }
+    int r = key.rounds;
+
+    alignas(16) uint8_t blocks[64];
+    while (len >= 64) {
+        for (int b = 0; b < 4; b++) {
+            memcpy(blocks + 16 * b, counter, 16);
+            increment32(counter);
+        }
+        const __m128i* src = reinterpret_cast<const __m128i*>(blocks);
+        __m128i b0 = _mm_xor_si128(_mm_load_si128(src), rk[0]);
+        __m128i b1 = _mm_xor_si128(_mm_load_si128(src + 1), rk[0]);
+        __m128i b2 = _mm_xor_si128(_mm_load_si128(src + 2), rk[0]);
+        __m128i b3 = _mm_xor_si128(_mm_load_si128(src + 3), rk[0]);
+        for (int i = 1; i < r; i++) {
+            b0 = _mm_aesenc_si128(b0, rk[i]);
+            b1 = _mm_aesenc_si128(b1, rk[i]);
+            b2 = _mm_aesenc_si128(b2, rk[i]);
+            b3 = _mm_aesenc_si128(b3, rk[i]);
+        }
+        const __m128i* plain = reinterpret_cast<const __m128i*>(in);
+        __m128i* sealed = reinterpret_cast<__m128i*>(out);
+        _mm_storeu_si128(sealed, _mm_xor_si128(_mm_loadu_si128(plain), _mm_aesenclast_si128(b0, rk[r])));
+        _mm_storeu_si128(sealed + 1, _mm_xor_si128(_mm_loadu_si128(plain + 1), _mm_aesenclast_si128(b1, rk[r])));
+        _mm_storeu_si128(sealed + 2, _mm_xor_si128(_mm_loadu_si128(plain + 2), _mm_aesenclast_si128(b2, rk[r])));
+        _mm_storeu_si128(sealed + 3, _mm_xor_si128(_mm_loadu_si128(plain + 3), _mm_aesenclast_si128(b3, rk[r])));
+        in += 64;
+        out += 64;
+        len -= 64;
+    }
+    while (len > 0) {
+        __m128i b = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(counter)), rk[0]);
+        for (int i = 1; i < r; i++) b = _mm_aesenc_si128(b, rk[i]);
+        _mm_store_si128(reinterpret_cast<__m128i*>(blocks), _mm_aesenclast_si128(b, rk[r]));
+        increment32(counter);
+        size_t n = len < 16 ? len : 16;
+        for (size_t i = 0; i < n; i++) out[i] = in[i] ^ blocks[i];
+        in += n;
+        out += n;
+        len -= n;
+    }
+}
+
+#else
+
+bool detect_aes_hardware() {
+    return false;
+}
+
+#endif
+
+#if defined(AEAD_BENCH_ARM_CRYPTO) || defined(AEAD_BENCH_X86_CRYPTO)
+#define AEAD_BENCH_HAS_HW 1
+
+/** y = (y ^ block) * H per block, with carry-less multiply instructions */
+AEAD_BENCH_HW_TARGET
+void ghash_hardware(const GcmKey& key, uint8_t y[16], const uint8_t* data, size_t blocks) {
+    uint64_t yh = load64_be(y);
+    uint64_t yl = load64_be(y + 8);
+    for (size_t i = 0; i < blocks; i++, data += 16) {
+        yh ^= load64_be(data);
+        yl ^= load64_be(data + 8);
+
+        uint64_t p0l, p0h, p1l, p1h, m0l, m0h, m1l, m1h;
+        clmul64(yl, key.h_lo, p0l, p0h);
+        clmul64(yh, key.h_hi, p1l, p1h);
+        clmul64(yl, key.h_hi, m0l, m0h);
+        clmul64(yh, key.h_lo, m1l, m1h);
+        ghash_reduce(p0l, p0h ^ m0l ^ m1l, p1l ^ m0h ^ m1h, p1h, yh, yl);
+    }
+    store64_be(y, yh);
+    store64_be(y + 8, yl);
+}
+
+#endif
+
+bool aes_hardware_available() {
+    static const bool available = detect_aes_hardware();
+    return available;
+}
+
+void aes_ctr(const GcmKey& key, uint8_t counter[16], const uint8_t* in, uint8_t* out, size_t len) {
+#if defined(AEAD_BENCH_HAS_HW)
+    if (key.hardware) {
+        aes_ctr_hardware(key.aes, counter, in, out, len);
+        return;
+    }
+#endif
+    uint8_t stream[16];
+    while (len > 0) {
+        aes_encrypt_block(key.aes, counter, stream);
+        increment32(counter);
+        size_t n = len < 16 ? len : 16;
+        for (size_t i = 0; i < n; i++) out[i] = in[i] ^ stream[i];
+        in += n;
+        out += n;
+        len -= n;
+    }
+}
+
+/** Absorb data zero-padded to whole blocks */
+void ghash_update(const GcmKey& key, uint8_t y[16], const uint8_t* data, size_t len) {
+    size_t blocks = len / 16;
+#if defined(AEAD_BENCH_HAS_HW)
+    if (key.hardware) {
+        ghash_hardware(key, y, data, blocks);
+    } else
+#endif
+    {
+        for (size_t b = 0; b < blocks; b++) {
+            for (int i = 0; i < 16; i++) y[i] ^= data[16 * b + i];
+            ghash_mult_table(key, y);
+        }
+    }
+
+    size_t rest = len % 16;
+    if (rest > 0) {
+        uint8_t last[16] = {};
+        memcpy(last, data + 16 * blocks, rest);
+        ghash_update(key, y, last, 16);
+    }
+}
+
+void gcm_init(GcmKey& key, const uint8_t* aes_key, size_t key_len, bool use_hardware) {
+    aes_expand(aes_key, key_len, key.aes);
+    key.hardware = use_hardware && aes_hardware_available();
+
+    uint8_t zero[16] = {};
+    uint8_t h[16];
+    aes_encrypt_block(key.aes, zero, h);
+    key.h_hi = load64_be(h);
+    key.h_lo = load64_be(h + 8);
+    ghash_init_table(key);
+}
+
+void gcm_seal(const GcmKey& key, const uint8_t* nonce, const uint8_t* aad, size_t aad_len,
+              const uint8_t* in, size_t len, uint8_t* out, uint8_t* tag) {
+    uint8_t counter[16];
+    memcpy(counter, nonce, kNonceBytes);
+    store32_be(counter + 12, 1);
+
+    uint8_t zero[16] = {};
+    uint8_t tag_mask[16];
+    aes_ctr(key, counter, zero, tag_mask, 16);
+    aes_ctr(key, counter, in, out, len);
+
+    uint8_t y[16] = {};
+    ghash_update(key, y, aad, aad_len);
+    ghash_update(key, y, out, len);
+    uint8_t lengths[16];
+    store64_be(lengths, static_cast<uint64_t>(aad_len) * 8);
+    store64_be(lengths + 8, static_cast<uint64_t>(len) * 8);
+    ghash_update(key, y, lengths, 16);
+
+    for (int i = 0; i < 16; i++) tag[i] = y[i] ^ tag_mask[i];
+}
+
+// ---- ChaCha20-Poly1305 (RFC 8439) ----
+
+inline void quarter_round(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d) {
+    a += b; d ^= a; d = rotl32(d, 16);
+    c += d; b ^= c; b = rotl32(b, 12);
+    a += b; d ^= a; d = rotl32(d, 8);
+    c += d; b ^= c; b = rotl32(b, 7);
+}
+
+void chacha20_block(const uint32_t state[16], uint8_t out[64]) {
+    uint32_t x[16];
+    memcpy(x, state, sizeof(x));
+    for (int i = 0; i < 10; i++) {
+        quarter_round(x[0], x[4], x[8], x[12]);
+        quarter_round(x[1], x[5], x[9], x[13]);
+        quarter_round(x[2], x[6], x[10], x[14]);
+        quarter_round(x[3], x[7], x[11], x[15]);
+        quarter_round(x[0], x[5], x[10], x[15]);
+        quarter_round(x[1], x[6], x[11], x[12]);
+        quarter_round(x[2], x[7], x[8], x[13]);
+        quarter_round(x[3], x[4], x[9], x[14]);
+    }
+    for (int i = 0; i < 16; i++) store32_le(out + 4 * i, x[i] + state[i]);
+}
+
+void chacha20_init(uint32_t state[16], const uint8_t* key, const uint8_t* nonce, uint32_t counter) {
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (int i = 0; i < 8; i++) state[4 + i] = load32_le(key + 4 * i);
+    state[12] = counter;
+    for (int i = 0; i < 3; i++) state[13 + i] = load32_le(nonce + 4 * i);
+}
+
+void chacha20_xor(uint32_t state[16], const uint8_t* in, uint8_t* out, size_t len) {
+    uint8_t stream[64];
+    while (len > 0) {
+        chacha20_block(state, stream);
+        state[12]++;
+        size_t n = len < 64 ? len : 64;
+        for (size_t i = 0; i < n; i++) out[i] = in[i] ^ stream[i];
+        in += n;
+        out += n;
+        len -= n;
+    }
+}
+
+#if defined(__SIZEOF_INT128__)
+
+/** Poly1305 with 44-bit limbs and 128-bit products (poly1305-donna-64) */
+class Poly1305 {
+public:
+    explicit Poly1305(const uint8_t key[32]) {
+        uint64_t t0 = load64_le(key);
+        uint64_t t1 = load64_le(key + 8);
+        r_[0] = t0 & 0xffc0fffffffULL;
+        r_[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffffULL;
+        r_[2] = (t1 >> 24) & 0x00ffffffc0fULL;
+        pad_[0] = load64_le(key + 16);
+        pad_[1] = load64_le(key + 24);
+    }
+
+    /** Absorb data zero-padded to whole blocks, as the AEAD construction does */
+    void update_padded(const uint8_t* data, size_t len) {
+        size_t full = len & ~static_cast<size_t>(15);
+        blocks(data, full, kHibit);
+        if (len > full) {
+            uint8_t last[16] = {};
+            memcpy(last, data + full, len - full);
+            blocks(last, 16, kHibit);
+        }
+    }
+
+    void finish(uint8_t mac[16]) {
+        uint64_t h0 = h_[0], h1 = h_[1], h2 = h_[2];
+        uint64_t c = h1 >> 44; h1 &= kMask44;
+        h2 += c; c = h2 >> 42; h2 &= kMask42;
+        h0 += c * 5; c = h0 >> 44; h0 &= kMask44;
+        h1 += c; c = h1 >> 44; h1 &= kMask44;
+        h2 += c; c = h2 >> 42; h2 &= kMask42;
+        h0 += c * 5; c = h0 >> 44; h0 &= kMask44;
+        h1 += c;
+
+        // h - p, selected in constant time when h >= p
+        uint64_t g0 = h0 + 5; c = g0 >> 44; g0 &= kMask44;
+        uint64_t g1 = h1 + c; c = g1 >> 44; g1 &= kMask44;
+        uint64_t g2 = h2 + c - (1ULL << 42);
+        c = (g2 >> 63) - 1;
+        h0 = (h0 & ~c) | (g0 & c);
+        h1 = (h1 & ~c) | (g1 & c);
+        h2 = (h2 & ~c) | (g2 & c);
+
+        uint64_t t0 = pad_[0], t1 = pad_[1];
+        h0 += t0 & kMask44; c = h0 >> 44; h0 &= kMask44;
+        h1 += (((t0 >> 44) | (t1 << 20)) & kMask44) + c; c = h1 >> 44; h1 &= kMask44;
+        h2 += ((t1 >> 24) & kMask42) + c; h2 &= kMask42;
+
+        store64_le(mac, h0 | (h1 << 44));
+        store64_le(mac + 8, (h1 >> 20) | (h2 << 24));
+    }
+
+private:
+    static constexpr uint64_t kMask44 = 0xfffffffffffULL;
+    static constexpr uint64_t kMask42 = 0x3ffffffffffULL;
+    static constexpr uint64_t kHibit = 1ULL << 40;
+
+    static uint64_t load64_le(const uint8_t* p) {
+        return load32_le(p) | (static_cast<uint64_t>(load32_le(p + 4)) << 32);
+    }
+
+    void blocks(const uint8_t* m, size_t len, uint64_t hibit) {
+        using u128 = unsigned __int128;
+        uint64_t r0 = r_[0], r1 = r_[1], r2 = r_[2];
+        uint64_t s1 = r1 * (5 << 2), s2 = r2 * (5 << 2);
+        uint64_t h0 = h_[0], h1 = h_[1], h2 = h_[2];
+
+        for (; len >= 16; m += 16, len -= 16) {
+            uint64_t t0 = load64_le(m);
+            uint64_t t1 = load64_le(m + 8);
+            h0 += t0 & kMask44;
+            h1 += ((t0 >> 44) | (t1 << 20)) & kMask44;
+            h2 += ((t1 >> 24) & kMask42) | hibit;
+
+            u128 d0 = static_cast<u128>(h0) * r0 + static_cast<u128>(h1) * s2 + static_cast<u128>(h2) * s1;
+            u128 d1 = static_cast<u128>(h0) * r1 + static_cast<u128>(h1) * r0 + static_cast<u128>(h2) * s2;
+            u128 d2 = static_cast<u128>(h0) * r2 + static_cast<u128>(h1) * r1 + static_cast<u128>(h2) * r0;
+
+            uint64_t c = static_cast<uint64_t>(d0 >> 44); h0 = static_cast<uint64_t>(d0) & kMask44;
+            d1 += c; c = static_cast<uint64_t>(d1 >> 44); h1 = static_cast<uint64_t>(d1) & kMask44;
+            d2 += c; c = static_cast<uint64_t>(d2 >> 42); h2 = static_cast<uint64_t>(d2) & kMask42;
+            h0 += c * 5; c = h0 >> 44; h0 &= kMask44;
+            h1 += c;
+        }
+        h_[0] = h0;
+        h_[1] = h1;
+        h_[2] = h2;
+    }
+
+    uint64_t r_[3];
+    uint64_t h_[3] = {0, 0, 0};
+    uint64_t pad_[2];
+};
+
+#else
+
+/** Poly1305 with 26-bit limbs for 32-bit targets (poly1305-donna-32) */
+class Poly1305 {
+public:
+    explicit Poly1305(const uint8_t key[32]) {
+        r_[0] = load32_le(key) & 0x3ffffff;
+        r_[1] = (load32_le(key + 3) >> 2) & 0x3ffff03;
+        r_[2] = (load32_le(key + 6) >> 4) & 0x3ffc0ff;
+        r_[3] = (load32_le(key + 9) >> 6) & 0x3f03fff;
+        r_[4] = (load32_le(key + 12) >> 8) & 0x00fffff;
+        for (int i = 0; i < 4; i++) pad_[i] = load32_le(key + 16 + 4 * i);
+    }
+
+    /** Absorb data zero-padded to whole blocks, as the AEAD construction does */
+    void update_padded(const uint8_t* data, size_t len) {
+        size_t full = len & ~static_cast<size_t>(15);
+        blocks(data, full);
+        if (len > full) {
+            uint8_t last[16] = {};
+            memcpy(last, data + full, len - full);
+            blocks(last, 16);
+        }
+    }
+
+    void finish(uint8_t mac[16]) {
+        uint32_t h0 = h_[0], h1 = h_[1], h2 = h_[2], h3 = h_[3], h4 = h_[4];
+        uint32_t c = h1 >> 26; h1 &= kMask26;
+        h2 += c; c = h2 >> 26; h2 &= kMask26;
+        h3 += c; c = h3 >> 26; h3 &= kMask26;
+        h4 += c; c = h4 >> 26; h4 &= kMask26;
+        h0 += c * 5; c = h0 >> 26; h0 &= kMask26;
+        h1 += c;
+
+        // h - p, selected in constant time when h >= p
+        uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= kMask26;
+        uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= kMask26;
+        uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= kMask26;
+        uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= kMask26;
+        uint32_t g4 = h4 + c - (1UL << 26);
+        uint32_t mask = (g4 >> 31) - 1;
+        h0 = (h0 & ~mask) | (g0 & mask);
+        h1 = (h1 & ~mask) | (g1 & mask);
+        h2 = (h2 & ~mask) | (g2 & mask);
+        h3 = (h3 & ~mask) | (g3 & mask);
+        h4 = (h4 & ~mask) | (g4 & mask);
+
+        uint32_t w0 = h0 | (h1 << 26);
+        uint32_t w1 = (h1 >> 6) | (h2 << 20);
+        uint32_t w2 = (h2 >> 12) | (h3 << 14);
+        uint32_t w3 = (h3 >> 18) | (h4 << 8);
+
+        uint64_t f = static_cast<uint64_t>(w0) + pad_[0];
+        store32_le(mac, static_cast<uint32_t>(f));
+        f = static_cast<uint64_t>(w1) + pad_[1] + (f >> 32);
+        store32_le(mac + 4, static_cast<uint32_t>(f));
+        f = static_cast<uint64_t>(w2) + pad_[2] + (f >> 32);
+        store32_le(mac + 8, static_cast<uint32_t>(f));
+        f = static_cast<uint64_t>(w3) + pad_[3] + (f >> 32);
+        store32_le(mac + 12, static_cast<uint32_t>(f));
+    }
+
+private:
+    static constexpr uint32_t kMask26 = 0x3ffffff;
+
+    void blocks(const uint8_t* m, size_t len) {
+        uint32_t r0 = r_[0], r1 = r_[1], r2 = r_[2], r3 = r_[3], r4 = r_[4];
+        uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+        uint32_t h0 = h_[0], h1 = h_[1], h2 = h_[2], h3 = h_[3], h4 = h_[4];
+
+        for (; len >= 16; m += 16, len -= 16) {
+            h0 += load32_le(m) & kMask26;
+            h1 += (load32_le(m + 3) >> 2) & kMask26;
+            h2 += (load32_le(m + 6) >> 4) & kMask26;
+            h3 += (load32_le(m + 9) >> 6) & kMask26;
+            h4 += (load32_le(m + 12) >> 8) | (1UL << 24);
+
+            uint64_t d0 = static_cast<uint64_t>(h0) * r0 + static_cast<uint64_t>(h1) * s4 +
+                          static_cast<uint64_t>(h2) * s3 + static_cast<uint64_t>(h3) * s2 +
+                          static_cast<uint64_t>(h4) * s1;
+            uint64_t d1 = static_cast<uint64_t>(h0) * r1 + static_cast<uint64_t>(h1) * r0 +
+                          static_cast<uint64_t>(h2) * s4 + static_cast<uint64_t>(h3) * s3 +
+                          static_cast<uint64_t>(h4) * s2;
+            uint64_t d2 = static_cast<uint64_t>(h0) * r2 + static_cast<uint64_t>(h1) * r1 +
+                          static_cast<uint64_t>(h2) * r0 + static_cast<uint64_t>(h3) * s4 +
+                          static_cast<uint64_t>(h4) * s3;
+            uint64_t d3 = static_cast<uint64_t>(h0) * r3 + static_cast<uint64_t>(h1) * r2 +
+                          static_cast<uint64_t>(h2) * r1 + static_cast<uint64_t>(h3) * r0 +
+                          static_cast<uint64_t>(h4) * s4;
+            uint64_t d4 = static_cast<uint64_t>(h0) * r4 + static_cast<uint64_t>(h1) * r3 +
+                          static_cast<uint64_t>(h2) * r2 + static_cast<uint64_t>(h3) * r1 +
+                          static_cast<uint64_t>(h4) * r0;
+
+            uint32_t c = static_cast<uint32_t>(d0 >> 26); h0 = static_cast<uint32_t>(d0) & kMask26;
+            d1 += c; c = static_cast<uint32_t>(d1 >> 26); h1 = static_cast<uint32_t>(d1) & kMask26;
+            d2 += c; c = static_cast<uint32_t>(d2 >> 26); h2 = static_cast<uint32_t>(d2) & kMask26;
+            d3 += c; c = static_cast<uint32_t>(d3 >> 26); h3 = static_cast<uint32_t>(d3) & kMask26;
+            d4 += c; c = static_cast<uint32_t>(d4 >> 26); h4 = static_cast<uint32_t>(d4) & kMask26;
+            h0 += c * 5; c = h0 >> 26; h0 &= kMask26;
+            h1 += c;
+        }
+        h_[0] = h0;
+        h_[1] = h1;
+        h_[2] = h2;
+        h_[3] = h3;
+        h_[4] = h4;
+    }
+
+    uint32_t r_[5];
+    uint32_t h_[5] = {0, 0, 0, 0, 0};
+    uint32_t pad_[4];
+};
+
+#endif
+
+void chacha20_poly1305_seal(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad,
+                            size_t aad_len, const uint8_t* in, size_t len,
+                            uint8_t* out, uint8_t* tag) {
+    uint32_t state[16];
+    chacha20_init(state, key, nonce, 0);
+
+    // Block 0 keys the authenticator; the payload starts at block 1
+    uint8_t poly_key[64];
+    chacha20_block(state, poly_key);
+    state[12] = 1;
+    chacha20_xor(state, in, out, len);
+
+    Poly1305 mac(poly_key);
+    mac.update_padded(aad, aad_len);
+    mac.update_padded(out, len);
+    uint8_t lengths[16];
+    store64_le(lengths, aad_len);
+    store64_le(lengths + 8, len);
+    mac.update_padded(lengths, 16);
+    mac.finish(tag);
+}
+
+bool hex_equals(const uint8_t* data, const char* hex) {
+    for (size_t i = 0; hex[2 * i] != '\0'; i++) {
+        unsigned int byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1 || data[i] != byte) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+size_t key_bytes(Cipher cipher) {
+    return cipher == kAes128Gcm ? 16 : 32;
+}
+
+bool has_aes_hardware() {
+    return aes_hardware_available();
+}
+
+void seal(Cipher cipher, const uint8_t* key, const uint8_t* nonce,
+          const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len,
+          uint8_t* out, uint8_t* tag, bool use_hardware) {
+    if (cipher == kChaCha20Poly1305) {
+        chacha20_poly1305_seal(key, nonce, aad, aad_len, in, len, out, tag);
+        return;
+    }
+    GcmKey gcm;
+    gcm_init(gcm, key, key_bytes(cipher), use_hardware);
+    gcm_seal(gcm, nonce, aad, aad_len, in, len, out, tag);
+}
+
+bool self_test() {
+    uint8_t zero[32] = {};
+    uint8_t out[128];
+    uint8_t tag[kTagBytes];
+
+    // GCM test cases 2 and 14 (McGrew and Viega), on every available AES path
+    for (int hardware = 0; hardware <= (has_aes_hardware() ? 1 : 0); hardware++) {
+        seal(kAes128Gcm, zero, zero, nullptr, 0, zero, 16, out, tag, hardware != 0);
+        if (!hex_equals(out, "0388dace60b6a392f328c2b971b2fe78") ||
+            !hex_equals(tag, "ab6e47d42cec13bdf53a67b21257bddf")) {
+            return false;
+        }
+        seal(kAes256Gcm, zero, zero, nullptr, 0, zero, 16, out, tag, hardware != 0);
+        if (!hex_equals(out, "cea7403d4d606b6e074ec5d3baf39d18") ||
+            !hex_equals(tag, "d0d1c8a799996bf0265b98b5d48ab919")) {
+            return false;
+        }
+    }
+
+    // RFC 8439 section 2.8.2
+    static const char kPlaintext[] =
+            "Ladies and Gentlemen of the class of '99: If I could offer you only one tip "
+            "for the future, sunscreen would be it.";
+    uint8_t key[32];
+    for (int i = 0; i < 32; i++) key[i] = static_cast<uint8_t>(0x80 + i);
+    const uint8_t nonce[kNonceBytes] = {0x07, 0, 0, 0, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47};
+    const uint8_t aad[] = {0x50, 0x51, 0x52, 0x53, 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7};
+    seal(kChaCha20Poly1305, key, nonce, aad, sizeof(aad),
+         reinterpret_cast<const uint8_t*>(kPlaintext), sizeof(kPlaintext) - 1, out, tag);
+    return hex_equals(out, "d31a8d34648e60db7b86afbc53ef7ec2") &&
+           hex_equals(tag, "1ae10b594f09e26a7e902ecbd0600691");
+}
+
+int64_t benchmark(Cipher cipher, int duration_ms) {
+    if (duration_ms <= 0) return 0;
+
+    std::vector<uint8_t> plain(kRecordBytes);
+    std::vector<uint8_t> sealed(kRecordBytes);
+    for (size_t i = 0; i < plain.size(); i++) plain[i] = static_cast<uint8_t>(i * 31);
+
+    uint8_t key[32];
+    for (int i = 0; i < 32; i++) key[i] = static_cast<uint8_t>(i * 7 + 1);
+    uint8_t nonce[kNonceBytes] = {};
+    uint8_t aad[2] = {0x40, 0x00}; // record length prefix, as Shadowsocks seals it
+    uint8_t tag[kTagBytes];
+
+    // The key schedule runs once per connection, not per record
+    GcmKey gcm;
+    if (cipher != kChaCha20Poly1305) gcm_init(gcm, key, key_bytes(cipher), true);
+
+    auto seal_record = [&] {
+        if (cipher == kChaCha20Poly1305) {
+            chacha20_poly1305_seal(key, nonce, aad, sizeof(aad), plain.data(), plain.size(),
+                                   sealed.data(), tag);
+        } else {
+            gcm_seal(gcm, nonce, aad, sizeof(aad), plain.data(), plain.size(), sealed.data(), tag);
+        }
+        store32_le(nonce, load32_le(nonce) + 1);
+    };
+
+    seal_record(); // warm caches and tables
+    int64_t bytes = 0;
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + std::chrono::milliseconds(duration_ms);
+    Clock::time_point now;
+    do {
+        for (int i = 0; i < 4; i++) seal_record();
+        bytes += 4 * static_cast<int64_t>(kRecordBytes);
+        now = Clock::now();
+    } while (now < deadline);
+
+    double elapsed = std::chrono::duration<double>(now - start).count();
+    return elapsed > 0 ? static_cast<int64_t>(static_cast<double>(bytes) / elapsed) : 0;
+}
+
+} // namespace aead_bench
+
+extern "C" {
+
+/**
+ * Seal throughput in bytes/s as [AES-128-GCM, AES-256-GCM, ChaCha20-Poly1305],
+ * or null when an implementation fails its test vectors
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_hiddify_hiddifyng_utils_ConfigOptimizer_benchmarkAeadCiphers(JNIEnv *env, jclass clazz,
+                                                                     jint duration_ms) {
+    if (!aead_bench::self_test()) {
+        LOGE("AEAD self test failed, not benchmarking");
+        return nullptr;
+    }
+
+    static const char* const kNames[] = {"aes-128-gcm", "aes-256-gcm", "chacha20-poly1305"};
+    jlong values[aead_bench::kCipherCount];
+    for (int i = 0; i < aead_bench::kCipherCount; i++) {
+        values[i] = aead_bench::benchmark(static_cast<aead_bench::Cipher>(i), duration_ms);
+        LOGI("AEAD %s: %lld MB/s%s", kNames[i], static_cast<long long>(values[i] >> 20),
+             i != aead_bench::kChaCha20Poly1305 && aead_bench::has_aes_hardware() ? " (hardware AES)" : "");
+    }
+
+    jlongArray result = env->NewLongArray(aead_bench::kCipherCount);
+    env->SetLongArrayRegion(result, 0, aead_bench::kCipherCount, values);
+    return result;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_hiddify_hiddifyng_utils_ConfigOptimizer_hasAesHardware(JNIEnv *env, jclass clazz) {
+    return aead_bench::has_aes_hardware() ? JNI_TRUE : JNI_FALSE;
+}
+
+} // extern "C"
@@ -0,0 +1,252 @@
+#include <jni.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "bdp.h"
+#include "native_log.h"
+
+namespace bdp {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kChunkBytes = 64 * 1024;
+
+// How often the relay looks for newly queued bytes; bounds the delay error
+constexpr auto kRelayTick = std::chrono::milliseconds(1);
+
+/**
+ * Connected loopback pair; the buffers are set before the handshake so the
+ * receive window scales to them, 0 keeps the kernel default
+ */
+bool loopback_pair(int& client, int& server, int send_buffer, int receive_buffer) {
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) return false;
+    if (receive_buffer > 0) {
+        setsockopt(listener, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    client = -1;
+    server = -1;
+
+    if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+        listen(listener, 1) == 0 &&
+        getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+        client = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (client >= 0 && send_buffer > 0) {
+            setsockopt(client, SOL_SOCKET, SO_SNDBUF, &send_buffer, sizeof(send_buffer));
+        }
+        if (client >= 0 && connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            server = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        }
+    }
+    close(listener);
+
+    if (server < 0) {
+        if (client >= 0) close(client);
+        return false;
+    }
+    return true;
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/**
+ * Forward from in to out, reading each byte only once it has been queued on
+ * in for the delay. The kernel receive queue is the delay line, so the
+ * receive window of in, not the relay, bounds what the sender has in flight.
+ */
+void delay_relay(int in, int out, Clock::duration delay, const std::atomic<bool>& stop) {
+    struct Arrival {
+        Clock::time_point at;
+        uint64_t end; // stream offset up to which bytes had arrived
+    };
+    std::deque<Arrival> arrivals;
+    std::vector<char> buf(kChunkBytes);
+    uint64_t consumed = 0;
+    uint64_t seen = 0;
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        Clock::time_point now = Clock::now();
+        int queued = 0;
+        if (ioctl(in, FIONREAD, &queued) < 0) return;
+        if (consumed + static_cast<uint64_t>(queued) > seen) {
+            seen = consumed + static_cast<uint64_t>(queued);
+            arrivals.push_back({now, seen});
+        }
+
+        uint64_t due = consumed;
+        while (!arrivals.empty() && arrivals.front().at + delay <= now) {
+            due = arrivals.front().end;
+            arrivals.pop_front();
+        }
+        while (consumed < due) {
+            size_t want = static_cast<size_t>(std::min<uint64_t>(due - consumed, buf.size()));
+            ssize_t n = read(in, buf.data(), want);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0 || !write_all(out, buf.data(), static_cast<size_t>(n))) return;
+            consumed += static_cast<uint64_t>(n);
+        }
+
+        Clock::time_point wake = now + kRelayTick;
+        if (!arrivals.empty()) wake = std::min(wake, arrivals.front().at + delay);
+        std::this_thread::sleep_until(wake);
+    }
+}
+
+} // namespace
+
+Sizing size_buffers(double bandwidth_kbps, double rtt_ms, int64_t min_bytes, int64_t max_bytes) {
+    if (min_bytes <= 0) min_bytes = kMinBufferBytes;
+    if (max_bytes <= 0) max_bytes = kMaxBufferBytes;
+    max_bytes = std::max(max_bytes, min_bytes);
+
+    Sizing sizing{};
+    if (bandwidth_kbps > 0 && rtt_ms > 0) {
+        sizing.bdp_bytes = static_cast<int64_t>(bandwidth_kbps * 1000.0 / 8.0 * rtt_ms / 1000.0);
+    }
+
+    int64_t buffer = static_cast<int64_t>(static_cast<double>(sizing.bdp_bytes) * kHeadroom);
+    buffer = (buffer + kBufferGranularity - 1) / kBufferGranularity * kBufferGranularity;
+    sizing.buffer_bytes = std::clamp(buffer, min_bytes, max_bytes);
+    return sizing;
+}
+
+int64_t benchmark_window(int rtt_ms, int buffer_bytes, int duration_ms) {
+    if (rtt_ms < 0 || buffer_bytes <= 0 || duration_ms <= 0) return -1;
+
+    // sender -> relay is the delayed path with the buffers under test, as the
+    // config would set them; relay -> receiver keeps default buffers
+    int sender;
+    int relay_in;
+    int relay_out;
+    int receiver;
+    if (!loopback_pair(sender, relay_in, buffer_bytes, buffer_bytes)) {
+        LOGE("Failed to create loopback pair: %s", strerror(errno));
+        return -1;
+    }
+    if (!loopback_pair(relay_out, receiver, 0, 0)) {
+        LOGE("Failed to create loopback pair: %s", strerror(errno));
+        close(sender);
+        close(relay_in);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(sender, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(relay_out, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    std::atomic<bool> stop{false};
+    std::atomic<bool> failed{false};
+    std::atomic<int64_t> received{0};
+
+    std::thread writer([&] {
+        std::vector<char> chunk(kChunkBytes, 'x');
+        while (!stop.load(std::memory_order_relaxed) &&
+               write_all(sender, chunk.data(), chunk.size())) {
+        }
+        if (!stop.load()) failed = true;
+    });
+    std::thread relay([&] {
+        delay_relay(relay_in, relay_out, std::chrono::milliseconds(rtt_ms), stop);
+        if (!stop.load()) failed = true;
+    });
+    std::thread reader([&] {
+        std::vector<char> buf(kChunkBytes);
+        while (true) {
+            ssize_t n = read(receiver, buf.data(), buf.size());
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            received.fetch_add(n, std::memory_order_relaxed);
+        }
+    });
+
+    Clock::time_point start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+    int64_t bytes = received.load();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Unblock whichever side is parked in read or write
+    stop.store(true);
+    for (int fd : {sender, relay_in, relay_out, receiver}) shutdown(fd, SHUT_RDWR);
+    writer.join();
+    relay.join();
+    reader.join();
+    for (int fd : {sender, relay_in, relay_out, receiver}) close(fd);
+
+    if (failed) {
+        LOGE("Buffer benchmark aborted: %s", strerror(errno));
+        return -1;
+    }
+    return elapsed > 0 ? static_cast<int64_t>(static_cast<double>(bytes) / elapsed) : 0;
+}
+
+} // namespace bdp
+
+extern "C" {
+
+/**
+ * @return [bdp bytes, buffer bytes] for the given goodput and RTT
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_hiddify_hiddifyng_utils_ConfigOptimizer_sizeBuffers(JNIEnv *env, jclass clazz,
+                                                            jfloat bandwidth_kbps, jfloat rtt_ms,
+                                                            jlong min_bytes, jlong max_bytes) {
+    bdp::Sizing sizing = bdp::size_buffers(bandwidth_kbps, rtt_ms, min_bytes, max_bytes);
+    jlong values[] = {sizing.bdp_bytes, sizing.buffer_bytes};
+    jlongArray result = env->NewLongArray(2);
+    env->SetLongArrayRegion(result, 0, 2, values);
+    return result;
+}
+
+/**
+ * Throughput (bytes/s) of a loopback transfer through a delaying relay per
+ * socket buffer size at the given RTT; -1 entries failed
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_hiddify_hiddifyng_utils_ConfigOptimizer_benchmarkBufferSizes(JNIEnv *env, jclass clazz,
+                                                                     jint rtt_ms,
+                                                                     jintArray buffer_sizes,
+                                                                     jint duration_ms) {
+    jsize count = env->GetArrayLength(buffer_sizes);
+    std::vector<jint> sizes(static_cast<size_t>(count));
+    env->GetIntArrayRegion(buffer_sizes, 0, count, sizes.data());
+
+    std::vector<jlong> results(sizes.size());
+    for (size_t i = 0; i < sizes.size(); i++) {
+        results[i] = bdp::benchmark_window(rtt_ms, sizes[i], duration_ms);
+        LOGI("Buffer %d KB at %d ms RTT: %lld KB/s", sizes[i] / 1024, rtt_ms,
+             static_cast<long long>(results[i] / 1024));
+    }
+
+    jlongArray result = env->NewLongArray(count);
+    env->SetLongArrayRegion(result, 0, count, results.data());
+    return result;
+}
+
+} // extern "C"
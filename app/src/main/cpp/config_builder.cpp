@@ -0,0 +1,1142 @@
+#include <jni.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include "config_builder.h"
+#include "config_validator.h"
+#include "json_writer.h"
+#include "native_log.h"
+#include "pb_writer.h"
+#include "text_codec.h"
+
+using server_record::ServerRecord;
+
+namespace config_builder {
+
+namespace {
+
+// Routing list files shipped by RoutingManager, in rule priority order
+struct RoutingList {
+    const char* file;
+    const char* outbound_tag;
+};
+constexpr RoutingList kRoutingLists[] = {
+    {"block.txt", "block"},
+    {"direct.txt", "direct"},
+    {"proxy.txt", "proxy"},
+};
+
+// Private ranges always go direct; spelled out so the pb form
+// does not depend on geoip.dat being loadable
+const char* const kPrivateCidrs[] = {
+    "10.0.0.0/8", "100.64.0.0/10", "127.0.0.0/8", "169.254.0.0/16",
+    "172.16.0.0/12", "192.168.0.0/16", "::1/128", "fc00::/7", "fe80::/10",
+};
+
+// Tag prefix of balanced proxy outbounds ("proxy-0", "proxy-1", ...)
+constexpr char kBalancedOutboundPrefix[] = "proxy-";
+
+// Per-record outbound and inbound tags of batch configs ("batch-3", "batch-in-3")
+constexpr char kBatchOutboundPrefix[] = "batch-";
+constexpr char kBatchInboundPrefix[] = "batch-in-";
+
+// Expected JSON bytes per record byte, for reserving the batch arena
+constexpr size_t kFragmentExpansion = 3;
+
+std::string_view protocol_of(const ServerRecord& server) {
+    return server.get(server_record::kProtocol);
+}
+
+bool is_reality(const ServerRecord& server) {
+    return protocol_of(server) == "reality" ||
+           server.get(server_record::kSecurityType) == "reality";
+}
+
+std::string_view network_of(const ServerRecord& server) {
+    if (protocol_of(server) == "xhttp") return "xhttp";
+    std::string_view network = server.get(server_record::kNetwork);
+    return network.empty() ? std::string_view("tcp") : network;
+}
+
+// SS-2022 methods ("2022-blake3-...") use a pre-shared key instead of a password
+bool is_shadowsocks_2022(const ServerRecord& server) {
+    return protocol_of(server) == "shadowsocks" &&
+           server.get(server_record::kSecurityType).find("2022") != std::string_view::npos;
+}
+
+// xhttp:// links fill the xhttp fields, vless links with type=xhttp the ws ones
+std::string_view xhttp_host(const ServerRecord& server) {
+    return server.has(server_record::kXhttpHost) ? server.get(server_record::kXhttpHost)
+                                                 : server.get(server_record::kHeader);
+}
+
+std::string_view xhttp_path(const ServerRecord& server) {
+    std::string_view path = server.has(server_record::kXhttpPath)
+            ? server.get(server_record::kXhttpPath) : server.get(server_record::kWsPath);
+    return path.empty() ? std::string_view("/") : path;
+}
+
+std::string_view security_of(const ServerRecord& server) {
+    if (is_reality(server)) return "reality";
+    if (server.tls()) return "tls";
+    return "none";
+}
+
+/** VMess body security: the record's own choice, else the outbound's preferred AEAD */
+std::string_view vmess_security_of(const OutboundSpec& outbound) {
+    std::string_view security = outbound.server->get(server_record::kSecurityType);
+    if (!security.empty() && security != "auto") return security;
+    return outbound.vmess_security.empty() ? std::string_view("auto")
+                                           : std::string_view(outbound.vmess_security);
+}
+
+/**
+ * Load one routing list: one entry per line, '#' comments allowed.
+ * Bare entries are treated as domain suffixes; prefixed entries pass through.
+ */
+void load_list(const std::string& path, std::vector<std::string>& domains,
+               std::vector<std::string>& ips) {
+    FILE* file = fopen(path.c_str(), "r");
+    if (!file) return;
+
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        std::string_view entry(line);
+        while (!entry.empty() && (entry.back() == '\n' || entry.back() == '\r' ||
+                                  entry.back() == ' ' || entry.back() == '\t')) {
+            entry.remove_suffix(1);
+        }
+        while (!entry.empty() && (entry.front() == ' ' || entry.front() == '\t')) {
+            entry.remove_prefix(1);
+        }
+        if (entry.empty() || entry.front() == '#') continue;
+
+        if (entry.find('/') != std::string_view::npos &&
+            entry.find_first_not_of("0123456789abcdefABCDEF.:/") == std::string_view::npos) {
+            ips.emplace_back(entry);
+        } else if (entry.find(':') != std::string_view::npos) {
+            domains.emplace_back(entry);
+        } else {
+            domains.emplace_back("domain:" + std::string(entry));
+        }
+    }
+    fclose(file);
+}
+
+// ---------------------------------------------------------------------------
+// JSON emitter
+// ---------------------------------------------------------------------------
+
+void json_stream_settings(JsonWriter& w, const ServerRecord& server, const SocketSettings& sockopt) {
+    std::string_view network = network_of(server);
+    std::string_view security = security_of(server);
+
+    w.key("streamSettings").begin_object();
+    w.field("network", network);
+    w.field("security", security);
+
+    if (security == "tls") {
+        w.key("tlsSettings").begin_object();
+        w.field("allowInsecure", false);
+        w.field_if("serverName", server.get(server_record::kTlsServerName));
+        w.field_if("fingerprint", server.get(server_record::kTlsFingerprint));
+        w.end_object();
+    } else if (security == "reality") {
+        std::string_view fingerprint = server.get(server_record::kTlsFingerprint);
+        w.key("realitySettings").begin_object();
+        w.field("show", false);
+        w.field("fingerprint", fingerprint.empty() ? std::string_view("chrome") : fingerprint);
+        w.field_if("serverName", server.get(server_record::kTlsServerName));
+        w.field_if("publicKey", server.get(server_record::kRealityPublicKey));
+        w.field_if("shortId", server.get(server_record::kRealityShortId));
+        w.field_if("spiderX", server.get(server_record::kRealitySpiderX));
+        w.end_object();
+    }
+
+    if (network == "ws") {
+        w.key("wsSettings").begin_object();
+        w.field_if("path", server.get(server_record::kWsPath));
+        w.field_if("host", server.get(server_record::kHeader));
+        w.end_object();
+    } else if (network == "grpc") {
+        w.key("grpcSettings").begin_object();
+        w.field_if("serviceName", server.get(server_record::kWsPath));
+        w.end_object();
+    } else if (network == "xhttp") {
+        w.key("xhttpSettings").begin_object();
+        w.field_if("host", xhttp_host(server));
+        w.field("path", xhttp_path(server));
+        w.end_object();
+    }
+
+    if (sockopt.send_buffer > 0 || sockopt.receive_buffer > 0) {
+        w.key("sockopt").begin_object();
+        if (sockopt.send_buffer > 0) w.field("tcpSendBufferSize", sockopt.send_buffer);
+        if (sockopt.receive_buffer > 0) w.field("tcpReceiveBufferSize", sockopt.receive_buffer);
+        w.end_object();
+    }
+
+    w.end_object();
+}
+
+void json_proxy_outbound(JsonWriter& w, const OutboundSpec& outbound) {
+    const ServerRecord& server = *outbound.server;
+    std::string_view protocol = protocol_of(server);
+    std::string_view address = server.get(server_record::kAddress);
+    bool vnext = protocol == "vless" || protocol == "reality" || protocol == "xhttp" ||
+                 protocol == "vmess";
+
+    w.begin_object();
+    w.field("tag", outbound.tag);
+    // REALITY and XHTTP records are VLESS over that security or transport
+    w.field("protocol", protocol == "reality" || protocol == "xhttp" ? std::string_view("vless")
+                                                                      : protocol);
+
+    w.key("settings").begin_object();
+    if (vnext) {
+        w.key("vnext").begin_array().begin_object();
+        w.field("address", address);
+        w.field("port", server.port);
+        w.key("users").begin_array().begin_object();
+        w.field("id", server.get(server_record::kUserId));
+        if (protocol == "vmess") {
+            w.field("alterId", 0);
+            w.field("security", vmess_security_of(outbound));
+        } else {
+            w.field("encryption", "none");
+            w.field_if("flow", server.get(server_record::kFlow));
+        }
+        w.end_object().end_array();
+        w.end_object().end_array();
+    } else {
+        w.key("servers").begin_array().begin_object();
+        w.field("address", address);
+        w.field("port", server.port);
+        w.field("password", server.get(server_record::kPassword));
+        if (protocol == "shadowsocks") {
+            w.field("method", server.get(server_record::kSecurityType));
+        }
+        w.end_object().end_array();
+    }
+    w.end_object();
+
+    json_stream_settings(w, server, outbound.sockopt);
+
+    if (outbound.mux.enabled) {
+        w.key("mux").begin_object();
+        w.field("enabled", true);
+        w.field("concurrency", outbound.mux.concurrency);
+        w.end_object();
+    }
+
+    w.end_object();
+}
+
+void json_outbounds(JsonWriter& w, const ConfigSpec& spec) {
+    w.key("outbounds").begin_array();
+    for (const OutboundSpec& outbound : spec.outbounds) {
+        switch (outbound.kind) {
+            case OutboundSpec::kProxy:
+                json_proxy_outbound(w, outbound);
+                break;
+            case OutboundSpec::kDirect:
+                w.begin_object().field("tag", outbound.tag).field("protocol", "freedom").end_object();
+                break;
+            case OutboundSpec::kBlock:
+                w.begin_object().field("tag", outbound.tag).field("protocol", "blackhole").end_object();
+                break;
+        }
+    }
+    w.end_array();
+}
+
+void emit_json(const ConfigSpec& spec, std::string& out) {
+    JsonWriter w(out);
+    w.begin_object();
+
+    w.key("log").begin_object().field("loglevel", spec.log_level).end_object();
+
+    w.key("inbounds").begin_array();
+    for (const InboundSpec& inbound : spec.inbounds) {
+        w.begin_object();
+        w.field("tag", inbound.tag);
+        w.field("listen", inbound.listen);
+        w.field("port", inbound.port);
+        w.field("protocol", "socks");
+        w.key("settings").begin_object().field("auth", "noauth").field("udp", inbound.udp).end_object();
+        w.end_object();
+    }
+    w.end_array();
+
+    json_outbounds(w, spec);
+
+    w.key("routing").begin_object();
+    w.field("domainStrategy", spec.domain_strategy);
+    w.key("rules").begin_array();
+    for (const RuleSpec& rule : spec.rules) {
+        w.begin_object();
+        w.field("type", "field");
+        if (!rule.balancer_tag.empty()) {
+            w.field("balancerTag", rule.balancer_tag);
+        } else {
+            w.field("outboundTag", rule.outbound_tag);
+        }
+        if (!rule.inbound_tags.empty()) {
+            w.key("inboundTag").begin_array();
+            for (const std::string& tag : rule.inbound_tags) w.value(tag);
+            w.end_array();
+        }
+        if (!rule.domains.empty()) {
+            w.key("domain").begin_array();
+            for (const std::string& domain : rule.domains) w.value(domain);
+            w.end_array();
+        }
+        if (!rule.ips.empty()) {
+            w.key("ip").begin_array();
+            for (const std::string& ip : rule.ips) w.value(ip);
+            w.end_array();
+        }
+        w.end_object();
+    }
+    w.end_array();
+    if (!spec.balancers.empty()) {
+        w.key("balancers").begin_array();
+        for (const BalancerSpec& balancer : spec.balancers) {
+            w.begin_object();
+            w.field("tag", balancer.tag);
+            w.key("selector").begin_array();
+            for (const std::string& selector : balancer.selectors) w.value(selector);
+            w.end_array();
+            w.key("strategy").begin_object().field("type", balancer.strategy).end_object();
+            w.field_if("fallbackTag", balancer.fallback_tag);
+            w.end_object();
+        }
+        w.end_array();
+    }
+    w.end_object();
+
+    if (!spec.observatory.selectors.empty()) {
+        const ObservatorySpec& observatory = spec.observatory;
+        w.key("observatory").begin_object();
+        w.key("subjectSelector").begin_array();
+        for (const std::string& selector : observatory.selectors) w.value(selector);
+        w.end_array();
+        w.field("probeURL", observatory.probe_url);
+        w.field("probeInterval", std::to_string(observatory.probe_interval_ms) + "ms");
+        w.field("enableConcurrency", observatory.concurrent);
+        w.end_object();
+    }
+
+    w.end_object();
+}
+
+// ---------------------------------------------------------------------------
+// Protobuf emitter (xray.core.Config)
+// ---------------------------------------------------------------------------
+
+/** xray.common.net.IPOrDomain { oneof { bytes ip = 1; string domain = 2; } } */
+PbWriter pb_ip_or_domain(std::string_view host) {
+    PbWriter w;
+    std::string address(host);
+    unsigned char ip[16];
+    if (inet_pton(AF_INET, address.c_str(), ip) == 1) {
+        w.bytes(1, std::string_view(reinterpret_cast<char*>(ip), 4));
+    } else if (inet_pton(AF_INET6, address.c_str(), ip) == 1) {
+        w.bytes(1, std::string_view(reinterpret_cast<char*>(ip), 16));
+    } else {
+        w.string(2, host);
+    }
+    return w;
+}
+
+/** xray.app.router.CIDR { bytes ip = 1; uint32 prefix = 2; } */
+bool pb_cidr(std::string_view cidr, PbWriter& w) {
+    size_t slash = cidr.find('/');
+    std::string address(cidr.substr(0, slash));
+    long long prefix = -1;
+    if (slash != std::string_view::npos && !text_codec::parse_int(cidr.substr(slash + 1), prefix)) {
+        return false;
+    }
+    unsigned char ip[16];
+    if (inet_pton(AF_INET, address.c_str(), ip) == 1) {
+        w.bytes(1, std::string_view(reinterpret_cast<char*>(ip), 4));
+        w.varint(2, prefix < 0 ? 32 : static_cast<uint64_t>(prefix));
+    } else if (inet_pton(AF_INET6, address.c_str(), ip) == 1) {
+        w.bytes(1, std::string_view(reinterpret_cast<char*>(ip), 16));
+        w.varint(2, prefix < 0 ? 128 : static_cast<uint64_t>(prefix));
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/** xray.app.router.Domain { Type type = 1; string value = 2; } */
+PbWriter pb_domain(std::string_view domain) {
+    enum { kPlain = 0, kRegex = 1, kDomain = 2, kFull = 3 };
+    struct Prefix {
+        const char* text;
+        int type;
+    };
+    static const Prefix kPrefixes[] = {
+        {"domain:", kDomain}, {"full:", kFull}, {"regexp:", kRegex}, {"keyword:", kPlain},
+    };
+
+    int type = kPlain;
+    for (const Prefix& prefix : kPrefixes) {
+        size_t len = strlen(prefix.text);
+        if (domain.compare(0, len, prefix.text) == 0) {
+            type = prefix.type;
+            domain.remove_prefix(len);
+            break;
+        }
+    }
+
+    PbWriter w;
+    w.varint(1, type);
+    w.string(2, domain);
+    return w;
+}
+
+/** xray.common.protocol.User with the protocol-specific account */
+PbWriter pb_user(const OutboundSpec& outbound) {
+    const ServerRecord& server = *outbound.server;
+    std::string_view protocol = protocol_of(server);
+    PbWriter account;
+    const char* account_type;
+
+    if (protocol == "vmess") {
+        // xray.proxy.vmess.SecurityType
+        std::string_view security = vmess_security_of(outbound);
+        int type = 2; // AUTO
+        if (security == "aes-128-gcm") type = 3;
+        else if (security == "chacha20-poly1305") type = 4;
+        else if (security == "none") type = 5;
+        else if (security == "zero") type = 6;
+        PbWriter security_config;
+        security_config.varint(1, type);
+        account.string(1, server.get(server_record::kUserId));
+        account.message(3, security_config);
+        account_type = "xray.proxy.vmess.Account";
+    } else if (protocol == "trojan") {
+        account.string(1, server.get(server_record::kPassword));
+        account_type = "xray.proxy.trojan.Account";
+    } else if (protocol == "shadowsocks") {
+        // xray.proxy.shadowsocks.CipherType
+        std::string_view method = server.get(server_record::kSecurityType);
+        int cipher = 0;
+        if (method == "aes-128-gcm") cipher = 5;
+        else if (method == "aes-256-gcm") cipher = 6;
+        else if (method == "chacha20-poly1305" || method == "chacha20-ietf-poly1305") cipher = 7;
+        else if (method == "xchacha20-poly1305" || method == "xchacha20-ietf-poly1305") cipher = 8;
+        else if (method == "none" || method == "plain") cipher = 9;
+        account.string(1, server.get(server_record::kPassword));
+        account.varint(2, cipher);
+        account_type = "xray.proxy.shadowsocks.Account";
+    } else {
+        account.string(1, server.get(server_record::kUserId));
+        account.string(2, server.get(server_record::kFlow));
+        account.string(3, "none");
+        account_type = "xray.proxy.vless.Account";
+    }
+
+    PbWriter user;
+    user.typed_message(3, account_type, account);
+    return user;
+}
+
+/** xray.transport.internet.StreamConfig */
+PbWriter pb_stream_settings(const ServerRecord& server) {
+    std::string_view network = network_of(server);
+    std::string_view security = security_of(server);
+    PbWriter stream;
+
+    if (network == "ws") {
+        PbWriter ws;
+        ws.string(2, server.get(server_record::kWsPath));
+        ws.string(5, server.get(server_record::kHeader));
+        PbWriter transport;
+        transport.typed_message(2, "xray.transport.internet.websocket.Config", ws);
+        transport.string(3, "websocket");
+        stream.message(2, transport);
+        stream.string(5, "websocket");
+    } else if (network == "grpc") {
+        PbWriter grpc;
+        grpc.string(2, server.get(server_record::kWsPath));
+        PbWriter transport;
+        transport.typed_message(2, "xray.transport.internet.grpc.encoding.Config", grpc);
+        transport.string(3, "grpc");
+        stream.message(2, transport);
+        stream.string(5, "grpc");
+    } else {
+        stream.string(5, "tcp");
+    }
+
+    if (security == "tls") {
+        PbWriter tls;
+        tls.string(3, server.get(server_record::kTlsServerName));
+        tls.string(11, server.get(server_record::kTlsFingerprint));
+        stream.string(3, "xray.transport.internet.tls.Config");
+        stream.typed_message(4, "xray.transport.internet.tls.Config", tls);
+    } else if (security == "reality") {
+        // publicKey and shortId travel as raw bytes in the pb form
+        std::string public_key;
+        std::string short_id;
+        text_codec::base64_decode(server.get(server_record::kRealityPublicKey), public_key);
+        text_codec::hex_decode(server.get(server_record::kRealityShortId), short_id);
+        std::string_view fingerprint = server.get(server_record::kTlsFingerprint);
+
+        PbWriter reality;
+        reality.string(21, fingerprint.empty() ? std::string_view("chrome") : fingerprint);
+        reality.string(22, server.get(server_record::kTlsServerName));
+        reality.string(23, public_key);
+        reality.string(24, short_id);
+        reality.string(25, server.get(server_record::kRealitySpiderX));
+        stream.string(3, "xray.transport.internet.reality.Config");
+        stream.typed_message(4, "xray.transport.internet.reality.Config", reality);
+    }
+
+    return stream;
+}
+
+/** xray.core.OutboundHandlerConfig */
+PbWriter pb_outbound(const OutboundSpec& outbound) {
+    PbWriter handler;
+    handler.string(1, outbound.tag);
+
+    PbWriter sender; // xray.app.proxyman.SenderConfig
+    PbWriter proxy;
+    const char* proxy_type;
+
+    switch (outbound.kind) {
+        case OutboundSpec::kDirect:
+            proxy_type = "xray.proxy.freedom.Config";
+            break;
+        case OutboundSpec::kBlock:
+            proxy_type = "xray.proxy.blackhole.Config";
+            break;
+        case OutboundSpec::kProxy:
+        default: {
+            const ServerRecord& server = *outbound.server;
+            std::string_view protocol = protocol_of(server);
+
+            if (is_shadowsocks_2022(server)) {
+                // Carries the endpoint itself: address, port, method, key
+                proxy.message(1, pb_ip_or_domain(server.get(server_record::kAddress)));
+                proxy.varint(2, static_cast<uint32_t>(server.port));
+                proxy.string(3, server.get(server_record::kSecurityType));
+                proxy.string(4, server.get(server_record::kPassword));
+                proxy_type = "xray.proxy.shadowsocks_2022.ClientConfig";
+            } else {
+                PbWriter endpoint; // xray.common.protocol.ServerEndpoint
+                endpoint.message(1, pb_ip_or_domain(server.get(server_record::kAddress)));
+                endpoint.varint(2, static_cast<uint32_t>(server.port));
+                endpoint.message(3, pb_user(outbound));
+                proxy.message(1, endpoint);
+
+                if (protocol == "vmess") proxy_type = "xray.proxy.vmess.outbound.Config";
+                else if (protocol == "trojan") proxy_type = "xray.proxy.trojan.ClientConfig";
+                else if (protocol == "shadowsocks") proxy_type = "xray.proxy.shadowsocks.ClientConfig";
+                else proxy_type = "xray.proxy.vless.outbound.Config";
+            }
+
+            sender.message(2, pb_stream_settings(server));
+            if (outbound.mux.enabled) {
+                PbWriter mux;
+                mux.boolean(1, true);
+                mux.varint(2, static_cast<uint32_t>(outbound.mux.concurrency));
+                sender.message(4, mux);
+            }
+            break;
+        }
+    }
+
+    handler.typed_message(2, "xray.app.proxyman.SenderConfig", sender);
+    handler.typed_message(3, proxy_type, proxy);
+    return handler;
+}
+
+/** xray.core.InboundHandlerConfig for a local SOCKS listener */
+PbWriter pb_inbound(const InboundSpec& inbound) {
+    PbWriter range;
+    range.varint(1, static_cast<uint32_t>(inbound.port));
+    range.varint(2, static_cast<uint32_t>(inbound.port));
+    PbWriter port_list;
+    port_list.message(1, range);
+
+    PbWriter receiver; // xray.app.proxyman.ReceiverConfig
+    receiver.message(1, port_list);
+    receiver.message(2, pb_ip_or_domain(inbound.listen));
+
+    PbWriter socks; // xray.proxy.socks.ServerConfig, auth_type NO_AUTH = 0
+    socks.message(3, pb_ip_or_domain(inbound.listen));
+    socks.boolean(4, inbound.udp);
+
+    PbWriter handler;
+    handler.string(1, inbound.tag);
+    handler.typed_message(2, "xray.app.proxyman.ReceiverConfig", receiver);
+    handler.typed_message(3, "xray.proxy.socks.ServerConfig", socks);
+    return handler;
+}
+
+/** xray.app.router.Config */
+PbWriter pb_router(const ConfigSpec& spec) {
+    PbWriter router;
+    int strategy = 0; // AsIs
+    if (spec.domain_strategy == "UseIp") strategy = 1;
+    else if (spec.domain_strategy == "IPIfNonMatch") strategy = 2;
+    else if (spec.domain_strategy == "IPOnDemand") strategy = 3;
+    router.varint(1, strategy);
+
+    for (const RuleSpec& rule : spec.rules) {
+        PbWriter r;
+        if (!rule.balancer_tag.empty()) {
+            r.string(12, rule.balancer_tag);
+        } else {
+            r.string(1, rule.outbound_tag);
+        }
+        for (const std::string& domain : rule.domains) {
+            r.message(2, pb_domain(domain));
+        }
+        for (const std::string& tag : rule.inbound_tags) {
+            r.bytes(8, tag);
+        }
+        if (!rule.ips.empty()) {
+            PbWriter geoip; // anonymous GeoIP holding literal CIDRs
+            for (const std::string& ip : rule.ips) {
+                PbWriter cidr;
+                if (pb_cidr(ip, cidr)) geoip.message(2, cidr);
+            }
+            r.message(10, geoip);
+        }
+        router.message(2, r);
+    }
+
+    for (const BalancerSpec& balancer : spec.balancers) {
+        PbWriter b; // xray.app.router.BalancingRule
+        b.string(1, balancer.tag);
+        for (const std::string& selector : balancer.selectors) {
+            b.bytes(2, selector);
+        }
+        b.string(3, balancer.strategy);
+        b.string(5, balancer.fallback_tag);
+        router.message(3, b);
+    }
+
+    return router;
+}
+
+/** xray.core.app.observatory.Config */
+PbWriter pb_observatory(const ObservatorySpec& observatory) {
+    PbWriter w;
+    for (const std::string& selector : observatory.selectors) {
+        w.bytes(2, selector);
+    }
+    w.string(3, observatory.probe_url);
+    w.varint(4, static_cast<uint64_t>(observatory.probe_interval_ms) * 1000000ULL);
+    w.boolean(5, observatory.concurrent);
+    return w;
+}
+
+void emit_pb(const ConfigSpec& spec, std::string& out) {
+    PbWriter config;
+
+    for (const InboundSpec& inbound : spec.inbounds) {
+        config.message(1, pb_inbound(inbound));
+    }
+    for (const OutboundSpec& outbound : spec.outbounds) {
+        config.message(2, pb_outbound(outbound));
+    }
+
+    // xray.app.log.Config: console error log, no access log
+    int severity = 2; // Warning
+    if (spec.log_level == "error") severity = 1;
+    else if (spec.log_level == "info") severity = 3;
+    else if (spec.log_level == "debug") severity = 4;
+    PbWriter log;
+    log.varint(1, 1);
+    log.varint(2, severity);
+
+    PbWriter empty;
+    config.typed_message(4, "xray.app.log.Config", log);
+    config.typed_message(4, "xray.app.dispatcher.Config", empty);
+    config.typed_message(4, "xray.app.proxyman.InboundConfig", empty);
+    config.typed_message(4, "xray.app.proxyman.OutboundConfig", empty);
+    config.typed_message(4, "xray.app.router.Config", pb_router(spec));
+    if (!spec.observatory.selectors.empty()) {
+        config.typed_message(4, "xray.core.app.observatory.Config",
+                             pb_observatory(spec.observatory));
+    }
+
+    out.swap(config.data());
+}
+
+void add_socks_inbound(ConfigSpec& spec) {
+    InboundSpec socks;
+    socks.tag = "socks-in";
+    socks.port = kDefaultSocksPort;
+    spec.inbounds.push_back(socks);
+}
+
+void add_direct_and_block(ConfigSpec& spec) {
+    OutboundSpec direct;
+    direct.tag = "direct";
+    direct.kind = OutboundSpec::kDirect;
+    spec.outbounds.push_back(direct);
+
+    OutboundSpec block;
+    block.tag = "block";
+    block.kind = OutboundSpec::kBlock;
+    spec.outbounds.push_back(block);
+}
+
+/**
+ * Private ranges first, then the block/direct/proxy lists; proxy rules
+ * target the "proxy" balancer instead of an outbound when balanced
+ */
+void add_routing_rules(const std::string& routing_dir, bool balanced, ConfigSpec& spec) {
+    RuleSpec private_ips;
+    private_ips.outbound_tag = "direct";
+    private_ips.ips.assign(std::begin(kPrivateCidrs), std::end(kPrivateCidrs));
+    spec.rules.push_back(private_ips);
+
+    for (const RoutingList& list : kRoutingLists) {
+        RuleSpec rule;
+        if (balanced && strcmp(list.outbound_tag, "proxy") == 0) {
+            rule.balancer_tag = list.outbound_tag;
+        } else {
+            rule.outbound_tag = list.outbound_tag;
+        }
+        load_list(routing_dir + "/" + list.file, rule.domains, rule.ips);
+        if (!rule.domains.empty() || !rule.ips.empty()) {
+            spec.rules.push_back(std::move(rule));
+        }
+    }
+}
+
+/** Supported and passes validation; logs why a record is skipped */
+bool usable(const ServerRecord& server) {
+    if (!is_supported(server)) return false;
+
+    std::vector<config_validator::Issue> issues;
+    config_validator::validate_server(server, "server", issues);
+    if (!issues.empty()) {
+        LOGW("Skipping server %lld: %s %s", static_cast<long long>(server.id),
+             issues[0].path.c_str(), issues[0].message.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool is_supported(const ServerRecord& server) {
+    std::string_view protocol = protocol_of(server);
+    if (protocol != "vless" && protocol != "reality" && protocol != "xhttp" &&
+        protocol != "vmess" && protocol != "trojan" && protocol != "shadowsocks") {
+        return false;
+    }
+    std::string_view network = network_of(server);
+    return network == "tcp" || network == "ws" || network == "grpc" || network == "xhttp";
+}
+
+Status build_default(const ServerRecord& server, const std::string& routing_dir, ConfigSpec& spec) {
+    std::vector<config_validator::Issue> issues;
+    config_validator::validate_server(server, "server", issues);
+    if (!issues.empty()) {
+        LOGE("Server %lld rejected: %s %s", static_cast<long long>(server.id),
+             issues[0].path.c_str(), issues[0].message.c_str());
+        return kInvalidInput;
+    }
+    if (!is_supported(server)) {
+        return kUnsupported;
+    }
+
+    add_socks_inbound(spec);
+
+    OutboundSpec proxy;
+    proxy.tag = "proxy";
+    proxy.server = &server;
+    spec.outbounds.push_back(proxy);
+
+    add_direct_and_block(spec);
+    add_routing_rules(routing_dir, false, spec);
+    return kOk;
+}
+
+int balancer_size_for_budget(int64_t budget_bytes) {
+    int64_t k = budget_bytes / kBalancerOutboundBytes;
+    return static_cast<int>(std::clamp<int64_t>(k, 1, kMaxBalancerOutbounds));
+}
+
+Status build_balanced(const std::vector<ServerRecord>& servers, int max_outbounds,
+                      const std::string& routing_dir, ConfigSpec& spec, int& emitted) {
+    emitted = 0;
+    if (max_outbounds <= 0) {
+        return kInvalidInput;
+    }
+
+    add_socks_inbound(spec);
+
+    // Servers arrive best first; the first one is also the fallback
+    // until the observatory has measured the rest
+    for (const ServerRecord& server : servers) {
+        if (emitted >= max_outbounds) break;
+        if (!usable(server)) continue;
+
+        OutboundSpec proxy;
+        proxy.tag = std::string(kBalancedOutboundPrefix) + std::to_string(emitted);
+        proxy.server = &server;
+        spec.outbounds.push_back(proxy);
+        emitted++;
+    }
+    if (emitted == 0) {
+        return kUnsupported;
+    }
+
+    add_direct_and_block(spec);
+
+    BalancerSpec balancer;
+    balancer.tag = "proxy";
+    balancer.selectors.push_back(kBalancedOutboundPrefix);
+    balancer.fallback_tag = spec.outbounds.front().tag;
+    spec.balancers.push_back(balancer);
+
+    spec.observatory.selectors.push_back(kBalancedOutboundPrefix);
+
+    add_routing_rules(routing_dir, true, spec);
+
+    // Without this, unmatched traffic would pin to the first outbound
+    RuleSpec fallthrough;
+    fallthrough.balancer_tag = "proxy";
+    fallthrough.inbound_tags.push_back("socks-in");
+    spec.rules.push_back(fallthrough);
+
+    return kOk;
+}
+
+int emit_outbound_fragments(BatchArena& arena, int mux_concurrency) {
+    size_t record_bytes = 0;
+    for (const ServerRecord& server : arena.servers) {
+        for (std::string_view field : server.fields) record_bytes += field.size();
+    }
+    arena.data.reserve(record_bytes * kFragmentExpansion);
+    arena.ends.reserve(arena.servers.size());
+
+    OutboundSpec outbound;
+    outbound.tag = "proxy";
+    int emitted = 0;
+    for (const ServerRecord& server : arena.servers) {
+        if (usable(server)) {
+            outbound.server = &server;
+            outbound.mux.enabled = mux_concurrency > 0 && server.get(server_record::kFlow).empty();
+            outbound.mux.concurrency = mux_concurrency;
+            // A writer per fragment, so fragments are not comma-separated
+            JsonWriter fragment(arena.data);
+            json_proxy_outbound(fragment, outbound);
+            emitted++;
+        }
+        arena.ends.push_back(arena.data.size());
+        arena.data.push_back('\0');
+    }
+    return emitted;
+}
+
+Status build_batch(const std::vector<ServerRecord>& servers, int base_port, ConfigSpec& spec,
+                   int& emitted) {
+    emitted = 0;
+    if (base_port <= 0 || base_port + static_cast<int64_t>(servers.size()) > 65536) {
+        return kInvalidInput;
+    }
+
+    for (size_t i = 0; i < servers.size(); i++) {
+        if (!usable(servers[i])) continue;
+        std::string index = std::to_string(i);
+
+        InboundSpec inbound;
+        inbound.tag = kBatchInboundPrefix + index;
+        inbound.port = base_port + static_cast<int>(i);
+        inbound.udp = false;
+        spec.inbounds.push_back(inbound);
+
+        OutboundSpec proxy;
+        proxy.tag = kBatchOutboundPrefix + index;
+        proxy.server = &servers[i];
+        spec.outbounds.push_back(proxy);
+
+        RuleSpec rule;
+        rule.outbound_tag = proxy.tag;
+        rule.inbound_tags.push_back(inbound.tag);
+        spec.rules.push_back(std::move(rule));
+        emitted++;
+    }
+    if (emitted == 0) {
+        return kUnsupported;
+    }
+
+    // Traffic from no batch inbound has nowhere to go
+    OutboundSpec block;
+    block.tag = "block";
+    block.kind = OutboundSpec::kBlock;
+    spec.outbounds.insert(spec.outbounds.begin(), block);
+    return kOk;
+}
+
+void apply_mux(ConfigSpec& spec, int concurrency) {
+    if (concurrency <= 0) return;
+    for (OutboundSpec& outbound : spec.outbounds) {
+        if (outbound.kind != OutboundSpec::kProxy ||
+            !outbound.server->get(server_record::kFlow).empty()) {
+            continue;
+        }
+        outbound.mux.enabled = true;
+        outbound.mux.concurrency = concurrency;
+    }
+}
+
+void apply_socket_buffers(ConfigSpec& spec, int buffer_bytes) {
+    if (buffer_bytes <= 0) return;
+    for (OutboundSpec& outbound : spec.outbounds) {
+        if (outbound.kind != OutboundSpec::kProxy) continue;
+        outbound.sockopt.send_buffer = buffer_bytes;
+        outbound.sockopt.receive_buffer = buffer_bytes;
+    }
+}
+
+void apply_vmess_security(ConfigSpec& spec, std::string_view security) {
+    if (security.empty()) return;
+    for (OutboundSpec& outbound : spec.outbounds) {
+        if (outbound.kind != OutboundSpec::kProxy || protocol_of(*outbound.server) != "vmess") {
+            continue;
+        }
+        outbound.vmess_security = std::string(security);
+    }
+}
+
+Status emit(const ConfigSpec& spec, Format format, std::string& out) {
+    out.clear();
+    if (format == Format::kProtobuf) {
+        for (const OutboundSpec& outbound : spec.outbounds) {
+            if (outbound.kind == OutboundSpec::kProxy && network_of(*outbound.server) == "xhttp") {
+                return kUnsupported;
+            }
+        }
+        emit_pb(spec, out);
+    } else {
+        emit_json(spec, out);
+    }
+    return kOk;
+}
+
+Status write_file(const std::string& data, const std::string& path) {
+    std::string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        LOGE("Failed to open %s: %s", tmp.c_str(), strerror(errno));
+        return kIoError;
+    }
+
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOGE("Failed to write %s: %s", tmp.c_str(), strerror(errno));
+            close(fd);
+            unlink(tmp.c_str());
+            return kIoError;
+        }
+        written += static_cast<size_t>(n);
+    }
+    close(fd);
+
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        LOGE("Failed to rename %s: %s", tmp.c_str(), strerror(errno));
+        unlink(tmp.c_str());
+        return kIoError;
+    }
+    return kOk;
+}
+
+} // namespace config_builder
+
+namespace {
+
+std::string jstring_to_string(JNIEnv* env, jstring value) {
+    const char* chars = env->GetStringUTFChars(value, nullptr);
+    std::string result(chars);
+    env->ReleaseStringUTFChars(value, chars);
+    return result;
+}
+
+bool decode_records(JNIEnv* env, jobject records, jint length,
+                    std::vector<server_record::ServerRecord>& servers) {
+    auto* data = static_cast<const uint8_t*>(env->GetDirectBufferAddress(records));
+    if (data == nullptr || length <= 0) {
+        LOGE("Server records must be a direct ByteBuffer");
+        return false;
+    }
+    if (!server_record::decode(data, static_cast<size_t>(length), servers) || servers.empty()) {
+        LOGE("Malformed server record buffer");
+        return false;
+    }
+    return true;
+}
+
+// Batch generation reuses one arena; calls are serialized on it
+std::mutex g_arena_mutex;
+config_builder::BatchArena g_arena;
+
+config_builder::Status emit_to_file(const config_builder::ConfigSpec& spec, jint format,
+                                    const std::string& out_path) {
+    std::string out;
+    auto out_format = format == 1 ? config_builder::Format::kProtobuf : config_builder::Format::kJson;
+    config_builder::Status status = config_builder::emit(spec, out_format, out);
+    if (status != config_builder::kOk) {
+        return status;
+    }
+    LOGI("Generated %s config (%zu bytes, %zu outbounds, %zu rules)", format == 1 ? "pb" : "json",
+         out.size(), spec.outbounds.size(), spec.rules.size());
+    return config_builder::write_file(out, out_path);
+}
+
+} // namespace
+
+extern "C" {
+
+/**
+ * Generate the config for the first record in the buffer and write it
+ * to output_path in the requested format (0 = JSON, 1 = protobuf);
+ * mux_concurrency and buffer_size 0 leave mux disabled and buffers at
+ * the kernel default, an empty vmess_security keeps VMess at auto
+ * @return 0 on success, or a negative config_builder::Status
+ */
+JNIEXPORT jint JNICALL
+Java_com_hiddify_hiddifyng_core_XrayManager_writeNativeConfig(JNIEnv *env, jclass clazz,
+                                                            jobject records, jint length,
+                                                            jstring routing_dir, jint format,
+                                                            jint mux_concurrency,
+                                                            jint buffer_size,
+                                                            jstring vmess_security,
+                                                            jstring output_path) {
+    std::vector<server_record::ServerRecord> servers;
+    if (!decode_records(env, records, length, servers)) {
+        return config_builder::kInvalidInput;
+    }
+
+    config_builder::ConfigSpec spec;
+    config_builder::Status status = config_builder::build_default(
+            servers[0], jstring_to_string(env, routing_dir), spec);
+    if (status != config_builder::kOk) {
+        return status;
+    }
+    config_builder::apply_mux(spec, mux_concurrency);
+    config_builder::apply_socket_buffers(spec, buffer_size);
+    config_builder::apply_vmess_security(spec, jstring_to_string(env, vmess_security));
+
+    return emit_to_file(spec, format, jstring_to_string(env, output_path));
+}
+
+/**
+ * Generate a balanced failover config from the records (best first),
+ * keeping as many outbounds as memory_budget allows
+ * @return Number of balanced outbounds (> 0), or a negative config_builder::Status
+ */
+JNIEXPORT jint JNICALL
+Java_com_hiddify_hiddifyng_core_XrayManager_writeNativeBalancedConfig(JNIEnv *env, jclass clazz,
+                                                                    jobject records, jint length,
+                                                                    jstring routing_dir, jint format,
+                                                                    jlong memory_budget,
+                                                                    jint mux_concurrency,
+                                                                    jint buffer_size,
+                                                                    jstring vmess_security,
+                                                                    jstring output_path) {
+    std::vector<server_record::ServerRecord> servers;
+    if (!decode_records(env, records, length, servers)) {
+        return config_builder::kInvalidInput;
+    }
+
+    int max_outbounds = config_builder::balancer_size_for_budget(memory_budget);
+    int emitted = 0;
+    config_builder::ConfigSpec spec;
+    config_builder::Status status = config_builder::build_balanced(
+            servers, max_outbounds, jstring_to_string(env, routing_dir), spec, emitted);
+    if (status != config_builder::kOk) {
+        return status;
+    }
+    config_builder::apply_mux(spec, mux_concurrency);
+    config_builder::apply_socket_buffers(spec, buffer_size);
+    config_builder::apply_vmess_security(spec, jstring_to_string(env, vmess_security));
+
+    status = emit_to_file(spec, format, jstring_to_string(env, output_path));
+    return status == config_builder::kOk ? emitted : status;
+}
+
+/**
+ * Generate one JSON proxy outbound per record in a single pass over the
+ * batch arena; mux_concurrency 0 leaves mux disabled
+ * @return One outbound per record (null where the record was skipped),
+ *         or null when the buffer is malformed
+ */
+JNIEXPORT jobjectArray JNICALL
+Java_com_hiddify_hiddifyng_core_XrayManager_buildNativeOutbounds(JNIEnv *env, jclass clazz,
+                                                               jobject records, jint length,
+                                                               jint mux_concurrency) {
+    std::lock_guard<std::mutex> lock(g_arena_mutex);
+    g_arena.clear();
+    if (!decode_records(env, records, length, g_arena.servers)) {
+        return nullptr;
+    }
+    int emitted = config_builder::emit_outbound_fragments(g_arena, mux_concurrency);
+    LOGI("Generated %d/%zu outbounds (%zu bytes)", emitted, g_arena.servers.size(),
+         g_arena.data.size());
+
+    jclass string_class = env->FindClass("java/lang/String");
+    jobjectArray result = env->NewObjectArray(static_cast<jsize>(g_arena.servers.size()),
+                                              string_class, nullptr);
+    for (size_t i = 0; i < g_arena.servers.size(); i++) {
+        std::string_view fragment = g_arena.fragment(i);
+        if (fragment.empty()) continue;
+        jstring value = env->NewStringUTF(fragment.data());
+        env->SetObjectArrayElement(result, static_cast<jsize>(i), value);
+        env->DeleteLocalRef(value);
+    }
+    return result;
+}
+
+/**
+ * Generate a probing config with a SOCKS inbound per record on
+ * base_port + record index, each routed to its own server
+ * @return Number of outbounds (> 0), or a negative config_builder::Status
+ */
+JNIEXPORT jint JNICALL
+Java_com_hiddify_hiddifyng_core_XrayManager_writeNativeBatchConfig(JNIEnv *env, jclass clazz,
+                                                                 jobject records, jint length,
+                                                                 jint format, jint base_port,
+                                                                 jstring output_path) {
+    std::lock_guard<std::mutex> lock(g_arena_mutex);
+    g_arena.clear();
+    if (!decode_records(env, records, length, g_arena.servers)) {
+        return config_builder::kInvalidInput;
+    }
+
+    int emitted = 0;
+    config_builder::ConfigSpec spec;
+    config_builder::Status status = config_builder::build_batch(g_arena.servers, base_port, spec,
+                                                                emitted);
+    if (status != config_builder::kOk) {
+        return status;
+    }
+
+    status = emit_to_file(spec, format, jstring_to_string(env, output_path));
+    return status == config_builder::kOk ? emitted : status;
+}
+
+} // extern "C"
@@ -0,0 +1,413 @@
+#include <jni.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "config_builder.h"
+#include "config_minimizer.h"
+#include "config_validator.h"
+#include "json_reader.h"
+#include "json_writer.h"
+#include "native_log.h"
+
+namespace config_minimizer {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Parses per measurement; the fastest one is reported
+constexpr int kParseRounds = 5;
+
+// Rule members that name the target rather than a match condition
+const char* const kRuleTargetKeys[] = {"outboundTag", "balancerTag", "ruleTag", "type"};
+
+void write_value(const JsonValue& value, JsonWriter& w) {
+    switch (value.type()) {
+        case JsonValue::kNull: w.raw("null"); break;
+        case JsonValue::kBool: w.value(value.as_bool()); break;
+        case JsonValue::kNumber: w.value(value.as_number()); break;
+        case JsonValue::kString: w.value(value.as_string()); break;
+        case JsonValue::kArray:
+            w.begin_array();
+            for (const JsonValue& item : value.items()) write_value(item, w);
+            w.end_array();
+            break;
+        case JsonValue::kObject:
+            w.begin_object();
+            for (const JsonValue::Member& member : value.members()) {
+                w.key(member.first);
+                write_value(member.second, w);
+            }
+            w.end_object();
+            break;
+    }
+}
+
+std::string serialize(const JsonValue& value) {
+    std::string out;
+    JsonWriter w(out);
+    write_value(value, w);
+    return out;
+}
+
+int64_t time_parse(std::string_view json) {
+    int64_t best = 0;
+    for (int i = 0; i < kParseRounds; i++) {
+        JsonValue root;
+        std::string error;
+        Clock::time_point start = Clock::now();
+        JsonValue::parse(json, root, error);
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        if (i == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+bool is_target_key(const std::string& key) {
+    for (const char* target : kRuleTargetKeys) {
+        if (key == target) return true;
+    }
+    return false;
+}
+
+/** "tcp,udp" as a string or list */
+bool covers_all_networks(const JsonValue& network) {
+    std::string joined;
+    if (network.is_string()) {
+        joined = network.as_string();
+    } else if (network.is_array()) {
+        for (const JsonValue& item : network.items()) joined += item.as_string() + ",";
+    }
+    return joined.find("tcp") != std::string::npos && joined.find("udp") != std::string::npos;
+}
+
+/** A rule whose only conditions match every connection; later rules never run */
+bool matches_everything(const JsonValue& rule) {
+    bool has_condition = false;
+    for (const JsonValue::Member& member : rule.members()) {
+        if (is_target_key(member.first)) continue;
+        has_condition = true;
+        if (member.first == "network") {
+            if (!covers_all_networks(member.second)) return false;
+        } else if (member.first == "port") {
+            std::string_view port = member.second.is_string() ? member.second.as_string() : "";
+            if (port != "0-65535" && port != "1-65535") return false;
+        } else {
+            return false;
+        }
+    }
+    return has_condition;
+}
+
+/** Serialize a rule with duplicate entries dropped from its string lists */
+std::string write_rule(const JsonValue& rule, int& entries_removed) {
+    std::string out;
+    JsonWriter w(out);
+    w.begin_object();
+    for (const JsonValue::Member& member : rule.members()) {
+        w.key(member.first);
+        if (!member.second.is_array()) {
+            write_value(member.second, w);
+            continue;
+        }
+        std::unordered_set<std::string> seen;
+        w.begin_array();
+        for (const JsonValue& item : member.second.items()) {
+            if (item.is_string() && !seen.insert(item.as_string()).second) {
+                entries_removed++;
+                continue;
+            }
+            write_value(item, w);
+        }
+        w.end_array();
+    }
+    w.end_object();
+    return out;
+}
+
+class Minimizer {
+public:
+    Minimizer(const JsonValue& root, Report& report) : root_(root), report_(report) {}
+
+    void run(std::string& out) {
+        collect_rules();
+        collect_balancers();
+        collect_outbounds();
+        collect_dns_servers();
+
+        JsonWriter w(out);
+        w.begin_object();
+        for (const JsonValue::Member& member : root_.members()) {
+            const std::string& key = member.first;
+            if ((key == "observatory" || key == "burstObservatory") && kept_balancers_.empty()) {
+                report_.observatory_removed = true;
+                continue;
+            }
+            w.key(key);
+            if (key == "outbounds" && member.second.is_array()) {
+                write_kept(kept_outbound_items_, w);
+            } else if (key == "routing" && member.second.is_object()) {
+                write_routing(member.second, w);
+            } else if (key == "dns" && member.second.is_object()) {
+                write_dns(member.second, w);
+            } else {
+                write_value(member.second, w);
+            }
+        }
+        w.end_object();
+    }
+
+private:
+    void collect_rules() {
+        const JsonValue* routing = root_.find("routing");
+        const JsonValue* rules = routing != nullptr ? routing->find("rules") : nullptr;
+        if (rules == nullptr || !rules->is_array()) return;
+
+        std::unordered_set<std::string> seen;
+        bool shadowed = false;
+        for (const JsonValue& rule : rules->items()) {
+            if (shadowed || !rule.is_object()) {
+                report_.rules_removed++;
+                continue;
+            }
+            std::string written = write_rule(rule, report_.rule_entries_removed);
+            if (!seen.insert(written).second) {
+                report_.rules_removed++;
+                continue;
+            }
+            kept_rules_.push_back(std::move(written));
+
+            std::string_view outbound = rule.string_at("outboundTag");
+            std::string_view balancer = rule.string_at("balancerTag");
+            if (!outbound.empty()) referenced_tags_.emplace(outbound);
+            if (!balancer.empty()) referenced_balancers_.emplace(balancer);
+            shadowed = matches_everything(rule);
+        }
+    }
+
+    void collect_balancers() {
+        const JsonValue* routing = root_.find("routing");
+        const JsonValue* balancers = routing != nullptr ? routing->find("balancers") : nullptr;
+        if (balancers == nullptr || !balancers->is_array()) return;
+
+        for (const JsonValue& balancer : balancers->items()) {
+            if (referenced_balancers_.count(std::string(balancer.string_at("tag"))) == 0) {
+                report_.balancers_removed++;
+                continue;
+            }
+            kept_balancers_.push_back(&balancer);
+
+            const JsonValue* selector = balancer.find("selector");
+            if (selector != nullptr && selector->is_array()) {
+                for (const JsonValue& prefix : selector->items()) {
+                    if (prefix.is_string()) selector_prefixes_.push_back(prefix.as_string());
+                }
+            }
+            std::string_view fallback = balancer.string_at("fallbackTag");
+            if (!fallback.empty()) referenced_tags_.emplace(fallback);
+        }
+    }
+
+    bool outbound_referenced(size_t index, const JsonValue& outbound) const {
+        // The first outbound carries traffic no rule matched
+        if (index == 0) return true;
+        std::string tag(outbound.string_at("tag"));
+        if (tag.empty()) return false;
+        if (referenced_tags_.count(tag) > 0) return true;
+        for (const std::string& prefix : selector_prefixes_) {
+            if (tag.compare(0, prefix.size(), prefix) == 0) return true;
+        }
+        return false;
+    }
+
+    void collect_outbounds() {
+        const JsonValue* outbounds = root_.find("outbounds");
+        if (outbounds == nullptr || !outbounds->is_array()) return;
+        const std::vector<JsonValue>& items = outbounds->items();
+        std::vector<bool> kept(items.size(), false);
+
+        // Reverse proxies wire outbounds up by tag outside routing; leave them all
+        bool keep_all = root_.find("reverse") != nullptr;
+
+        // Kept outbounds can chain through others; repeat until the set is closed
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t i = 0; i < items.size(); i++) {
+                if (kept[i] || !(keep_all || outbound_referenced(i, items[i]))) continue;
+                kept[i] = true;
+                changed = true;
+
+                const JsonValue* proxy = items[i].find("proxySettings");
+                if (proxy != nullptr && !proxy->string_at("tag").empty()) {
+                    referenced_tags_.emplace(proxy->string_at("tag"));
+                }
+                const JsonValue* stream = items[i].find("streamSettings");
+                const JsonValue* sockopt = stream != nullptr ? stream->find("sockopt") : nullptr;
+                if (sockopt != nullptr && !sockopt->string_at("dialerProxy").empty()) {
+                    referenced_tags_.emplace(sockopt->string_at("dialerProxy"));
+                }
+            }
+        }
+
+        for (size_t i = 0; i < items.size(); i++) {
+            if (kept[i]) {
+                kept_outbound_items_.push_back(&items[i]);
+            } else {
+                report_.outbounds_removed++;
+            }
+        }
+    }
+
+    void collect_dns_servers() {
+        const JsonValue* dns = root_.find("dns");
+        const JsonValue* servers = dns != nullptr ? dns->find("servers") : nullptr;
+        if (servers == nullptr || !servers->is_array()) return;
+
+        std::unordered_set<std::string> seen;
+        for (const JsonValue& server : servers->items()) {
+            // Skipped by fallback and matching no domain: never queried
+            if (server.is_object()) {
+                const JsonValue* skip = server.find("skipFallback");
+                const JsonValue* domains = server.find("domains");
+                bool no_domains = domains == nullptr || !domains->is_array() || domains->items().empty();
+                if (skip != nullptr && skip->is_bool() && skip->as_bool() && no_domains) {
+                    report_.dns_servers_removed++;
+                    continue;
+                }
+            }
+            if (!seen.insert(serialize(server)).second) {
+                report_.dns_servers_removed++;
+                continue;
+            }
+            kept_dns_servers_.push_back(&server);
+        }
+    }
+
+    static void write_kept(const std::vector<const JsonValue*>& kept, JsonWriter& w) {
+        w.begin_array();
+        for (const JsonValue* item : kept) write_value(*item, w);
+        w.end_array();
+    }
+
+    void write_routing(const JsonValue& routing, JsonWriter& w) {
+        w.begin_object();
+        for (const JsonValue::Member& member : routing.members()) {
+            const std::string& key = member.first;
+            if (key == "balancers" && kept_balancers_.empty()) continue;
+            w.key(key);
+            if (key == "rules" && member.second.is_array()) {
+                w.begin_array();
+                for (const std::string& rule : kept_rules_) w.raw(rule);
+                w.end_array();
+            } else if (key == "balancers" && member.second.is_array()) {
+                write_kept(kept_balancers_, w);
+            } else {
+                write_value(member.second, w);
+            }
+        }
+        w.end_object();
+    }
+
+    void write_dns(const JsonValue& dns, JsonWriter& w) {
+        w.begin_object();
+        for (const JsonValue::Member& member : dns.members()) {
+            w.key(member.first);
+            if (member.first == "servers" && member.second.is_array()) {
+                write_kept(kept_dns_servers_, w);
+            } else {
+                write_value(member.second, w);
+            }
+        }
+        w.end_object();
+    }
+
+    const JsonValue& root_;
+    Report& report_;
+    std::vector<std::string> kept_rules_;
+    std::vector<const JsonValue*> kept_balancers_;
+    std::vector<const JsonValue*> kept_outbound_items_;
+    std::vector<const JsonValue*> kept_dns_servers_;
+    std::unordered_set<std::string> referenced_tags_;
+    std::unordered_set<std::string> referenced_balancers_;
+    std::vector<std::string> selector_prefixes_;
+};
+
+} // namespace
+
+bool minimize(std::string_view json, std::string& out, Report& report, std::string& error) {
+    out.clear();
+    report = Report();
+
+    JsonValue root;
+    if (!JsonValue::parse(json, root, error)) return false;
+    if (!root.is_object()) {
+        error = "config must be a JSON object";
+        return false;
+    }
+
+    Minimizer(root, report).run(out);
+
+    report.bytes_before = json.size();
+    report.bytes_after = out.size();
+    report.parse_ns_before = time_parse(json);
+    report.parse_ns_after = time_parse(out);
+    return true;
+}
+
+} // namespace config_minimizer
+
+extern "C" {
+
+/**
+ * Minimize a JSON config; output_path may equal input_path
+ * @return [bytes before, bytes after, parse ns before, parse ns after, outbounds,
+ *         balancers, rules, rule entries and DNS servers removed, observatory removed (0/1)],
+ *         or null when the input cannot be read, parsed or the output written
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_hiddify_hiddifyng_core_XrayManager_minimizeConfig(JNIEnv *env, jclass clazz,
+                                                         jstring input_path, jstring output_path) {
+    const char* input = env->GetStringUTFChars(input_path, nullptr);
+    const char* output = env->GetStringUTFChars(output_path, nullptr);
+
+    std::string json;
+    std::string minimized;
+    std::string error;
+    config_minimizer::Report report;
+    bool ok = false;
+    if (!config_validator::read_file(input, json)) {
+        LOGE("Failed to read %s: %s", input, strerror(errno));
+    } else if (!config_minimizer::minimize(json, minimized, report, error)) {
+        LOGE("Not minimizing %s: %s", input, error.c_str());
+    } else {
+        ok = config_builder::write_file(minimized, output) == config_builder::kOk;
+    }
+    env->ReleaseStringUTFChars(input_path, input);
+    env->ReleaseStringUTFChars(output_path, output);
+    if (!ok) return nullptr;
+
+    LOGI("Minimized config %zu -> %zu bytes: -%d outbounds, -%d balancers, -%d rules, "
+         "-%d rule entries, -%d DNS servers", report.bytes_before, report.bytes_after,
+         report.outbounds_removed, report.balancers_removed, report.rules_removed,
+         report.rule_entries_removed, report.dns_servers_removed);
+
+    jlong values[] = {
+            static_cast<jlong>(report.bytes_before), static_cast<jlong>(report.bytes_after),
+            report.parse_ns_before, report.parse_ns_after,
+            report.outbounds_removed, report.balancers_removed, report.rules_removed,
+            report.rule_entries_removed, report.dns_servers_removed,
+            report.observatory_removed ? 1 : 0,
+    };
+    jsize count = sizeof(values) / sizeof(values[0]);
+    jlongArray result = env->NewLongArray(count);
+    env->SetLongArrayRegion(result, 0, count, values);
+    return result;
+}
+
+} // extern "C"
@@ -0,0 +1,483 @@
+#include <jni.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+
+#include "config_validator.h"
+#include "json_reader.h"
+#include "native_log.h"
+#include "text_codec.h"
+
+using server_record::ServerRecord;
+
+namespace config_validator {
+
+namespace {
+
+// Longest custom (non-UUID) id the core accepts for VLESS/VMess
+constexpr size_t kMaxCustomIdLength = 30;
+constexpr size_t kRealityKeyLength = 32;
+constexpr size_t kMaxShortIdLength = 16;
+
+// Largest config we are willing to read for validation
+constexpr off_t kMaxConfigSize = 16 * 1024 * 1024;
+
+void add(std::vector<Issue>& issues, Code code, std::string path, std::string message) {
+    issues.push_back({code, std::move(path), std::move(message)});
+}
+
+std::string index_path(const std::string& base, const char* name, size_t index) {
+    return base + (base.empty() ? "" : ".") + name + "[" + std::to_string(index) + "]";
+}
+
+std::string member_path(const std::string& base, const char* name) {
+    return base + "." + name;
+}
+
+/** Port given as a JSON number, a numeric string or an "a-b" range string */
+bool check_port_value(const JsonValue* value, const std::string& path, bool allow_range,
+                      std::vector<Issue>& issues) {
+    if (value == nullptr) {
+        add(issues, kMissingField, path, "port is required");
+        return false;
+    }
+    if (value->is_number()) {
+        double port = value->as_number();
+        if (port != std::floor(port) || !is_valid_port(static_cast<long long>(port))) {
+            add(issues, kInvalidPort, path, "port must be an integer in 1-65535");
+            return false;
+        }
+        return true;
+    }
+    if (value->is_string()) {
+        std::string_view text = value->as_string();
+        size_t dash = allow_range ? text.find('-') : std::string_view::npos;
+        long long from;
+        long long to;
+        bool ok;
+        if (dash == std::string_view::npos) {
+            ok = text_codec::parse_int(text, from) && is_valid_port(from);
+        } else {
+            ok = text_codec::parse_int(text.substr(0, dash), from) &&
+                 text_codec::parse_int(text.substr(dash + 1), to) &&
+                 is_valid_port(from) && is_valid_port(to) && from <= to;
+        }
+        if (!ok) {
+            add(issues, kInvalidPort, path, "invalid port '" + value->as_string() + "'");
+        }
+        return ok;
+    }
+    add(issues, kInvalidPort, path, "port must be a number or string");
+    return false;
+}
+
+void check_address(const JsonValue& server, const std::string& path, std::vector<Issue>& issues) {
+    if (server.string_at("address").empty()) {
+        add(issues, kMissingField, member_path(path, "address"), "address is required");
+    }
+    check_port_value(server.find("port"), member_path(path, "port"), false, issues);
+}
+
+/** settings.vnext[] for VLESS/VMess */
+void check_vnext(const JsonValue& settings, const std::string& path, std::vector<Issue>& issues) {
+    const JsonValue* vnext = settings.find("vnext");
+    if (vnext == nullptr || !vnext->is_array() || vnext->items().empty()) {
+        add(issues, kMissingField, member_path(path, "vnext"), "at least one server is required");
+        return;
+    }
+    for (size_t i = 0; i < vnext->items().size(); i++) {
+        const JsonValue& server = vnext->items()[i];
+        std::string server_path = index_path(path, "vnext", i);
+        check_address(server, server_path, issues);
+
+        const JsonValue* users = server.find("users");
+        if (users == nullptr || !users->is_array() || users->items().empty()) {
+            add(issues, kMissingField, member_path(server_path, "users"),
+                "at least one user is required");
+            continue;
+        }
+        for (size_t u = 0; u < users->items().size(); u++) {
+            std::string_view id = users->items()[u].string_at("id");
+            if (!is_valid_user_id(id)) {
+                add(issues, kInvalidUserId, member_path(index_path(server_path, "users", u), "id"),
+                    id.empty() ? "user id is required" : "user id is not a UUID");
+            }
+        }
+    }
+}
+
+/** settings.servers[] for Trojan/Shadowsocks */
+void check_servers(const JsonValue& settings, const std::string& path, bool shadowsocks,
+                   std::vector<Issue>& issues) {
+    const JsonValue* servers = settings.find("servers");
+    if (servers == nullptr || !servers->is_array() || servers->items().empty()) {
+        add(issues, kMissingField, member_path(path, "servers"), "at least one server is required");
+        return;
+    }
+    for (size_t i = 0; i < servers->items().size(); i++) {
+        const JsonValue& server = servers->items()[i];
+        std::string server_path = index_path(path, "servers", i);
+        check_address(server, server_path, issues);
+        if (server.string_at("password").empty()) {
+            add(issues, kMissingField, member_path(server_path, "password"), "password is required");
+        }
+        if (shadowsocks && server.string_at("method").empty()) {
+            add(issues, kMissingField, member_path(server_path, "method"), "method is required");
+        }
+    }
+}
+
+void check_stream_settings(const JsonValue& stream, const std::string& path,
+                           std::vector<Issue>& issues) {
+    if (stream.string_at("security") != "reality") return;
+
+    const JsonValue* reality = stream.find("realitySettings");
+    std::string reality_path = member_path(path, "realitySettings");
+    if (reality == nullptr || !reality->is_object()) {
+        add(issues, kMissingField, reality_path, "realitySettings is required for REALITY");
+        return;
+    }
+    if (!is_valid_reality_public_key(reality->string_at("publicKey"))) {
+        add(issues, kInvalidRealityKey, member_path(reality_path, "publicKey"),
+            "publicKey must encode 32 bytes");
+    }
+    if (!is_valid_short_id(reality->string_at("shortId"))) {
+        add(issues, kInvalidShortId, member_path(reality_path, "shortId"),
+            "shortId must be up to 16 hex digits of even length");
+    }
+    if (reality->string_at("serverName").empty()) {
+        add(issues, kMissingField, member_path(reality_path, "serverName"),
+            "serverName is required for REALITY");
+    }
+}
+
+/**
+ * Collect tags of an array of objects, reporting duplicates
+ */
+void collect_tags(const JsonValue* list, const char* name, std::unordered_set<std::string>& tags,
+                  std::vector<Issue>& issues) {
+    if (list == nullptr || !list->is_array()) return;
+    for (size_t i = 0; i < list->items().size(); i++) {
+        std::string_view tag = list->items()[i].string_at("tag");
+        if (tag.empty()) continue;
+        if (!tags.emplace(tag).second) {
+            add(issues, kDuplicateTag, member_path(index_path("", name, i), "tag"),
+                "duplicate tag '" + std::string(tag) + "'");
+        }
+    }
+}
+
+void check_reference(const std::unordered_set<std::string>& tags, std::string_view tag,
+                     const std::string& path, const char* kind, std::vector<Issue>& issues) {
+    if (tags.count(std::string(tag)) == 0) {
+        add(issues, kDanglingReference, path,
+            std::string("unknown ") + kind + " '" + std::string(tag) + "'");
+    }
+}
+
+/** Selector arrays match by tag prefix; each must match at least one outbound */
+void check_selectors(const JsonValue* selectors, const std::unordered_set<std::string>& outbound_tags,
+                     const std::string& path, std::vector<Issue>& issues) {
+    if (selectors == nullptr || !selectors->is_array() || selectors->items().empty()) {
+        add(issues, kMissingField, path, "selector is required");
+        return;
+    }
+    for (size_t i = 0; i < selectors->items().size(); i++) {
+        const std::string& prefix = selectors->items()[i].as_string();
+        bool matched = false;
+        for (const std::string& tag : outbound_tags) {
+            if (tag.compare(0, prefix.size(), prefix) == 0) {
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) {
+            add(issues, kDanglingReference, path + "[" + std::to_string(i) + "]",
+                "selector '" + prefix + "' matches no outbound");
+        }
+    }
+}
+
+void check_inbounds(const JsonValue& root, std::vector<Issue>& issues) {
+    const JsonValue* inbounds = root.find("inbounds");
+    if (inbounds == nullptr || !inbounds->is_array()) return;
+    for (size_t i = 0; i < inbounds->items().size(); i++) {
+        const JsonValue& inbound = inbounds->items()[i];
+        std::string path = index_path("", "inbounds", i);
+        if (inbound.string_at("protocol").empty()) {
+            add(issues, kMissingField, member_path(path, "protocol"), "protocol is required");
+        }
+        check_port_value(inbound.find("port"), member_path(path, "port"), true, issues);
+    }
+}
+
+void check_outbounds(const JsonValue& root, const std::unordered_set<std::string>& outbound_tags,
+                     std::vector<Issue>& issues) {
+    const JsonValue* outbounds = root.find("outbounds");
+    if (outbounds == nullptr || !outbounds->is_array() || outbounds->items().empty()) {
+        add(issues, kMissingField, "outbounds", "at least one outbound is required");
+        return;
+    }
+    for (size_t i = 0; i < outbounds->items().size(); i++) {
+        const JsonValue& outbound = outbounds->items()[i];
+        std::string path = index_path("", "outbounds", i);
+        std::string_view protocol = outbound.string_at("protocol");
+        if (protocol.empty()) {
+            add(issues, kMissingField, member_path(path, "protocol"), "protocol is required");
+            continue;
+        }
+
+        const JsonValue* settings = outbound.find("settings");
+        std::string settings_path = member_path(path, "settings");
+        bool needs_settings = protocol == "vless" || protocol == "vmess" ||
+                              protocol == "trojan" || protocol == "shadowsocks";
+        if (needs_settings && (settings == nullptr || !settings->is_object())) {
+            add(issues, kMissingField, settings_path, "settings is required");
+        } else if (protocol == "vless" || protocol == "vmess") {
+            check_vnext(*settings, settings_path, issues);
+        } else if (protocol == "trojan" || protocol == "shadowsocks") {
+            check_servers(*settings, settings_path, protocol == "shadowsocks", issues);
+        }
+
+        const JsonValue* stream = outbound.find("streamSettings");
+        if (stream != nullptr && stream->is_object()) {
+            check_stream_settings(*stream, member_path(path, "streamSettings"), issues);
+        }
+
+        const JsonValue* proxy_settings = outbound.find("proxySettings");
+        if (proxy_settings != nullptr && !proxy_settings->string_at("tag").empty()) {
+            check_reference(outbound_tags, proxy_settings->string_at("tag"),
+                            member_path(path, "proxySettings.tag"), "outbound", issues);
+        }
+    }
+}
+
+void check_routing(const JsonValue& root, const std::unordered_set<std::string>& inbound_tags,
+                   const std::unordered_set<std::string>& outbound_tags, std::vector<Issue>& issues) {
+    const JsonValue* routing = root.find("routing");
+    if (routing == nullptr || !routing->is_object()) return;
+
+    std::unordered_set<std::string> balancer_tags;
+    const JsonValue* balancers = routing->find("balancers");
+    if (balancers != nullptr && balancers->is_array()) {
+        for (size_t i = 0; i < balancers->items().size(); i++) {
+            const JsonValue& balancer = balancers->items()[i];
+            std::string path = index_path("routing", "balancers", i);
+            std::string_view tag = balancer.string_at("tag");
+            if (tag.empty()) {
+                add(issues, kMissingField, member_path(path, "tag"), "balancer tag is required");
+            } else if (!balancer_tags.emplace(tag).second) {
+                add(issues, kDuplicateTag, member_path(path, "tag"),
+                    "duplicate balancer tag '" + std::string(tag) + "'");
+            }
+            check_selectors(balancer.find("selector"), outbound_tags, member_path(path, "selector"),
+                            issues);
+            if (!balancer.string_at("fallbackTag").empty()) {
+                check_reference(outbound_tags, balancer.string_at("fallbackTag"),
+                                member_path(path, "fallbackTag"), "outbound", issues);
+            }
+        }
+    }
+
+    const JsonValue* rules = routing->find("rules");
+    if (rules == nullptr || !rules->is_array()) return;
+    for (size_t i = 0; i < rules->items().size(); i++) {
+        const JsonValue& rule = rules->items()[i];
+        std::string path = index_path("routing", "rules", i);
+        std::string_view outbound_tag = rule.string_at("outboundTag");
+        std::string_view balancer_tag = rule.string_at("balancerTag");
+
+        if (!outbound_tag.empty()) {
+            check_reference(outbound_tags, outbound_tag, member_path(path, "outboundTag"),
+                            "outbound", issues);
+        } else if (!balancer_tag.empty()) {
+            check_reference(balancer_tags, balancer_tag, member_path(path, "balancerTag"),
+                            "balancer", issues);
+        } else {
+            add(issues, kMissingField, path, "rule needs outboundTag or balancerTag");
+        }
+
+        const JsonValue* inbound_refs = rule.find("inboundTag");
+        if (inbound_refs != nullptr && inbound_refs->is_array()) {
+            for (size_t t = 0; t < inbound_refs->items().size(); t++) {
+                check_reference(inbound_tags, inbound_refs->items()[t].as_string(),
+                                index_path(path, "inboundTag", t), "inbound", issues);
+            }
+        }
+    }
+}
+
+} // namespace
+
+bool read_file(const char* path, std::string& out) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size > kMaxConfigSize) {
+        close(fd);
+        return false;
+    }
+    out.resize(static_cast<size_t>(st.st_size));
+
+    size_t done = 0;
+    while (done < out.size()) {
+        ssize_t n = read(fd, &out[done], out.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += static_cast<size_t>(n);
+    }
+    close(fd);
+    out.resize(done);
+    return true;
+}
+
+bool is_valid_user_id(std::string_view id) {
+    if (id.size() == 36) {
+        for (size_t i = 0; i < id.size(); i++) {
+            bool dash = i == 8 || i == 13 || i == 18 || i == 23;
+            if (dash ? id[i] != '-' : text_codec::hex_value(id[i]) < 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+    // Anything else the core hashes into a UUID, but only up to 30 bytes
+    return !id.empty() && id.size() <= kMaxCustomIdLength;
+}
+
+bool is_valid_reality_public_key(std::string_view key) {
+    std::string decoded;
+    return !key.empty() && text_codec::base64_decode(key, decoded) &&
+           decoded.size() == kRealityKeyLength;
+}
+
+bool is_valid_short_id(std::string_view short_id) {
+    std::string decoded;
+    return short_id.size() <= kMaxShortIdLength && short_id.size() % 2 == 0 &&
+           text_codec::hex_decode(short_id, decoded);
+}
+
+bool is_valid_port(long long port) {
+    return port >= 1 && port <= 65535;
+}
+
+void validate_server(const ServerRecord& server, const std::string& path, std::vector<Issue>& issues) {
+    std::string_view protocol = server.get(server_record::kProtocol);
+    if (protocol.empty()) {
+        add(issues, kMissingField, path + ".protocol", "protocol is required");
+    }
+    if (server.get(server_record::kAddress).empty()) {
+        add(issues, kMissingField, path + ".address", "address is required");
+    }
+    if (!is_valid_port(server.port)) {
+        add(issues, kInvalidPort, path + ".port", "port must be in 1-65535");
+    }
+
+    bool reality = protocol == "reality" || server.get(server_record::kSecurityType) == "reality";
+    if (protocol == "vless" || protocol == "vmess" || protocol == "reality" ||
+        protocol == "xhttp") {
+        if (!is_valid_user_id(server.get(server_record::kUserId))) {
+            add(issues, kInvalidUserId, path + ".userId", "user id is not a UUID");
+        }
+    } else if (protocol == "trojan" || protocol == "shadowsocks") {
+        if (server.get(server_record::kPassword).empty()) {
+            add(issues, kMissingField, path + ".password", "password is required");
+        }
+    }
+
+    if (reality) {
+        if (!is_valid_reality_public_key(server.get(server_record::kRealityPublicKey))) {
+            add(issues, kInvalidRealityKey, path + ".realityPublicKey",
+                "publicKey must encode 32 bytes");
+        }
+        if (!is_valid_short_id(server.get(server_record::kRealityShortId))) {
+            add(issues, kInvalidShortId, path + ".realityShortId",
+                "shortId must be up to 16 hex digits of even length");
+        }
+        if (server.get(server_record::kTlsServerName).empty()) {
+            add(issues, kMissingField, path + ".tlsServerName", "serverName is required for REALITY");
+        }
+    }
+}
+
+void validate_json(std::string_view json, std::vector<Issue>& issues) {
+    JsonValue root;
+    std::string error;
+    if (!JsonValue::parse(json, root, error)) {
+        add(issues, kSyntax, "", error);
+        return;
+    }
+    if (!root.is_object()) {
+        add(issues, kSyntax, "", "config must be a JSON object");
+        return;
+    }
+
+    std::unordered_set<std::string> inbound_tags;
+    std::unordered_set<std::string> outbound_tags;
+    collect_tags(root.find("inbounds"), "inbounds", inbound_tags, issues);
+    collect_tags(root.find("outbounds"), "outbounds", outbound_tags, issues);
+
+    check_inbounds(root, issues);
+    check_outbounds(root, outbound_tags, issues);
+    check_routing(root, inbound_tags, outbound_tags, issues);
+
+    const JsonValue* observatory = root.find("observatory");
+    if (observatory != nullptr && observatory->is_object()) {
+        check_selectors(observatory->find("subjectSelector"), outbound_tags,
+                        "observatory.subjectSelector", issues);
+    }
+}
+
+} // namespace config_validator
+
+extern "C" {
+
+/**
+ * Validate a JSON config file before launching the core
+ * @return Flattened (code, path, message) triples; empty when the config is valid
+ */
+JNIEXPORT jobjectArray JNICALL
+Java_com_hiddify_hiddifyng_core_XrayManager_validateConfig(JNIEnv *env, jclass clazz,
+                                                         jstring config_path) {
+    const char* path = env->GetStringUTFChars(config_path, nullptr);
+
+    std::vector<config_validator::Issue> issues;
+    std::string json;
+    if (config_validator::read_file(path, json)) {
+        config_validator::validate_json(json, issues);
+    } else {
+        issues.push_back({config_validator::kUnreadable, "", strerror(errno)});
+    }
+    env->ReleaseStringUTFChars(config_path, path);
+
+    if (!issues.empty()) {
+        LOGW("Config validation found %zu issues, first: %s %s", issues.size(),
+             issues[0].path.c_str(), issues[0].message.c_str());
+    }
+
+    jclass string_class = env->FindClass("java/lang/String");
+    jobjectArray result = env->NewObjectArray(static_cast<jsize>(issues.size() * 3), string_class,
+                                              nullptr);
+    for (size_t i = 0; i < issues.size(); i++) {
+        const config_validator::Issue& issue = issues[i];
+        jstring fields[] = {
+                env->NewStringUTF(std::to_string(issue.code).c_str()),
+                env->NewStringUTF(issue.path.c_str()),
+                env->NewStringUTF(issue.message.c_str()),
+        };
+        for (int f = 0; f < 3; f++) {
+            env->SetObjectArrayElement(result, static_cast<jsize>(i * 3 + f), fields[f]);
+            env->DeleteLocalRef(fields[f]);
+        }
+    }
+    return result;
+}
+
+} // extern "C"
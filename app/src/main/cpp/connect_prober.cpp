@@ -0,0 +1,532 @@
+#include <jni.h>
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <queue>
+
+#include "connect_prober.h"
+#include "dns_resolver.h"
+#include "native_log.h"
+
+namespace connect_prober {
+
+namespace {
+
+using dns_resolver::Address;
+
+constexpr int kMaxEvents = 128;
+constexpr int kMaxInFlight = 1024;   // stays well under the per-process fd limit
+constexpr uint64_t kWakeTag = ~0ull; // epoll data of the resolver eventfd
+constexpr int kSlotBits = 4;         // epoll data: probe id << kSlotBits | address slot
+constexpr size_t kMaxSlots = 1u << kSlotBits;
+
+int64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Answers handed over from the resolver thread; shared with it, so a sweep
+ * that stops early never waits on a slow lookup
+ */
+struct Resolved {
+    std::vector<size_t> targets;  // target index of each host passed to the resolver
+    int wake_fd = -1;
+
+    std::mutex mutex;
+    std::vector<std::pair<size_t, dns_resolver::Answer>> answers;
+
+    ~Resolved() {
+        if (wake_fd >= 0) close(wake_fd);
+    }
+};
+
+/** One connect of a sample's race */
+struct Attempt {
+    int fd = -1;
+    int64_t started_ns = 0;
+};
+
+struct Probe {
+    size_t index = 0;
+    std::vector<Address> addresses;  // race order; a winner moves to the front
+    std::vector<Attempt> racing;     // parallel to addresses
+    size_t next_address = 0;         // next one the current sample may start
+    int open = 0;                    // connects of the current sample in flight
+    bool active = false;
+    uint32_t generation = 0;  // bumped per sample so stale deadlines are ignored
+    int attempts = 0;
+    int successes = 0;
+    int64_t best_ns = 0;
+    int64_t total_ns = 0;
+    std::vector<int64_t> samples_ns;
+    Status failure = kTimeout;
+    Status sample_failure = kTimeout;
+};
+
+enum class Timer { kSample, kNextAddress };
+
+struct Deadline {
+    int64_t at_ns;
+    size_t probe;
+    uint32_t generation;
+    Timer timer;
+    size_t next_address;  // kNextAddress: stale once that address has started
+    bool operator>(const Deadline& other) const { return at_ns > other.at_ns; }
+};
+
+Status status_of(int error) {
+    switch (error) {
+        case ECONNREFUSED:
+            return kRefused;
+        case ENETUNREACH:
+        case EHOSTUNREACH:
+        case EADDRNOTAVAIL:
+        case EAFNOSUPPORT:
+            return kUnreachable;
+        case ETIMEDOUT:
+            return kTimeout;
+        default:
+            return kError;
+    }
+}
+
+class Sweep {
+public:
+    Sweep(const std::vector<Target>& targets, const Options& options, const Sink& sink)
+        : targets_(targets), options_(options), sink_(sink) {
+        options_.samples = std::max(1, options_.samples);
+        options_.timeout_ms = std::max(1, options_.timeout_ms);
+        options_.max_in_flight = std::clamp(options_.max_in_flight, 1, kMaxInFlight);
+        options_.attempt_delay_ms = std::clamp(options_.attempt_delay_ms, 10, options_.timeout_ms);
+    }
+
+    ~Sweep() {
+        for (Probe& probe : probes_) {
+            for (Attempt& attempt : probe.racing) {
+                if (attempt.fd >= 0) close(attempt.fd);
+            }
+        }
+        if (lookup_) lookup_->cancel();
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+    }
+
+    size_t run() {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            LOGE("epoll_create1 failed: %s", strerror(errno));
+            return 0;
+        }
+        probes_.reserve(targets_.size());
+        start_resolution();
+
+        epoll_event events[kMaxEvents];
+        while (!stopped_ && delivered_ < targets_.size()) {
+            drain_resolved();
+            launch();
+            flush();
+            if (stopped_ || delivered_ == targets_.size()) break;
+
+            int n = epoll_wait(epoll_fd_, events, kMaxEvents, wait_ms());
+            int64_t now = now_ns();
+            if (n < 0 && errno != EINTR) {
+                LOGE("epoll_wait failed: %s", strerror(errno));
+                break;
+            }
+            for (int i = 0; i < n; i++) {
+                if (events[i].data.u64 == kWakeTag) {
+                    uint64_t count;
+                    ssize_t ignored = read(resolved_->wake_fd, &count, sizeof(count));
+                    (void) ignored;
+                    continue;
+                }
+                complete(events[i].data.u64, now);
+            }
+            expire(now);
+        }
+        flush();
+        return delivered_;
+    }
+
+private:
+    void start_resolution() {
+        std::vector<std::string> hosts;
+        auto resolved = std::make_shared<Resolved>();
+        for (size_t i = 0; i < targets_.size(); i++) {
+            if (targets_[i].port <= 0 || targets_[i].port > 65535) {
+                report_failure(i, kError);
+            } else {
+                hosts.push_back(targets_[i].host);
+                resolved->targets.push_back(i);
+            }
+        }
+        if (hosts.empty()) return;
+
+        resolved->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = kWakeTag;
+        if (resolved->wake_fd < 0 ||
+            epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, resolved->wake_fd, &event) < 0) {
+            LOGE("Cannot watch resolver: %s", strerror(errno));
+            for (size_t index : resolved->targets) report_failure(index, kResolveFailed);
+            return;
+        }
+
+        resolved_ = resolved;
+        lookup_ = dns_resolver::resolve_async(
+                hosts, dns_resolver::Options(),
+                [resolved](size_t host, const dns_resolver::Answer& answer) {
+                    {
+                        std::lock_guard<std::mutex> lock(resolved->mutex);
+                        resolved->answers.emplace_back(resolved->targets[host], answer);
+                    }
+                    uint64_t one = 1;
+                    ssize_t ignored = write(resolved->wake_fd, &one, sizeof(one));
+                    (void) ignored;
+                });
+    }
+
+    void drain_resolved() {
+        if (!resolved_) return;
+        std::vector<std::pair<size_t, dns_resolver::Answer>> batch;
+        {
+            std::lock_guard<std::mutex> lock(resolved_->mutex);
+            batch.swap(resolved_->answers);
+        }
+        for (auto& [index, answer] : batch) {
+            if (answer.status != dns_resolver::kOk || answer.addresses.empty()) {
+                report_failure(index, kResolveFailed);
+            } else {
+                add_probe(index, answer.addresses);
+            }
+        }
+    }
+
+    void add_probe(size_t index, std::vector<Address> addresses) {
+        if (addresses.size() > kMaxSlots) addresses.resize(kMaxSlots);
+        for (Address& address : addresses) address.set_port(targets_[index].port);
+        Probe probe;
+        probe.index = index;
+        probe.racing.resize(addresses.size());
+        probe.addresses = std::move(addresses);
+        probes_.push_back(std::move(probe));
+        ready_.push_back(probes_.size() - 1);
+    }
+
+    /** Start samples while sockets are available */
+    void launch() {
+        while (!stopped_ && in_flight_ < options_.max_in_flight && !ready_.empty()) {
+            size_t id = ready_.front();
+            ready_.pop_front();
+            Probe& probe = probes_[id];
+            probe.generation++;
+            probe.active = true;
+            probe.next_address = 0;
+            probe.sample_failure = kTimeout;
+            int64_t now = now_ns();
+            if (!start_attempt(id, now)) {
+                // Out of descriptors: run at the level that fit
+                probe.active = false;
+                options_.max_in_flight = in_flight_;
+                ready_.push_front(id);
+                LOGW("Descriptor limit hit, probing %d at a time", in_flight_);
+                return;
+            }
+            if (probe.active) {
+                deadlines_.push({now + options_.timeout_ms * 1000000ll, id, probe.generation,
+                                 Timer::kSample, 0});
+            }
+        }
+    }
+
+    /**
+     * Connect to the sample's next address (RFC 8305 section 5): it races the
+     * ones already in flight, and the one after it starts attempt_delay_ms
+     * later or as soon as a connect fails, whichever comes first
+     * @return false if out of descriptors before the sample's first connect
+     */
+    bool start_attempt(size_t id, int64_t now) {
+        Probe& probe = probes_[id];
+        while (probe.next_address < probe.addresses.size()) {
+            size_t slot = probe.next_address++;
+            const Address& address = probe.addresses[slot];
+            int fd = socket(address.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) {
+                if ((errno == EMFILE || errno == ENFILE) && slot == 0 && in_flight_ > 0) {
+                    return false;
+                }
+                probe.sample_failure = status_of(errno);
+                continue;
+            }
+            // Reset instead of FIN on close: no TIME_WAIT per sample
+            linger reset{1, 0};
+            setsockopt(fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+
+            Attempt& attempt = probe.racing[slot];
+            attempt.started_ns = now_ns();
+            int rc = connect(fd, reinterpret_cast<const sockaddr*>(&address.storage), address.length);
+            if (rc == 0) {
+                int64_t elapsed = now_ns() - attempt.started_ns;
+                close(fd);
+                win(id, slot, elapsed);
+                return true;
+            }
+            epoll_event event{};
+            event.events = EPOLLOUT;
+            event.data.u64 = static_cast<uint64_t>(id) << kSlotBits | slot;
+            if (errno != EINPROGRESS || epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+                probe.sample_failure = status_of(errno);
+                close(fd);
+                continue;
+            }
+            attempt.fd = fd;
+            probe.open++;
+            in_flight_++;
+            if (probe.next_address < probe.addresses.size()) {
+                deadlines_.push({now + options_.attempt_delay_ms * 1000000ll, id, probe.generation,
+                                 Timer::kNextAddress, probe.next_address});
+            }
+            return true;
+        }
+        if (probe.open == 0) finish_sample(id, false, probe.sample_failure, 0);
+        return true;
+    }
+
+    void complete(uint64_t tag, int64_t now) {
+        size_t id = static_cast<size_t>(tag >> kSlotBits);
+        size_t slot = static_cast<size_t>(tag & (kMaxSlots - 1));
+        Probe& probe = probes_[id];
+        if (slot >= probe.racing.size() || probe.racing[slot].fd < 0) return;
+
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(probe.racing[slot].fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        close_attempt(probe, slot);
+        if (error == 0) {
+            win(id, slot, now - probe.racing[slot].started_ns);
+            return;
+        }
+        probe.sample_failure = status_of(error);
+        if (probe.next_address < probe.addresses.size()) {
+            start_attempt(id, now);
+        } else if (probe.open == 0) {
+            finish_sample(id, false, probe.sample_failure, 0);
+        }
+    }
+
+    /** A connect won the race: drop the others and try its address first from now on */
+    void win(size_t id, size_t slot, int64_t elapsed_ns) {
+        Probe& probe = probes_[id];
+        for (size_t i = 0; i < probe.racing.size(); i++) {
+            if (probe.racing[i].fd >= 0) close_attempt(probe, i);
+        }
+        if (slot > 0) {
+            std::rotate(probe.addresses.begin(), probe.addresses.begin() + static_cast<ptrdiff_t>(slot),
+                        probe.addresses.begin() + static_cast<ptrdiff_t>(slot) + 1);
+        }
+        finish_sample(id, true, kOk, elapsed_ns);
+    }
+
+    void expire(int64_t now) {
+        while (!deadlines_.empty() && deadlines_.top().at_ns <= now) {
+            Deadline deadline = deadlines_.top();
+            deadlines_.pop();
+            Probe& probe = probes_[deadline.probe];
+            if (!probe.active || probe.generation != deadline.generation) continue;
+            if (deadline.timer == Timer::kNextAddress) {
+                if (probe.next_address == deadline.next_address) start_attempt(deadline.probe, now);
+                continue;
+            }
+            for (size_t i = 0; i < probe.racing.size(); i++) {
+                if (probe.racing[i].fd >= 0) close_attempt(probe, i);
+            }
+            finish_sample(deadline.probe, false, kTimeout, 0);
+        }
+    }
+
+    void close_attempt(Probe& probe, size_t slot) {
+        close(probe.racing[slot].fd);  // also removes it from the epoll set
+        probe.racing[slot].fd = -1;
+        probe.open--;
+        in_flight_--;
+    }
+
+    void finish_sample(size_t id, bool ok, Status status, int64_t elapsed_ns) {
+        Probe& probe = probes_[id];
+        probe.active = false;
+        probe.attempts++;
+        if (ok) {
+            probe.successes++;
+            probe.total_ns += elapsed_ns;
+            probe.samples_ns.push_back(elapsed_ns);
+            if (probe.best_ns == 0 || elapsed_ns < probe.best_ns) probe.best_ns = elapsed_ns;
+        } else {
+            probe.failure = status;
+        }
+
+        // A refusal or missing route will not change on the next sample
+        bool definitive = !ok && status != kTimeout && probe.successes == 0;
+        if (probe.attempts < options_.samples && !definitive) {
+            ready_.push_back(id);
+            return;
+        }
+
+        Result result;
+        result.index = probe.index;
+        result.status = probe.successes > 0 ? kOk : probe.failure;
+        result.best_ns = probe.best_ns;
+        result.mean_ns = probe.successes > 0 ? probe.total_ns / probe.successes : 0;
+        result.successes = probe.successes;
+        result.attempts = probe.attempts;
+        result.samples_ns = std::move(probe.samples_ns);
+        deliver(result);
+    }
+
+    void report_failure(size_t index, Status status) {
+        Result result;
+        result.index = index;
+        result.status = status;
+        deliver(result);
+    }
+
+    void deliver(const Result& result) {
+        finished_.push_back(result);
+    }
+
+    void flush() {
+        if (finished_.empty() || stopped_) return;
+        delivered_ += finished_.size();
+        if (!sink_(finished_)) stopped_ = true;
+        finished_.clear();
+    }
+
+    /** Sleep until the nearest deadline; block for resolver wakeups when idle */
+    int wait_ms() const {
+        if (!ready_.empty() && in_flight_ < options_.max_in_flight) return 0;
+        if (deadlines_.empty()) return -1;
+        int64_t remaining = deadlines_.top().at_ns - now_ns();
+        return remaining <= 0 ? 0 : static_cast<int>((remaining + 999999) / 1000000);
+    }
+
+    const std::vector<Target>& targets_;
+    Options options_;
+    const Sink& sink_;
+
+    int epoll_fd_ = -1;
+    std::shared_ptr<Resolved> resolved_;
+    std::shared_ptr<dns_resolver::Lookup> lookup_;
+    std::vector<Probe> probes_;
+    std::vector<Result> finished_;  // reported at the end of the loop iteration
+    std::deque<size_t> ready_;
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> deadlines_;
+    int in_flight_ = 0;
+    size_t delivered_ = 0;
+    bool stopped_ = false;
+};
+
+} // namespace
+
+size_t run(const std::vector<Target>& targets, const Options& options, const Sink& sink) {
+    if (targets.empty()) return 0;
+    Sweep sweep(targets, options, sink);
+    return sweep.run();
+}
+
+} // namespace connect_prober
+
+namespace {
+
+// Leading longs per result: index, status, best ns, mean ns, successes, attempts;
+// one column per requested sample follows
+constexpr size_t kResultStride = 6;
+
+} // namespace
+
+extern "C" {
+
+/**
+ * Probe host:port pairs, streaming results to sink.onResults(long[]) as they
+ * finish; each row is kResultStride longs and then max(1, samples) connect
+ * times, completed ones first and 0 for the rest. onResults returning false
+ * stops the sweep
+ * @return Number of targets reported
+ */
+JNIEXPORT jint JNICALL
+Java_com_hiddify_hiddifyng_utils_PingUtils_probeTcpNative(JNIEnv *env, jclass clazz,
+                                                          jobjectArray hosts, jintArray ports,
+                                                          jint samples, jint timeout_ms,
+                                                          jint max_in_flight, jobject sink) {
+    jsize count = env->GetArrayLength(hosts);
+    if (env->GetArrayLength(ports) < count) return 0;
+
+    jmethodID on_results = env->GetMethodID(env->GetObjectClass(sink), "onResults", "([J)Z");
+    if (on_results == nullptr) {
+        LOGE("Probe sink has no onResults(long[])");
+        return 0;
+    }
+
+    std::vector<jint> port_values(static_cast<size_t>(count));
+    env->GetIntArrayRegion(ports, 0, count, port_values.data());
+    std::vector<connect_prober::Target> targets(static_cast<size_t>(count));
+    for (jsize i = 0; i < count; i++) {
+        auto host = static_cast<jstring>(env->GetObjectArrayElement(hosts, i));
+        if (host != nullptr) {
+            const char* chars = env->GetStringUTFChars(host, nullptr);
+            targets[i].host = chars;
+            env->ReleaseStringUTFChars(host, chars);
+            env->DeleteLocalRef(host);
+        }
+        targets[i].port = port_values[i];
+    }
+
+    connect_prober::Options options;
+    options.samples = samples;
+    options.timeout_ms = timeout_ms;
+    options.max_in_flight = max_in_flight;
+
+    size_t stride = kResultStride + static_cast<size_t>(std::max(1, static_cast<int>(samples)));
+    std::vector<jlong> rows;
+    auto started = std::chrono::steady_clock::now();
+    size_t reported = connect_prober::run(
+            targets, options, [&](const std::vector<connect_prober::Result>& results) {
+                rows.clear();
+                for (const connect_prober::Result& result : results) {
+                    jlong row[kResultStride] = {static_cast<jlong>(result.index), result.status,
+                                                result.best_ns, result.mean_ns,
+                                                result.successes, result.attempts};
+                    rows.insert(rows.end(), row, row + kResultStride);
+                    size_t filled = rows.size();
+                    rows.resize(filled + stride - kResultStride, 0);
+                    std::copy(result.samples_ns.begin(), result.samples_ns.end(),
+                              rows.begin() + static_cast<ptrdiff_t>(filled));
+                }
+                auto size = static_cast<jsize>(rows.size());
+                jlongArray batch = env->NewLongArray(size);
+                if (batch == nullptr) return false;
+                env->SetLongArrayRegion(batch, 0, size, rows.data());
+                bool keep_going = env->CallBooleanMethod(sink, on_results, batch) == JNI_TRUE;
+                env->DeleteLocalRef(batch);
+                // A throwing sink stops the sweep; the exception surfaces on return
+                return keep_going && !env->ExceptionCheck();
+            });
+
+    auto elapsed = std::chrono::steady_clock::now() - started;
+    LOGI("TCP probe: %zu/%d targets in %lld ms", reported, count,
+         static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()));
+    return static_cast<jint>(reported);
+}
+
+} // extern "C"
@@ -0,0 +1,875 @@
+#include <jni.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#include "dns_resolver.h"
+#include "native_log.h"
+
+namespace dns_resolver {
+
+void Address::set_port(int port) {
+    auto value = htons(static_cast<uint16_t>(port));
+    if (family() == AF_INET) {
+        reinterpret_cast<sockaddr_in*>(&storage)->sin_port = value;
+    } else if (family() == AF_INET6) {
+        reinterpret_cast<sockaddr_in6*>(&storage)->sin6_port = value;
+    }
+}
+
+namespace {
+
+constexpr int kMaxEvents = 64;
+constexpr int kMaxInFlight = 512;
+constexpr int kMaxAttempts = 8;
+constexpr int kDnsPort = 53;
+constexpr size_t kMaxAddresses = 8;     // per answer, across both families
+constexpr size_t kMaxCacheEntries = 4096;
+constexpr int kSystemThreads = 4;
+
+// Record types and codes
+constexpr uint16_t kTypeA = 1;
+constexpr uint16_t kTypeCname = 5;
+constexpr uint16_t kTypeAaaa = 28;
+constexpr uint16_t kTypeOpt = 41;
+constexpr uint16_t kClassIn = 1;
+constexpr uint8_t kNoError = 0;
+constexpr uint8_t kNxDomain = 3;
+constexpr uint16_t kUdpPayload = 1232;  // EDNS buffer size that avoids IP fragmentation
+
+// Cache lifetimes, seconds
+constexpr uint32_t kMinTtl = 30;
+constexpr uint32_t kMaxTtl = 3600;
+constexpr uint32_t kNegativeTtl = 60;
+constexpr uint32_t kSystemTtl = 60;     // getaddrinfo reports no TTL
+
+constexpr int64_t kResolutionDelayNs = 50000000;
+
+int64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/** Cache key: lowercase, no trailing dot */
+std::string normalize(const std::string& host) {
+    std::string name = host;
+    if (!name.empty() && name.back() == '.') name.pop_back();
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return name;
+}
+
+bool parse_numeric(const std::string& host, const std::string& port, Address& out) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+    addrinfo* info = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &info) != 0 || !info) return false;
+    memcpy(&out.storage, info->ai_addr, info->ai_addrlen);
+    out.length = info->ai_addrlen;
+    freeaddrinfo(info);
+    return true;
+}
+
+/** Literal address, optionally bracketed; scope ids (fe80::1%wlan0) are kept */
+bool parse_literal(const std::string& host, Address& out) {
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        return parse_numeric(host.substr(1, host.size() - 2), "0", out);
+    }
+    return parse_numeric(host, "0", out);
+}
+
+/** Server address: "ip", "ip:port" or "[ip6]:port" */
+bool parse_server(const std::string& text, Address& out) {
+    std::string host = text;
+    std::string port = std::to_string(kDnsPort);
+    if (!text.empty() && text.front() == '[') {
+        size_t close = text.find(']');
+        if (close == std::string::npos) return false;
+        host = text.substr(1, close - 1);
+        if (close + 1 < text.size()) {
+            if (text[close + 1] != ':') return false;
+            port = text.substr(close + 2);
+        }
+    } else if (std::count(text.begin(), text.end(), ':') == 1) {
+        size_t colon = text.find(':');
+        host = text.substr(0, colon);
+        port = text.substr(colon + 1);
+    }
+    return parse_numeric(host, port, out);
+}
+
+bool same_address(const Address& a, const Address& b) {
+    if (a.family() != b.family()) return false;
+    if (a.family() == AF_INET) {
+        return reinterpret_cast<const sockaddr_in&>(a.storage).sin_addr.s_addr ==
+               reinterpret_cast<const sockaddr_in&>(b.storage).sin_addr.s_addr;
+    }
+    return memcmp(&reinterpret_cast<const sockaddr_in6&>(a.storage).sin6_addr,
+                  &reinterpret_cast<const sockaddr_in6&>(b.storage).sin6_addr,
+                  sizeof(in6_addr)) == 0;
+}
+
+/** RFC 8305 section 4: alternate families, IPv6 first, duplicates dropped */
+std::vector<Address> interleave(const std::vector<Address>& addresses) {
+    std::vector<Address> v6;
+    std::vector<Address> v4;
+    for (const Address& address : addresses) {
+        auto& family = address.family() == AF_INET6 ? v6 : v4;
+        bool seen = std::any_of(family.begin(), family.end(),
+                                [&](const Address& other) { return same_address(address, other); });
+        if (!seen) family.push_back(address);
+    }
+    std::vector<Address> ordered;
+    for (size_t i = 0; i < std::max(v6.size(), v4.size()) && ordered.size() < kMaxAddresses; i++) {
+        if (i < v6.size()) ordered.push_back(v6[i]);
+        if (i < v4.size() && ordered.size() < kMaxAddresses) ordered.push_back(v4[i]);
+    }
+    return ordered;
+}
+
+/**
+ * Whether a family has a route, as AI_ADDRCONFIG decides for getaddrinfo;
+ * connecting a UDP socket sends nothing
+ */
+bool has_route(int family) {
+    Address target;
+    if (!parse_numeric(family == AF_INET6 ? "2001:4860:4860::8888" : "8.8.8.8", "53", target)) {
+        return false;
+    }
+    int fd = socket(family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    bool routed = connect(fd, reinterpret_cast<const sockaddr*>(&target.storage), target.length) == 0;
+    close(fd);
+    return routed;
+}
+
+// Process-wide state: default servers and the answer cache
+
+std::mutex servers_mutex;
+std::vector<std::string> configured_servers;
+bool servers_configured = false;
+
+std::vector<std::string> system_servers() {
+    std::vector<std::string> servers;
+    std::ifstream conf("/etc/resolv.conf");
+    std::string line;
+    while (std::getline(conf, line)) {
+        std::istringstream fields(line);
+        std::string keyword;
+        std::string value;
+        if (fields >> keyword >> value && keyword == "nameserver") servers.push_back(value);
+    }
+    return servers;
+}
+
+std::vector<std::string> default_servers() {
+    std::lock_guard<std::mutex> lock(servers_mutex);
+    if (!servers_configured) {
+        configured_servers = system_servers();
+        servers_configured = true;
+    }
+    return configured_servers;
+}
+
+struct CacheEntry {
+    Answer answer;
+    int64_t expires_ns = 0;
+};
+
+std::mutex cache_mutex;
+std::unordered_map<std::string, CacheEntry> cache;
+
+bool cache_get(const std::string& name, Answer& out) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto it = cache.find(name);
+    if (it == cache.end()) return false;
+    if (it->second.expires_ns <= now_ns()) {
+        cache.erase(it);
+        return false;
+    }
+    out = it->second.answer;
+    return true;
+}
+
+void cache_put(const std::string& name, const Answer& answer, uint32_t ttl) {
+    if (answer.status == kFailed) return;
+    int64_t now = now_ns();
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (cache.size() >= kMaxCacheEntries) {
+        for (auto it = cache.begin(); it != cache.end();) {
+            it = it->second.expires_ns <= now ? cache.erase(it) : std::next(it);
+        }
+        if (cache.size() >= kMaxCacheEntries) cache.clear();
+    }
+    cache[name] = CacheEntry{answer, now + static_cast<int64_t>(ttl) * 1000000000};
+}
+
+// Wire format
+
+uint16_t read_u16(const uint8_t* p) { return static_cast<uint16_t>(p[0] << 8 | p[1]); }
+
+uint32_t read_u32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+           static_cast<uint32_t>(p[2]) << 8 | p[3];
+}
+
+void put_u16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+/** Recursive query for name with an EDNS OPT record; false if name has an invalid label */
+bool build_query(const std::string& name, uint16_t id, uint16_t type, std::vector<uint8_t>& out) {
+    out.clear();
+    put_u16(out, id);
+    put_u16(out, 0x0100);  // RD
+    put_u16(out, 1);       // QDCOUNT
+    put_u16(out, 0);
+    put_u16(out, 0);
+    put_u16(out, 1);       // ARCOUNT: OPT
+    if (name.empty() || name.size() > 253) return false;
+    size_t start = 0;
+    for (;;) {
+        size_t dot = name.find('.', start);
+        size_t end = dot == std::string::npos ? name.size() : dot;
+        size_t length = end - start;
+        if (length == 0 || length > 63) return false;
+        out.push_back(static_cast<uint8_t>(length));
+        out.insert(out.end(), name.begin() + static_cast<ptrdiff_t>(start),
+                   name.begin() + static_cast<ptrdiff_t>(end));
+        if (dot == std::string::npos) break;
+        start = dot + 1;
+    }
+    out.push_back(0);
+    put_u16(out, type);
+    put_u16(out, kClassIn);
+    out.push_back(0);  // OPT: root owner
+    put_u16(out, kTypeOpt);
+    put_u16(out, kUdpPayload);
+    out.insert(out.end(), {0, 0, 0, 0, 0, 0});  // extended rcode and flags, no options
+    return true;
+}
+
+/** Read a possibly compressed name, lowercased and dotted; offset moves past it */
+bool read_name(const uint8_t* message, size_t size, size_t& offset, std::string& out) {
+    out.clear();
+    size_t position = offset;
+    bool jumped = false;
+    for (int jumps = 0; jumps < 32;) {
+        if (position >= size) return false;
+        uint8_t length = message[position];
+        if (length == 0) {
+            if (!jumped) offset = position + 1;
+            return true;
+        }
+        if ((length & 0xc0) == 0xc0) {
+            if (position + 1 >= size) return false;
+            if (!jumped) offset = position + 2;
+            jumped = true;
+            position = static_cast<size_t>(length & 0x3f) << 8 | message[position + 1];
+            jumps++;
+            continue;
+        }
+        if ((length & 0xc0) != 0 || position + 1 + length > size) return false;
+        if (!out.empty()) out.push_back('.');
+        for (size_t i = 0; i < length; i++) {
+            out.push_back(static_cast<char>(std::tolower(message[position + 1 + i])));
+        }
+        if (out.size() > 253) return false;
+        position += 1 + length;
+    }
+    return false;
+}
+
+struct Reply {
+    uint8_t rcode = 0;
+    bool truncated = false;
+    std::vector<Address> addresses;
+    uint32_t ttl = kMaxTtl;
+};
+
+/**
+ * Parse a response to (id, name, type); false if it is not one, so a stray
+ * or spoofed datagram is ignored. Follows the CNAME chain inside the answer
+ */
+bool parse_reply(const uint8_t* message, size_t size, uint16_t id, const std::string& name,
+                 uint16_t type, Reply& reply) {
+    if (size < 12 || read_u16(message) != id || (message[2] & 0x80) == 0) return false;
+    reply = Reply();
+    reply.truncated = (message[2] & 0x02) != 0;
+    reply.rcode = message[3] & 0x0f;
+    if (read_u16(message + 4) != 1) return false;
+    uint16_t answers = read_u16(message + 6);
+
+    size_t offset = 12;
+    std::string owner;
+    if (!read_name(message, size, offset, owner) || owner != name || offset + 4 > size ||
+        read_u16(message + offset) != type) {
+        return false;
+    }
+    offset += 4;
+
+    struct Record {
+        std::string owner;
+        uint16_t type;
+        uint32_t ttl;
+        size_t data;
+        uint16_t length;
+    };
+    std::vector<Record> records;
+    for (uint16_t i = 0; i < answers; i++) {
+        Record record;
+        if (!read_name(message, size, offset, record.owner) || offset + 10 > size) return false;
+        record.type = read_u16(message + offset);
+        uint16_t record_class = read_u16(message + offset + 2);
+        record.ttl = read_u32(message + offset + 4);
+        record.length = read_u16(message + offset + 8);
+        record.data = offset + 10;
+        offset = record.data + record.length;
+        if (offset > size) return false;
+        if (record_class == kClassIn) records.push_back(std::move(record));
+    }
+
+    // Names the address records may be owned by; CNAMEs usually precede their
+    // targets, but nothing requires it
+    std::vector<std::string> aliases{name};
+    auto known = [&](const std::string& alias) {
+        return std::find(aliases.begin(), aliases.end(), alias) != aliases.end();
+    };
+    for (bool grew = true; grew;) {
+        grew = false;
+        for (const Record& record : records) {
+            if (record.type != kTypeCname || !known(record.owner)) continue;
+            size_t data = record.data;
+            std::string target;
+            if (!read_name(message, record.data + record.length, data, target)) return false;
+            if (known(target)) continue;
+            aliases.push_back(target);
+            reply.ttl = std::min(reply.ttl, record.ttl);
+            grew = true;
+        }
+    }
+
+    for (const Record& record : records) {
+        if (record.type != type || !known(record.owner)) continue;
+        Address address;
+        if (type == kTypeA && record.length == 4) {
+            auto* v4 = reinterpret_cast<sockaddr_in*>(&address.storage);
+            v4->sin_family = AF_INET;
+            memcpy(&v4->sin_addr, message + record.data, 4);
+            address.length = sizeof(sockaddr_in);
+        } else if (type == kTypeAaaa && record.length == 16) {
+            auto* v6 = reinterpret_cast<sockaddr_in6*>(&address.storage);
+            v6->sin6_family = AF_INET6;
+            memcpy(&v6->sin6_addr, message + record.data, 16);
+            address.length = sizeof(sockaddr_in6);
+        } else {
+            continue;
+        }
+        reply.addresses.push_back(address);
+        reply.ttl = std::min(reply.ttl, record.ttl);
+    }
+    return true;
+}
+
+/** getaddrinfo for names the servers did not answer; blocking, a few at a time */
+void system_lookup(const std::vector<std::string>& names, std::vector<Answer>& answers,
+                   bool want_v4, bool want_v6) {
+    std::atomic<size_t> next{0};
+    auto work = [&] {
+        for (;;) {
+            size_t index = next.fetch_add(1);
+            if (index >= names.size()) return;
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = AI_ADDRCONFIG;
+            addrinfo* info = nullptr;
+            int rc = getaddrinfo(names[index].c_str(), nullptr, &hints, &info);
+            std::vector<Address> found;
+            for (addrinfo* entry = info; rc == 0 && entry; entry = entry->ai_next) {
+                if ((entry->ai_family == AF_INET && !want_v4) ||
+                    (entry->ai_family == AF_INET6 && !want_v6) ||
+                    entry->ai_addrlen > sizeof(sockaddr_storage)) {
+                    continue;
+                }
+                Address address;
+                memcpy(&address.storage, entry->ai_addr, entry->ai_addrlen);
+                address.length = entry->ai_addrlen;
+                found.push_back(address);
+            }
+            if (info) freeaddrinfo(info);
+
+            Answer& answer = answers[index];
+            answer.addresses = interleave(found);
+            if (!answer.addresses.empty()) {
+                answer.status = kOk;
+            } else if (rc == 0 || rc == EAI_NONAME || rc == EAI_NODATA) {
+                answer.status = kNotFound;
+            } else {
+                answer.status = kFailed;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    size_t count = std::min<size_t>(kSystemThreads, names.size());
+    for (size_t i = 1; i < count; i++) threads.emplace_back(work);
+    work();
+    for (std::thread& thread : threads) thread.join();
+}
+
+struct Query {
+    size_t host = 0;
+    uint16_t type = kTypeA;
+    uint16_t id = 0;
+    int fd = -1;
+    int attempts = 0;
+    bool done = false;
+    bool answered = false;  // a server gave NOERROR or NXDOMAIN
+    Reply reply;
+};
+
+struct Host {
+    std::string name;
+    std::vector<size_t> indices;  // every input position with this name
+    std::vector<size_t> queries;  // A and/or AAAA
+    bool reported = false;
+    bool settled = false;
+};
+
+struct Timer {
+    int64_t at_ns;
+    size_t id;          // query, or host for a resolution delay
+    int attempt;        // query attempt it belongs to; -1 for a resolution delay
+};
+
+class Batch {
+public:
+    Batch(const std::vector<std::string>& hosts, const Options& options, Callback callback,
+          std::shared_ptr<Lookup> lookup, bool early)
+        : inputs_(hosts), options_(options), callback_(std::move(callback)),
+          lookup_(std::move(lookup)), early_(early), random_(std::random_device{}()) {
+        options_.timeout_ms = std::max(1, options_.timeout_ms);
+        options_.attempts = std::clamp(options_.attempts, 1, kMaxAttempts);
+        options_.max_in_flight = std::clamp(options_.max_in_flight, 1, kMaxInFlight);
+    }
+
+    ~Batch() {
+        for (Query& query : queries_) {
+            if (query.fd >= 0) close(query.fd);
+        }
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+    }
+
+    void run() {
+        want_v4_ = has_route(AF_INET);
+        want_v6_ = has_route(AF_INET6);
+        if (!want_v4_ && !want_v6_) want_v4_ = want_v6_ = true;  // offline: let the queries fail
+
+        prepare();
+        if (!queries_.empty()) {
+            epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+            if (epoll_fd_ < 0) {
+                LOGE("epoll_create1 failed: %s", strerror(errno));
+                for (Query& query : queries_) query.done = true;
+            }
+            loop();
+        }
+        for (size_t i = 0; i < hosts_.size(); i++) {
+            if (!hosts_[i].settled) settle(i);
+        }
+        fall_back();
+    }
+
+private:
+    void prepare() {
+        std::vector<std::string> servers = options_.servers.empty() ? default_servers()
+                                                                    : options_.servers;
+        for (const std::string& text : servers) {
+            Address server;
+            if (parse_server(text, server)) {
+                servers_.push_back(server);
+            } else {
+                LOGW("Ignoring DNS server '%s'", text.c_str());
+            }
+        }
+
+        std::unordered_map<std::string, size_t> by_name;
+        std::vector<uint8_t> scratch;
+        for (size_t i = 0; i < inputs_.size(); i++) {
+            Answer answer;
+            std::string name = normalize(inputs_[i]);
+            if (name.empty()) {
+                answer.status = kNotFound;
+                report(i, answer);
+                continue;
+            }
+            Address literal;
+            if (parse_literal(inputs_[i], literal)) {
+                answer.status = kOk;
+                answer.addresses.push_back(literal);
+                report(i, answer);
+                continue;
+            }
+            if (name == "localhost") {
+                parse_literal("127.0.0.1", literal);
+                answer.addresses.push_back(literal);
+                parse_literal("::1", literal);
+                answer.addresses.push_back(literal);
+                answer.status = kOk;
+                report(i, answer);
+                continue;
+            }
+            if (cache_get(name, answer)) {
+                report(i, answer);
+                continue;
+            }
+            if (!build_query(name, 0, kTypeA, scratch)) {
+                answer.status = kNotFound;  // not a valid DNS name
+                report(i, answer);
+                continue;
+            }
+
+            auto [it, inserted] = by_name.emplace(name, hosts_.size());
+            if (inserted) {
+                Host host;
+                host.name = name;
+                hosts_.push_back(std::move(host));
+            }
+            hosts_[it->second].indices.push_back(i);
+        }
+
+        for (size_t i = 0; i < hosts_.size() && !servers_.empty(); i++) {
+            for (uint16_t type : {kTypeAaaa, kTypeA}) {
+                if (!(type == kTypeA ? want_v4_ : want_v6_)) continue;
+                Query query;
+                query.host = i;
+                query.type = type;
+                hosts_[i].queries.push_back(queries_.size());
+                ready_.push_back(queries_.size());
+                queries_.push_back(query);
+            }
+        }
+    }
+
+    void loop() {
+        epoll_event events[kMaxEvents];
+        while (!cancelled() && (!ready_.empty() || in_flight_ > 0)) {
+            launch();
+            if (in_flight_ == 0) continue;
+
+            int n = epoll_wait(epoll_fd_, events, kMaxEvents, wait_ms());
+            int64_t now = now_ns();
+            if (n < 0 && errno != EINTR) {
+                LOGE("epoll_wait failed: %s", strerror(errno));
+                break;
+            }
+            for (int i = 0; i < n; i++) receive(events[i].data.u64, now);
+            expire(now);
+        }
+    }
+
+    /** Send queries while sockets are available */
+    void launch() {
+        while (in_flight_ < options_.max_in_flight && !ready_.empty()) {
+            size_t id = ready_.front();
+            ready_.pop_front();
+            Query& query = queries_[id];
+            if (query.attempts >= options_.attempts) {
+                finish(id, now_ns());
+                continue;
+            }
+            // Each retry goes to the next server, from a fresh socket and port
+            const Address& server = servers_[static_cast<size_t>(query.attempts) % servers_.size()];
+            query.attempts++;
+            query.id = static_cast<uint16_t>(random_());
+
+            std::vector<uint8_t> message;
+            build_query(hosts_[query.host].name, query.id, query.type, message);
+            int fd = socket(server.family(), SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) {
+                ready_.push_back(id);
+                if (in_flight_ > 0) return;  // retry once a socket frees up
+                continue;
+            }
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = id;
+            if (connect(fd, reinterpret_cast<const sockaddr*>(&server.storage), server.length) < 0 ||
+                send(fd, message.data(), message.size(), 0) < 0 ||
+                epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+                close(fd);
+                ready_.push_back(id);
+                continue;
+            }
+            query.fd = fd;
+            in_flight_++;
+            deadlines_.push_back({now_ns() + options_.timeout_ms * 1000000ll, id, query.attempts});
+        }
+    }
+
+    void receive(size_t id, int64_t now) {
+        Query& query = queries_[id];
+        uint8_t buffer[kUdpPayload + 512];
+        while (query.fd >= 0) {
+            ssize_t n = recv(query.fd, buffer, sizeof(buffer), 0);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return;
+                retry(id);  // ICMP port unreachable and the like
+                return;
+            }
+            Reply reply;
+            if (!parse_reply(buffer, static_cast<size_t>(n), query.id, hosts_[query.host].name,
+                             query.type, reply)) {
+                continue;
+            }
+            bool usable = (reply.rcode == kNoError || reply.rcode == kNxDomain) &&
+                          !(reply.truncated && reply.addresses.empty());
+            if (!usable) {
+                retry(id);  // SERVFAIL, REFUSED, or truncated to nothing
+                return;
+            }
+            close_query(query);
+            query.answered = true;
+            query.reply = std::move(reply);
+            finish(id, now);
+            return;
+        }
+    }
+
+    void retry(size_t id) {
+        close_query(queries_[id]);
+        ready_.push_back(id);
+    }
+
+    void expire(int64_t now) {
+        while (!deadlines_.empty() && deadlines_.front().at_ns <= now) {
+            Timer timer = deadlines_.front();
+            deadlines_.pop_front();
+            Query& query = queries_[timer.id];
+            if (query.fd >= 0 && query.attempts == timer.attempt) retry(timer.id);
+        }
+        while (!delays_.empty() && delays_.front().at_ns <= now) {
+            size_t host = delays_.front().id;
+            delays_.pop_front();
+            if (!hosts_[host].reported) report_host(host, false);
+        }
+    }
+
+    void close_query(Query& query) {
+        if (query.fd < 0) return;
+        close(query.fd);
+        query.fd = -1;
+        in_flight_--;
+    }
+
+    void finish(size_t id, int64_t now) {
+        Query& query = queries_[id];
+        query.done = true;
+        Host& host = hosts_[query.host];
+        bool complete = std::all_of(host.queries.begin(), host.queries.end(),
+                                    [&](size_t other) { return queries_[other].done; });
+        if (complete) {
+            settle(query.host);
+        } else if (early_ && !host.reported && !query.reply.addresses.empty()) {
+            // First family in: give the other one the resolution delay
+            delays_.push_back({now + kResolutionDelayNs, query.host, -1});
+        }
+    }
+
+    /** All queries of a host are done (or abandoned): report and cache */
+    void settle(size_t index) {
+        Host& host = hosts_[index];
+        host.settled = true;
+        bool any_answered = false;
+        bool nxdomain = false;
+        bool all_answered = !host.queries.empty();
+        for (size_t id : host.queries) {
+            const Query& query = queries_[id];
+            any_answered |= query.answered;
+            all_answered &= query.answered;
+            nxdomain |= query.answered && query.reply.rcode == kNxDomain;
+        }
+        Answer answer = collect(index);
+        if (answer.status == kOk) {
+            uint32_t ttl = kMaxTtl;
+            for (size_t id : host.queries) {
+                if (!queries_[id].reply.addresses.empty()) ttl = std::min(ttl, queries_[id].reply.ttl);
+            }
+            cache_put(host.name, answer, std::clamp(ttl, kMinTtl, kMaxTtl));
+        } else if (nxdomain || (all_answered && any_answered)) {
+            answer.status = kNotFound;
+            cache_put(host.name, answer, kNegativeTtl);
+        } else {
+            fallback_.push_back(index);  // no server answered
+            return;
+        }
+        if (!host.reported) report_host(index, true);
+    }
+
+    Answer collect(size_t index) const {
+        std::vector<Address> found;
+        for (size_t id : hosts_[index].queries) {
+            const auto& addresses = queries_[id].reply.addresses;
+            found.insert(found.end(), addresses.begin(), addresses.end());
+        }
+        Answer answer;
+        answer.addresses = interleave(found);
+        answer.status = answer.addresses.empty() ? kNotFound : kOk;
+        return answer;
+    }
+
+    void report_host(size_t index, bool settled) {
+        Host& host = hosts_[index];
+        Answer answer = collect(index);
+        if (settled && answer.status != kOk) answer.status = kNotFound;
+        host.reported = true;
+        for (size_t i : host.indices) report(i, answer);
+    }
+
+    void fall_back() {
+        if (fallback_.empty() || cancelled()) return;
+        std::vector<std::string> names;
+        for (size_t index : fallback_) names.push_back(hosts_[index].name);
+        std::vector<Answer> answers(names.size());
+        system_lookup(names, answers, want_v4_, want_v6_);
+        for (size_t i = 0; i < fallback_.size(); i++) {
+            Host& host = hosts_[fallback_[i]];
+            cache_put(host.name, answers[i], answers[i].status == kOk ? kSystemTtl : kNegativeTtl);
+            if (host.reported) continue;
+            host.reported = true;
+            for (size_t index : host.indices) report(index, answers[i]);
+        }
+        if (!servers_.empty()) {
+            LOGW("DNS servers did not answer for %zu names, used getaddrinfo", fallback_.size());
+        }
+    }
+
+    void report(size_t index, const Answer& answer) {
+        if (!cancelled()) callback_(index, answer);
+    }
+
+    bool cancelled() const { return lookup_ && lookup_->cancelled(); }
+
+    /** Sleep until the nearest query timeout or resolution delay */
+    int wait_ms() const {
+        if (!ready_.empty() && in_flight_ < options_.max_in_flight) return 0;
+        int64_t next = INT64_MAX;
+        if (!deadlines_.empty()) next = deadlines_.front().at_ns;
+        if (!delays_.empty()) next = std::min(next, delays_.front().at_ns);
+        if (next == INT64_MAX) return -1;
+        int64_t remaining = next - now_ns();
+        return remaining <= 0 ? 0 : static_cast<int>((remaining + 999999) / 1000000);
+    }
+
+    std::vector<std::string> inputs_;
+    Options options_;
+    Callback callback_;
+    std::shared_ptr<Lookup> lookup_;
+    bool early_;
+    std::mt19937 random_;
+
+    bool want_v4_ = true;
+    bool want_v6_ = true;
+    std::vector<Address> servers_;
+    std::vector<Host> hosts_;
+    std::vector<Query> queries_;
+    std::vector<size_t> fallback_;
+    std::deque<size_t> ready_;
+    // Both are appended with a fixed offset from now, so they stay sorted
+    std::deque<Timer> deadlines_;
+    std::deque<Timer> delays_;
+    int epoll_fd_ = -1;
+    int in_flight_ = 0;
+};
+
+} // namespace
+
+std::vector<Answer> resolve(const std::vector<std::string>& hosts, const Options& options) {
+    std::vector<Answer> answers(hosts.size());
+    if (hosts.empty()) return answers;
+    Batch batch(hosts, options, [&](size_t index, const Answer& answer) { answers[index] = answer; },
+                nullptr, false);
+    batch.run();
+    return answers;
+}
+
+std::shared_ptr<Lookup> resolve_async(const std::vector<std::string>& hosts,
+                                      const Options& options, Callback callback) {
+    auto lookup = std::make_shared<Lookup>();
+    if (hosts.empty()) return lookup;
+    auto batch = std::make_shared<Batch>(hosts, options, std::move(callback), lookup, true);
+    std::thread([batch] { batch->run(); }).detach();
+    return lookup;
+}
+
+bool set_servers(const std::vector<std::string>& servers) {
+    std::lock_guard<std::mutex> lock(servers_mutex);
+    bool changed = !servers_configured || configured_servers != servers;
+    configured_servers = servers;
+    servers_configured = true;
+    return changed;
+}
+
+void clear_cache() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.clear();
+}
+
+void age_cache(uint32_t seconds) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    for (auto& [name, entry] : cache) {
+        entry.expires_ns -= static_cast<int64_t>(seconds) * 1000000000;
+    }
+}
+
+} // namespace dns_resolver
+
+extern "C" {
+
+/**
+ * Use the active network's DNS servers for probe lookups; an empty array
+ * falls back to getaddrinfo. Cached answers are dropped when the servers
+ * change, since they came from the previous network's servers
+ */
+JNIEXPORT void JNICALL
+Java_com_hiddify_hiddifyng_utils_PingUtils_setDnsServersNative(JNIEnv *env, jclass clazz,
+                                                               jobjectArray servers) {
+    std::vector<std::string> values;
+    jsize count = servers != nullptr ? env->GetArrayLength(servers) : 0;
+    for (jsize i = 0; i < count; i++) {
+        auto server = static_cast<jstring>(env->GetObjectArrayElement(servers, i));
+        if (server == nullptr) continue;
+        const char* chars = env->GetStringUTFChars(server, nullptr);
+        values.emplace_back(chars);
+        env->ReleaseStringUTFChars(server, chars);
+        env->DeleteLocalRef(server);
+    }
+    if (dns_resolver::set_servers(values)) {
+        dns_resolver::clear_cache();
+        LOGI("DNS servers for probes: %d", static_cast<int>(values.size()));
+    }
+}
+
+} // extern "C"
@@ -0,0 +1,139 @@
+#include <jni.h>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <unordered_map>
+
+#include "endpoint_dedup.h"
+#include "dns_resolver.h"
+#include "native_log.h"
+
+namespace endpoint_dedup {
+
+namespace {
+
+/** Raw address bytes prefixed with the family, so v4 and v6 never collide */
+std::string address_bytes(const dns_resolver::Address& address) {
+    std::string out(1, static_cast<char>(address.family()));
+    if (address.family() == AF_INET) {
+        const auto& in = reinterpret_cast<const sockaddr_in&>(address.storage);
+        out.append(reinterpret_cast<const char*>(&in.sin_addr), sizeof(in.sin_addr));
+    } else if (address.family() == AF_INET6) {
+        const auto& in6 = reinterpret_cast<const sockaddr_in6&>(address.storage);
+        out.append(reinterpret_cast<const char*>(&in6.sin6_addr), sizeof(in6.sin6_addr));
+    }
+    return out;
+}
+
+/**
+ * Transport and port, then either the sorted address set or, when the name
+ * did not resolve, the lowercased name. Names that share only some of their
+ * addresses stay apart, since the prober may pick a different one for each
+ */
+std::string key_of(const Endpoint& endpoint, const dns_resolver::Answer& answer) {
+    std::string key;
+    key.push_back(static_cast<char>(endpoint.transport));
+    key.push_back(static_cast<char>(endpoint.port >> 8));
+    key.push_back(static_cast<char>(endpoint.port));
+    if (answer.status == dns_resolver::kOk && !answer.addresses.empty()) {
+        std::vector<std::string> addresses;
+        addresses.reserve(answer.addresses.size());
+        for (const dns_resolver::Address& address : answer.addresses) {
+            addresses.push_back(address_bytes(address));
+        }
+        std::sort(addresses.begin(), addresses.end());
+        addresses.erase(std::unique(addresses.begin(), addresses.end()), addresses.end());
+        key.push_back('a');
+        for (const std::string& address : addresses) key += address;
+    } else {
+        key.push_back('n');
+        std::string name = endpoint.host;
+        while (!name.empty() && name.back() == '.') name.pop_back();
+        for (char& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        key += name;
+    }
+    return key;
+}
+
+} // namespace
+
+std::vector<size_t> group(const std::vector<Endpoint>& endpoints, Stats* stats) {
+    std::vector<size_t> groups(endpoints.size());
+    if (endpoints.empty()) {
+        if (stats != nullptr) *stats = Stats();
+        return groups;
+    }
+
+    std::vector<std::string> hosts;
+    hosts.reserve(endpoints.size());
+    for (const Endpoint& endpoint : endpoints) hosts.push_back(endpoint.host);
+    std::vector<dns_resolver::Answer> answers = dns_resolver::resolve(hosts);
+
+    std::unordered_map<std::string, size_t> first;
+    first.reserve(endpoints.size());
+    size_t unresolved = 0;
+    for (size_t i = 0; i < endpoints.size(); i++) {
+        if (answers[i].status != dns_resolver::kOk || answers[i].addresses.empty()) unresolved++;
+        groups[i] = first.emplace(key_of(endpoints[i], answers[i]), i).first->second;
+    }
+
+    if (stats != nullptr) {
+        stats->endpoints = endpoints.size();
+        stats->groups = first.size();
+        stats->unresolved = unresolved;
+    }
+    return groups;
+}
+
+} // namespace endpoint_dedup
+
+extern "C" {
+
+/**
+ * Group host:port targets of the given transport classes by resolved endpoint
+ * @return For each target, the index of the first target of its group, or null
+ */
+JNIEXPORT jintArray JNICALL
+Java_com_hiddify_hiddifyng_utils_PingUtils_groupEndpointsNative(JNIEnv *env, jclass clazz,
+                                                                jobjectArray hosts, jintArray ports,
+                                                                jintArray transports) {
+    jsize size = env->GetArrayLength(hosts);
+    if (env->GetArrayLength(ports) != size || env->GetArrayLength(transports) != size) return nullptr;
+    std::vector<jint> port_values(static_cast<size_t>(size));
+    std::vector<jint> transport_values(static_cast<size_t>(size));
+    env->GetIntArrayRegion(ports, 0, size, port_values.data());
+    env->GetIntArrayRegion(transports, 0, size, transport_values.data());
+    std::vector<endpoint_dedup::Endpoint> endpoints(static_cast<size_t>(size));
+    for (jsize i = 0; i < size; i++) {
+        auto host = static_cast<jstring>(env->GetObjectArrayElement(hosts, i));
+        if (host != nullptr) {
+            const char* chars = env->GetStringUTFChars(host, nullptr);
+            endpoints[i].host = chars;
+            env->ReleaseStringUTFChars(host, chars);
+            env->DeleteLocalRef(host);
+        }
+        endpoints[i].port = port_values[i];
+        endpoints[i].transport = transport_values[i] == endpoint_dedup::kUdp
+                                 ? endpoint_dedup::kUdp : endpoint_dedup::kTcp;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    endpoint_dedup::Stats stats;
+    std::vector<size_t> groups = endpoint_dedup::group(endpoints, &stats);
+    auto elapsed = std::chrono::steady_clock::now() - started;
+    LOGI("Endpoint dedup: %zu targets, %zu unique endpoints, %zu unresolved, in %lld ms",
+         stats.endpoints, stats.groups, stats.unresolved,
+         static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()));
+
+    std::vector<jint> values(groups.begin(), groups.end());
+    jintArray array = env->NewIntArray(size);
+    if (array == nullptr) return nullptr;
+    env->SetIntArrayRegion(array, 0, size, values.data());
+    return array;
+}
+
+} // extern "C"
@@ -0,0 +1,415 @@
+#include <jni.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/errqueue.h>
+#include <netinet/icmp6.h>
+#include <netinet/in.h>
+#include <netinet/ip_icmp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "icmp_prober.h"
+#include "dns_resolver.h"
+#include "native_log.h"
+
+namespace icmp_prober {
+
+namespace {
+
+constexpr int kMaxCount = 100;
+constexpr int kMaxPayload = 1400;
+constexpr int kReceiveBuffer = 256 * 1024;
+
+int64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+using dns_resolver::Address;
+
+bool same_host(const Address& a, const sockaddr_storage& b) {
+    if (a.family() != b.ss_family) return false;
+    if (b.ss_family == AF_INET) {
+        return reinterpret_cast<const sockaddr_in&>(a.storage).sin_addr.s_addr ==
+               reinterpret_cast<const sockaddr_in&>(b).sin_addr.s_addr;
+    }
+    return memcmp(&reinterpret_cast<const sockaddr_in6&>(a.storage).sin6_addr,
+                  &reinterpret_cast<const sockaddr_in6&>(b).sin6_addr, sizeof(in6_addr)) == 0;
+}
+
+/** First address of each host in connection order; failed lookups keep length 0 */
+std::vector<Address> resolve(const std::vector<std::string>& hosts) {
+    std::vector<Address> addresses(hosts.size());
+    std::vector<dns_resolver::Answer> answers = dns_resolver::resolve(hosts);
+    for (size_t i = 0; i < hosts.size(); i++) {
+        if (answers[i].status == dns_resolver::kOk) addresses[i] = answers[i].addresses.front();
+    }
+    return addresses;
+}
+
+/** Leads every echo payload; the rest is filler */
+struct Stamp {
+    uint32_t cookie;  // per sweep, rejects replies that belong to an earlier one
+    uint32_t index;
+    uint32_t sample;
+};
+
+constexpr size_t kHeaderSize = 8;  // type, code, checksum, id, sequence
+
+struct Echo {
+    uint16_t sequence = 0;
+    int64_t sent_ns = 0;
+    int64_t rtt_ns = -1;
+};
+
+struct Host {
+    Address address;
+    std::vector<Echo> echoes;
+    int sent = 0;
+    int received = 0;
+    Status failure = kTimeout;
+};
+
+class Sweep {
+public:
+    Sweep(const std::vector<std::string>& hosts, const Options& options)
+        : hosts_(hosts), options_(options) {
+        options_.count = std::clamp(options_.count, 1, kMaxCount);
+        options_.interval_ms = std::max(0, options_.interval_ms);
+        options_.timeout_ms = std::max(1, options_.timeout_ms);
+        options_.payload_bytes = std::clamp(options_.payload_bytes,
+                                            static_cast<int>(sizeof(Stamp)), kMaxPayload);
+        cookie_ = static_cast<uint32_t>(now_ns() ^ reinterpret_cast<uintptr_t>(this));
+    }
+
+    ~Sweep() {
+        if (fd4_ >= 0) close(fd4_);
+        if (fd6_ >= 0) close(fd6_);
+    }
+
+    std::vector<Result> run() {
+        std::vector<Address> addresses = resolve(hosts_);
+        targets_.resize(hosts_.size());
+        bool want4 = false;
+        bool want6 = false;
+        for (size_t i = 0; i < targets_.size(); i++) {
+            Host& host = targets_[i];
+            host.address = addresses[i];
+            if (host.address.length == 0) {
+                host.failure = kResolveFailed;
+                continue;
+            }
+            host.echoes.resize(static_cast<size_t>(options_.count));
+            (host.address.family() == AF_INET ? want4 : want6) = true;
+        }
+        if (want4) fd4_ = open_socket(AF_INET);
+        if (want6) fd6_ = open_socket(AF_INET6);
+
+        // Spread the first round over one interval instead of a single burst
+        int64_t start = now_ns();
+        int64_t interval_ns = options_.interval_ms * 1000000ll;
+        std::vector<std::pair<int64_t, size_t>> schedule;  // (send at, host)
+        for (size_t i = 0; i < targets_.size(); i++) {
+            if (targets_[i].echoes.empty()) continue;
+            if (socket_for(targets_[i]) < 0) {
+                targets_[i].failure = kUnsupported;
+                targets_[i].echoes.clear();
+                continue;
+            }
+            int64_t offset = interval_ns * static_cast<int64_t>(i) /
+                             static_cast<int64_t>(targets_.size());
+            for (int k = 0; k < options_.count; k++) {
+                schedule.emplace_back(start + offset + k * interval_ns, i);
+            }
+        }
+        std::sort(schedule.begin(), schedule.end());
+
+        int64_t timeout_ns = options_.timeout_ms * 1000000ll;
+        int64_t last_deadline = 0;
+        size_t next = 0;
+        std::vector<char> packet(kHeaderSize + static_cast<size_t>(options_.payload_bytes));
+        for (;;) {
+            int64_t now = now_ns();
+            for (; next < schedule.size() && schedule[next].first <= now; next++) {
+                if (send_echo(schedule[next].second, packet, now)) {
+                    last_deadline = now + timeout_ns;
+                }
+            }
+            bool sending = next < schedule.size();
+            if (!sending && (outstanding_ == 0 || now >= last_deadline)) break;
+
+            int64_t wake = sending ? schedule[next].first : last_deadline;
+            int wait_ms = static_cast<int>(std::max<int64_t>(0, (wake - now + 999999) / 1000000));
+            pollfd fds[2];
+            nfds_t nfds = 0;
+            if (fd4_ >= 0) fds[nfds++] = {fd4_, POLLIN, 0};
+            if (fd6_ >= 0) fds[nfds++] = {fd6_, POLLIN, 0};
+            int n = poll(fds, nfds, wait_ms);
+            if (n < 0 && errno != EINTR) {
+                LOGE("ICMP poll failed: %s", strerror(errno));
+                break;
+            }
+            for (nfds_t i = 0; n > 0 && i < nfds; i++) {
+                if (fds[i].revents & POLLERR) drain_errors(fds[i].fd);
+                if (fds[i].revents & POLLIN) drain_replies(fds[i].fd);
+            }
+        }
+
+        std::vector<Result> results(targets_.size());
+        for (size_t i = 0; i < targets_.size(); i++) results[i] = summarize(i);
+        return results;
+    }
+
+private:
+    int open_socket(int family) {
+        int protocol = family == AF_INET ? int{IPPROTO_ICMP} : int{IPPROTO_ICMPV6};
+        int fd = socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol);
+        if (fd < 0) {
+            LOGW("No %s ping socket: %s", family == AF_INET ? "IPv4" : "IPv6", strerror(errno));
+            return -1;
+        }
+        // Destination-unreachable errors arrive on the error queue
+        int on = 1;
+        if (family == AF_INET) {
+            setsockopt(fd, IPPROTO_IP, IP_RECVERR, &on, sizeof(on));
+        } else {
+            setsockopt(fd, IPPROTO_IPV6, IPV6_RECVERR, &on, sizeof(on));
+        }
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &kReceiveBuffer, sizeof(kReceiveBuffer));
+        return fd;
+    }
+
+    int socket_for(const Host& host) const {
+        return host.address.family() == AF_INET ? fd4_ : fd6_;
+    }
+
+    /** @return true when the echo left the socket */
+    bool send_echo(size_t index, std::vector<char>& packet, int64_t now) {
+        Host& host = targets_[index];
+        if (host.failure == kUnreachable && host.received == 0) return false;
+
+        auto sample = static_cast<uint32_t>(host.sent);
+        Echo& echo = host.echoes[sample];
+        echo.sequence = sequence_++;
+
+        // The kernel fills in the identifier and checksum of datagram ICMP
+        std::fill(packet.begin(), packet.end(), 0);
+        packet[0] = static_cast<char>(host.address.family() == AF_INET ? ICMP_ECHO
+                                                                       : ICMP6_ECHO_REQUEST);
+        uint16_t sequence = htons(echo.sequence);
+        memcpy(&packet[6], &sequence, sizeof(sequence));
+        Stamp stamp{cookie_, static_cast<uint32_t>(index), sample};
+        memcpy(&packet[kHeaderSize], &stamp, sizeof(stamp));
+
+        host.sent++;
+        echo.sent_ns = now;
+        ssize_t rc = sendto(socket_for(host), packet.data(), packet.size(), 0,
+                            reinterpret_cast<const sockaddr*>(&host.address.storage),
+                            host.address.length);
+        if (rc < 0) {
+            if (errno == ENETUNREACH || errno == EHOSTUNREACH || errno == EADDRNOTAVAIL) {
+                host.failure = kUnreachable;
+            } else if (errno != EAGAIN && errno != ENOBUFS) {
+                host.failure = kError;
+            }
+            echo.sent_ns = 0;  // counted as sent and lost
+            return false;
+        }
+        outstanding_++;
+        return true;
+    }
+
+    /** Locate the echo a packet was built for; nullptr if it is not ours */
+    Echo* match(const char* data, size_t length, int family, Host** owner) {
+        if (length < kHeaderSize + sizeof(Stamp)) return nullptr;
+        Stamp stamp;
+        memcpy(&stamp, data + kHeaderSize, sizeof(stamp));
+        if (stamp.cookie != cookie_ || stamp.index >= targets_.size()) return nullptr;
+        Host& host = targets_[stamp.index];
+        if (host.address.family() != family || stamp.sample >= host.echoes.size()) return nullptr;
+
+        uint16_t sequence;
+        memcpy(&sequence, data + 6, sizeof(sequence));
+        Echo& echo = host.echoes[stamp.sample];
+        if (ntohs(sequence) != echo.sequence || echo.sent_ns == 0) return nullptr;
+        *owner = &host;
+        return &echo;
+    }
+
+    void drain_replies(int fd) {
+        char buffer[kHeaderSize + kMaxPayload];
+        for (;;) {
+            sockaddr_storage from{};
+            socklen_t from_length = sizeof(from);
+            ssize_t n = recvfrom(fd, buffer, sizeof(buffer), 0,
+                                 reinterpret_cast<sockaddr*>(&from), &from_length);
+            if (n < 0) return;
+            int64_t now = now_ns();
+
+            int family = fd == fd4_ ? AF_INET : AF_INET6;
+            auto reply = static_cast<uint8_t>(family == AF_INET ? ICMP_ECHOREPLY
+                                                                : ICMP6_ECHO_REPLY);
+            if (n < 1 || static_cast<uint8_t>(buffer[0]) != reply) continue;
+            Host* host = nullptr;
+            Echo* echo = match(buffer, static_cast<size_t>(n), family, &host);
+            if (echo == nullptr || echo->rtt_ns >= 0 || !same_host(host->address, from)) continue;
+
+            int64_t rtt = now - echo->sent_ns;
+            if (rtt > options_.timeout_ms * 1000000ll) continue;  // late: already lost
+            echo->rtt_ns = rtt;
+            host->received++;
+            outstanding_--;
+        }
+    }
+
+    void drain_errors(int fd) {
+        char buffer[kHeaderSize + kMaxPayload];
+        char control[512];
+        for (;;) {
+            iovec iov{buffer, sizeof(buffer)};
+            msghdr message{};
+            message.msg_iov = &iov;
+            message.msg_iovlen = 1;
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            ssize_t n = recvmsg(fd, &message, MSG_ERRQUEUE | MSG_DONTWAIT);
+            if (n < 0) return;
+
+            int error = 0;
+            for (cmsghdr* c = CMSG_FIRSTHDR(&message); c != nullptr; c = CMSG_NXTHDR(&message, c)) {
+                if ((c->cmsg_level == IPPROTO_IP && c->cmsg_type == IP_RECVERR) ||
+                    (c->cmsg_level == IPPROTO_IPV6 && c->cmsg_type == IPV6_RECVERR)) {
+                    sock_extended_err extended;
+                    memcpy(&extended, CMSG_DATA(c), sizeof(extended));
+                    error = static_cast<int>(extended.ee_errno);
+                }
+            }
+            // The queued data is the echo request the error refers to
+            int family = fd == fd4_ ? AF_INET : AF_INET6;
+            Host* host = nullptr;
+            Echo* echo = match(buffer, static_cast<size_t>(n), family, &host);
+            if (echo == nullptr || echo->rtt_ns >= 0) continue;
+            echo->sent_ns = 0;
+            outstanding_--;
+            if (error == EHOSTUNREACH || error == ENETUNREACH || error == ECONNREFUSED) {
+                host->failure = kUnreachable;
+            }
+        }
+    }
+
+    Result summarize(size_t index) const {
+        const Host& host = targets_[index];
+        Result result;
+        result.index = index;
+        result.sent = host.sent;
+        result.received = host.received;
+        result.status = host.received > 0 ? kOk : host.failure;
+
+        int64_t total = 0;
+        int64_t previous = -1;
+        int64_t swing = 0;
+        int gaps = 0;
+        for (const Echo& echo : host.echoes) {
+            if (echo.rtt_ns < 0) continue;
+            if (result.min_ns == 0 || echo.rtt_ns < result.min_ns) result.min_ns = echo.rtt_ns;
+            result.max_ns = std::max(result.max_ns, echo.rtt_ns);
+            total += echo.rtt_ns;
+            if (previous >= 0) {
+                swing += std::abs(echo.rtt_ns - previous);
+                gaps++;
+            }
+            previous = echo.rtt_ns;
+        }
+        if (host.received > 0) result.avg_ns = total / host.received;
+        if (gaps > 0) result.jitter_ns = swing / gaps;
+        return result;
+    }
+
+    const std::vector<std::string>& hosts_;
+    Options options_;
+    uint32_t cookie_ = 0;
+    uint16_t sequence_ = 0;
+
+    int fd4_ = -1;
+    int fd6_ = -1;
+    std::vector<Host> targets_;
+    int outstanding_ = 0;  // echoes sent but neither answered nor failed
+};
+
+} // namespace
+
+std::vector<Result> run(const std::vector<std::string>& hosts, const Options& options) {
+    if (hosts.empty()) return {};
+    Sweep sweep(hosts, options);
+    return sweep.run();
+}
+
+} // namespace icmp_prober
+
+namespace {
+
+// Longs per host: status, sent, received, min ns, avg ns, max ns, jitter ns
+constexpr size_t kResultStride = 7;
+
+} // namespace
+
+extern "C" {
+
+/**
+ * Ping hosts over unprivileged ICMP sockets
+ * @return kResultStride longs per host in input order, or null
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_hiddify_hiddifyng_utils_PingUtils_probeIcmpNative(JNIEnv *env, jclass clazz,
+                                                           jobjectArray hosts, jint count,
+                                                           jint interval_ms, jint timeout_ms) {
+    jsize size = env->GetArrayLength(hosts);
+    std::vector<std::string> names(static_cast<size_t>(size));
+    for (jsize i = 0; i < size; i++) {
+        auto host = static_cast<jstring>(env->GetObjectArrayElement(hosts, i));
+        if (host != nullptr) {
+            const char* chars = env->GetStringUTFChars(host, nullptr);
+            names[i] = chars;
+            env->ReleaseStringUTFChars(host, chars);
+            env->DeleteLocalRef(host);
+        }
+    }
+
+    icmp_prober::Options options;
+    options.count = count;
+    options.interval_ms = interval_ms;
+    options.timeout_ms = timeout_ms;
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<icmp_prober::Result> results = icmp_prober::run(names, options);
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    std::vector<jlong> rows;
+    rows.reserve(results.size() * kResultStride);
+    int answered = 0;
+    for (const icmp_prober::Result& result : results) {
+        jlong row[kResultStride] = {result.status, result.sent, result.received,
+                                    result.min_ns, result.avg_ns, result.max_ns,
+                                    result.jitter_ns};
+        rows.insert(rows.end(), row, row + kResultStride);
+        if (result.status == icmp_prober::kOk) answered++;
+    }
+    LOGI("ICMP probe: %d/%d hosts answered in %lld ms", answered, size,
+         static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()));
+
+    jlongArray array = env->NewLongArray(static_cast<jsize>(rows.size()));
+    if (array == nullptr) return nullptr;
+    env->SetLongArrayRegion(array, 0, static_cast<jsize>(rows.size()), rows.data());
+    return array;
+}
+
+} // extern "C"
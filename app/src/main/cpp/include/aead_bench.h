@@ -0,0 +1,58 @@
+#ifndef HIDDIFYNG_AEAD_BENCH_H
+#define HIDDIFYNG_AEAD_BENCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * On-device AEAD throughput benchmark
+ *
+ * The core seals every VMess and Shadowsocks chunk with an AEAD, so on a
+ * phone the cipher choice is a large share of the per-byte CPU cost. AES-GCM
+ * is several times faster than ChaCha20-Poly1305 on cores with the ARMv8
+ * crypto extensions (or AES-NI on x86) and several times slower without
+ * them. Each cipher is implemented the way the core's Go runtime does it on
+ * this device class: hardware AES and carry-less multiply when the CPU
+ * reports them, table-based AES with a 4-bit GHASH table otherwise.
+ */
+namespace aead_bench {
+
+enum Cipher {
+    kAes128Gcm = 0,
+    kAes256Gcm = 1,
+    kChaCha20Poly1305 = 2,
+};
+constexpr int kCipherCount = 3;
+
+// Sealed record size; VMess and Shadowsocks chunks are at most 16 KB
+constexpr size_t kRecordBytes = 16 * 1024;
+
+constexpr size_t kNonceBytes = 12;
+constexpr size_t kTagBytes = 16;
+
+size_t key_bytes(Cipher cipher);
+
+/** True when AES rounds and GHASH run on the CPU's crypto instructions */
+bool has_aes_hardware();
+
+/**
+ * Encrypt and authenticate one record
+ * @param key key_bytes(cipher) bytes
+ * @param use_hardware Allow the hardware AES path when the CPU has it
+ */
+void seal(Cipher cipher, const uint8_t* key, const uint8_t* nonce,
+          const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len,
+          uint8_t* out, uint8_t* tag, bool use_hardware = true);
+
+/** Check every cipher against published test vectors */
+bool self_test();
+
+/**
+ * Seal kRecordBytes records back to back for about duration_ms
+ * @return Throughput in bytes per second
+ */
+int64_t benchmark(Cipher cipher, int duration_ms);
+
+} // namespace aead_bench
+
+#endif // HIDDIFYNG_AEAD_BENCH_H
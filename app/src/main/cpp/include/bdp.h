@@ -0,0 +1,48 @@
+#ifndef HIDDIFYNG_BDP_H
+#define HIDDIFYNG_BDP_H
+
+#include <cstdint>
+
+/**
+ * Socket buffer sizing from the bandwidth-delay product
+ *
+ * A TCP flow can keep at most one receive window in flight per RTT, so a
+ * buffer below the path's BDP caps throughput at buffer / RTT while one far
+ * above it only adds memory and queueing. Sizes are derived per server from
+ * probed RTT and recent throughput instead of fixed quality tiers.
+ */
+namespace bdp {
+
+constexpr int64_t kMinBufferBytes = 64 * 1024;
+constexpr int64_t kMaxBufferBytes = 8 * 1024 * 1024;
+
+// Headroom over the BDP so slow start and rate swings do not hit the limit
+constexpr double kHeadroom = 2.0;
+// Buffers are rounded up to this granularity
+constexpr int64_t kBufferGranularity = 16 * 1024;
+
+struct Sizing {
+    int64_t bdp_bytes;
+    int64_t buffer_bytes;
+};
+
+/**
+ * @param bandwidth_kbps Recent goodput in kilobits per second
+ * @param rtt_ms Smoothed round-trip time in milliseconds
+ * @param min_bytes Lower bound; clamps to kMinBufferBytes when <= 0
+ * @param max_bytes Upper bound; clamps to kMaxBufferBytes when <= 0
+ */
+Sizing size_buffers(double bandwidth_kbps, double rtt_ms, int64_t min_bytes, int64_t max_bytes);
+
+/**
+ * Loopback transfer through a relay that holds every byte in its socket's
+ * receive queue for rtt_ms before forwarding it. The sender's SO_SNDBUF and
+ * the relay's SO_RCVBUF are set to buffer_bytes, so the kernel's own flow
+ * control caps throughput near buffer / rtt as on a real long-RTT link.
+ * @return Achieved throughput in bytes per second, or -1 on socket errors
+ */
+int64_t benchmark_window(int rtt_ms, int buffer_bytes, int duration_ms);
+
+} // namespace bdp
+
+#endif // HIDDIFYNG_BDP_H
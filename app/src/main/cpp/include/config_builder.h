@@ -0,0 +1,222 @@
+#ifndef HIDDIFYNG_CONFIG_BUILDER_H
+#define HIDDIFYNG_CONFIG_BUILDER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "server_record.h"
+
+/**
+ * Native Xray config generation
+ *
+ * Builds a format-neutral ConfigSpec from flattened server records and
+ * emits it either as JSON or directly as the protobuf form of
+ * xray.core.Config, so the core can skip JSON parsing at startup.
+ */
+namespace config_builder {
+
+enum class Format {
+    kJson = 0,
+    kProtobuf = 1,
+};
+
+enum Status {
+    kOk = 0,
+    kInvalidInput = -1,
+    kUnsupported = -2,
+    kIoError = -3,
+};
+
+struct MuxSettings {
+    bool enabled = false;
+    int concurrency = 0;
+};
+
+/**
+ * Socket options of a proxy outbound's connections to its server
+ * Emitted in the JSON form only; 0 keeps the kernel's autotuned size.
+ */
+struct SocketSettings {
+    int send_buffer = 0;
+    int receive_buffer = 0;
+};
+
+struct OutboundSpec {
+    enum Kind { kProxy, kDirect, kBlock };
+
+    std::string tag;
+    Kind kind = kProxy;
+    const server_record::ServerRecord* server = nullptr; // set for kProxy only
+    MuxSettings mux;
+    SocketSettings sockopt;
+    // VMess body cipher used when the record leaves security at "auto"; empty keeps auto
+    std::string vmess_security;
+};
+
+struct InboundSpec {
+    std::string tag;
+    std::string listen = "127.0.0.1";
+    int port = 0;
+    bool udp = true;
+};
+
+/**
+ * Routing rule. Domains use Xray's prefix syntax ("domain:", "full:",
+ * "regexp:", "keyword:"); ips are literal CIDRs. Exactly one of
+ * outbound_tag or balancer_tag is set.
+ */
+struct RuleSpec {
+    std::string outbound_tag;
+    std::string balancer_tag;
+    std::vector<std::string> domains;
+    std::vector<std::string> ips;
+    std::vector<std::string> inbound_tags;
+};
+
+/**
+ * Routing balancer over outbounds whose tags start with one of the selectors.
+ * fallback_tag is used until the observatory has results.
+ */
+struct BalancerSpec {
+    std::string tag;
+    std::vector<std::string> selectors;
+    std::string strategy = "leastPing";
+    std::string fallback_tag;
+};
+
+/**
+ * Background health check feeding leastPing balancers; disabled when
+ * selectors is empty
+ */
+struct ObservatorySpec {
+    std::vector<std::string> selectors;
+    std::string probe_url = "https://www.gstatic.com/generate_204";
+    int probe_interval_ms = 10000;
+    bool concurrent = true;
+};
+
+struct ConfigSpec {
+    std::string log_level = "warning";
+    std::string domain_strategy = "AsIs";
+    std::vector<InboundSpec> inbounds;
+    std::vector<OutboundSpec> outbounds;
+    std::vector<RuleSpec> rules;
+    std::vector<BalancerSpec> balancers;
+    ObservatorySpec observatory;
+};
+
+/** Default local SOCKS inbound the app routes through */
+constexpr int kDefaultSocksPort = 10808;
+
+/**
+ * Rough resident cost of one balanced outbound in the core (handler,
+ * observatory probe connection and its buffers); used to size K
+ */
+constexpr int64_t kBalancerOutboundBytes = 384 * 1024;
+constexpr int kMaxBalancerOutbounds = 16;
+
+/**
+ * Whether the record's protocol/transport can be emitted natively
+ * Unsupported records are left to the Kotlin protocol handlers.
+ */
+bool is_supported(const server_record::ServerRecord& server);
+
+/**
+ * Build the standard single-proxy config: SOCKS inbound, proxy/direct/block
+ * outbounds and routing from the block/direct/proxy lists in routing_dir
+ */
+Status build_default(const server_record::ServerRecord& server, const std::string& routing_dir,
+                     ConfigSpec& spec);
+
+/**
+ * Number of balanced outbounds that fit the memory budget, in [1, kMaxBalancerOutbounds]
+ */
+int balancer_size_for_budget(int64_t budget_bytes);
+
+/**
+ * Build a failover config: up to max_outbounds supported servers (taken in
+ * the given order, best first) as "proxy-N" outbounds behind a leastPing
+ * balancer tagged "proxy", health-checked by the observatory
+ * @param emitted Number of proxy outbounds actually placed in the spec
+ */
+Status build_balanced(const std::vector<server_record::ServerRecord>& servers, int max_outbounds,
+                      const std::string& routing_dir, ConfigSpec& spec, int& emitted);
+
+/**
+ * Reusable storage for batch generation
+ * Records are decoded into servers (views into the caller's buffer) and
+ * fragments are written back to back into data, each NUL-terminated so it
+ * can be handed out in place; fragment i ends at ends[i]. clear() keeps
+ * capacity, so a long-lived arena stops allocating once it has held the
+ * largest batch.
+ */
+struct BatchArena {
+    std::vector<server_record::ServerRecord> servers;
+    std::string data;
+    std::vector<size_t> ends;
+
+    void clear() {
+        servers.clear();
+        data.clear();
+        ends.clear();
+    }
+
+    std::string_view fragment(size_t i) const {
+        size_t begin = i == 0 ? 0 : ends[i - 1] + 1;
+        return std::string_view(data).substr(begin, ends[i] - begin);
+    }
+};
+
+/**
+ * Emit one JSON proxy outbound (tagged "proxy") per record in arena.servers,
+ * in a single pass; records that are invalid or not expressible natively
+ * get an empty fragment
+ * @param mux_concurrency 0 leaves mux disabled
+ * @return Number of non-empty fragments
+ */
+int emit_outbound_fragments(BatchArena& arena, int mux_concurrency);
+
+/**
+ * Build a probing config with one SOCKS inbound per record on base_port + i
+ * routed to that record's own outbound; skipped records leave their port unused
+ * @param emitted Number of proxy outbounds placed in the spec
+ */
+Status build_batch(const std::vector<server_record::ServerRecord>& servers, int base_port,
+                   ConfigSpec& spec, int& emitted);
+
+/**
+ * Enable mux with the given concurrency on proxy outbounds that can carry
+ * it (XTLS flows cannot); 0 leaves mux disabled
+ */
+void apply_mux(ConfigSpec& spec, int concurrency);
+
+/**
+ * Set the send and receive buffers of every proxy outbound's server
+ * connections; 0 leaves the kernel default
+ */
+void apply_socket_buffers(ConfigSpec& spec, int buffer_bytes);
+
+/**
+ * Use the given AEAD ("aes-128-gcm" or "chacha20-poly1305") on VMess
+ * outbounds whose record leaves security at auto; the client picks the body
+ * cipher per request, so servers accept either. Empty changes nothing.
+ */
+void apply_vmess_security(ConfigSpec& spec, std::string_view security);
+
+/**
+ * Serialize the spec
+ * @return kUnsupported for protobuf when an outbound uses the xhttp
+ *         transport, which only the JSON form carries
+ */
+Status emit(const ConfigSpec& spec, Format format, std::string& out);
+
+/**
+ * Write data to path atomically (temp file + rename)
+ */
+Status write_file(const std::string& data, const std::string& path);
+
+} // namespace config_builder
+
+#endif // HIDDIFYNG_CONFIG_BUILDER_H
@@ -0,0 +1,39 @@
+#ifndef HIDDIFYNG_CONFIG_MINIMIZER_H
+#define HIDDIFYNG_CONFIG_MINIMIZER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Post-pass that strips what the core would load but never use
+ *
+ * The core parses and allocates every section it is given, so outbounds no
+ * rule can reach, balancers no rule names, rules shadowed by an earlier
+ * duplicate or catch-all, and DNS servers that can never be queried only
+ * cost heap and start-up time. Everything reachable is written back
+ * unchanged, in its original order.
+ */
+namespace config_minimizer {
+
+struct Report {
+    size_t bytes_before = 0;
+    size_t bytes_after = 0;
+    int64_t parse_ns_before = 0; // native DOM parse time, a proxy for the core's
+    int64_t parse_ns_after = 0;
+    int outbounds_removed = 0;
+    int balancers_removed = 0;
+    int rules_removed = 0;         // duplicate or unreachable after a catch-all
+    int rule_entries_removed = 0;  // duplicate entries inside a rule's match lists
+    int dns_servers_removed = 0;
+    bool observatory_removed = false;
+};
+
+/**
+ * @param error Set when the input is not a JSON object; out is left empty
+ */
+bool minimize(std::string_view json, std::string& out, Report& report, std::string& error);
+
+} // namespace config_minimizer
+
+#endif // HIDDIFYNG_CONFIG_MINIMIZER_H
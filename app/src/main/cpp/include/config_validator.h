@@ -0,0 +1,69 @@
+#ifndef HIDDIFYNG_CONFIG_VALIDATOR_H
+#define HIDDIFYNG_CONFIG_VALIDATOR_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "server_record.h"
+
+/**
+ * Pre-launch config validation
+ *
+ * Catches configs the core would reject (or silently misroute) before a
+ * process is spawned: malformed JSON, bad user ids and REALITY keys, port
+ * ranges, duplicate tags and references to tags that do not exist.
+ */
+namespace config_validator {
+
+/** Issue codes; values are shared with XrayManager.ConfigIssue */
+enum Code {
+    kSyntax = 1,
+    kMissingField = 2,
+    kInvalidValue = 3,
+    kInvalidUserId = 4,
+    kInvalidRealityKey = 5,
+    kInvalidShortId = 6,
+    kInvalidPort = 7,
+    kDuplicateTag = 8,
+    kDanglingReference = 9,
+    kUnreadable = 10,
+};
+
+struct Issue {
+    Code code;
+    std::string path;    // location in the config, e.g. "outbounds[0].settings.vnext[0].port"
+    std::string message;
+};
+
+/** Canonical 8-4-4-4-12 UUID, or a 1-30 byte custom id the core maps to a UUIDv5 */
+bool is_valid_user_id(std::string_view id);
+
+/** REALITY public key: base64url (or std) encoding of 32 bytes */
+bool is_valid_reality_public_key(std::string_view key);
+
+/** REALITY short id: empty or up to 16 hex digits of even length */
+bool is_valid_short_id(std::string_view short_id);
+
+bool is_valid_port(long long port);
+
+/**
+ * Check the fields of one flattened server record
+ * @param path Prefix used for issue paths
+ */
+void validate_server(const server_record::ServerRecord& server, const std::string& path,
+                     std::vector<Issue>& issues);
+
+/**
+ * Check a complete Xray JSON config
+ */
+void validate_json(std::string_view json, std::vector<Issue>& issues);
+
+/**
+ * Read a config file for inspection; fails for files over 16 MB
+ */
+bool read_file(const char* path, std::string& out);
+
+} // namespace config_validator
+
+#endif // HIDDIFYNG_CONFIG_VALIDATOR_H
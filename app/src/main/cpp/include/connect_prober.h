@@ -0,0 +1,71 @@
+#ifndef HIDDIFYNG_CONNECT_PROBER_H
+#define HIDDIFYNG_CONNECT_PROBER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Concurrent TCP connect prober
+ *
+ * Every probe is a non-blocking connect() watched by one epoll loop, so a
+ * sweep costs one thread and one socket per probe in flight instead of a
+ * blocked thread per sample. Hosts are resolved by dns_resolver, which feeds
+ * the loop as names resolve, so connects to early hosts overlap the
+ * resolution of later ones. Each sample races the host's addresses Happy
+ * Eyeballs style (RFC 8305) and times the connect that wins from its own
+ * start, so a dead IPv6 path costs a stagger delay instead of a timeout and
+ * the winning address is tried first from then on. Samples of one target
+ * run back to back; different targets run in parallel up to the in-flight cap.
+ */
+namespace connect_prober {
+
+struct Target {
+    std::string host;  // name or literal address
+    int port = 0;
+};
+
+struct Options {
+    int samples = 3;           // connects per target
+    int timeout_ms = 2000;     // per connect
+    int max_in_flight = 256;   // sockets open at once
+    int attempt_delay_ms = 250;  // before racing a host's next address
+};
+
+enum Status : int32_t {
+    kOk = 0,
+    kTimeout = 1,        // no sample completed before its deadline
+    kRefused = 2,        // RST: the host is up but nothing listens on the port
+    kUnreachable = 3,    // ICMP host/network unreachable, or no route
+    kResolveFailed = 4,
+    kError = 5,
+};
+
+struct Result {
+    size_t index = 0;     // into the targets passed to run()
+    Status status = kError;
+    int64_t best_ns = 0;  // fastest completed connect, 0 if none completed
+    int64_t mean_ns = 0;
+    int successes = 0;
+    int attempts = 0;
+    std::vector<int64_t> samples_ns;  // every completed connect, in order
+};
+
+/**
+ * Receives the targets whose last sample finished during one loop wakeup,
+ * on the thread that called run(); returning false stops the sweep early
+ */
+using Sink = std::function<bool(const std::vector<Result>&)>;
+
+/**
+ * Probe every target; blocks until all are reported or the sink stops the
+ * sweep. Targets still pending at a stop are not reported.
+ * @return Number of results delivered
+ */
+size_t run(const std::vector<Target>& targets, const Options& options, const Sink& sink);
+
+} // namespace connect_prober
+
+#endif // HIDDIFYNG_CONNECT_PROBER_H
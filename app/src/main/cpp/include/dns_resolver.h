@@ -0,0 +1,96 @@
+#ifndef HIDDIFYNG_DNS_RESOLVER_H
+#define HIDDIFYNG_DNS_RESOLVER_H
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Stub resolver shared by the probers
+ *
+ * Sends A and AAAA queries for every name of a batch at once over UDP from
+ * one epoll loop, retrying on the next server after a timeout, and keeps the
+ * answers in a process-wide cache for the records' TTL. Names that do not
+ * exist are cached too, for a shorter time. Each host is looked up once per
+ * batch however many servers share it. Answers list addresses in RFC 8305
+ * order (families interleaved, IPv6 first) for connection racing. Names no
+ * server answers for fall back to getaddrinfo, so Private DNS and networks
+ * that block port 53 still resolve, only slower.
+ */
+namespace dns_resolver {
+
+struct Address {
+    sockaddr_storage storage{};
+    socklen_t length = 0;
+
+    int family() const { return storage.ss_family; }
+    void set_port(int port);
+};
+
+struct Options {
+    std::vector<std::string> servers;  // "ip", "ip:port" or "[ip6]:port"; empty = set_servers()
+    int timeout_ms = 800;              // per query attempt, each on the next server
+    int attempts = 3;
+    int max_in_flight = 128;           // queries outstanding at once
+};
+
+enum Status : int32_t {
+    kOk = 0,
+    kNotFound = 1,  // NXDOMAIN or no A/AAAA records; cached
+    kFailed = 2,    // no server answered and getaddrinfo failed too; not cached
+};
+
+struct Answer {
+    Status status = kFailed;
+    std::vector<Address> addresses;  // port 0, in connection attempt order
+};
+
+/**
+ * Resolve every host, blocking the calling thread. Literals and cached names
+ * are answered without a query; results are in input order
+ */
+std::vector<Answer> resolve(const std::vector<std::string>& hosts,
+                            const Options& options = Options());
+
+/** Called once per input index, from the lookup's thread */
+using Callback = std::function<void(size_t index, const Answer& answer)>;
+
+class Lookup {
+public:
+    /** Stop querying; hosts not yet reported are never reported */
+    void cancel() { cancelled_.store(true); }
+    bool cancelled() const { return cancelled_.load(); }
+
+private:
+    std::atomic<bool> cancelled_{false};
+};
+
+/**
+ * Resolve on a detached thread, reporting each host as soon as its answer
+ * is settled, so callers can start connecting before the batch finishes.
+ * The first family to answer waits at most 50 ms for the other (the
+ * resolution delay of RFC 8305 section 3)
+ */
+std::shared_ptr<Lookup> resolve_async(const std::vector<std::string>& hosts,
+                                      const Options& options, Callback callback);
+
+/**
+ * Servers used when Options::servers is empty; /etc/resolv.conf until first set
+ * @return Whether they differ from the previous ones
+ */
+bool set_servers(const std::vector<std::string>& servers);
+
+void clear_cache();
+
+/** Bring every cached answer seconds closer to expiry, as if that time had passed */
+void age_cache(uint32_t seconds);
+
+} // namespace dns_resolver
+
+#endif // HIDDIFYNG_DNS_RESOLVER_H
@@ -0,0 +1,47 @@
+#ifndef HIDDIFYNG_ENDPOINT_DEDUP_H
+#define HIDDIFYNG_ENDPOINT_DEDUP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Groups probe targets by the endpoint they actually reach
+ *
+ * Subscriptions often list one server many times, with different UUIDs,
+ * transports or host names, all behind the same address and port; a TCP
+ * connect or QUIC probe cannot tell them apart. Targets are canonicalized to
+ * (transport class, port, resolved address set) through dns_resolver, so the
+ * lookups are cached for the probe that follows, and each group needs to be
+ * probed only once. Names that do not resolve are grouped by name, so their
+ * failure is still reported once per group.
+ */
+namespace endpoint_dedup {
+
+enum Transport : int32_t {
+    kTcp = 0,
+    kUdp = 1,
+};
+
+struct Endpoint {
+    std::string host;  // name or literal address
+    int port = 0;
+    Transport transport = kTcp;
+};
+
+struct Stats {
+    size_t endpoints = 0;
+    size_t groups = 0;
+    size_t unresolved = 0;  // endpoints grouped by name
+};
+
+/**
+ * Resolve and group the endpoints, blocking the calling thread
+ * @return For each endpoint, the index of the first endpoint of its group
+ */
+std::vector<size_t> group(const std::vector<Endpoint>& endpoints, Stats* stats = nullptr);
+
+} // namespace endpoint_dedup
+
+#endif // HIDDIFYNG_ENDPOINT_DEDUP_H
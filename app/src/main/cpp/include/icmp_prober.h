@@ -0,0 +1,57 @@
+#ifndef HIDDIFYNG_ICMP_PROBER_H
+#define HIDDIFYNG_ICMP_PROBER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Unprivileged ICMP echo prober
+ *
+ * Uses datagram ICMP sockets (SOCK_DGRAM/IPPROTO_ICMP and IPPROTO_ICMPV6),
+ * which need no root: the kernel owns the echo identifier and only hands a
+ * socket the replies to its own requests. One socket per address family
+ * carries the echoes of every host, replies are matched back by sequence
+ * number and payload, and RTT is taken from send to receive in-process, so
+ * no process spawn is counted as latency.
+ */
+namespace icmp_prober {
+
+struct Options {
+    int count = 3;          // echoes per host
+    int interval_ms = 200;  // between echoes to the same host
+    int timeout_ms = 2000;  // per echo
+    int payload_bytes = 32;
+};
+
+enum Status : int32_t {
+    kOk = 0,
+    kTimeout = 1,        // every echo was lost
+    kUnreachable = 2,    // ICMP destination unreachable, or no route
+    kResolveFailed = 3,
+    kUnsupported = 4,    // datagram ICMP sockets are not permitted for this uid
+    kError = 5,
+};
+
+struct Result {
+    size_t index = 0;     // into the hosts passed to run()
+    Status status = kError;
+    int sent = 0;
+    int received = 0;
+    int64_t min_ns = 0;
+    int64_t avg_ns = 0;
+    int64_t max_ns = 0;
+    int64_t jitter_ns = 0;  // mean difference between consecutive RTTs
+};
+
+/**
+ * Ping every host concurrently; blocks for about
+ * (count - 1) * interval_ms + timeout_ms once names are resolved
+ * @return One result per host, in input order
+ */
+std::vector<Result> run(const std::vector<std::string>& hosts, const Options& options);
+
+} // namespace icmp_prober
+
+#endif // HIDDIFYNG_ICMP_PROBER_H
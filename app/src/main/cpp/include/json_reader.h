@@ -0,0 +1,60 @@
+#ifndef HIDDIFYNG_JSON_READER_H
+#define HIDDIFYNG_JSON_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * Minimal JSON DOM for inspecting generated configs natively
+ *
+ * Parses into owned values; objects keep member order and duplicate keys
+ * as written so validators can report them.
+ */
+class JsonValue {
+public:
+    enum Type { kNull, kBool, kNumber, kString, kArray, kObject };
+
+    using Member = std::pair<std::string, JsonValue>;
+
+    Type type() const { return type_; }
+    bool is_null() const { return type_ == kNull; }
+    bool is_bool() const { return type_ == kBool; }
+    bool is_number() const { return type_ == kNumber; }
+    bool is_string() const { return type_ == kString; }
+    bool is_array() const { return type_ == kArray; }
+    bool is_object() const { return type_ == kObject; }
+
+    bool as_bool() const { return bool_; }
+    double as_number() const { return number_; }
+    const std::string& as_string() const { return string_; }
+    const std::vector<JsonValue>& items() const { return items_; }
+    const std::vector<Member>& members() const { return members_; }
+
+    /** First member with the given key, or nullptr (also for non-objects) */
+    const JsonValue* find(std::string_view key) const;
+
+    /** String member value, or empty when missing or not a string */
+    std::string_view string_at(std::string_view key) const;
+
+    /**
+     * Parse a complete document
+     * @param error Set to a message with the byte offset on failure
+     */
+    static bool parse(std::string_view text, JsonValue& out, std::string& error);
+
+private:
+    friend class JsonParser;
+
+    Type type_ = kNull;
+    bool bool_ = false;
+    double number_ = 0;
+    std::string string_;
+    std::vector<JsonValue> items_;
+    std::vector<Member> members_;
+};
+
+#endif // HIDDIFYNG_JSON_READER_H
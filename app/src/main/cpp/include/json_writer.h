@@ -0,0 +1,112 @@
+#ifndef HIDDIFYNG_JSON_WRITER_H
+#define HIDDIFYNG_JSON_WRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+/**
+ * Streaming JSON writer used by the native config emitters
+ *
+ * Tracks whether a comma is needed at each nesting level so callers can
+ * emit keys and values in order without building a DOM.
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out_(out) {}
+
+    JsonWriter& begin_object() { separate(); out_.push_back('{'); push(); return *this; }
+    JsonWriter& end_object() { pop(); out_.push_back('}'); return *this; }
+    JsonWriter& begin_array() { separate(); out_.push_back('['); push(); return *this; }
+    JsonWriter& end_array() { pop(); out_.push_back(']'); return *this; }
+
+    JsonWriter& key(std::string_view name) {
+        separate();
+        quote(name);
+        out_.push_back(':');
+        after_key_ = true;
+        return *this;
+    }
+
+    JsonWriter& value(std::string_view v) { separate(); quote(v); return *this; }
+    JsonWriter& value(const char* v) { return value(std::string_view(v)); }
+    JsonWriter& value(bool v) { separate(); out_.append(v ? "true" : "false"); return *this; }
+    JsonWriter& value(int64_t v) {
+        separate();
+        char buf[24];
+        int n = snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(v));
+        out_.append(buf, n);
+        return *this;
+    }
+    JsonWriter& value(int v) { return value(static_cast<int64_t>(v)); }
+    JsonWriter& value(double v) {
+        // Integral values print without an exponent so ports and sizes round-trip
+        if (v == static_cast<double>(static_cast<int64_t>(v)) && v > -9e15 && v < 9e15) {
+            return value(static_cast<int64_t>(v));
+        }
+        separate();
+        char buf[32];
+        int n = snprintf(buf, sizeof(buf), "%.17g", v);
+        out_.append(buf, n);
+        return *this;
+    }
+
+    /** Append an already-serialized JSON value verbatim */
+    JsonWriter& raw(std::string_view json) { separate(); out_.append(json.data(), json.size()); return *this; }
+
+    template <typename T>
+    JsonWriter& field(std::string_view name, T v) { key(name); return value(v); }
+
+    /** Emit the field only when the string is non-empty */
+    JsonWriter& field_if(std::string_view name, std::string_view v) {
+        if (!v.empty()) field(name, v);
+        return *this;
+    }
+
+private:
+    static constexpr int kMaxDepth = 64;
+
+    void separate() {
+        if (after_key_) {
+            after_key_ = false;
+            return;
+        }
+        if (depth_ > 0) {
+            if (has_items_[depth_ - 1]) out_.push_back(',');
+            has_items_[depth_ - 1] = true;
+        }
+    }
+
+    void push() { if (depth_ < kMaxDepth) has_items_[depth_++] = false; }
+    void pop() { if (depth_ > 0) depth_--; }
+
+    void quote(std::string_view s) {
+        out_.push_back('"');
+        for (char c : s) {
+            switch (c) {
+                case '"': out_.append("\\\""); break;
+                case '\\': out_.append("\\\\"); break;
+                case '\n': out_.append("\\n"); break;
+                case '\r': out_.append("\\r"); break;
+                case '\t': out_.append("\\t"); break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char esc[8];
+                        snprintf(esc, sizeof(esc), "\\u%04x", c);
+                        out_.append(esc);
+                    } else {
+                        out_.push_back(c);
+                    }
+            }
+        }
+        out_.push_back('"');
+    }
+
+    std::string& out_;
+    bool has_items_[kMaxDepth] = {};
+    int depth_ = 0;
+    bool after_key_ = false;
+};
+
+#endif // HIDDIFYNG_JSON_WRITER_H
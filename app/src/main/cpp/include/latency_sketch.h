@@ -0,0 +1,55 @@
+#ifndef HIDDIFYNG_LATENCY_SKETCH_H
+#define HIDDIFYNG_LATENCY_SKETCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Per-server latency histogram
+ *
+ * A log-linear (HDR-style) histogram over microseconds: values below 32 us
+ * get a bucket each, every power of two above is split into 32 buckets, so
+ * any quantile is within about 3% of the true sample. Counts are halved
+ * whenever the total passes kDecayThreshold, so samples from earlier runs
+ * fade instead of pinning the distribution forever. Only non-empty buckets
+ * are serialized, which keeps a typical server's blob under 100 bytes.
+ */
+namespace latency_sketch {
+
+constexpr int kSubBucketBits = 5;
+constexpr int kMaxExponent = 26;  // values are clamped below 2^26 us (~67 s)
+constexpr size_t kBucketCount = (1u << kSubBucketBits) * (kMaxExponent - kSubBucketBits + 1);
+constexpr uint32_t kDecayThreshold = 256;
+
+class Sketch {
+public:
+    Sketch() : counts_{} {}
+
+    void add(int64_t value_us);
+    void merge(const Sketch& other);
+
+    uint64_t count() const { return total_; }
+
+    /**
+     * Value at quantile q (0..1), a bucket midpoint
+     * @return Microseconds, or -1 when the sketch is empty
+     */
+    int64_t quantile(double q) const;
+
+    /** Append the serialized form: version byte, then (bucket delta, count) varints */
+    void encode(std::string& out) const;
+
+    /** @return false when data is not a sketch; out is left empty then */
+    bool decode(const uint8_t* data, size_t size);
+
+private:
+    void decay();
+
+    uint32_t counts_[kBucketCount];
+    uint64_t total_ = 0;
+};
+
+} // namespace latency_sketch
+
+#endif // HIDDIFYNG_LATENCY_SKETCH_H
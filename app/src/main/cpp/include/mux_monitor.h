@@ -0,0 +1,73 @@
+#ifndef HIDDIFYNG_MUX_MONITOR_H
+#define HIDDIFYNG_MUX_MONITOR_H
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * Live mux concurrency tuning from the core's own sockets
+ *
+ * Streams are the connections accepted on the local inbound; tunnels are
+ * the core's established connections to the server. A tunnel with an RTO
+ * in progress or a deep unacknowledged send queue stalls every stream
+ * multiplexed onto it (head-of-line blocking), so the tuner backs off
+ * concurrency multiplicatively on stalls and grows it additively while
+ * streams outnumber the slots the current tunnels offer.
+ */
+namespace mux_monitor {
+
+struct Sample {
+    bool available = false;  // the socket tables could be read at all
+    int streams = 0;         // established connections on the inbound port
+    int tunnels = 0;         // established connections to the server port
+    int stalled_tunnels = 0; // tunnels retransmitting or with a deep send queue
+    int64_t queued_bytes = 0;
+};
+
+/**
+ * Read the socket table of a process
+ * Uses /proc/<pid>/fd to find the process's sockets and /proc/<pid>/net/tcp{,6}
+ * for their state. Android 10 and later deny apps the tables; the sample is
+ * then marked unavailable rather than reporting an idle link
+ * @return false if the process is gone
+ */
+bool sample_process(pid_t pid, int inbound_port, int server_port, Sample& out);
+
+constexpr int kMinConcurrency = 1;
+constexpr int kMaxConcurrency = 32;
+
+/**
+ * Recommends concurrency relative to the value the core is running with;
+ * changes take effect on the next reconnect, so recommendations do not
+ * compound while the same config keeps running
+ */
+class Tuner {
+public:
+    /** Start observing a core running with this concurrency */
+    void reset(int running_concurrency);
+
+    /**
+     * Add a sample and return the concurrency to use from the next reconnect;
+     * unavailable samples are not counted
+     */
+    int update(const Sample& sample);
+
+    int recommended();
+
+private:
+    static constexpr size_t kWindow = 30;     // samples kept
+    static constexpr size_t kMinSamples = 5;  // before any change
+
+    std::mutex mutex_;
+    std::vector<Sample> window_;
+    size_t next_ = 0;
+    int running_ = 8;
+    int recommended_ = 8;
+};
+
+} // namespace mux_monitor
+
+#endif // HIDDIFYNG_MUX_MONITOR_H
@@ -0,0 +1,15 @@
+#ifndef HIDDIFYNG_NATIVE_LOG_H
+#define HIDDIFYNG_NATIVE_LOG_H
+
+#include <android/log.h>
+
+#ifndef LOG_TAG
+#define LOG_TAG "XrayCoreJNI"
+#endif
+
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+#endif // HIDDIFYNG_NATIVE_LOG_H
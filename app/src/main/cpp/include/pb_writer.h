@@ -0,0 +1,80 @@
+#ifndef HIDDIFYNG_PB_WRITER_H
+#define HIDDIFYNG_PB_WRITER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Minimal protobuf wire-format encoder
+ *
+ * Only covers what the Xray config messages need: varints, bools,
+ * length-delimited strings/bytes and nested messages. Nested messages are
+ * built in their own writer and appended with message(), which keeps the
+ * length prefix exact without a second sizing pass.
+ */
+class PbWriter {
+public:
+    enum WireType : uint32_t {
+        kVarint = 0,
+        kLengthDelimited = 2,
+    };
+
+    void varint(uint32_t field, uint64_t value) {
+        if (value == 0) return; // proto3 default, omitted on the wire
+        tag(field, kVarint);
+        raw_varint(value);
+    }
+
+    void boolean(uint32_t field, bool value) {
+        if (!value) return;
+        tag(field, kVarint);
+        buf_.push_back(1);
+    }
+
+    void string(uint32_t field, std::string_view value) {
+        if (value.empty()) return;
+        bytes(field, value);
+    }
+
+    /** Length-delimited field that is emitted even when empty */
+    void bytes(uint32_t field, std::string_view value) {
+        tag(field, kLengthDelimited);
+        raw_varint(value.size());
+        buf_.append(value.data(), value.size());
+    }
+
+    void message(uint32_t field, const PbWriter& sub) {
+        bytes(field, sub.data());
+    }
+
+    /** xray.common.serial.TypedMessage { string type = 1; bytes value = 2; } */
+    void typed_message(uint32_t field, std::string_view type, const PbWriter& value) {
+        PbWriter typed;
+        typed.string(1, type);
+        typed.bytes(2, value.data());
+        message(field, typed);
+    }
+
+    const std::string& data() const { return buf_; }
+    std::string& data() { return buf_; }
+    size_t size() const { return buf_.size(); }
+    void clear() { buf_.clear(); }
+
+private:
+    void tag(uint32_t field, WireType type) {
+        raw_varint((static_cast<uint64_t>(field) << 3) | type);
+    }
+
+    void raw_varint(uint64_t value) {
+        while (value >= 0x80) {
+            buf_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        buf_.push_back(static_cast<char>(value));
+    }
+
+    std::string buf_;
+};
+
+#endif // HIDDIFYNG_PB_WRITER_H
@@ -0,0 +1,68 @@
+#ifndef HIDDIFYNG_PROBE_CACHE_H
+#define HIDDIFYNG_PROBE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+ * Recent probe results shared by every caller that pings servers
+ *
+ * The background worker and the UI's "test all" probe the same endpoints;
+ * whichever ran last leaves its results here, and the other takes any that
+ * are still fresh instead of probing again. The table is a fixed-size file
+ * mapped with MAP_SHARED, so results outlive the process that measured them
+ * and the kernel writes them back without explicit saves. Entries are keyed
+ * by (host, port, transport) and stamped with wall-clock time; successes
+ * stay fresh longer than failures, which are worth retrying sooner. Each
+ * slot carries a sequence counter so a reader never sees a half-written
+ * entry.
+ */
+namespace probe_cache {
+
+constexpr int64_t kFreshReachableMs = 2 * 60 * 1000;
+constexpr int64_t kFreshFailedMs = 30 * 1000;
+
+// lookup() results that are not a ping
+constexpr int32_t kMiss = 0;
+constexpr int32_t kFailed = -1;
+
+struct Key {
+    std::string host;
+    int port = 0;
+    int transport = 0;  // endpoint_dedup::Transport
+};
+
+class Cache {
+public:
+    Cache() = default;
+    Cache(const Cache&) = delete;
+    Cache& operator=(const Cache&) = delete;
+    ~Cache();
+
+    /** Map the table at path, creating or resetting it when missing or corrupt */
+    bool open(const std::string& path);
+
+    /**
+     * @return Ping in milliseconds, kFailed for a fresh failure, or kMiss when the
+     *         endpoint has no fresh entry or the cache is not open
+     */
+    int32_t lookup(const Key& key, int64_t now_ms) const;
+
+    /** Record a result; a ping of 0 or less records a failure */
+    void store(const Key& key, int32_t ping_ms, int64_t now_ms);
+
+private:
+    struct Slot;
+
+    Slot* slots_ = nullptr;
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    std::string path_;
+    std::mutex mutex_;  // serializes writers and open(); readers go by slot sequence
+};
+
+} // namespace probe_cache
+
+#endif // HIDDIFYNG_PROBE_CACHE_H
@@ -0,0 +1,79 @@
+#ifndef HIDDIFYNG_PROBE_SCHEDULER_H
+#define HIDDIFYNG_PROBE_SCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Decides which servers a ping run probes
+ *
+ * Every server gets a refresh interval from what is known about it: steady
+ * servers are re-probed up to 4x less often than jittery ones, servers the
+ * user is unlikely to pick (not a favorite, not selected, not among the
+ * fastest) 4x less often again, and unreachable ones back off exponentially
+ * up to a day. A run probes only servers past their interval, most overdue
+ * and most important first, up to a budget; servers never probed always
+ * go. State persists in a compact fixed-record file.
+ */
+namespace probe_scheduler {
+
+enum Flags : uint32_t {
+    kFavorite = 1,
+    kSelected = 2,
+};
+
+struct Candidate {
+    int64_t server_id;
+    uint32_t flags;
+};
+
+class Scheduler {
+public:
+    /** Load state from path; a missing or corrupt file starts empty */
+    bool open(const std::string& path);
+
+    /**
+     * Servers to probe now, most urgent first. Forgets servers not in the list
+     * @param budget Probes for servers already known; new ones come on top
+     * @param now Unix seconds
+     */
+    std::vector<int64_t> plan(const std::vector<Candidate>& servers, size_t budget, uint32_t now);
+
+    /** Seconds until the next server falls due, 0 if one already is */
+    uint32_t next_due(const std::vector<Candidate>& servers, uint32_t now);
+
+    /**
+     * Fold in one probe
+     * @param latency_ms Negative when the server did not answer
+     */
+    void record(int64_t server_id, float latency_ms, uint32_t now);
+
+    /** Persist to the opened path */
+    bool save();
+
+private:
+    struct Entry {
+        int64_t server_id;
+        uint32_t probed;     // unix seconds
+        uint16_t failures;   // consecutive
+        uint16_t count;
+        float mean_ms;       // EWMA of answered probes
+        float variance;      // exponentially weighted, ms^2
+    };
+
+    Entry* find(int64_t server_id);
+    double interval_of(const Entry& entry, uint32_t flags, bool fast) const;
+    std::vector<bool> fastest(const std::vector<Candidate>& servers);
+
+    std::mutex mutex_;
+    std::string path_;
+    std::vector<Entry> entries_;
+    bool dirty_ = false;
+};
+
+} // namespace probe_scheduler
+
+#endif // HIDDIFYNG_PROBE_SCHEDULER_H
@@ -0,0 +1,32 @@
+#ifndef HIDDIFYNG_PROC_SOCKETS_H
+#define HIDDIFYNG_PROC_SOCKETS_H
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <unordered_map>
+
+/**
+ * Sockets held by a process, from its /proc/<pid>/fd links
+ *
+ * The mux monitor and the tunnel sampler both match the core's sockets by
+ * inode on the same few-second tick, so they share one walk of the
+ * descriptor table: a listing of the same process younger than kMaxAgeMs is
+ * handed out again instead of reading every link a second time.
+ */
+namespace proc_sockets {
+
+constexpr int64_t kMaxAgeMs = 1000;
+
+/** Socket inode to descriptor number in the process */
+using Sockets = std::unordered_map<uint64_t, int>;
+
+/**
+ * List the sockets of a process
+ * @return false if the process is gone or its descriptors cannot be listed
+ */
+bool list(pid_t pid, Sockets& out);
+
+} // namespace proc_sockets
+
+#endif // HIDDIFYNG_PROC_SOCKETS_H
@@ -0,0 +1,75 @@
+#ifndef HIDDIFYNG_SERVER_RECORD_H
+#define HIDDIFYNG_SERVER_RECORD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * Flattened view of the Kotlin Server entity.
+ *
+ * Records are produced by NativeServerRecords.kt into a single direct
+ * ByteBuffer and decoded here without copying: every string field is a
+ * view into the caller's buffer, so the buffer must outlive the records.
+ *
+ * Buffer layout (little-endian):
+ *   u32 magic ('SVR1'), u32 record_count, then per record:
+ *   u32 record_size, i64 id, i32 port, i32 up_mbps, i32 down_mbps,
+ *   u32 flags, u16 field_count, field_count x { u8 id, u8 0, u16 len, bytes }
+ */
+namespace server_record {
+
+constexpr uint32_t kMagic = 0x31525653; // "SVR1"
+
+enum Field : uint8_t {
+    kName = 0,
+    kProtocol,
+    kAddress,
+    kUserId,
+    kPassword,
+    kSecurityType,
+    kTlsServerName,
+    kTlsFingerprint,
+    kNetwork,
+    kWsPath,
+    kHeader,
+    kRealityPublicKey,
+    kRealityShortId,
+    kRealitySpiderX,
+    kHysteriaProtocol,
+    kHysteriaObfs,
+    kXhttpHost,
+    kXhttpPath,
+    kFlow,
+    kFieldCount
+};
+
+enum Flags : uint32_t {
+    kFlagTls = 1u << 0,
+    kFlagFavorite = 1u << 1,
+    kFlagSelected = 1u << 2,
+};
+
+struct ServerRecord {
+    int64_t id = 0;
+    int32_t port = 0;
+    int32_t up_mbps = 0;
+    int32_t down_mbps = 0;
+    uint32_t flags = 0;
+    std::string_view fields[kFieldCount];
+
+    std::string_view get(Field f) const { return fields[f]; }
+    bool has(Field f) const { return !fields[f].empty(); }
+    bool tls() const { return (flags & kFlagTls) != 0; }
+};
+
+/**
+ * Decode every record in the buffer
+ * @return false if the buffer is truncated or has a bad magic
+ */
+bool decode(const uint8_t* data, size_t size, std::vector<ServerRecord>& out);
+
+} // namespace server_record
+
+#endif // HIDDIFYNG_SERVER_RECORD_H
@@ -0,0 +1,96 @@
+#ifndef HIDDIFYNG_SHARE_LINK_H
+#define HIDDIFYNG_SHARE_LINK_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Share-link codec for vmess, vless, trojan, ss, hysteria, reality and xhttp
+ *
+ * Every scheme is described by a compile-time table of query keys (with
+ * their aliases) mapped onto slots of one flat Link, so parsing and
+ * generation share a single splitter, percent codec and Base64 path instead
+ * of one hand-written parser per protocol.
+ */
+namespace share_link {
+
+enum Scheme : int32_t {
+    kVmess = 0,
+    kVless,
+    kTrojan,
+    kShadowsocks,
+    kHysteria,
+    kReality,
+    kXhttp,
+    kSchemeCount
+};
+
+enum Field : uint8_t {
+    kName = 0,
+    kAddress,
+    kUserId,      // vmess/vless/reality/xhttp uuid
+    kPassword,    // trojan and shadowsocks password, hysteria auth
+    kMethod,      // vmess security or shadowsocks cipher
+    kNetwork,
+    kSecurity,    // "tls", "reality" or empty
+    kSni,
+    kAlpn,
+    kFingerprint,
+    kFlow,
+    kPath,
+    kHost,
+    kServiceName,
+    kHeaderType,
+    kPublicKey,
+    kShortId,
+    kSpiderX,
+    kHysteriaProtocol,
+    kObfs,
+    kEncryption,
+    kFieldCount
+};
+
+enum Number : uint8_t {
+    kPort = 0,
+    kAlterId,
+    kUpMbps,
+    kDownMbps,
+    kInsecure,    // 0 or 1
+    kNumberCount
+};
+
+struct Link {
+    Scheme scheme = kVless;
+    std::string fields[kFieldCount];
+    int32_t numbers[kNumberCount] = {};
+
+    const std::string& get(Field f) const { return fields[f]; }
+    int32_t number(Number n) const { return numbers[n]; }
+    void clear();
+};
+
+/** Scheme name as used by the Server entity ("shadowsocks", not "ss") */
+std::string_view scheme_name(Scheme scheme);
+
+/**
+ * Parse one share link; unknown query keys are ignored
+ * @return false when the scheme is unknown or the authority is malformed
+ */
+bool parse(std::string_view uri, Link& out);
+
+/** Write the canonical link for the scheme's fields; out is appended to */
+void generate(const Link& link, std::string& out);
+
+/**
+ * Parse and regenerate the links back to back for about duration_ms
+ * @param parse_ns Mean parse time per link
+ * @param generate_ns Mean generate time per link
+ * @return Number of links that parsed
+ */
+int benchmark(const std::string* uris, size_t count, int duration_ms,
+              int64_t& parse_ns, int64_t& generate_ns);
+
+} // namespace share_link
+
+#endif // HIDDIFYNG_SHARE_LINK_H
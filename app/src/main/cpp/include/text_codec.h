@@ -0,0 +1,114 @@
+#ifndef HIDDIFYNG_TEXT_CODEC_H
+#define HIDDIFYNG_TEXT_CODEC_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Small text codecs shared by the config builder, validator and link codec
+ */
+namespace text_codec {
+
+/**
+ * Decode standard or URL-safe Base64, with or without padding
+ * Whitespace is ignored. @return false on any other invalid character
+ */
+inline bool base64_decode(std::string_view in, std::string& out) {
+    out.clear();
+    out.reserve(in.size() * 3 / 4);
+    uint32_t acc = 0;
+    int bits = 0;
+    for (char c : in) {
+        int v;
+        if (c >= 'A' && c <= 'Z') v = c - 'A';
+        else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') v = c - '0' + 52;
+        else if (c == '+' || c == '-') v = 62;
+        else if (c == '/' || c == '_') v = 63;
+        else if (c == '=') break;
+        else if (c == '\n' || c == '\r' || c == ' ' || c == '\t') continue;
+        else return false;
+        acc = (acc << 6) | static_cast<uint32_t>(v);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>((acc >> bits) & 0xFF));
+        }
+    }
+    return true;
+}
+
+/**
+ * Encode Base64
+ * @param url_safe use the '-_' alphabet
+ * @param pad append '=' padding
+ */
+inline void base64_encode(std::string_view in, std::string& out, bool url_safe, bool pad) {
+    static const char kStd[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    static const char kUrl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    const char* alphabet = url_safe ? kUrl : kStd;
+    size_t i = 0;
+    for (; i + 2 < in.size(); i += 3) {
+        uint32_t n = (static_cast<uint8_t>(in[i]) << 16) | (static_cast<uint8_t>(in[i + 1]) << 8) |
+                     static_cast<uint8_t>(in[i + 2]);
+        out.push_back(alphabet[(n >> 18) & 63]);
+        out.push_back(alphabet[(n >> 12) & 63]);
+        out.push_back(alphabet[(n >> 6) & 63]);
+        out.push_back(alphabet[n & 63]);
+    }
+    size_t rest = in.size() - i;
+    if (rest > 0) {
+        uint32_t n = static_cast<uint8_t>(in[i]) << 16;
+        if (rest == 2) n |= static_cast<uint8_t>(in[i + 1]) << 8;
+        out.push_back(alphabet[(n >> 18) & 63]);
+        out.push_back(alphabet[(n >> 12) & 63]);
+        if (rest == 2) out.push_back(alphabet[(n >> 6) & 63]);
+        if (pad) out.append(rest == 1 ? "==" : "=");
+    }
+}
+
+inline int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * Decode an even-length hex string
+ */
+inline bool hex_decode(std::string_view in, std::string& out) {
+    out.clear();
+    if (in.size() % 2 != 0) return false;
+    for (size_t i = 0; i < in.size(); i += 2) {
+        int hi = hex_value(in[i]);
+        int lo = hex_value(in[i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out.push_back(static_cast<char>((hi << 4) | lo));
+    }
+    return true;
+}
+
+/**
+ * Parse a decimal integer, @return false on trailing garbage or overflow
+ */
+inline bool parse_int(std::string_view in, long long& out) {
+    if (in.empty()) return false;
+    bool negative = in[0] == '-';
+    size_t i = negative ? 1 : 0;
+    if (i == in.size()) return false;
+    long long value = 0;
+    for (; i < in.size(); i++) {
+        char c = in[i];
+        if (c < '0' || c > '9') return false;
+        if (value > (INT64_MAX - (c - '0')) / 10) return false;
+        value = value * 10 + (c - '0');
+    }
+    out = negative ? -value : value;
+    return true;
+}
+
+} // namespace text_codec
+
+#endif // HIDDIFYNG_TEXT_CODEC_H
@@ -0,0 +1,66 @@
+#ifndef HIDDIFYNG_TLS_PROBER_H
+#define HIDDIFYNG_TLS_PROBER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * TLS handshake timing prober
+ *
+ * Sends a ClientHello shaped like the server's uTLS fingerprint (cipher
+ * order, extensions, GREASE, padding) with the configured SNI, and times
+ * the server's answer without completing the key exchange: TCP connect,
+ * first response byte, full ServerHello, and the end of the server's first
+ * flight. For TLS 1.2 that flight ends at ServerHelloDone; for TLS 1.3 it
+ * is encrypted, so it ends at the last record received before the
+ * connection goes quiet for about one round trip. A REALITY server answers
+ * an unauthenticated hello by relaying its target site, so its timings
+ * include that relay.
+ */
+namespace tls_prober {
+
+struct Target {
+    std::string host;         // name or literal address to connect to
+    int port = 0;
+    std::string sni;          // empty sends no server_name
+    std::string fingerprint;  // uTLS name: chrome, firefox, safari, ios, edge, random...
+};
+
+struct Options {
+    int timeout_ms = 3000;   // per target, connect included
+    int max_in_flight = 64;
+};
+
+enum Status : int32_t {
+    kOk = 0,
+    kTimeout = 1,
+    kRefused = 2,
+    kUnreachable = 3,
+    kResolveFailed = 4,
+    kHandshakeFailed = 5,  // alert, close or non-TLS bytes before ServerHello
+    kError = 6,
+};
+
+/** Phase times, all measured from the start of the TCP connect */
+struct Result {
+    size_t index = 0;
+    Status status = kError;
+    int64_t connect_ns = 0;
+    int64_t first_byte_ns = 0;
+    int64_t server_hello_ns = 0;
+    int64_t handshake_ns = 0;  // 0 when the flight did not finish (e.g. HelloRetryRequest)
+    uint16_t version = 0;      // negotiated, 0x0304 for TLS 1.3
+    uint16_t cipher = 0;
+};
+
+/**
+ * Probe every target concurrently; blocks until all finish or time out
+ * @return One result per target, in input order
+ */
+std::vector<Result> run(const std::vector<Target>& targets, const Options& options);
+
+} // namespace tls_prober
+
+#endif // HIDDIFYNG_TLS_PROBER_H
@@ -0,0 +1,83 @@
+#ifndef HIDDIFYNG_TUNING_STORE_H
+#define HIDDIFYNG_TUNING_STORE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Closed-loop tuning of per-server transport settings
+ *
+ * Mux concurrency and socket buffer size are chosen from a small grid.
+ * Every session reports measured goodput, RTT and retransmit rate for the
+ * (network type, server, grid cell) it used; selection then hill-climbs
+ * over neighbouring cells with a UCB exploration bonus, so it settles on
+ * the best local setting across sessions. Statistics persist in a compact
+ * fixed-record file.
+ */
+namespace tuning_store {
+
+/** Grid axes; mux 0 means disabled */
+constexpr int kMuxLevels[] = {0, 2, 4, 8, 16};
+constexpr int kBufferLevels[] = {512 * 1024, 1024 * 1024, 2 * 1024 * 1024, 4 * 1024 * 1024};
+constexpr int kMuxLevelCount = sizeof(kMuxLevels) / sizeof(kMuxLevels[0]);
+constexpr int kBufferLevelCount = sizeof(kBufferLevels) / sizeof(kBufferLevels[0]);
+
+struct Settings {
+    int mux_concurrency;
+    int buffer_bytes;
+};
+
+struct Sample {
+    float goodput_kbps;
+    float rtt_ms;
+    float retransmit_rate; // retransmitted / sent segments, 0..1
+};
+
+class Store {
+public:
+    /** Load statistics from path; a missing or corrupt file starts empty */
+    bool open(const std::string& path);
+
+    /**
+     * Settings to use for the next session
+     * @param fallback Used (snapped to the grid) when nothing is known yet
+     * @param pin_buffer Keep the buffer at the fallback's grid level and only
+     *                   tune mux, for callers that size buffers from the BDP
+     */
+    Settings select(uint8_t network, int64_t server_id, Settings fallback, bool pin_buffer);
+
+    /** Best smoothed goodput seen for the server on this network, 0 if unknown */
+    float goodput_kbps(uint8_t network, int64_t server_id);
+
+    /** Fold one session's measurements into the cell the settings map to */
+    void record(uint8_t network, int64_t server_id, Settings used, const Sample& sample);
+
+    /** Persist to the opened path */
+    bool save();
+
+private:
+    struct Entry {
+        int64_t server_id;
+        uint8_t network;
+        uint8_t cell;
+        uint16_t count;
+        float goodput_kbps;
+        float rtt_ms;
+        float retransmit_rate;
+        uint32_t updated; // unix seconds
+    };
+
+    Entry* find(uint8_t network, int64_t server_id, int cell);
+    void evict_oldest();
+
+    std::mutex mutex_;
+    std::string path_;
+    std::vector<Entry> entries_;
+    bool dirty_ = false;
+};
+
+} // namespace tuning_store
+
+#endif // HIDDIFYNG_TUNING_STORE_H
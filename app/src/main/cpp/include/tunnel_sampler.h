@@ -0,0 +1,94 @@
+#ifndef HIDDIFYNG_TUNNEL_SAMPLER_H
+#define HIDDIFYNG_TUNNEL_SAMPLER_H
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Passive path quality of the core's live tunnels
+ *
+ * Reads the kernel's TCP state (struct tcp_info) of the core's established
+ * connections to the server: smoothed RTT and its variance, congestion
+ * window, retransmissions and delivery rate, which is what the user's
+ * traffic is experiencing right now, without sending a single probe. Each
+ * of the core's sockets is duplicated into this process with pidfd_getfd
+ * and read with getsockopt(TCP_INFO); where that is refused, established
+ * sockets are dumped through NETLINK_SOCK_DIAG and matched to the core by
+ * inode instead. The sockets come from proc_sockets, the listing the mux
+ * monitor uses too.
+ */
+namespace tunnel_sampler {
+
+enum Source : int32_t {
+    kNone = 0,        // neither path could read the tunnels
+    kSockDiag = 1,
+    kDuplicated = 2,  // pidfd_getfd + TCP_INFO
+};
+
+struct TcpStats {
+    uint64_t inode = 0;
+    uint32_t srtt_us = 0;
+    uint32_t rttvar_us = 0;
+    uint32_t min_rtt_us = 0;
+    uint32_t snd_cwnd = 0;     // segments
+    uint32_t snd_mss = 0;
+    uint32_t unacked = 0;      // segments in flight
+    uint32_t backoff = 0;      // consecutive RTOs on the oldest unacked segment
+    uint32_t total_retrans = 0;
+    uint32_t segs_out = 0;
+    uint64_t bytes_acked = 0;
+    uint64_t delivery_rate = 0;  // bytes per second, 0 on kernels before 4.9
+};
+
+/**
+ * Read the established TCP connections of a process to a remote port
+ * Loopback peers (the core's own inbounds) are skipped
+ * @return false if the process is gone
+ */
+bool read_process(pid_t pid, int server_port, std::vector<TcpStats>& out, Source& source);
+
+/**
+ * One observation across all tunnels; RTT and window come from the tunnel
+ * that acknowledged the most data since the previous sample, the one the
+ * user's traffic is actually on, and counters are deltas since then
+ */
+struct Quality {
+    Source source = kNone;
+    int tunnels = 0;
+    int stalled = 0;            // tunnels waiting on a retransmission timeout
+    int64_t srtt_us = 0;
+    int64_t rttvar_us = 0;
+    int64_t min_rtt_us = 0;
+    int64_t cwnd_bytes = 0;
+    int64_t delivery_rate = 0;  // bytes per second, summed over tunnels
+    int64_t acked_bytes = 0;
+    int64_t sent_segments = 0;
+    int64_t retransmitted_segments = 0;
+};
+
+class Sampler {
+public:
+    /** Forget previous counters, e.g. after the core restarted */
+    void reset();
+
+    /** @return false if the process is gone */
+    bool sample(pid_t pid, int server_port, Quality& out);
+
+private:
+    struct Counters {
+        uint64_t bytes_acked;
+        uint32_t segs_out;
+        uint32_t total_retrans;
+    };
+
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, Counters> previous_;
+};
+
+} // namespace tunnel_sampler
+
+#endif // HIDDIFYNG_TUNNEL_SAMPLER_H
@@ -0,0 +1,67 @@
+#ifndef HIDDIFYNG_UDP_PROBER_H
+#define HIDDIFYNG_UDP_PROBER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * UDP round-trip, loss and jitter prober for QUIC servers
+ *
+ * Hysteria and TUIC listen with QUIC, which answers any long-header packet
+ * carrying an unknown version with a Version Negotiation packet before any
+ * crypto (RFC 9000 section 6), so a padded Initial-shaped datagram with a
+ * reserved version draws a cleartext reply from the real server port. Each
+ * host gets a paced train of these; the reply echoes the connection ID the
+ * probe was sent with, which identifies host and sample. Trains of all
+ * hosts share one socket per address family, go out with sendmmsg and come
+ * back in recvmmsg batches with kernel receive timestamps, so RTTs do not
+ * include the time a batch waited to be read. Servers that obfuscate their
+ * packets (Hysteria 2 salamander, faketcp) never answer and are not worth
+ * probing this way.
+ */
+namespace udp_prober {
+
+struct Target {
+    std::string host;  // name or literal address
+    int port = 0;
+};
+
+struct Options {
+    int count = 10;         // probes per host
+    int interval_ms = 20;   // between probes to the same host
+    int timeout_ms = 1000;  // per probe
+};
+
+enum Status : int32_t {
+    kOk = 0,
+    kTimeout = 1,        // no probe was answered
+    kRefused = 2,        // ICMP port unreachable: nothing listens on the UDP port
+    kUnreachable = 3,    // ICMP host/network unreachable, or no route
+    kResolveFailed = 4,
+    kError = 5,
+};
+
+struct Result {
+    size_t index = 0;      // into the targets passed to run()
+    Status status = kError;
+    int sent = 0;
+    int received = 0;
+    int64_t min_ns = 0;
+    int64_t avg_ns = 0;
+    int64_t max_ns = 0;
+    int64_t jitter_ns = 0;      // mean difference between consecutive RTTs
+    uint32_t quic_version = 0;  // first version the server offered, 0 if none
+};
+
+/**
+ * Probe every target concurrently; blocks for about
+ * (count - 1) * interval_ms + timeout_ms once names are resolved
+ * @return One result per target, in input order
+ */
+std::vector<Result> run(const std::vector<Target>& targets, const Options& options);
+
+} // namespace udp_prober
+
+#endif // HIDDIFYNG_UDP_PROBER_H
@@ -0,0 +1,66 @@
+#ifndef HIDDIFYNG_URL_TESTER_H
+#define HIDDIFYNG_URL_TESTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * End-to-end URL test through local SOCKS inbounds
+ *
+ * A batch core config (config_builder::build_batch) gives every server its
+ * own SOCKS inbound; this fetches an HTTP URL through each inbound at once
+ * from one epoll loop and times each fetch from the local connect to the
+ * response status line, so the result covers the proxy handshake, the
+ * server's hop to the target and the HTTP round trip. Only plain http://
+ * targets are supported: the request is written by hand.
+ *
+ * With a body budget the same fetch becomes a throughput probe: the response
+ * body is read until the byte or time budget runs out and goodput is taken
+ * from the first body byte to the last, so the proxy handshake and the time
+ * to first byte do not dilute it.
+ */
+namespace url_tester {
+
+struct Options {
+    std::string url = "http://www.gstatic.com/generate_204";
+    int samples = 1;          // fetches per inbound, each on a fresh connection
+    int timeout_ms = 5000;    // per fetch
+    int max_in_flight = 64;
+    int ready_timeout_ms = 3000;  // wait for the core's inbounds to accept
+    int64_t body_bytes = 0;   // body to read and time per fetch; 0 stops at the status line
+    int body_ms = 3000;       // cap on the body read; the fetch counts as measured when it hits
+};
+
+enum Status : int32_t {
+    kOk = 0,
+    kTimeout = 1,
+    kRefused = 2,        // nothing listens on the inbound port
+    kProxyFailed = 3,    // the SOCKS inbound rejected or dropped the CONNECT
+    kBadResponse = 4,    // reached something, but not a 204 (200 or 206 with a body budget)
+    kError = 5,
+};
+
+struct Result {
+    size_t index = 0;     // into the ports passed to run()
+    Status status = kError;
+    int http_status = 0;  // of the last response seen
+    int64_t best_ns = 0;
+    int64_t mean_ns = 0;
+    int successes = 0;
+    int attempts = 0;
+    int64_t body_bytes = 0;  // read over all measured fetches
+    int64_t body_ns = 0;     // from first to last body byte, summed over measured fetches
+};
+
+/**
+ * Fetch options.url through 127.0.0.1:port for every port concurrently
+ * Waits up to ready_timeout_ms for the first inbound to accept before starting
+ * @return One result per port in input order; empty if the URL is not http://
+ */
+std::vector<Result> run(const std::vector<int>& ports, const Options& options);
+
+} // namespace url_tester
+
+#endif // HIDDIFYNG_URL_TESTER_H
@@ -0,0 +1,12 @@
+#ifndef HIDDIFYNG_XRAY_PROCESS_H
+#define HIDDIFYNG_XRAY_PROCESS_H
+
+#include <sys/types.h>
+
+/**
+ * PID of the running Xray core, or -1 when it is not running
+ * Implemented alongside process management in xray-core-jni.cpp
+ */
+pid_t xray_process_id();
+
+#endif // HIDDIFYNG_XRAY_PROCESS_H
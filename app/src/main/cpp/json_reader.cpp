@@ -0,0 +1,259 @@
+#include "json_reader.h"
+
+#include <cstdlib>
+
+#include "text_codec.h"
+
+namespace {
+
+constexpr int kMaxDepth = 128;
+
+void append_utf8(uint32_t cp, std::string& out) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+} // namespace
+
+/** Recursive descent parser over a borrowed buffer */
+class JsonParser {
+public:
+    explicit JsonParser(std::string_view text) : text_(text) {}
+
+    bool parse_document(JsonValue& out, std::string& error) {
+        skip_ws();
+        if (!parse_value(out, 0)) {
+            error = error_ + " at offset " + std::to_string(pos_);
+            return false;
+        }
+        skip_ws();
+        if (pos_ != text_.size()) {
+            error = "trailing data at offset " + std::to_string(pos_);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool fail(const char* message) {
+        error_ = message;
+        return false;
+    }
+
+    void skip_ws() {
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+            pos_++;
+        }
+    }
+
+    bool consume(std::string_view literal) {
+        if (text_.substr(pos_, literal.size()) != literal) return false;
+        pos_ += literal.size();
+        return true;
+    }
+
+    bool parse_value(JsonValue& out, int depth) {
+        if (depth > kMaxDepth) return fail("nesting too deep");
+        if (pos_ >= text_.size()) return fail("unexpected end of input");
+
+        switch (text_[pos_]) {
+            case '{': return parse_object(out, depth);
+            case '[': return parse_array(out, depth);
+            case '"':
+                out.type_ = JsonValue::kString;
+                return parse_string(out.string_);
+            case 't':
+                if (!consume("true")) return fail("invalid literal");
+                out.type_ = JsonValue::kBool;
+                out.bool_ = true;
+                return true;
+            case 'f':
+                if (!consume("false")) return fail("invalid literal");
+                out.type_ = JsonValue::kBool;
+                out.bool_ = false;
+                return true;
+            case 'n':
+                if (!consume("null")) return fail("invalid literal");
+                out.type_ = JsonValue::kNull;
+                return true;
+            default:
+                return parse_number(out);
+        }
+    }
+
+    bool parse_object(JsonValue& out, int depth) {
+        out.type_ = JsonValue::kObject;
+        pos_++; // '{'
+        skip_ws();
+        if (pos_ < text_.size() && text_[pos_] == '}') {
+            pos_++;
+            return true;
+        }
+
+        while (true) {
+            skip_ws();
+            if (pos_ >= text_.size() || text_[pos_] != '"') return fail("expected object key");
+            out.members_.emplace_back();
+            JsonValue::Member& member = out.members_.back();
+            if (!parse_string(member.first)) return false;
+
+            skip_ws();
+            if (pos_ >= text_.size() || text_[pos_] != ':') return fail("expected ':'");
+            pos_++;
+            skip_ws();
+            if (!parse_value(member.second, depth + 1)) return false;
+
+            skip_ws();
+            if (pos_ >= text_.size()) return fail("unterminated object");
+            if (text_[pos_] == ',') {
+                pos_++;
+                continue;
+            }
+            if (text_[pos_] == '}') {
+                pos_++;
+                return true;
+            }
+            return fail("expected ',' or '}'");
+        }
+    }
+
+    bool parse_array(JsonValue& out, int depth) {
+        out.type_ = JsonValue::kArray;
+        pos_++; // '['
+        skip_ws();
+        if (pos_ < text_.size() && text_[pos_] == ']') {
+            pos_++;
+            return true;
+        }
+
+        while (true) {
+            skip_ws();
+            out.items_.emplace_back();
+            if (!parse_value(out.items_.back(), depth + 1)) return false;
+
+            skip_ws();
+            if (pos_ >= text_.size()) return fail("unterminated array");
+            if (text_[pos_] == ',') {
+                pos_++;
+                continue;
+            }
+            if (text_[pos_] == ']') {
+                pos_++;
+                return true;
+            }
+            return fail("expected ',' or ']'");
+        }
+    }
+
+    bool parse_hex4(uint32_t& out) {
+        if (pos_ + 4 > text_.size()) return fail("truncated \\u escape");
+        out = 0;
+        for (int i = 0; i < 4; i++) {
+            int v = text_codec::hex_value(text_[pos_++]);
+            if (v < 0) return fail("invalid \\u escape");
+            out = (out << 4) | static_cast<uint32_t>(v);
+        }
+        return true;
+    }
+
+    bool parse_string(std::string& out) {
+        pos_++; // opening quote
+        while (pos_ < text_.size()) {
+            char c = text_[pos_++];
+            if (c == '"') return true;
+            if (static_cast<unsigned char>(c) < 0x20) return fail("control character in string");
+            if (c != '\\') {
+                out.push_back(c);
+                continue;
+            }
+
+            if (pos_ >= text_.size()) break;
+            char e = text_[pos_++];
+            switch (e) {
+                case '"': out.push_back('"'); break;
+                case '\\': out.push_back('\\'); break;
+                case '/': out.push_back('/'); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': {
+                    uint32_t cp;
+                    if (!parse_hex4(cp)) return false;
+                    if (cp >= 0xD800 && cp <= 0xDBFF) {
+                        uint32_t low;
+                        if (!consume("\\u") || !parse_hex4(low) || low < 0xDC00 || low > 0xDFFF) {
+                            return fail("invalid surrogate pair");
+                        }
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(cp, out);
+                    break;
+                }
+                default:
+                    return fail("invalid escape");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool parse_number(JsonValue& out) {
+        size_t start = pos_;
+        if (pos_ < text_.size() && text_[pos_] == '-') pos_++;
+        size_t digits = pos_;
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                pos_++;
+            } else {
+                break;
+            }
+        }
+        if (pos_ == digits) return fail("unexpected character");
+
+        std::string number(text_.substr(start, pos_ - start));
+        char* end = nullptr;
+        out.number_ = strtod(number.c_str(), &end);
+        if (end != number.c_str() + number.size()) return fail("invalid number");
+        out.type_ = JsonValue::kNumber;
+        return true;
+    }
+
+    std::string_view text_;
+    size_t pos_ = 0;
+    std::string error_;
+};
+
+const JsonValue* JsonValue::find(std::string_view key) const {
+    for (const Member& member : members_) {
+        if (member.first == key) return &member.second;
+    }
+    return nullptr;
+}
+
+std::string_view JsonValue::string_at(std::string_view key) const {
+    const JsonValue* value = find(key);
+    if (value == nullptr || !value->is_string()) return {};
+    return value->string_;
+}
+
+bool JsonValue::parse(std::string_view text, JsonValue& out, std::string& error) {
+    out = JsonValue();
+    return JsonParser(text).parse_document(out, error);
+}
@@ -0,0 +1,199 @@
+#include <jni.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "latency_sketch.h"
+#include "native_log.h"
+
+namespace latency_sketch {
+
+namespace {
+
+constexpr uint8_t kVersion = 1;
+constexpr int64_t kSubBuckets = 1 << kSubBucketBits;
+constexpr int64_t kMaxValue = (int64_t{1} << kMaxExponent) - 1;
+
+size_t bucket_of(int64_t value) {
+    value = std::clamp<int64_t>(value, 0, kMaxValue);
+    if (value < kSubBuckets) return static_cast<size_t>(value);
+    int exponent = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+    int shift = exponent - kSubBucketBits;
+    int64_t mantissa = (value >> shift) & (kSubBuckets - 1);
+    return static_cast<size_t>(kSubBuckets + shift * kSubBuckets + mantissa);
+}
+
+/** Midpoint of the values a bucket covers */
+int64_t value_of(size_t bucket) {
+    auto index = static_cast<int64_t>(bucket);
+    if (index < kSubBuckets) return index;
+    int64_t shift = (index - kSubBuckets) / kSubBuckets;
+    int64_t mantissa = (index - kSubBuckets) % kSubBuckets;
+    int64_t low = (kSubBuckets + mantissa) << shift;
+    return low + ((int64_t{1} << shift) >> 1);
+}
+
+void put_varint(uint64_t value, std::string& out) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+void Sketch::add(int64_t value_us) {
+    counts_[bucket_of(value_us)]++;
+    total_++;
+    if (total_ > kDecayThreshold) decay();
+}
+
+void Sketch::merge(const Sketch& other) {
+    for (size_t i = 0; i < kBucketCount; i++) counts_[i] += other.counts_[i];
+    total_ += other.total_;
+    while (total_ > kDecayThreshold) decay();
+}
+
+void Sketch::decay() {
+    // Halving drops single old outliers first, which is the point
+    total_ = 0;
+    for (uint32_t& count : counts_) {
+        count >>= 1;
+        total_ += count;
+    }
+}
+
+int64_t Sketch::quantile(double q) const {
+    if (total_ == 0) return -1;
+    q = std::clamp(q, 0.0, 1.0);
+    auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(total_))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; i++) {
+        seen += counts_[i];
+        if (seen >= rank) return value_of(i);
+    }
+    return value_of(kBucketCount - 1);
+}
+
+void Sketch::encode(std::string& out) const {
+    out.push_back(static_cast<char>(kVersion));
+    int64_t previous = -1;
+    for (size_t i = 0; i < kBucketCount; i++) {
+        if (counts_[i] == 0) continue;
+        put_varint(static_cast<uint64_t>(static_cast<int64_t>(i) - previous - 1), out);
+        put_varint(counts_[i], out);
+        previous = static_cast<int64_t>(i);
+    }
+}
+
+bool Sketch::decode(const uint8_t* data, size_t size) {
+    *this = Sketch();
+    if (size == 0 || data[0] != kVersion) return false;
+    const uint8_t* p = data + 1;
+    const uint8_t* end = data + size;
+    uint64_t next = 0;  // smallest bucket the next delta can name
+    while (p < end) {
+        uint64_t delta;
+        uint64_t count;
+        if (!get_varint(p, end, delta) || !get_varint(p, end, count) ||
+            delta >= kBucketCount - next || count == 0 || count > UINT32_MAX) {
+            *this = Sketch();
+            return false;
+        }
+        size_t bucket = static_cast<size_t>(next + delta);
+        counts_[bucket] = static_cast<uint32_t>(count);
+        total_ += count;
+        next = bucket + 1;
+    }
+    return true;
+}
+
+} // namespace latency_sketch
+
+namespace {
+
+bool read_sketch(JNIEnv *env, jbyteArray blob, latency_sketch::Sketch& sketch) {
+    if (blob == nullptr) return false;
+    jsize size = env->GetArrayLength(blob);
+    std::vector<uint8_t> bytes(static_cast<size_t>(size));
+    env->GetByteArrayRegion(blob, 0, size, reinterpret_cast<jbyte*>(bytes.data()));
+    return sketch.decode(bytes.data(), bytes.size());
+}
+
+} // namespace
+
+extern "C" {
+
+/**
+ * Add latency samples to a serialized sketch; a missing or unreadable one starts empty
+ * @param samples_ns Samples in nanoseconds; non-positive entries are skipped
+ * @return The updated sketch
+ */
+JNIEXPORT jbyteArray JNICALL
+Java_com_hiddify_hiddifyng_utils_LatencySketch_mergeNative(JNIEnv *env, jclass clazz,
+                                                           jbyteArray sketch_blob,
+                                                           jlongArray samples_ns) {
+    latency_sketch::Sketch sketch;
+    if (sketch_blob != nullptr && !read_sketch(env, sketch_blob, sketch)) {
+        LOGW("Discarding unreadable latency sketch");
+    }
+
+    jsize count = env->GetArrayLength(samples_ns);
+    std::vector<jlong> samples(static_cast<size_t>(count));
+    env->GetLongArrayRegion(samples_ns, 0, count, samples.data());
+    for (jlong sample : samples) {
+        if (sample > 0) sketch.add((sample + 500) / 1000);
+    }
+
+    std::string encoded;
+    sketch.encode(encoded);
+    jbyteArray result = env->NewByteArray(static_cast<jsize>(encoded.size()));
+    if (result == nullptr) return nullptr;
+    env->SetByteArrayRegion(result, 0, static_cast<jsize>(encoded.size()),
+                            reinterpret_cast<const jbyte*>(encoded.data()));
+    return result;
+}
+
+/**
+ * Read the same quantiles from many sketches in one call
+ * @return quantiles.length values per sketch in microseconds, -1 for empty or
+ * unreadable sketches
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_hiddify_hiddifyng_utils_LatencySketch_quantilesNative(JNIEnv *env, jclass clazz,
+                                                               jobjectArray sketches,
+                                                               jdoubleArray quantiles) {
+    jsize count = env->GetArrayLength(sketches);
+    jsize width = env->GetArrayLength(quantiles);
+    std::vector<jdouble> qs(static_cast<size_t>(width));
+    env->GetDoubleArrayRegion(quantiles, 0, width, qs.data());
+
+    std::vector<jlong> values;
+    values.reserve(static_cast<size_t>(count) * static_cast<size_t>(width));
+    latency_sketch::Sketch sketch;
+    for (jsize i = 0; i < count; i++) {
+        auto blob = static_cast<jbyteArray>(env->GetObjectArrayElement(sketches, i));
+        bool readable = read_sketch(env, blob, sketch);
+        if (blob != nullptr) env->DeleteLocalRef(blob);
+        for (jdouble q : qs) values.push_back(readable ? sketch.quantile(q) : -1);
+    }
+
+    jlongArray result = env->NewLongArray(static_cast<jsize>(values.size()));
+    if (result == nullptr) return nullptr;
+    env->SetLongArrayRegion(result, 0, static_cast<jsize>(values.size()), values.data());
+    return result;
+}
+
+} // extern "C"
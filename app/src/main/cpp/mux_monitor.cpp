@@ -0,0 +1,188 @@
+#include <jni.h>
+#include <errno.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "mux_monitor.h"
+#include "native_log.h"
+#include "proc_sockets.h"
+#include "xray_process.h"
+
+namespace mux_monitor {
+
+namespace {
+
+constexpr int kStateEstablished = 0x01;
+
+// Unacknowledged bytes beyond which a tunnel counts as stalled
+constexpr unsigned long kStallQueueBytes = 64 * 1024;
+
+// Stall share of tunnel samples that triggers back-off
+constexpr double kHeavyStallRatio = 0.10;
+constexpr double kLightStallRatio = 0.02;
+
+/** /proc/net/tcp addresses are hex words in host order; check for 127/8 and ::1 */
+bool is_loopback(const char* hex_address) {
+    size_t len = strlen(hex_address);
+    if (len == 8) {
+        return strcmp(hex_address + 6, "7F") == 0;
+    }
+    if (len == 32) {
+        if (strcmp(hex_address, "00000000000000000000000001000000") == 0) return true;
+        return strncmp(hex_address, "0000000000000000FFFF0000", 24) == 0 &&
+               strcmp(hex_address + 30, "7F") == 0;
+    }
+    return false;
+}
+
+bool scan_table(const std::string& path, const proc_sockets::Sockets& inodes,
+                int inbound_port, int server_port, Sample& out) {
+    FILE* file = fopen(path.c_str(), "re");
+    if (file == nullptr) return false;
+
+    char line[512];
+    fgets(line, sizeof(line), file); // header
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        char local[33];
+        char remote[33];
+        unsigned int local_port;
+        unsigned int remote_port;
+        unsigned int state;
+        unsigned long tx_queue;
+        unsigned int retransmits;
+        unsigned long inode;
+        int fields = sscanf(line,
+                            " %*d: %32[0-9A-Fa-f]:%x %32[0-9A-Fa-f]:%x %x %lx:%*x %*x:%*x %x %*u %*u %lu",
+                            local, &local_port, remote, &remote_port, &state, &tx_queue,
+                            &retransmits, &inode);
+        if (fields != 8 || state != kStateEstablished || inodes.count(inode) == 0) continue;
+
+        if (static_cast<int>(local_port) == inbound_port) {
+            out.streams++;
+        } else if (static_cast<int>(remote_port) == server_port && !is_loopback(remote)) {
+            out.tunnels++;
+            out.queued_bytes += static_cast<int64_t>(tx_queue);
+            if (retransmits > 0 || tx_queue > kStallQueueBytes) out.stalled_tunnels++;
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+} // namespace
+
+bool sample_process(pid_t pid, int inbound_port, int server_port, Sample& out) {
+    out = Sample();
+    proc_sockets::Sockets inodes;
+    if (!proc_sockets::list(pid, inodes)) return false;
+
+    std::string net = "/proc/" + std::to_string(pid) + "/net/";
+    bool readable = scan_table(net + "tcp", inodes, inbound_port, server_port, out);
+    readable = scan_table(net + "tcp6", inodes, inbound_port, server_port, out) || readable;
+    if (!readable) {
+        LOGD("Socket tables of %d are not readable: %s", pid, strerror(errno));
+        out = Sample();
+    }
+    out.available = readable;
+    return true;
+}
+
+void Tuner::reset(int running_concurrency) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    window_.clear();
+    next_ = 0;
+    running_ = std::clamp(running_concurrency, kMinConcurrency, kMaxConcurrency);
+    recommended_ = running_;
+}
+
+int Tuner::update(const Sample& sample) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!sample.available) return recommended_;
+    if (window_.size() < kWindow) {
+        window_.push_back(sample);
+    } else {
+        window_[next_] = sample;
+        next_ = (next_ + 1) % kWindow;
+    }
+    if (window_.size() < kMinSamples) return recommended_;
+
+    std::vector<int> streams;
+    streams.reserve(window_.size());
+    int tunnels = 0;
+    int stalled = 0;
+    for (const Sample& s : window_) {
+        streams.push_back(s.streams);
+        tunnels += s.tunnels;
+        stalled += s.stalled_tunnels;
+    }
+    if (tunnels == 0) return recommended_;
+
+    size_t p95_index = (streams.size() * 95 + 99) / 100 - 1;
+    std::nth_element(streams.begin(), streams.begin() + p95_index, streams.end());
+    int p95_streams = streams[p95_index];
+    double stall_ratio = static_cast<double>(stalled) / tunnels;
+
+    int next;
+    if (stall_ratio > kHeavyStallRatio) {
+        // Streams are waiting behind each other; spread them over more tunnels
+        next = running_ / 2;
+    } else if (stall_ratio > kLightStallRatio) {
+        next = running_ - 1;
+    } else if (p95_streams > running_) {
+        // Clean tunnels but bursts open extra handshakes; grow toward the burst
+        next = std::min(p95_streams, running_ * 2);
+    } else {
+        next = running_;
+    }
+
+    recommended_ = std::clamp(next, kMinConcurrency, kMaxConcurrency);
+    return recommended_;
+}
+
+int Tuner::recommended() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return recommended_;
+}
+
+} // namespace mux_monitor
+
+namespace {
+mux_monitor::Tuner g_tuner;
+}
+
+extern "C" {
+
+JNIEXPORT void JNICALL
+Java_com_hiddify_hiddifyng_utils_MuxTuner_resetTuner(JNIEnv *env, jclass clazz,
+                                                    jint running_concurrency) {
+    g_tuner.reset(running_concurrency);
+}
+
+/**
+ * Sample the running core and update the recommendation
+ * @return [streams, tunnels, stalled tunnels, queued KB, recommended concurrency, available],
+ *         or null when the core is not running; available is 0 when the socket
+ *         tables cannot be read and the other values mean nothing
+ */
+JNIEXPORT jintArray JNICALL
+Java_com_hiddify_hiddifyng_utils_MuxTuner_sampleCore(JNIEnv *env, jclass clazz,
+                                                    jint inbound_port, jint server_port) {
+    mux_monitor::Sample sample;
+    if (!mux_monitor::sample_process(xray_process_id(), inbound_port, server_port, sample)) {
+        return nullptr;
+    }
+    int recommended = g_tuner.update(sample);
+
+    jint values[] = {sample.streams, sample.tunnels, sample.stalled_tunnels,
+                     static_cast<jint>(sample.queued_bytes / 1024), recommended,
+                     sample.available ? 1 : 0};
+    jintArray result = env->NewIntArray(6);
+    env->SetIntArrayRegion(result, 0, 6, values);
+    return result;
+}
+
+} // extern "C"
@@ -0,0 +1,252 @@
+#include <jni.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include "probe_cache.h"
+#include "native_log.h"
+
+namespace probe_cache {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x31435250; // "PRC1"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 16;
+constexpr size_t kSlotCount = 4096;   // power of two
+constexpr size_t kProbeLength = 8;    // slots searched per key before evicting the oldest
+constexpr int kMaxReadAttempts = 4;
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t reserved;
+};
+static_assert(sizeof(Header) == kHeaderSize, "header layout");
+
+/** FNV-1a over the lowercased host, port and transport; 0 marks an empty slot */
+uint64_t hash_of(const Key& key) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](uint8_t byte) {
+        hash ^= byte;
+        hash *= 0x100000001b3ull;
+    };
+    for (char c : key.host) mix(static_cast<uint8_t>(std::tolower(static_cast<unsigned char>(c))));
+    mix(0);
+    mix(static_cast<uint8_t>(key.port >> 8));
+    mix(static_cast<uint8_t>(key.port));
+    mix(static_cast<uint8_t>(key.transport));
+    return hash != 0 ? hash : 1;
+}
+
+template <typename T>
+T load(const T& field, int order = __ATOMIC_RELAXED) {
+    return __atomic_load_n(&field, order);
+}
+
+template <typename T>
+void store_field(T& field, T value, int order = __ATOMIC_RELAXED) {
+    __atomic_store_n(&field, value, order);
+}
+
+} // namespace
+
+struct Cache::Slot {
+    uint32_t sequence;  // odd while a writer is inside
+    int32_t ping_ms;    // kFailed for a failure
+    uint64_t key;
+    int64_t measured_at_ms;
+};
+
+Cache::~Cache() {
+    if (mapping_ != nullptr) munmap(mapping_, mapping_size_);
+}
+
+bool Cache::open(const std::string& path) {
+    static_assert(sizeof(Slot) == 24, "slot layout");
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Readers do not lock, so a mapping is never replaced once published
+    if (mapping_ != nullptr) return path == path_;
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        LOGE("Cannot open probe cache %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    size_t size = kHeaderSize + kSlotCount * sizeof(Slot);
+    struct stat st;
+    bool fresh = fstat(fd, &st) != 0 || st.st_size != static_cast<off_t>(size);
+    if (fresh && (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+        LOGE("Cannot size probe cache: %s", strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        LOGE("Cannot map probe cache: %s", strerror(errno));
+        return false;
+    }
+
+    auto* header = static_cast<Header*>(mapping);
+    if (header->magic != kMagic || header->version != kVersion || header->slot_count != kSlotCount) {
+        memset(mapping, 0, size);
+        header->version = kVersion;
+        header->slot_count = kSlotCount;
+        store_field(header->magic, kMagic, __ATOMIC_RELEASE);
+        LOGI("Probe cache initialized at %s", path.c_str());
+    }
+
+    mapping_size_ = size;
+    path_ = path;
+    slots_ = reinterpret_cast<Slot*>(static_cast<uint8_t*>(mapping) + kHeaderSize);
+    __atomic_store_n(&mapping_, mapping, __ATOMIC_RELEASE);
+    return true;
+}
+
+int32_t Cache::lookup(const Key& key, int64_t now_ms) const {
+    if (__atomic_load_n(&mapping_, __ATOMIC_ACQUIRE) == nullptr) return kMiss;
+
+    uint64_t hash = hash_of(key);
+    for (size_t i = 0; i < kProbeLength; i++) {
+        const Slot& slot = slots_[(hash + i) & (kSlotCount - 1)];
+        for (int attempt = 0; attempt < kMaxReadAttempts; attempt++) {
+            uint32_t before = load(slot.sequence, __ATOMIC_ACQUIRE);
+            if (before & 1) continue;
+            uint64_t slot_key = load(slot.key);
+            int32_t ping_ms = load(slot.ping_ms);
+            int64_t measured_at = load(slot.measured_at_ms);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (load(slot.sequence) != before) continue;
+
+            if (slot_key != hash) break;
+            int64_t age = now_ms - measured_at;
+            int64_t max_age = ping_ms > 0 ? kFreshReachableMs : kFreshFailedMs;
+            // An entry from the future means the clock was set back; do not trust it
+            if (age < 0 || age > max_age) return kMiss;
+            return ping_ms > 0 ? ping_ms : kFailed;
+        }
+    }
+    return kMiss;
+}
+
+void Cache::store(const Key& key, int32_t ping_ms, int64_t now_ms) {
+    if (__atomic_load_n(&mapping_, __ATOMIC_ACQUIRE) == nullptr) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    uint64_t hash = hash_of(key);
+    Slot* target = nullptr;
+    for (size_t i = 0; i < kProbeLength; i++) {
+        Slot& slot = slots_[(hash + i) & (kSlotCount - 1)];
+        uint64_t slot_key = load(slot.key);
+        if (slot_key == hash || slot_key == 0) {
+            target = &slot;
+            break;
+        }
+        if (target == nullptr || load(slot.measured_at_ms) < load(target->measured_at_ms)) {
+            target = &slot;
+        }
+    }
+
+    uint32_t sequence = load(target->sequence);
+    store_field(target->sequence, sequence + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    store_field(target->key, hash);
+    store_field(target->ping_ms, ping_ms > 0 ? ping_ms : kFailed);
+    store_field(target->measured_at_ms, now_ms);
+    store_field(target->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+} // namespace probe_cache
+
+namespace {
+
+probe_cache::Cache g_cache;
+
+int64_t wall_clock_ms() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+std::vector<probe_cache::Key> read_keys(JNIEnv *env, jobjectArray hosts, jintArray ports,
+                                        jint transport) {
+    jsize size = env->GetArrayLength(hosts);
+    if (env->GetArrayLength(ports) != size) return {};
+    std::vector<jint> port_values(static_cast<size_t>(size));
+    env->GetIntArrayRegion(ports, 0, size, port_values.data());
+    std::vector<probe_cache::Key> keys(static_cast<size_t>(size));
+    for (jsize i = 0; i < size; i++) {
+        auto host = static_cast<jstring>(env->GetObjectArrayElement(hosts, i));
+        if (host != nullptr) {
+            const char* chars = env->GetStringUTFChars(host, nullptr);
+            keys[i].host = chars;
+            env->ReleaseStringUTFChars(host, chars);
+            env->DeleteLocalRef(host);
+        }
+        keys[i].port = port_values[i];
+        keys[i].transport = transport;
+    }
+    return keys;
+}
+
+} // namespace
+
+extern "C" {
+
+JNIEXPORT jboolean JNICALL
+Java_com_hiddify_hiddifyng_utils_PingUtils_openProbeCacheNative(JNIEnv *env, jclass clazz,
+                                                                jstring path) {
+    const char* chars = env->GetStringUTFChars(path, nullptr);
+    std::string value(chars);
+    env->ReleaseStringUTFChars(path, chars);
+    return g_cache.open(value) ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Fresh cached pings of host:port endpoints over one transport
+ * @return Per endpoint the ping in ms, -1 for a fresh failure or 0 for none, or null
+ */
+JNIEXPORT jintArray JNICALL
+Java_com_hiddify_hiddifyng_utils_PingUtils_lookupProbeCacheNative(JNIEnv *env, jclass clazz,
+                                                                  jobjectArray hosts, jintArray ports,
+                                                                  jint transport) {
+    jsize size = env->GetArrayLength(hosts);
+    std::vector<probe_cache::Key> keys = read_keys(env, hosts, ports, transport);
+    if (static_cast<jsize>(keys.size()) != size) return nullptr;
+
+    int64_t now = wall_clock_ms();
+    std::vector<jint> pings(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) pings[i] = g_cache.lookup(keys[i], now);
+
+    jintArray array = env->NewIntArray(size);
+    if (array == nullptr) return nullptr;
+    env->SetIntArrayRegion(array, 0, size, pings.data());
+    return array;
+}
+
+JNIEXPORT void JNICALL
+Java_com_hiddify_hiddifyng_utils_PingUtils_storeProbeCacheNative(JNIEnv *env, jclass clazz,
+                                                                 jobjectArray hosts, jintArray ports,
+                                                                 jint transport, jintArray pings) {
+    jsize size = env->GetArrayLength(hosts);
+    std::vector<probe_cache::Key> keys = read_keys(env, hosts, ports, transport);
+    if (static_cast<jsize>(keys.size()) != size || env->GetArrayLength(pings) != size) return;
+    std::vector<jint> values(static_cast<size_t>(size));
+    env->GetIntArrayRegion(pings, 0, size, values.data());
+
+    int64_t now = wall_clock_ms();
+    for (size_t i = 0; i < keys.size(); i++) g_cache.store(keys[i], values[i], now);
+}
+
+} // extern "C"
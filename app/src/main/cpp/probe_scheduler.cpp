@@ -0,0 +1,351 @@
+#include <jni.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+#include "config_builder.h"
+#include "native_log.h"
+#include "probe_scheduler.h"
+
+namespace probe_scheduler {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x31435350; // "PSC1"
+constexpr uint16_t kVersion = 1;
+constexpr size_t kHeaderSize = 12;
+constexpr size_t kEntrySize = 24;
+constexpr size_t kMaxEntries = 8192;
+
+// Refresh intervals, seconds; the base matches WorkManager's shortest period
+constexpr double kBaseInterval = 15 * 60;
+constexpr double kMaxInterval = 24 * 60 * 60;
+constexpr double kMaxStableFactor = 4;  // for a server with no jitter at all
+constexpr double kIdleFactor = 4;       // for servers the user is unlikely to pick
+constexpr double kJitterCv = 0.25;      // stddev / mean at which a server counts as jittery
+constexpr int kMaxBackoffShift = 7;     // 15 min << 7 is past a day anyway
+
+// Servers this close to the front of the latency ranking count as candidates
+constexpr size_t kFastCount = 16;
+
+// EWMA weight of a new probe
+constexpr float kAlpha = 0.3f;
+
+void put_u16(uint8_t* p, uint16_t v) { memcpy(p, &v, sizeof(v)); }
+void put_u32(uint8_t* p, uint32_t v) { memcpy(p, &v, sizeof(v)); }
+
+double jitter_of(float mean_ms, float variance) {
+    return mean_ms > 0 ? std::sqrt(std::max(variance, 0.0f)) / mean_ms : 0;
+}
+
+/** Higher for servers whose freshness the user notices first */
+double weight_of(uint32_t flags, bool fast) {
+    if (flags & kSelected) return 8;
+    if (flags & kFavorite) return 4;
+    return fast ? 2 : 1;
+}
+
+} // namespace
+
+bool Scheduler::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (path == path_) return true;
+
+    path_ = path;
+    entries_.clear();
+    dirty_ = false;
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == ENOENT;
+    }
+
+    struct stat st;
+    std::vector<uint8_t> data;
+    if (fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(kHeaderSize) &&
+        st.st_size <= static_cast<off_t>(kHeaderSize + kMaxEntries * kEntrySize)) {
+        data.resize(static_cast<size_t>(st.st_size));
+        ssize_t n = read(fd, data.data(), data.size());
+        if (n != static_cast<ssize_t>(data.size())) data.clear();
+    }
+    close(fd);
+
+    uint32_t magic = 0;
+    uint16_t version = 0;
+    uint32_t count = 0;
+    if (data.size() >= kHeaderSize) {
+        memcpy(&magic, &data[0], 4);
+        memcpy(&version, &data[4], 2);
+        memcpy(&count, &data[8], 4);
+    }
+    if (magic != kMagic || version != kVersion || data.size() != kHeaderSize + count * kEntrySize) {
+        LOGW("Discarding unreadable probe schedule %s", path.c_str());
+        return false;
+    }
+
+    entries_.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t* p = &data[kHeaderSize + i * kEntrySize];
+        Entry& e = entries_[i];
+        memcpy(&e.server_id, p, 8);
+        memcpy(&e.probed, p + 8, 4);
+        memcpy(&e.failures, p + 12, 2);
+        memcpy(&e.count, p + 14, 2);
+        memcpy(&e.mean_ms, p + 16, 4);
+        memcpy(&e.variance, p + 20, 4);
+    }
+    // find() relies on the order; a hand-edited file may not keep it
+    std::sort(entries_.begin(), entries_.end(),
+              [](const Entry& a, const Entry& b) { return a.server_id < b.server_id; });
+    return true;
+}
+
+Scheduler::Entry* Scheduler::find(int64_t server_id) {
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), server_id,
+                               [](const Entry& e, int64_t id) { return e.server_id < id; });
+    return it != entries_.end() && it->server_id == server_id ? &*it : nullptr;
+}
+
+double Scheduler::interval_of(const Entry& entry, uint32_t flags, bool fast) const {
+    bool important = (flags & (kFavorite | kSelected)) != 0 || fast;
+    double interval;
+    if (entry.failures > 0) {
+        // Dead hosts back off; ones the user cares about are retried within the hour
+        int shift = std::min<int>(entry.failures - 1, kMaxBackoffShift);
+        interval = std::min(kBaseInterval * (1 << shift), important ? 4 * kBaseInterval : kMaxInterval);
+    } else {
+        double steadiness = std::clamp(1.0 - jitter_of(entry.mean_ms, entry.variance) / kJitterCv,
+                                       0.0, 1.0);
+        interval = kBaseInterval * (1 + (kMaxStableFactor - 1) * steadiness);
+        if (!important) interval *= kIdleFactor;
+    }
+    if (flags & kSelected) return interval / 4;
+    if (flags & kFavorite) return interval / 2;
+    return interval;
+}
+
+/** Which candidates rank among the kFastCount lowest mean latencies */
+std::vector<bool> Scheduler::fastest(const std::vector<Candidate>& servers) {
+    std::vector<std::pair<float, size_t>> ranked;
+    for (size_t i = 0; i < servers.size(); i++) {
+        const Entry* e = find(servers[i].server_id);
+        if (e != nullptr && e->failures == 0 && e->count > 0) ranked.emplace_back(e->mean_ms, i);
+    }
+    size_t keep = std::min(kFastCount, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + static_cast<ptrdiff_t>(keep), ranked.end());
+    std::vector<bool> fast(servers.size(), false);
+    for (size_t i = 0; i < keep; i++) fast[ranked[i].second] = true;
+    return fast;
+}
+
+std::vector<int64_t> Scheduler::plan(const std::vector<Candidate>& servers, size_t budget,
+                                     uint32_t now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Forget servers that were deleted
+    std::vector<int64_t> present;
+    present.reserve(servers.size());
+    for (const Candidate& c : servers) present.push_back(c.server_id);
+    std::sort(present.begin(), present.end());
+    size_t before = entries_.size();
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                  [&](const Entry& e) {
+                                      return !std::binary_search(present.begin(), present.end(),
+                                                                 e.server_id);
+                                  }),
+                   entries_.end());
+    dirty_ |= entries_.size() != before;
+
+    std::vector<bool> fast = fastest(servers);
+    std::vector<int64_t> fresh;
+    std::vector<std::pair<double, int64_t>> due;
+    for (size_t i = 0; i < servers.size(); i++) {
+        const Candidate& c = servers[i];
+        const Entry* e = find(c.server_id);
+        if (e == nullptr) {
+            fresh.push_back(c.server_id);
+            continue;
+        }
+        double age = now > e->probed ? now - e->probed : 0;
+        double overdue = age / interval_of(*e, c.flags, fast[i]);
+        if (overdue < 1) continue;
+        double jitter = e->failures == 0 ? jitter_of(e->mean_ms, e->variance) : 0;
+        due.emplace_back(overdue * weight_of(c.flags, fast[i]) * (1 + jitter), c.server_id);
+    }
+
+    size_t keep = std::min(budget, due.size());
+    std::partial_sort(due.begin(), due.begin() + static_cast<ptrdiff_t>(keep), due.end(),
+                      [](const auto& a, const auto& b) { return a.first > b.first; });
+    std::vector<int64_t> chosen;
+    chosen.reserve(keep + fresh.size());
+    for (size_t i = 0; i < keep; i++) chosen.push_back(due[i].second);
+    chosen.insert(chosen.end(), fresh.begin(), fresh.end());
+    return chosen;
+}
+
+uint32_t Scheduler::next_due(const std::vector<Candidate>& servers, uint32_t now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<bool> fast = fastest(servers);
+    double soonest = kMaxInterval;
+    for (size_t i = 0; i < servers.size(); i++) {
+        const Entry* e = find(servers[i].server_id);
+        if (e == nullptr) return 0;
+        double at = e->probed + interval_of(*e, servers[i].flags, fast[i]);
+        soonest = std::min(soonest, std::max(at - now, 0.0));
+    }
+    return static_cast<uint32_t>(soonest);
+}
+
+void Scheduler::record(int64_t server_id, float latency_ms, uint32_t now) {
+    if (std::isnan(latency_ms)) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry* e = find(server_id);
+    if (e == nullptr) {
+        if (entries_.size() >= kMaxEntries) {
+            auto oldest = std::min_element(entries_.begin(), entries_.end(),
+                                           [](const Entry& a, const Entry& b) { return a.probed < b.probed; });
+            entries_.erase(oldest);
+        }
+        auto it = std::lower_bound(entries_.begin(), entries_.end(), server_id,
+                                   [](const Entry& entry, int64_t id) { return entry.server_id < id; });
+        e = &*entries_.insert(it, Entry{server_id, 0, 0, 0, 0, 0});
+    }
+
+    e->probed = now;
+    if (latency_ms < 0) {
+        if (e->failures < UINT16_MAX) e->failures++;
+    } else {
+        e->failures = 0;
+        if (e->count == 0) {
+            e->mean_ms = latency_ms;
+            e->variance = 0;
+        } else {
+            float diff = latency_ms - e->mean_ms;
+            e->mean_ms += kAlpha * diff;
+            e->variance = (1 - kAlpha) * (e->variance + kAlpha * diff * diff);
+        }
+        if (e->count < UINT16_MAX) e->count++;
+    }
+    dirty_ = true;
+}
+
+bool Scheduler::save() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (path_.empty()) return false;
+    if (!dirty_) return true;
+
+    std::string data(kHeaderSize + entries_.size() * kEntrySize, '\0');
+    auto* out = reinterpret_cast<uint8_t*>(&data[0]);
+    put_u32(out, kMagic);
+    put_u16(out + 4, kVersion);
+    put_u32(out + 8, static_cast<uint32_t>(entries_.size()));
+    for (size_t i = 0; i < entries_.size(); i++) {
+        const Entry& e = entries_[i];
+        uint8_t* p = out + kHeaderSize + i * kEntrySize;
+        memcpy(p, &e.server_id, 8);
+        put_u32(p + 8, e.probed);
+        put_u16(p + 12, e.failures);
+        put_u16(p + 14, e.count);
+        memcpy(p + 16, &e.mean_ms, 4);
+        memcpy(p + 20, &e.variance, 4);
+    }
+
+    if (config_builder::write_file(data, path_) != config_builder::kOk) {
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
+
+} // namespace probe_scheduler
+
+namespace {
+
+probe_scheduler::Scheduler g_scheduler;
+
+std::vector<probe_scheduler::Candidate> candidates_of(JNIEnv *env, jlongArray ids, jintArray flags) {
+    jsize count = env->GetArrayLength(ids);
+    if (env->GetArrayLength(flags) < count) return {};
+    std::vector<jlong> id_values(static_cast<size_t>(count));
+    std::vector<jint> flag_values(static_cast<size_t>(count));
+    env->GetLongArrayRegion(ids, 0, count, id_values.data());
+    env->GetIntArrayRegion(flags, 0, count, flag_values.data());
+    std::vector<probe_scheduler::Candidate> candidates(static_cast<size_t>(count));
+    for (jsize i = 0; i < count; i++) {
+        candidates[i] = {id_values[i], static_cast<uint32_t>(flag_values[i])};
+    }
+    return candidates;
+}
+
+uint32_t unix_now() {
+    return static_cast<uint32_t>(time(nullptr));
+}
+
+} // namespace
+
+extern "C" {
+
+JNIEXPORT jboolean JNICALL
+Java_com_hiddify_hiddifyng_utils_ProbeScheduler_openNative(JNIEnv *env, jclass clazz,
+                                                            jstring path) {
+    const char* chars = env->GetStringUTFChars(path, nullptr);
+    bool ok = g_scheduler.open(chars);
+    env->ReleaseStringUTFChars(path, chars);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * @param flags probe_scheduler::Flags per server id
+ * @return Ids to probe, most urgent first
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_hiddify_hiddifyng_utils_ProbeScheduler_planNative(JNIEnv *env, jclass clazz,
+                                                            jlongArray ids, jintArray flags,
+                                                            jint budget) {
+    std::vector<int64_t> chosen = g_scheduler.plan(candidates_of(env, ids, flags),
+                                                   static_cast<size_t>(std::max(0, static_cast<int>(budget))),
+                                                   unix_now());
+    auto size = static_cast<jsize>(chosen.size());
+    jlongArray result = env->NewLongArray(size);
+    if (result == nullptr) return nullptr;
+    env->SetLongArrayRegion(result, 0, size, reinterpret_cast<const jlong*>(chosen.data()));
+    LOGI("Probe plan: %d of %d servers due", static_cast<int>(size),
+         static_cast<int>(env->GetArrayLength(ids)));
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_hiddify_hiddifyng_utils_ProbeScheduler_nextDueNative(JNIEnv *env, jclass clazz,
+                                                               jlongArray ids, jintArray flags) {
+    return static_cast<jint>(g_scheduler.next_due(candidates_of(env, ids, flags), unix_now()));
+}
+
+/**
+ * @param latencies_ms Per server id; negative for servers that did not answer
+ */
+JNIEXPORT void JNICALL
+Java_com_hiddify_hiddifyng_utils_ProbeScheduler_recordNative(JNIEnv *env, jclass clazz,
+                                                              jlongArray ids, jfloatArray latencies_ms) {
+    jsize count = env->GetArrayLength(ids);
+    if (env->GetArrayLength(latencies_ms) < count) return;
+    std::vector<jlong> id_values(static_cast<size_t>(count));
+    std::vector<jfloat> latency_values(static_cast<size_t>(count));
+    env->GetLongArrayRegion(ids, 0, count, id_values.data());
+    env->GetFloatArrayRegion(latencies_ms, 0, count, latency_values.data());
+    uint32_t now = unix_now();
+    for (jsize i = 0; i < count; i++) g_scheduler.record(id_values[i], latency_values[i], now);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_hiddify_hiddifyng_utils_ProbeScheduler_saveNative(JNIEnv *env, jclass clazz) {
+    return g_scheduler.save() ? JNI_TRUE : JNI_FALSE;
+}
+
+} // extern "C"
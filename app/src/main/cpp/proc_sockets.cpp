@@ -0,0 +1,69 @@
+#include <dirent.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+
+#include "proc_sockets.h"
+
+namespace proc_sockets {
+
+namespace {
+
+std::mutex g_mutex;
+pid_t g_pid = -1;
+int64_t g_listed_at_ms = 0;
+Sockets g_sockets;
+
+int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool read_links(pid_t pid, Sockets& out) {
+    std::string dir_path = "/proc/" + std::to_string(pid) + "/fd";
+    DIR* dir = opendir(dir_path.c_str());
+    if (dir == nullptr) return false;
+
+    char link[64];
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] == '.') continue;
+        std::string fd_path = dir_path + "/" + entry->d_name;
+        ssize_t n = readlink(fd_path.c_str(), link, sizeof(link) - 1);
+        if (n <= 0) continue;
+        link[n] = '\0';
+
+        unsigned long long inode;
+        if (sscanf(link, "socket:[%llu]", &inode) == 1) out[inode] = atoi(entry->d_name);
+    }
+    closedir(dir);
+    return true;
+}
+
+} // namespace
+
+bool list(pid_t pid, Sockets& out) {
+    out.clear();
+    if (pid <= 0) return false;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    int64_t now = now_ms();
+    if (pid == g_pid && now - g_listed_at_ms < kMaxAgeMs) {
+        out = g_sockets;
+        return true;
+    }
+
+    g_pid = -1;
+    g_sockets.clear();
+    if (!read_links(pid, g_sockets)) return false;
+    g_pid = pid;
+    g_listed_at_ms = now;
+    out = g_sockets;
+    return true;
+}
+
+} // namespace proc_sockets
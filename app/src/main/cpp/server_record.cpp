@@ -0,0 +1,92 @@
+#include "server_record.h"
+
+#include <cstring>
+
+namespace server_record {
+
+namespace {
+
+/**
+ * Bounds-checked little-endian reader over the record buffer
+ */
+class Reader {
+public:
+    Reader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    template <typename T>
+    bool read(T& value) {
+        if (size_ - pos_ < sizeof(T)) return false;
+        std::memcpy(&value, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool read_view(size_t len, std::string_view& value) {
+        if (size_ - pos_ < len) return false;
+        value = std::string_view(reinterpret_cast<const char*>(data_ + pos_), len);
+        pos_ += len;
+        return true;
+    }
+
+    size_t pos() const { return pos_; }
+    void seek(size_t pos) { pos_ = pos; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+};
+
+} // namespace
+
+bool decode(const uint8_t* data, size_t size, std::vector<ServerRecord>& out) {
+    Reader reader(data, size);
+
+    uint32_t magic = 0;
+    uint32_t count = 0;
+    if (!reader.read(magic) || magic != kMagic || !reader.read(count)) {
+        return false;
+    }
+
+    out.reserve(out.size() + count);
+    for (uint32_t i = 0; i < count; i++) {
+        size_t start = reader.pos();
+        uint32_t record_size = 0;
+        if (!reader.read(record_size) || record_size > size - start) {
+            return false;
+        }
+
+        ServerRecord record;
+        uint16_t field_count = 0;
+        if (!reader.read(record.id) || !reader.read(record.port) ||
+            !reader.read(record.up_mbps) || !reader.read(record.down_mbps) ||
+            !reader.read(record.flags) || !reader.read(field_count)) {
+            return false;
+        }
+
+        for (uint16_t f = 0; f < field_count; f++) {
+            uint8_t id = 0;
+            uint8_t reserved = 0;
+            uint16_t len = 0;
+            std::string_view value;
+            if (!reader.read(id) || !reader.read(reserved) || !reader.read(len) ||
+                !reader.read_view(len, value)) {
+                return false;
+            }
+            // Unknown ids come from a newer encoder; skip them
+            if (id < kFieldCount) {
+                record.fields[id] = value;
+            }
+        }
+
+        if (reader.pos() - start > record_size) {
+            return false;
+        }
+        reader.seek(start + record_size);
+        out.push_back(record);
+    }
+
+    return true;
+}
+
+} // namespace server_record
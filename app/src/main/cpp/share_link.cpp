@@ -0,0 +1,828 @@
+#include <jni.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "json_reader.h"
+#include "json_writer.h"
+#include "native_log.h"
+#include "share_link.h"
+#include "text_codec.h"
+
+namespace share_link {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Table slots below kFieldCount are string fields, the rest are numbers
+constexpr uint8_t kNoSlot = 0xFF;
+
+constexpr uint8_t num(Number n) {
+    return static_cast<uint8_t>(kFieldCount + n);
+}
+
+/**
+ * One query key. The first non-alias key of a slot is the one generate()
+ * writes; aliases are only accepted when parsing. Keys match ignoring case.
+ */
+struct Param {
+    std::string_view key;
+    uint8_t slot;
+    bool alias;
+};
+
+struct Default {
+    uint8_t slot;
+    std::string_view value;
+};
+
+struct SchemeSpec {
+    std::string_view name;
+    std::string_view prefix;
+    uint8_t userinfo;  // slot the "user@" part goes into, kNoSlot when unused
+    const Param* params;
+    size_t param_count;
+    const Default* defaults;
+    size_t default_count;
+    int32_t default_port;  // when the link leaves the port out; 0 makes it required
+};
+
+// vless, reality, trojan and xhttp share the Xray stream parameters
+constexpr Param kStreamParams[] = {
+    {"type", kNetwork, false},
+    {"network", kNetwork, true},
+    {"security", kSecurity, false},
+    {"encryption", kEncryption, false},
+    {"flow", kFlow, false},
+    {"sni", kSni, false},
+    {"peer", kSni, true},
+    {"alpn", kAlpn, false},
+    {"fp", kFingerprint, false},
+    {"fingerprint", kFingerprint, true},
+    {"pbk", kPublicKey, false},
+    {"publickey", kPublicKey, true},
+    {"sid", kShortId, false},
+    {"shortid", kShortId, true},
+    {"spx", kSpiderX, false},
+    {"spiderx", kSpiderX, true},
+    {"path", kPath, false},
+    {"host", kHost, false},
+    {"serviceName", kServiceName, false},
+    {"headerType", kHeaderType, false},
+    {"allowInsecure", num(kInsecure), false},
+    {"insecure", num(kInsecure), true},
+};
+
+constexpr Param kHysteriaParams[] = {
+    {"protocol", kHysteriaProtocol, false},
+    {"auth", kPassword, false},
+    {"auth_str", kPassword, true},
+    {"peer", kSni, false},
+    {"sni", kSni, true},
+    {"insecure", num(kInsecure), false},
+    {"allowInsecure", num(kInsecure), true},
+    {"upmbps", num(kUpMbps), false},
+    {"up_mbps", num(kUpMbps), true},
+    {"downmbps", num(kDownMbps), false},
+    {"down_mbps", num(kDownMbps), true},
+    {"obfs", kObfs, false},
+    {"alpn", kAlpn, false},
+};
+
+// Shadowsocks carries everything in the authority; plugin options are ignored
+constexpr Param kShadowsocksParams[] = {
+    {"type", kNetwork, false},
+};
+
+// Members of the base64 JSON body of a vmess:// link (v2rayN format, "v": "2")
+constexpr Param kVmessParams[] = {
+    {"ps", kName, false},
+    {"add", kAddress, false},
+    {"port", num(kPort), false},
+    {"id", kUserId, false},
+    {"aid", num(kAlterId), false},
+    {"scy", kMethod, false},
+    {"net", kNetwork, false},
+    {"type", kHeaderType, false},
+    {"host", kHost, false},
+    {"path", kPath, false},
+    {"tls", kSecurity, false},
+    {"sni", kSni, false},
+    {"alpn", kAlpn, false},
+    {"fp", kFingerprint, false},
+};
+
+constexpr Default kVmessDefaults[] = {{kNetwork, "tcp"}, {kMethod, "auto"}};
+constexpr Default kVlessDefaults[] = {{kNetwork, "tcp"}, {kEncryption, "none"}};
+constexpr Default kTrojanDefaults[] = {{kNetwork, "tcp"}, {kSecurity, "tls"}};
+constexpr Default kShadowsocksDefaults[] = {{kNetwork, "tcp"}};
+constexpr Default kHysteriaDefaults[] = {{kHysteriaProtocol, "udp"}, {kSecurity, "tls"}};
+constexpr Default kRealityDefaults[] = {{kNetwork, "tcp"}, {kSecurity, "reality"},
+                                        {kEncryption, "none"}, {kFingerprint, "chrome"}};
+constexpr Default kXhttpDefaults[] = {{kNetwork, "xhttp"}, {kSecurity, "tls"}, {kPath, "/"}};
+
+template <typename T, size_t N>
+constexpr size_t count_of(const T (&)[N]) {
+    return N;
+}
+
+/** Every slot has one canonical key, and it comes before its aliases */
+template <size_t N>
+constexpr bool well_formed(const Param (&table)[N]) {
+    for (size_t i = 0; i < N; i++) {
+        bool canonical_before = false;
+        for (size_t j = 0; j < i; j++) {
+            if (table[j].slot != table[i].slot) continue;
+            if (!table[i].alias && !table[j].alias) return false;
+            if (!table[j].alias) canonical_before = true;
+        }
+        if (table[i].alias && !canonical_before) return false;
+        if (table[i].slot >= kFieldCount + kNumberCount) return false;
+    }
+    return true;
+}
+
+static_assert(well_formed(kStreamParams), "stream parameter table");
+static_assert(well_formed(kHysteriaParams), "hysteria parameter table");
+static_assert(well_formed(kShadowsocksParams), "shadowsocks parameter table");
+static_assert(well_formed(kVmessParams), "vmess parameter table");
+
+// Indexed by Scheme
+constexpr SchemeSpec kSchemes[] = {
+    {"vmess", "vmess://", kUserId, kStreamParams, count_of(kStreamParams),
+     kVmessDefaults, count_of(kVmessDefaults), 0},
+    {"vless", "vless://", kUserId, kStreamParams, count_of(kStreamParams),
+     kVlessDefaults, count_of(kVlessDefaults), 0},
+    {"trojan", "trojan://", kPassword, kStreamParams, count_of(kStreamParams),
+     kTrojanDefaults, count_of(kTrojanDefaults), 0},
+    {"shadowsocks", "ss://", kNoSlot, kShadowsocksParams, count_of(kShadowsocksParams),
+     kShadowsocksDefaults, count_of(kShadowsocksDefaults), 0},
+    {"hysteria", "hysteria://", kNoSlot, kHysteriaParams, count_of(kHysteriaParams),
+     kHysteriaDefaults, count_of(kHysteriaDefaults), 0},
+    // REALITY fronts a TLS site, so a link without a port means 443
+    {"reality", "reality://", kUserId, kStreamParams, count_of(kStreamParams),
+     kRealityDefaults, count_of(kRealityDefaults), 443},
+    {"xhttp", "xhttp://", kUserId, kStreamParams, count_of(kStreamParams),
+     kXhttpDefaults, count_of(kXhttpDefaults), 0},
+};
+static_assert(count_of(kSchemes) == kSchemeCount, "one spec per scheme");
+
+constexpr bool schemes_in_order() {
+    for (size_t i = 0; i < count_of(kSchemes); i++) {
+        if (kSchemes[i].params == nullptr || kSchemes[i].prefix.empty()) return false;
+    }
+    return kSchemes[kVmess].name == "vmess" && kSchemes[kShadowsocks].name == "shadowsocks" &&
+           kSchemes[kXhttp].name == "xhttp";
+}
+static_assert(schemes_in_order(), "kSchemes must follow the Scheme enum");
+
+// Other spellings of a prefix; vless+reality is the form some panels export
+struct PrefixAlias {
+    std::string_view prefix;
+    Scheme scheme;
+};
+
+constexpr PrefixAlias kPrefixAliases[] = {
+    {"vless+reality://", kReality},
+    {"shadowsocks://", kShadowsocks},
+};
+
+bool equals_ignore_case(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        char x = a[i], y = b[i];
+        if (x >= 'A' && x <= 'Z') x = static_cast<char>(x - 'A' + 'a');
+        if (y >= 'A' && y <= 'Z') y = static_cast<char>(y - 'A' + 'a');
+        if (x != y) return false;
+    }
+    return true;
+}
+
+bool starts_with_ignore_case(std::string_view s, std::string_view prefix) {
+    return s.size() >= prefix.size() && equals_ignore_case(s.substr(0, prefix.size()), prefix);
+}
+
+const Param* find_param(const SchemeSpec& spec, std::string_view key) {
+    for (size_t i = 0; i < spec.param_count; i++) {
+        if (equals_ignore_case(spec.params[i].key, key)) return &spec.params[i];
+    }
+    return nullptr;
+}
+
+/** Decode %XX escapes; malformed escapes are kept as written */
+void percent_decode(std::string_view in, std::string& out) {
+    out.clear();
+    out.reserve(in.size());
+    for (size_t i = 0; i < in.size(); i++) {
+        if (in[i] == '%' && i + 2 < in.size()) {
+            int hi = text_codec::hex_value(in[i + 1]);
+            int lo = text_codec::hex_value(in[i + 2]);
+            if (hi >= 0 && lo >= 0) {
+                out.push_back(static_cast<char>((hi << 4) | lo));
+                i += 2;
+                continue;
+            }
+        }
+        out.push_back(in[i]);
+    }
+}
+
+void percent_encode(std::string_view in, std::string& out) {
+    static const char kHex[] = "0123456789ABCDEF";
+    for (char c : in) {
+        bool plain = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                     c == '-' || c == '.' || c == '_' || c == '~' || c == '/' || c == ',';
+        if (plain) {
+            out.push_back(c);
+        } else {
+            auto b = static_cast<uint8_t>(c);
+            out.push_back('%');
+            out.push_back(kHex[b >> 4]);
+            out.push_back(kHex[b & 0xF]);
+        }
+    }
+}
+
+bool parse_number(std::string_view value, int32_t& out) {
+    if (equals_ignore_case(value, "true")) {
+        out = 1;
+        return true;
+    }
+    if (equals_ignore_case(value, "false")) {
+        out = 0;
+        return true;
+    }
+    long long n = 0;
+    if (!text_codec::parse_int(value, n) || n < INT32_MIN || n > INT32_MAX) return false;
+    out = static_cast<int32_t>(n);
+    return true;
+}
+
+void assign(Link& link, uint8_t slot, std::string_view value) {
+    if (slot < kFieldCount) {
+        percent_decode(value, link.fields[slot]);
+    } else {
+        std::string decoded;
+        percent_decode(value, decoded);
+        parse_number(decoded, link.numbers[slot - kFieldCount]);
+    }
+}
+
+void apply_defaults(const SchemeSpec& spec, Link& link) {
+    for (size_t i = 0; i < spec.default_count; i++) {
+        std::string& field = link.fields[spec.defaults[i].slot];
+        if (field.empty()) field.assign(spec.defaults[i].value);
+    }
+}
+
+/** "host:port" or "[v6]:port"; the port may be left out only with a default_port */
+bool split_host_port(std::string_view authority, int32_t default_port, Link& link) {
+    std::string_view host;
+    std::string_view port;
+    bool has_port = true;
+    if (!authority.empty() && authority.front() == '[') {
+        size_t close = authority.find(']');
+        if (close == std::string_view::npos) return false;
+        host = authority.substr(1, close - 1);
+        if (close + 1 == authority.size()) {
+            has_port = false;
+        } else if (authority[close + 1] == ':') {
+            port = authority.substr(close + 2);
+        } else {
+            return false;
+        }
+    } else {
+        size_t colon = authority.rfind(':');
+        if (colon == 0) return false;
+        host = authority.substr(0, colon);
+        if (colon == std::string_view::npos) {
+            has_port = false;
+        } else {
+            port = authority.substr(colon + 1);
+        }
+    }
+
+    int32_t value = default_port;
+    if (host.empty() || (!has_port && default_port <= 0)) return false;
+    if (has_port && !parse_number(port, value)) return false;
+    if (value <= 0 || value > 65535) return false;
+    percent_decode(host, link.fields[kAddress]);
+    link.numbers[kPort] = value;
+    return true;
+}
+
+void parse_query(const SchemeSpec& spec, std::string_view query, Link& link) {
+    while (!query.empty()) {
+        size_t amp = query.find('&');
+        std::string_view pair = query.substr(0, amp);
+        query = amp == std::string_view::npos ? std::string_view() : query.substr(amp + 1);
+
+        size_t eq = pair.find('=');
+        if (eq == std::string_view::npos) continue;
+        const Param* param = find_param(spec, pair.substr(0, eq));
+        if (param != nullptr) assign(link, param->slot, pair.substr(eq + 1));
+    }
+}
+
+/**
+ * scheme://[userinfo@]host:port[/][?query][#name], the shape shared by
+ * every scheme except the legacy vmess and shadowsocks bodies
+ */
+bool parse_url(const SchemeSpec& spec, std::string_view body, Link& link) {
+    size_t q = body.find('?');
+    std::string_view query = q == std::string_view::npos ? std::string_view() : body.substr(q + 1);
+    std::string_view authority = body.substr(0, q);
+    size_t slash = authority.find('/');
+    if (slash != std::string_view::npos) authority = authority.substr(0, slash);
+
+    size_t at = authority.rfind('@');
+    if (spec.userinfo != kNoSlot) {
+        if (at == std::string_view::npos || at == 0) return false;
+        assign(link, spec.userinfo, authority.substr(0, at));
+    }
+    if (at != std::string_view::npos) authority = authority.substr(at + 1);
+    if (!split_host_port(authority, spec.default_port, link)) return false;
+
+    parse_query(spec, query, link);
+    return true;
+}
+
+bool parse_vmess_json(std::string_view body, Link& link) {
+    std::string json;
+    if (!text_codec::base64_decode(body, json) || json.empty()) return false;
+
+    JsonValue root;
+    std::string error;
+    if (!JsonValue::parse(json, root, error) || !root.is_object()) return false;
+
+    for (const Param& param : kVmessParams) {
+        const JsonValue* value = root.find(param.key);
+        if (value == nullptr) continue;
+        if (param.slot < kFieldCount) {
+            if (value->is_string()) link.fields[param.slot] = value->as_string();
+        } else if (value->is_number()) {
+            link.numbers[param.slot - kFieldCount] = static_cast<int32_t>(value->as_number());
+        } else if (value->is_string()) {
+            parse_number(value->as_string(), link.numbers[param.slot - kFieldCount]);
+        }
+    }
+    if (link.fields[kSecurity] == "none") link.fields[kSecurity].clear();
+
+    int32_t port = link.numbers[kPort];
+    return !link.fields[kAddress].empty() && port > 0 && port <= 65535;
+}
+
+/** Split a decoded "method:password"; the password may itself contain ':' */
+bool split_method_password(std::string_view decoded, Link& link) {
+    size_t colon = decoded.find(':');
+    if (colon == std::string_view::npos || colon == 0) return false;
+    link.fields[kMethod].assign(decoded.substr(0, colon));
+    link.fields[kPassword].assign(decoded.substr(colon + 1));
+    return true;
+}
+
+/**
+ * SIP002 ss://base64(method:password)@host:port, its plain percent-encoded
+ * form used by 2022 ciphers, and the legacy ss://base64(method:password@host:port)
+ */
+bool parse_shadowsocks(std::string_view body, Link& link) {
+    const SchemeSpec& spec = kSchemes[kShadowsocks];
+    size_t q = body.find('?');
+    std::string_view authority = body.substr(0, q);
+    size_t slash = authority.find('/');
+    if (slash != std::string_view::npos) authority = authority.substr(0, slash);
+
+    size_t at = authority.rfind('@');
+    if (at == std::string_view::npos) {
+        std::string decoded;
+        if (!text_codec::base64_decode(authority, decoded)) return false;
+        size_t inner_at = decoded.rfind('@');
+        if (inner_at == std::string::npos) return false;
+        if (!split_method_password(std::string_view(decoded).substr(0, inner_at), link)) return false;
+        if (!split_host_port(std::string_view(decoded).substr(inner_at + 1), spec.default_port, link)) {
+            return false;
+        }
+    } else {
+        std::string userinfo;
+        percent_decode(authority.substr(0, at), userinfo);
+        std::string decoded;
+        if (userinfo.find(':') == std::string::npos) {
+            if (!text_codec::base64_decode(userinfo, decoded)) return false;
+        } else {
+            decoded = std::move(userinfo);
+        }
+        if (!split_method_password(decoded, link)) return false;
+        if (!split_host_port(authority.substr(at + 1), spec.default_port, link)) return false;
+    }
+
+    if (q != std::string_view::npos) parse_query(spec, body.substr(q + 1), link);
+    return true;
+}
+
+void append_param(std::string& out, bool& first, std::string_view key, std::string_view value) {
+    out.push_back(first ? '?' : '&');
+    first = false;
+    out.append(key);
+    out.push_back('=');
+    percent_encode(value, out);
+}
+
+void append_authority(const Link& link, std::string& out) {
+    const std::string& address = link.get(kAddress);
+    if (address.find(':') != std::string::npos) {
+        out.push_back('[');
+        out.append(address);
+        out.push_back(']');
+    } else {
+        percent_encode(address, out);
+    }
+    out.push_back(':');
+    out.append(std::to_string(link.number(kPort)));
+}
+
+void append_name(const Link& link, std::string& out) {
+    if (link.get(kName).empty()) return;
+    out.push_back('#');
+    percent_encode(link.get(kName), out);
+}
+
+void generate_vmess(const Link& link, std::string& out) {
+    std::string json;
+    JsonWriter w(json);
+    w.begin_object();
+    w.field("v", "2");
+    for (const Param& param : kVmessParams) {
+        if (param.slot < kFieldCount) {
+            std::string_view value = link.fields[param.slot];
+            if (param.slot == kSecurity && value.empty()) value = "none";
+            w.field(param.key, value);
+        } else {
+            std::string number = std::to_string(link.numbers[param.slot - kFieldCount]);
+            w.field(param.key, std::string_view(number));
+        }
+    }
+    w.end_object();
+
+    out.append("vmess://");
+    text_codec::base64_encode(json, out, false, true);
+}
+
+void generate_shadowsocks(const Link& link, std::string& out) {
+    std::string userinfo = link.get(kMethod);
+    userinfo.push_back(':');
+    userinfo.append(link.get(kPassword));
+
+    out.append("ss://");
+    text_codec::base64_encode(userinfo, out, true, false);
+    out.push_back('@');
+    append_authority(link, out);
+    append_name(link, out);
+}
+
+} // namespace
+
+void Link::clear() {
+    scheme = kVless;
+    for (std::string& field : fields) field.clear();
+    for (int32_t& n : numbers) n = 0;
+}
+
+std::string_view scheme_name(Scheme scheme) {
+    return scheme >= 0 && scheme < kSchemeCount ? kSchemes[scheme].name : std::string_view();
+}
+
+bool parse(std::string_view uri, Link& out) {
+    out.clear();
+    while (!uri.empty() && (uri.back() == ' ' || uri.back() == '\r' || uri.back() == '\n' ||
+                            uri.back() == '\t')) {
+        uri.remove_suffix(1);
+    }
+    while (!uri.empty() && (uri.front() == ' ' || uri.front() == '\t')) uri.remove_prefix(1);
+
+    std::string_view body;
+    bool found = false;
+    for (int i = 0; i < kSchemeCount && !found; i++) {
+        if (starts_with_ignore_case(uri, kSchemes[i].prefix)) {
+            out.scheme = static_cast<Scheme>(i);
+            body = uri.substr(kSchemes[i].prefix.size());
+            found = true;
+        }
+    }
+    for (const PrefixAlias& alias : kPrefixAliases) {
+        if (!found && starts_with_ignore_case(uri, alias.prefix)) {
+            out.scheme = alias.scheme;
+            body = uri.substr(alias.prefix.size());
+            found = true;
+        }
+    }
+    if (!found) return false;
+
+    size_t hash = body.rfind('#');
+    if (hash != std::string_view::npos) {
+        percent_decode(body.substr(hash + 1), out.fields[kName]);
+        body = body.substr(0, hash);
+    }
+
+    const SchemeSpec& spec = kSchemes[out.scheme];
+    bool ok;
+    switch (out.scheme) {
+        case kVmess:
+            // v2rayN base64 JSON, or the newer vmess://uuid@host:port?... form
+            ok = parse_vmess_json(body, out);
+            if (!ok) {
+                std::string name = std::move(out.fields[kName]);
+                out.clear();
+                out.scheme = kVmess;
+                out.fields[kName] = std::move(name);
+                ok = parse_url(spec, body, out);
+            }
+            break;
+        case kShadowsocks:
+            ok = parse_shadowsocks(body, out);
+            break;
+        default:
+            ok = parse_url(spec, body, out);
+            break;
+    }
+    if (!ok) return false;
+
+    // vless links with security=reality are REALITY servers
+    if (out.scheme == kVless && out.get(kSecurity) == "reality") out.scheme = kReality;
+
+    apply_defaults(kSchemes[out.scheme], out);
+    return true;
+}
+
+void generate(const Link& link, std::string& out) {
+    if (link.scheme < 0 || link.scheme >= kSchemeCount) return;
+    if (link.scheme == kVmess) {
+        generate_vmess(link, out);
+        return;
+    }
+    if (link.scheme == kShadowsocks) {
+        generate_shadowsocks(link, out);
+        return;
+    }
+
+    const SchemeSpec& spec = kSchemes[link.scheme];
+    // REALITY is shared as the standard vless://...&security=reality form
+    out.append(link.scheme == kReality ? kSchemes[kVless].prefix : spec.prefix);
+    if (spec.userinfo != kNoSlot) {
+        percent_encode(link.fields[spec.userinfo], out);
+        out.push_back('@');
+    }
+    append_authority(link, out);
+
+    bool first = true;
+    for (size_t i = 0; i < spec.param_count; i++) {
+        const Param& param = spec.params[i];
+        if (param.alias || param.slot == spec.userinfo) continue;
+        if (param.slot < kFieldCount) {
+            const std::string& value = link.fields[param.slot];
+            if (!value.empty()) append_param(out, first, param.key, value);
+        } else {
+            int32_t value = link.numbers[param.slot - kFieldCount];
+            if (value != 0) append_param(out, first, param.key, std::to_string(value));
+        }
+    }
+    append_name(link, out);
+}
+
+int benchmark(const std::string* uris, size_t count, int duration_ms,
+              int64_t& parse_ns, int64_t& generate_ns) {
+    parse_ns = 0;
+    generate_ns = 0;
+    if (count == 0) return 0;
+
+    std::vector<Link> links(count);
+    int parsed = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (parse(uris[i], links[i])) parsed++;
+    }
+
+    // Half the budget for each direction, whole passes over the input only
+    auto run = [&](bool parsing) -> int64_t {
+        Link scratch;
+        std::string out;
+        int64_t ops = 0;
+        Clock::time_point start = Clock::now();
+        Clock::time_point deadline = start + std::chrono::milliseconds(duration_ms / 2);
+        Clock::time_point now;
+        do {
+            for (size_t i = 0; i < count; i++) {
+                if (parsing) {
+                    parse(uris[i], scratch);
+                } else {
+                    out.clear();
+                    generate(links[i], out);
+                }
+            }
+            ops += static_cast<int64_t>(count);
+            now = Clock::now();
+        } while (now < deadline);
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count() / ops;
+    };
+
+    parse_ns = run(true);
+    generate_ns = run(false);
+    return parsed;
+}
+
+} // namespace share_link
+
+namespace {
+
+// Parsed links cross JNI as UTF-16: names routinely carry emoji, which the
+// modified UTF-8 of NewStringUTF/GetStringUTFChars cannot round-trip
+
+std::string jstring_to_utf8(JNIEnv* env, jstring value) {
+    std::string out;
+    if (value == nullptr) return out;
+    jsize length = env->GetStringLength(value);
+    const jchar* chars = env->GetStringCritical(value, nullptr);
+    if (chars == nullptr) return out;
+    out.reserve(static_cast<size_t>(length));
+    for (jsize i = 0; i < length; i++) {
+        uint32_t c = chars[i];
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < length && chars[i + 1] >= 0xDC00 &&
+            chars[i + 1] <= 0xDFFF) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (chars[i + 1] - 0xDC00);
+            i++;
+        }
+        if (c < 0x80) {
+            out.push_back(static_cast<char>(c));
+        } else if (c < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (c >> 6)));
+            out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        } else if (c < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (c >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | (c >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        }
+    }
+    env->ReleaseStringCritical(value, chars);
+    return out;
+}
+
+/** Invalid UTF-8 (a mis-decoded name) becomes U+FFFD rather than failing */
+jstring utf8_to_jstring(JNIEnv* env, std::string_view value) {
+    std::vector<jchar> units;
+    units.reserve(value.size());
+    size_t i = 0;
+    while (i < value.size()) {
+        auto b = static_cast<uint8_t>(value[i]);
+        uint32_t c = 0xFFFD;
+        size_t extra = b < 0x80 ? 0 : (b & 0xE0) == 0xC0 ? 1 : (b & 0xF0) == 0xE0 ? 2
+                     : (b & 0xF8) == 0xF0 ? 3 : 4;
+        if (extra == 0) {
+            c = b;
+        } else if (extra < 4 && i + extra < value.size()) {
+            uint32_t v = b & (0x3F >> extra);
+            bool valid = true;
+            for (size_t k = 1; k <= extra; k++) {
+                auto cont = static_cast<uint8_t>(value[i + k]);
+                if ((cont & 0xC0) != 0x80) {
+                    valid = false;
+                    break;
+                }
+                v = (v << 6) | (cont & 0x3F);
+            }
+            if (valid) {
+                c = v;
+                i += extra;
+            }
+        }
+        i++;
+        if (c >= 0x10000) {
+            c -= 0x10000;
+            units.push_back(static_cast<jchar>(0xD800 + (c >> 10)));
+            units.push_back(static_cast<jchar>(0xDC00 + (c & 0x3FF)));
+        } else {
+            units.push_back(static_cast<jchar>(c));
+        }
+    }
+    return env->NewString(units.data(), static_cast<jsize>(units.size()));
+}
+
+} // namespace
+
+extern "C" {
+
+/**
+ * Parse share links into flat columns
+ * @param numbers Filled with (1 + kNumberCount) ints per link: the scheme
+ *                (-1 when the link did not parse) followed by the numbers
+ * @return kFieldCount strings per link, null where a field is empty
+ */
+JNIEXPORT jobjectArray JNICALL
+Java_com_hiddify_hiddifyng_utils_ShareLinkCodec_parseNative(JNIEnv *env, jclass clazz,
+                                                            jobjectArray links,
+                                                            jintArray numbers) {
+    constexpr jsize kNumberStride = 1 + share_link::kNumberCount;
+    jsize count = env->GetArrayLength(links);
+    if (env->GetArrayLength(numbers) < count * kNumberStride) {
+        LOGE("Share link number array too small for %d links", count);
+        return nullptr;
+    }
+
+    jclass string_class = env->FindClass("java/lang/String");
+    jobjectArray result = env->NewObjectArray(count * share_link::kFieldCount, string_class,
+                                              nullptr);
+    if (result == nullptr) return nullptr;
+
+    std::vector<jint> flat(static_cast<size_t>(count * kNumberStride), 0);
+    share_link::Link link;
+    int parsed = 0;
+    for (jsize i = 0; i < count; i++) {
+        auto uri = static_cast<jstring>(env->GetObjectArrayElement(links, i));
+        std::string text = jstring_to_utf8(env, uri);
+        env->DeleteLocalRef(uri);
+
+        jint* row = &flat[static_cast<size_t>(i * kNumberStride)];
+        if (!share_link::parse(text, link)) {
+            row[0] = -1;
+            continue;
+        }
+        parsed++;
+        row[0] = link.scheme;
+        for (int n = 0; n < share_link::kNumberCount; n++) row[1 + n] = link.numbers[n];
+
+        for (int f = 0; f < share_link::kFieldCount; f++) {
+            if (link.fields[f].empty()) continue;
+            jstring value = utf8_to_jstring(env, link.fields[f]);
+            env->SetObjectArrayElement(result, i * share_link::kFieldCount + f, value);
+            env->DeleteLocalRef(value);
+        }
+    }
+    env->SetIntArrayRegion(numbers, 0, count * kNumberStride, flat.data());
+
+    if (parsed < count) LOGW("Parsed %d of %d share links", parsed, count);
+    return result;
+}
+
+/**
+ * Generate a share link from flat columns (the layout parseNative returns)
+ * @return Link, or null for an unknown scheme
+ */
+JNIEXPORT jstring JNICALL
+Java_com_hiddify_hiddifyng_utils_ShareLinkCodec_generateNative(JNIEnv *env, jclass clazz,
+                                                               jint scheme, jobjectArray fields,
+                                                               jintArray numbers) {
+    if (scheme < 0 || scheme >= share_link::kSchemeCount ||
+        env->GetArrayLength(fields) < share_link::kFieldCount ||
+        env->GetArrayLength(numbers) < share_link::kNumberCount) {
+        return nullptr;
+    }
+
+    share_link::Link link;
+    link.scheme = static_cast<share_link::Scheme>(scheme);
+    for (int f = 0; f < share_link::kFieldCount; f++) {
+        auto value = static_cast<jstring>(env->GetObjectArrayElement(fields, f));
+        link.fields[f] = jstring_to_utf8(env, value);
+        if (value != nullptr) env->DeleteLocalRef(value);
+    }
+    env->GetIntArrayRegion(numbers, 0, share_link::kNumberCount, link.numbers);
+
+    std::string out;
+    share_link::generate(link, out);
+    return utf8_to_jstring(env, out);
+}
+
+/**
+ * Time the codec on the given links
+ * @return [links parsed, parse ns per link, generate ns per link]
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_hiddify_hiddifyng_utils_ShareLinkCodec_benchmarkNative(JNIEnv *env, jclass clazz,
+                                                                jobjectArray links,
+                                                                jint duration_ms) {
+    jsize count = env->GetArrayLength(links);
+    std::vector<std::string> uris;
+    uris.reserve(static_cast<size_t>(count));
+    for (jsize i = 0; i < count; i++) {
+        auto uri = static_cast<jstring>(env->GetObjectArrayElement(links, i));
+        uris.push_back(jstring_to_utf8(env, uri));
+        env->DeleteLocalRef(uri);
+    }
+
+    int64_t parse_ns = 0;
+    int64_t generate_ns = 0;
+    int parsed = share_link::benchmark(uris.data(), uris.size(), duration_ms, parse_ns,
+                                       generate_ns);
+    LOGI("Share link codec: %d/%d parsed, %lld ns parse, %lld ns generate per link",
+         parsed, count, static_cast<long long>(parse_ns), static_cast<long long>(generate_ns));
+
+    jlong values[3] = {parsed, parse_ns, generate_ns};
+    jlongArray result = env->NewLongArray(3);
+    if (result != nullptr) env->SetLongArrayRegion(result, 0, 3, values);
+    return result;
+}
+
+} // extern "C"
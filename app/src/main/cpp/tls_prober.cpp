@@ -0,0 +1,803 @@
+#include <jni.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <random>
+
+#include "tls_prober.h"
+#include "dns_resolver.h"
+#include "native_log.h"
+
+namespace tls_prober {
+
+namespace {
+
+constexpr int kMaxEvents = 64;
+constexpr int kMaxInFlight = 512;
+constexpr size_t kMaxRecord = 16384 + 2048;  // TLSCiphertext limit
+constexpr int64_t kQuietSlackNs = 20000000;    // added to the connect RTT
+
+// Record and handshake types
+constexpr uint8_t kChangeCipherSpec = 20;
+constexpr uint8_t kAlert = 21;
+constexpr uint8_t kHandshake = 22;
+constexpr uint8_t kApplicationData = 23;
+constexpr uint8_t kServerHello = 2;
+constexpr uint8_t kServerHelloDone = 14;
+
+// Extension types
+constexpr uint16_t kServerName = 0;
+constexpr uint16_t kStatusRequest = 5;
+constexpr uint16_t kSupportedGroups = 10;
+constexpr uint16_t kEcPointFormats = 11;
+constexpr uint16_t kSignatureAlgorithms = 13;
+constexpr uint16_t kAlpn = 16;
+constexpr uint16_t kSct = 18;
+constexpr uint16_t kPadding = 21;
+constexpr uint16_t kExtendedMasterSecret = 23;
+constexpr uint16_t kCompressCertificate = 27;
+constexpr uint16_t kRecordSizeLimit = 28;
+constexpr uint16_t kDelegatedCredentials = 34;
+constexpr uint16_t kSessionTicket = 35;
+constexpr uint16_t kSupportedVersions = 43;
+constexpr uint16_t kPskModes = 45;
+constexpr uint16_t kKeyShare = 51;
+constexpr uint16_t kApplicationSettings = 17513;
+constexpr uint16_t kRenegotiationInfo = 0xff01;
+constexpr uint16_t kGrease = 0x0a0a;  // placeholder, replaced by a random GREASE value
+
+constexpr uint16_t kX25519 = 29;
+
+// SHA-256 of "HelloRetryRequest", sent as the ServerHello random
+constexpr uint8_t kHelloRetryRandom[32] = {
+    0xcf, 0x21, 0xad, 0x74, 0xe5, 0x9a, 0x61, 0x11, 0xbe, 0x1d, 0x8c, 0x02, 0x1e, 0x65, 0xb8, 0x91,
+    0xc2, 0xa2, 0x11, 0x16, 0x7a, 0xbb, 0x8c, 0x5e, 0x07, 0x9e, 0x09, 0xe2, 0xc8, 0xa8, 0x33, 0x9c};
+
+/** What one browser family puts in its ClientHello, in wire order */
+struct Profile {
+    std::vector<uint16_t> ciphers;
+    std::vector<uint16_t> extensions;
+    std::vector<uint16_t> groups;
+    std::vector<uint16_t> signatures;
+    std::vector<uint16_t> versions;
+    std::vector<uint16_t> cert_compression;
+    bool shuffle;  // Chrome permutes its extensions on every hello
+};
+
+const Profile& chrome() {
+    static const Profile profile{
+            {kGrease, 0x1301, 0x1302, 0x1303, 0xc02b, 0xc02f, 0xc02c, 0xc030, 0xcca9, 0xcca8,
+             0xc013, 0xc014, 0x009c, 0x009d, 0x002f, 0x0035},
+            {kGrease, kServerName, kExtendedMasterSecret, kRenegotiationInfo, kSupportedGroups,
+             kEcPointFormats, kSessionTicket, kAlpn, kStatusRequest, kSignatureAlgorithms, kSct,
+             kKeyShare, kPskModes, kSupportedVersions, kCompressCertificate,
+             kApplicationSettings, kGrease, kPadding},
+            {kGrease, kX25519, 23, 24},
+            {0x0403, 0x0804, 0x0401, 0x0503, 0x0805, 0x0501, 0x0806, 0x0601},
+            {kGrease, 0x0304, 0x0303},
+            {2},  // brotli
+            true};
+    return profile;
+}
+
+const Profile& firefox() {
+    static const Profile profile{
+            {0x1301, 0x1303, 0x1302, 0xc02b, 0xc02f, 0xcca9, 0xcca8, 0xc02c, 0xc030, 0xc00a,
+             0xc009, 0xc013, 0xc014, 0x009c, 0x009d, 0x002f, 0x0035},
+            {kServerName, kExtendedMasterSecret, kRenegotiationInfo, kSupportedGroups,
+             kEcPointFormats, kSessionTicket, kAlpn, kStatusRequest, kDelegatedCredentials,
+             kKeyShare, kSupportedVersions, kSignatureAlgorithms, kPskModes, kRecordSizeLimit},
+            {kX25519, 23, 24, 25, 256, 257},
+            {0x0403, 0x0503, 0x0603, 0x0804, 0x0805, 0x0806, 0x0401, 0x0501, 0x0601, 0x0203,
+             0x0201},
+            {0x0304, 0x0303},
+            {},
+            false};
+    return profile;
+}
+
+const Profile& safari() {
+    static const Profile profile{
+            {kGrease, 0x1301, 0x1302, 0x1303, 0xc02c, 0xc02b, 0xcca9, 0xc030, 0xc02f, 0xcca8,
+             0xc00a, 0xc009, 0xc014, 0xc013, 0x009d, 0x009c, 0x0035, 0x002f, 0xc008, 0xc012,
+             0x000a},
+            {kGrease, kServerName, kExtendedMasterSecret, kRenegotiationInfo, kSupportedGroups,
+             kEcPointFormats, kAlpn, kStatusRequest, kSignatureAlgorithms, kSct, kKeyShare,
+             kPskModes, kSupportedVersions, kCompressCertificate, kGrease, kPadding},
+            {kGrease, kX25519, 23, 24, 25},
+            {0x0403, 0x0804, 0x0401, 0x0503, 0x0203, 0x0805, 0x0805, 0x0501, 0x0806, 0x0601,
+             0x0201},
+            {kGrease, 0x0304, 0x0303, 0x0302, 0x0301},
+            {1},  // zlib
+            false};
+    return profile;
+}
+
+/** uTLS fingerprint names; Chromium-based and unknown ones look like Chrome */
+const Profile& profile_for(const std::string& fingerprint) {
+    if (fingerprint == "firefox") return firefox();
+    if (fingerprint == "safari" || fingerprint == "ios") return safari();
+    return chrome();
+}
+
+class Writer {
+public:
+    explicit Writer(std::vector<uint8_t>& out) : out_(out) {}
+
+    void u8(uint8_t v) { out_.push_back(v); }
+    void u16(uint16_t v) { u8(static_cast<uint8_t>(v >> 8)); u8(static_cast<uint8_t>(v)); }
+    void u24(uint32_t v) { u8(static_cast<uint8_t>(v >> 16)); u16(static_cast<uint16_t>(v)); }
+    void bytes(const void* data, size_t size) {
+        auto* p = static_cast<const uint8_t*>(data);
+        out_.insert(out_.end(), p, p + size);
+    }
+
+    /** Reserve a length prefix of width bytes; close() fills it in */
+    size_t open(int width) {
+        size_t at = out_.size();
+        out_.insert(out_.end(), static_cast<size_t>(width), 0);
+        return at;
+    }
+    void close(size_t at, int width) {
+        size_t length = out_.size() - at - static_cast<size_t>(width);
+        for (int i = width - 1; i >= 0; i--, length >>= 8) {
+            out_[at + static_cast<size_t>(i)] = static_cast<uint8_t>(length);
+        }
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+};
+
+void fill_random(uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = getrandom(data, size, 0);
+        if (n <= 0) break;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+bool is_ip_literal(const std::string& host) {
+    in6_addr buffer;
+    return inet_pton(AF_INET, host.c_str(), &buffer) == 1 ||
+           inet_pton(AF_INET6, host.c_str(), &buffer) == 1;
+}
+
+struct Grease {
+    uint16_t values[4];  // cipher, first extension, last extension, group/version
+
+    Grease() {
+        uint8_t seed[4];
+        fill_random(seed, sizeof(seed));
+        for (int i = 0; i < 4; i++) values[i] = static_cast<uint16_t>(0x0a0a + 0x1010 * (seed[i] & 0x0f));
+        if (values[2] == values[1]) values[2] ^= 0x1010;
+    }
+};
+
+/** The body of one extension; padding is sized separately */
+void write_extension(uint16_t type, const Profile& profile, const std::string& sni,
+                     const Grease& grease, Writer& w) {
+    auto list16 = [&](const std::vector<uint16_t>& values) {
+        size_t at = w.open(2);
+        for (uint16_t v : values) w.u16(v == kGrease ? grease.values[3] : v);
+        w.close(at, 2);
+    };
+    switch (type) {
+        case kServerName: {
+            size_t list = w.open(2);
+            w.u8(0);  // host_name
+            w.u16(static_cast<uint16_t>(sni.size()));
+            w.bytes(sni.data(), sni.size());
+            w.close(list, 2);
+            break;
+        }
+        case kRenegotiationInfo:
+            w.u8(0);
+            break;
+        case kSupportedGroups:
+            list16(profile.groups);
+            break;
+        case kEcPointFormats:
+            w.u8(1);
+            w.u8(0);  // uncompressed
+            break;
+        case kAlpn: {
+            size_t list = w.open(2);
+            for (const char* protocol : {"h2", "http/1.1"}) {
+                w.u8(static_cast<uint8_t>(strlen(protocol)));
+                w.bytes(protocol, strlen(protocol));
+            }
+            w.close(list, 2);
+            break;
+        }
+        case kStatusRequest:
+            w.u8(1);  // OCSP, no responder ids or extensions
+            w.u16(0);
+            w.u16(0);
+            break;
+        case kSignatureAlgorithms:
+        case kDelegatedCredentials:
+            list16(profile.signatures);
+            break;
+        case kKeyShare: {
+            size_t list = w.open(2);
+            if (profile.groups.front() == kGrease) {
+                w.u16(grease.values[3]);
+                w.u16(1);
+                w.u8(0);
+            }
+            // Any 32 bytes are a valid X25519 public key; the probe never derives keys
+            uint8_t key[32];
+            fill_random(key, sizeof(key));
+            w.u16(kX25519);
+            w.u16(sizeof(key));
+            w.bytes(key, sizeof(key));
+            w.close(list, 2);
+            break;
+        }
+        case kPskModes:
+            w.u8(1);
+            w.u8(1);  // psk_dhe_ke
+            break;
+        case kSupportedVersions: {
+            size_t list = w.open(1);
+            for (uint16_t v : profile.versions) w.u16(v == kGrease ? grease.values[3] : v);
+            w.close(list, 1);
+            break;
+        }
+        case kCompressCertificate: {
+            size_t list = w.open(1);
+            for (uint16_t v : profile.cert_compression) w.u16(v);
+            w.close(list, 1);
+            break;
+        }
+        case kApplicationSettings: {
+            size_t list = w.open(2);
+            w.u8(2);
+            w.bytes("h2", 2);
+            w.close(list, 2);
+            break;
+        }
+        case kRecordSizeLimit:
+            w.u16(0x4001);
+            break;
+        default:  // extended_master_secret, session_ticket, sct, GREASE: empty
+            break;
+    }
+}
+
+void build_client_hello(const std::string& sni, const std::string& fingerprint,
+                        std::vector<uint8_t>& out) {
+    const Profile& profile = profile_for(fingerprint);
+    Grease grease;
+    bool send_sni = !sni.empty() && !is_ip_literal(sni);
+
+    std::vector<uint16_t> order = profile.extensions;
+    if (profile.shuffle) {
+        // GREASE and padding keep their places, as in Chrome
+        std::vector<size_t> slots;
+        std::vector<uint16_t> movable;
+        for (size_t i = 0; i < order.size(); i++) {
+            if (order[i] != kGrease && order[i] != kPadding) {
+                slots.push_back(i);
+                movable.push_back(order[i]);
+            }
+        }
+        uint64_t seed;
+        fill_random(reinterpret_cast<uint8_t*>(&seed), sizeof(seed));
+        std::shuffle(movable.begin(), movable.end(), std::mt19937_64(seed));
+        for (size_t i = 0; i < slots.size(); i++) order[slots[i]] = movable[i];
+    }
+
+    // Extensions first, so padding can be sized against the whole hello
+    std::vector<uint8_t> extensions;
+    Writer ext(extensions);
+    bool pad = false;
+    int grease_seen = 0;
+    for (uint16_t type : order) {
+        if (type == kPadding) {
+            pad = true;
+            continue;
+        }
+        if (type == kServerName && !send_sni) continue;
+        bool is_grease = type == kGrease;
+        ext.u16(is_grease ? grease.values[1 + std::min(grease_seen++, 1)] : type);
+        size_t body = ext.open(2);
+        if (is_grease && grease_seen == 2) ext.u8(0);  // Chrome's trailing GREASE carries a byte
+        else write_extension(type, profile, sni, grease, ext);
+        ext.close(body, 2);
+    }
+
+    std::vector<uint8_t> hello;
+    Writer w(hello);
+    w.u16(0x0303);
+    uint8_t random[64];
+    fill_random(random, sizeof(random));
+    w.bytes(random, 32);
+    w.u8(32);  // session id, as middlebox-compatible clients send
+    w.bytes(random + 32, 32);
+    size_t ciphers = w.open(2);
+    for (uint16_t c : profile.ciphers) w.u16(c == kGrease ? grease.values[0] : c);
+    w.close(ciphers, 2);
+    w.u8(1);
+    w.u8(0);  // null compression
+
+    if (pad) {
+        // BoringSSL pads hellos between 256 and 511 bytes up to 512
+        size_t length = 4 + hello.size() + 2 + extensions.size();
+        if (length > 0xff && length < 0x200) {
+            size_t padding = 0x200 - length;
+            padding = padding >= 5 ? padding - 4 : 1;
+            ext.u16(kPadding);
+            ext.u16(static_cast<uint16_t>(padding));
+            extensions.insert(extensions.end(), padding, 0);
+        }
+    }
+    w.u16(static_cast<uint16_t>(extensions.size()));
+    w.bytes(extensions.data(), extensions.size());
+
+    Writer record(out);
+    record.u8(kHandshake);
+    record.u16(0x0301);
+    record.u16(static_cast<uint16_t>(4 + hello.size()));
+    record.u8(1);  // client_hello
+    record.u24(static_cast<uint32_t>(hello.size()));
+    record.bytes(hello.data(), hello.size());
+}
+
+int64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+using dns_resolver::Address;
+
+/** First address of each target in connection order; failed lookups keep length 0 */
+std::vector<Address> resolve(const std::vector<Target>& targets) {
+    std::vector<std::string> hosts;
+    for (const Target& target : targets) hosts.push_back(target.host);
+    std::vector<Address> addresses(targets.size());
+    std::vector<dns_resolver::Answer> answers = dns_resolver::resolve(hosts);
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (answers[i].status != dns_resolver::kOk) continue;
+        addresses[i] = answers[i].addresses.front();
+        addresses[i].set_port(targets[i].port);
+    }
+    return addresses;
+}
+
+Status status_of(int error) {
+    switch (error) {
+        case ECONNREFUSED:
+            return kRefused;
+        case ENETUNREACH:
+        case EHOSTUNREACH:
+        case EADDRNOTAVAIL:
+        case EAFNOSUPPORT:
+            return kUnreachable;
+        case ETIMEDOUT:
+            return kTimeout;
+        default:
+            return kError;
+    }
+}
+
+struct Connection {
+    int fd = -1;
+    int64_t started_ns = 0;
+    int64_t deadline_ns = 0;
+    int64_t quiet_ns = 0;        // TLS 1.3: end of flight if nothing arrives by then
+    int64_t last_record_ns = 0;
+    std::vector<uint8_t> input;  // unparsed record bytes
+    std::vector<uint8_t> messages;  // handshake layer, plaintext records only
+    bool connected = false;
+    bool hello_seen = false;
+    bool tls13 = false;
+};
+
+class Sweep {
+public:
+    Sweep(const std::vector<Target>& targets, const Options& options)
+        : targets_(targets), options_(options) {
+        options_.timeout_ms = std::max(1, options_.timeout_ms);
+        options_.max_in_flight = std::clamp(options_.max_in_flight, 1, kMaxInFlight);
+    }
+
+    ~Sweep() {
+        for (Connection& connection : connections_) {
+            if (connection.fd >= 0) close(connection.fd);
+        }
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+    }
+
+    std::vector<Result> run() {
+        results_.resize(targets_.size());
+        connections_.resize(targets_.size());
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            LOGE("epoll_create1 failed: %s", strerror(errno));
+            for (size_t i = 0; i < targets_.size(); i++) results_[i].index = i;
+            return results_;
+        }
+
+        addresses_ = resolve(targets_);
+        for (size_t i = 0; i < targets_.size(); i++) {
+            results_[i].index = i;
+            if (targets_[i].port <= 0 || targets_[i].port > 65535) {
+                results_[i].status = kError;
+            } else if (addresses_[i].length == 0) {
+                results_[i].status = kResolveFailed;
+            } else {
+                pending_.push_back(i);
+            }
+        }
+
+        epoll_event events[kMaxEvents];
+        while (!pending_.empty() || in_flight_ > 0) {
+            launch();
+            if (in_flight_ == 0) continue;
+
+            int n = epoll_wait(epoll_fd_, events, kMaxEvents, wait_ms());
+            int64_t now = now_ns();
+            if (n < 0 && errno != EINTR) {
+                LOGE("epoll_wait failed: %s", strerror(errno));
+                break;
+            }
+            for (int i = 0; i < n; i++) {
+                auto index = static_cast<size_t>(events[i].data.u64);
+                if (connections_[index].fd < 0) continue;
+                if (connections_[index].connected) {
+                    receive(index, now);
+                } else {
+                    connected(index, now);
+                }
+            }
+            expire(now);
+        }
+        return results_;
+    }
+
+private:
+    void launch() {
+        while (in_flight_ < options_.max_in_flight && !pending_.empty()) {
+            size_t index = pending_.front();
+            pending_.pop_front();
+            Connection& connection = connections_[index];
+            const Address& address = addresses_[index];
+
+            int fd = socket(address.storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) {
+                results_[index].status = status_of(errno);
+                continue;
+            }
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            linger reset{1, 0};
+            setsockopt(fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+
+            connection.started_ns = now_ns();
+            connection.deadline_ns = connection.started_ns + options_.timeout_ms * 1000000ll;
+            if (connect(fd, reinterpret_cast<const sockaddr*>(&address.storage), address.length) < 0 &&
+                errno != EINPROGRESS) {
+                results_[index].status = status_of(errno);
+                ::close(fd);
+                continue;
+            }
+            epoll_event event{};
+            event.events = EPOLLOUT;
+            event.data.u64 = index;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+                results_[index].status = status_of(errno);
+                ::close(fd);
+                continue;
+            }
+            connection.fd = fd;
+            in_flight_++;
+        }
+    }
+
+    void connected(size_t index, int64_t now) {
+        Connection& connection = connections_[index];
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            finish(index, status_of(error));
+            return;
+        }
+        connection.connected = true;
+        results_[index].connect_ns = now - connection.started_ns;
+
+        std::vector<uint8_t> hello;
+        const Target& target = targets_[index];
+        build_client_hello(target.sni, target.fingerprint, hello);
+        ssize_t sent = send(connection.fd, hello.data(), hello.size(), MSG_NOSIGNAL);
+        if (sent != static_cast<ssize_t>(hello.size())) {
+            finish(index, sent < 0 ? status_of(errno) : kError);
+            return;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = index;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event);
+    }
+
+    void receive(size_t index, int64_t now) {
+        Connection& connection = connections_[index];
+        Result& result = results_[index];
+        uint8_t buffer[16384];
+        for (;;) {
+            ssize_t n = recv(connection.fd, buffer, sizeof(buffer), 0);
+            if (n == 0) {
+                // A TLS 1.3 server that hangs up after its flight still sent it
+                if (connection.last_record_ns > 0) {
+                    finish_flight(index, connection.last_record_ns);
+                } else {
+                    finish(index, result.server_hello_ns > 0 ? kOk : kHandshakeFailed);
+                }
+                return;
+            }
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+                finish(index, result.server_hello_ns > 0 ? kOk : status_of(errno));
+                return;
+            }
+            if (result.first_byte_ns == 0) result.first_byte_ns = now - connection.started_ns;
+            connection.input.insert(connection.input.end(), buffer, buffer + n);
+            if (!parse_records(index, now)) return;
+        }
+    }
+
+    /** @return false once the connection is finished */
+    bool parse_records(size_t index, int64_t now) {
+        Connection& connection = connections_[index];
+        Result& result = results_[index];
+        size_t offset = 0;
+        const std::vector<uint8_t>& in = connection.input;
+        while (in.size() - offset >= 5) {
+            uint8_t type = in[offset];
+            size_t length = (static_cast<size_t>(in[offset + 3]) << 8) | in[offset + 4];
+            if (in[offset + 1] != 3 || length > kMaxRecord) {
+                finish(index, kHandshakeFailed);
+                return false;
+            }
+            if (in.size() - offset < 5 + length) break;
+            const uint8_t* body = in.data() + offset + 5;
+            offset += 5 + length;
+
+            if (type == kHandshake && !connection.tls13) {
+                connection.messages.insert(connection.messages.end(), body, body + length);
+                if (!parse_messages(index, now)) return false;
+            } else if (type == kApplicationData && connection.tls13) {
+                connection.last_record_ns = now;
+                connection.quiet_ns = now + result.connect_ns + kQuietSlackNs;
+            } else if (type == kAlert) {
+                finish(index, kHandshakeFailed);
+                return false;
+            } else if (type != kChangeCipherSpec) {
+                finish(index, kHandshakeFailed);
+                return false;
+            }
+        }
+        connection.input.erase(connection.input.begin(), connection.input.begin() + offset);
+        return true;
+    }
+
+    bool parse_messages(size_t index, int64_t now) {
+        Connection& connection = connections_[index];
+        Result& result = results_[index];
+        size_t offset = 0;
+        const std::vector<uint8_t>& m = connection.messages;
+        while (m.size() - offset >= 4) {
+            uint8_t type = m[offset];
+            size_t length = (static_cast<size_t>(m[offset + 1]) << 16) |
+                            (static_cast<size_t>(m[offset + 2]) << 8) | m[offset + 3];
+            if (m.size() - offset < 4 + length) break;
+            const uint8_t* body = m.data() + offset + 4;
+            offset += 4 + length;
+
+            if (type == kServerHello) {
+                if (!parse_server_hello(body, length, result, connection)) {
+                    finish(index, kHandshakeFailed);
+                    return false;
+                }
+                result.server_hello_ns = now - connection.started_ns;
+                if (memcmp(body + 2, kHelloRetryRandom, sizeof(kHelloRetryRandom)) == 0) {
+                    // Answering would take a second hello; the flight time stays unknown
+                    finish(index, kOk);
+                    return false;
+                }
+            } else if (!connection.hello_seen) {
+                finish(index, kHandshakeFailed);
+                return false;
+            } else if (type == kServerHelloDone) {
+                finish_flight(index, now);
+                return false;
+            }
+        }
+        connection.messages.erase(connection.messages.begin(), connection.messages.begin() + offset);
+        return true;
+    }
+
+    static bool parse_server_hello(const uint8_t* p, size_t length, Result& result,
+                                   Connection& connection) {
+        // version(2) random(32) session id(1+n) cipher(2) compression(1) [extensions]
+        if (length < 38) return false;
+        size_t at = 34;
+        size_t session = p[at];
+        at += 1 + session;
+        if (length < at + 3) return false;
+        result.cipher = static_cast<uint16_t>((p[at] << 8) | p[at + 1]);
+        result.version = static_cast<uint16_t>((p[0] << 8) | p[1]);
+        at += 3;
+        if (length >= at + 2) {
+            size_t end = std::min(length, at + 2 + ((p[at] << 8) | p[at + 1]));
+            at += 2;
+            while (end - at >= 4) {
+                uint16_t type = static_cast<uint16_t>((p[at] << 8) | p[at + 1]);
+                size_t size = (p[at + 2] << 8) | p[at + 3];
+                at += 4;
+                if (end - at < size) break;
+                if (type == kSupportedVersions && size == 2) {
+                    result.version = static_cast<uint16_t>((p[at] << 8) | p[at + 1]);
+                }
+                at += size;
+            }
+        }
+        connection.hello_seen = true;
+        connection.tls13 = result.version == 0x0304;
+        return true;
+    }
+
+    void finish_flight(size_t index, int64_t at_ns) {
+        results_[index].handshake_ns = at_ns - connections_[index].started_ns;
+        finish(index, kOk);
+    }
+
+    void finish(size_t index, Status status) {
+        Connection& connection = connections_[index];
+        results_[index].status = status;
+        ::close(connection.fd);  // also removes it from the epoll set
+        connection.fd = -1;
+        connection.input = {};
+        connection.messages = {};
+        in_flight_--;
+    }
+
+    void expire(int64_t now) {
+        for (size_t index = 0; index < connections_.size(); index++) {
+            Connection& connection = connections_[index];
+            if (connection.fd < 0) continue;
+            if (connection.quiet_ns > 0 && now >= connection.quiet_ns) {
+                finish_flight(index, connection.last_record_ns);
+            } else if (now >= connection.deadline_ns) {
+                if (connection.last_record_ns > 0) {
+                    finish_flight(index, connection.last_record_ns);
+                } else {
+                    finish(index, kTimeout);
+                }
+            }
+        }
+    }
+
+    int wait_ms() const {
+        int64_t wake = INT64_MAX;
+        for (const Connection& connection : connections_) {
+            if (connection.fd < 0) continue;
+            wake = std::min(wake, connection.deadline_ns);
+            if (connection.quiet_ns > 0) wake = std::min(wake, connection.quiet_ns);
+        }
+        if (wake == INT64_MAX) return -1;
+        int64_t remaining = wake - now_ns();
+        return remaining <= 0 ? 0 : static_cast<int>((remaining + 999999) / 1000000);
+    }
+
+    const std::vector<Target>& targets_;
+    Options options_;
+
+    int epoll_fd_ = -1;
+    std::vector<Address> addresses_;
+    std::vector<Connection> connections_;
+    std::vector<Result> results_;
+    std::deque<size_t> pending_;
+    int in_flight_ = 0;
+};
+
+} // namespace
+
+std::vector<Result> run(const std::vector<Target>& targets, const Options& options) {
+    if (targets.empty()) return {};
+    Sweep sweep(targets, options);
+    return sweep.run();
+}
+
+} // namespace tls_prober
+
+namespace {
+
+// Longs per target: status, connect ns, first byte ns, server hello ns, handshake ns,
+// version, cipher
+constexpr size_t kResultStride = 7;
+
+std::string string_at(JNIEnv *env, jobjectArray array, jsize index) {
+    auto value = static_cast<jstring>(env->GetObjectArrayElement(array, index));
+    if (value == nullptr) return {};
+    const char* chars = env->GetStringUTFChars(value, nullptr);
+    std::string result(chars);
+    env->ReleaseStringUTFChars(value, chars);
+    env->DeleteLocalRef(value);
+    return result;
+}
+
+} // namespace
+
+extern "C" {
+
+/**
+ * Time TLS handshakes against host:port pairs with the given SNI and uTLS fingerprint
+ * @return kResultStride longs per target in input order, or null
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_hiddify_hiddifyng_utils_PingUtils_probeTlsNative(JNIEnv *env, jclass clazz,
+                                                          jobjectArray hosts, jintArray ports,
+                                                          jobjectArray snis,
+                                                          jobjectArray fingerprints,
+                                                          jint timeout_ms, jint max_in_flight) {
+    jsize count = env->GetArrayLength(hosts);
+    if (env->GetArrayLength(ports) < count || env->GetArrayLength(snis) < count ||
+        env->GetArrayLength(fingerprints) < count) {
+        return nullptr;
+    }
+
+    std::vector<jint> port_values(static_cast<size_t>(count));
+    env->GetIntArrayRegion(ports, 0, count, port_values.data());
+    std::vector<tls_prober::Target> targets(static_cast<size_t>(count));
+    for (jsize i = 0; i < count; i++) {
+        targets[i].host = string_at(env, hosts, i);
+        targets[i].port = port_values[i];
+        targets[i].sni = string_at(env, snis, i);
+        targets[i].fingerprint = string_at(env, fingerprints, i);
+    }
+
+    tls_prober::Options options;
+    options.timeout_ms = timeout_ms;
+    options.max_in_flight = max_in_flight;
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<tls_prober::Result> results = tls_prober::run(targets, options);
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    std::vector<jlong> rows;
+    rows.reserve(results.size() * kResultStride);
+    int completed = 0;
+    for (const tls_prober::Result& result : results) {
+        jlong row[kResultStride] = {result.status, result.connect_ns, result.first_byte_ns,
+                                    result.server_hello_ns, result.handshake_ns,
+                                    result.version, result.cipher};
+        rows.insert(rows.end(), row, row + kResultStride);
+        if (result.handshake_ns > 0) completed++;
+    }
+    LOGI("TLS probe: %d/%d handshakes timed in %lld ms", completed, count,
+         static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()));
+
+    jlongArray array = env->NewLongArray(static_cast<jsize>(rows.size()));
+    if (array == nullptr) return nullptr;
+    env->SetLongArrayRegion(array, 0, static_cast<jsize>(rows.size()), rows.data());
+    return array;
+}
+
+} // extern "C"
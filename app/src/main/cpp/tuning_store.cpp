@@ -0,0 +1,324 @@
+#include <jni.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+#include "config_builder.h"
+#include "native_log.h"
+#include "tuning_store.h"
+
+namespace tuning_store {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x314E5554; // "TUN1"
+constexpr uint16_t kVersion = 1;
+constexpr size_t kHeaderSize = 12;
+constexpr size_t kEntrySize = 32;
+constexpr size_t kMaxEntries = 4096;
+
+constexpr int kCellCount = kMuxLevelCount * kBufferLevelCount;
+
+// EWMA weight of a new session
+constexpr float kAlpha = 0.3f;
+// Sessions a cell needs before its neighbours are explored
+constexpr int kMinSamples = 2;
+// UCB exploration weight on normalized scores
+constexpr double kExploration = 0.05;
+
+int cell_of(int mux_index, int buffer_index) {
+    return mux_index * kBufferLevelCount + buffer_index;
+}
+
+int nearest_index(const int* levels, int count, int value) {
+    int best = 0;
+    for (int i = 1; i < count; i++) {
+        if (std::abs(levels[i] - value) < std::abs(levels[best] - value)) best = i;
+    }
+    return best;
+}
+
+int cell_of(Settings settings) {
+    return cell_of(nearest_index(kMuxLevels, kMuxLevelCount, settings.mux_concurrency),
+                   nearest_index(kBufferLevels, kBufferLevelCount, settings.buffer_bytes));
+}
+
+Settings settings_of(int cell) {
+    return {kMuxLevels[cell / kBufferLevelCount], kBufferLevels[cell % kBufferLevelCount]};
+}
+
+/**
+ * Goodput discounted for retransmits and for queueing delay, so a larger
+ * buffer that only adds bufferbloat does not win
+ */
+double score(float goodput_kbps, float rtt_ms, float retransmit_rate) {
+    double loss_penalty = 1.0 - std::min(static_cast<double>(retransmit_rate) * 10.0, 0.9);
+    return goodput_kbps * loss_penalty / (1.0 + rtt_ms / 500.0);
+}
+
+void put_u16(uint8_t* p, uint16_t v) { memcpy(p, &v, sizeof(v)); }
+void put_u32(uint8_t* p, uint32_t v) { memcpy(p, &v, sizeof(v)); }
+
+} // namespace
+
+bool Store::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (path == path_) return true;
+
+    path_ = path;
+    entries_.clear();
+    dirty_ = false;
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == ENOENT;
+    }
+
+    struct stat st;
+    std::vector<uint8_t> data;
+    if (fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(kHeaderSize) &&
+        st.st_size <= static_cast<off_t>(kHeaderSize + kMaxEntries * kEntrySize)) {
+        data.resize(static_cast<size_t>(st.st_size));
+        ssize_t n = read(fd, data.data(), data.size());
+        if (n != static_cast<ssize_t>(data.size())) data.clear();
+    }
+    close(fd);
+
+    uint32_t magic = 0;
+    uint16_t version = 0;
+    uint32_t count = 0;
+    if (data.size() >= kHeaderSize) {
+        memcpy(&magic, &data[0], 4);
+        memcpy(&version, &data[4], 2);
+        memcpy(&count, &data[8], 4);
+    }
+    if (magic != kMagic || version != kVersion || data.size() != kHeaderSize + count * kEntrySize) {
+        LOGW("Discarding unreadable tuning store %s", path.c_str());
+        return false;
+    }
+
+    entries_.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t* p = &data[kHeaderSize + i * kEntrySize];
+        Entry& e = entries_[i];
+        memcpy(&e.server_id, p, 8);
+        e.network = p[8];
+        e.cell = p[9];
+        memcpy(&e.count, p + 10, 2);
+        memcpy(&e.goodput_kbps, p + 12, 4);
+        memcpy(&e.rtt_ms, p + 16, 4);
+        memcpy(&e.retransmit_rate, p + 20, 4);
+        memcpy(&e.updated, p + 24, 4);
+    }
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                  [](const Entry& e) { return e.cell >= kCellCount; }),
+                   entries_.end());
+    return true;
+}
+
+Store::Entry* Store::find(uint8_t network, int64_t server_id, int cell) {
+    for (Entry& e : entries_) {
+        if (e.server_id == server_id && e.network == network && e.cell == cell) return &e;
+    }
+    return nullptr;
+}
+
+void Store::evict_oldest() {
+    auto oldest = std::min_element(entries_.begin(), entries_.end(),
+                                   [](const Entry& a, const Entry& b) { return a.updated < b.updated; });
+    if (oldest != entries_.end()) entries_.erase(oldest);
+}
+
+Settings Store::select(uint8_t network, int64_t server_id, Settings fallback, bool pin_buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    int pinned = cell_of(fallback) % kBufferLevelCount;
+    const Entry* cells[kCellCount] = {};
+    int total = 0;
+    for (const Entry& e : entries_) {
+        if (pin_buffer && e.cell % kBufferLevelCount != pinned) continue;
+        if (e.server_id == server_id && e.network == network) {
+            cells[e.cell] = &e;
+            total += e.count;
+        }
+    }
+
+    int best = -1;
+    double best_score = 0;
+    for (int c = 0; c < kCellCount; c++) {
+        if (cells[c] == nullptr) continue;
+        double s = score(cells[c]->goodput_kbps, cells[c]->rtt_ms, cells[c]->retransmit_rate);
+        if (best < 0 || s > best_score) {
+            best = c;
+            best_score = s;
+        }
+    }
+    if (best < 0) {
+        return settings_of(cell_of(fallback));
+    }
+    if (cells[best]->count < kMinSamples) {
+        return settings_of(best);
+    }
+
+    // Candidates: the best cell and its grid neighbours
+    int mux = best / kBufferLevelCount;
+    int buffer = best % kBufferLevelCount;
+    int candidates[5];
+    int candidate_count = 0;
+    candidates[candidate_count++] = best;
+    if (mux > 0) candidates[candidate_count++] = cell_of(mux - 1, buffer);
+    if (mux + 1 < kMuxLevelCount) candidates[candidate_count++] = cell_of(mux + 1, buffer);
+    if (!pin_buffer && buffer > 0) candidates[candidate_count++] = cell_of(mux, buffer - 1);
+    if (!pin_buffer && buffer + 1 < kBufferLevelCount) {
+        candidates[candidate_count++] = cell_of(mux, buffer + 1);
+    }
+
+    for (int i = 1; i < candidate_count; i++) {
+        if (cells[candidates[i]] == nullptr) return settings_of(candidates[i]);
+    }
+
+    int chosen = best;
+    double chosen_value = -1;
+    for (int i = 0; i < candidate_count; i++) {
+        const Entry* e = cells[candidates[i]];
+        double normalized = best_score > 0
+                ? score(e->goodput_kbps, e->rtt_ms, e->retransmit_rate) / best_score : 0;
+        double value = normalized + kExploration * std::sqrt(std::log(total) / e->count);
+        if (value > chosen_value) {
+            chosen = candidates[i];
+            chosen_value = value;
+        }
+    }
+    return settings_of(chosen);
+}
+
+float Store::goodput_kbps(uint8_t network, int64_t server_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    float best = 0;
+    for (const Entry& e : entries_) {
+        if (e.server_id == server_id && e.network == network) best = std::max(best, e.goodput_kbps);
+    }
+    return best;
+}
+
+void Store::record(uint8_t network, int64_t server_id, Settings used, const Sample& sample) {
+    if (!(sample.goodput_kbps >= 0) || !(sample.rtt_ms >= 0) || !(sample.retransmit_rate >= 0)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    int cell = cell_of(used);
+    Entry* e = find(network, server_id, cell);
+    if (e == nullptr) {
+        if (entries_.size() >= kMaxEntries) evict_oldest();
+        entries_.push_back({server_id, network, static_cast<uint8_t>(cell), 0, 0, 0, 0, 0});
+        e = &entries_.back();
+    }
+
+    float retransmit_rate = std::min(sample.retransmit_rate, 1.0f);
+    if (e->count == 0) {
+        e->goodput_kbps = sample.goodput_kbps;
+        e->rtt_ms = sample.rtt_ms;
+        e->retransmit_rate = retransmit_rate;
+    } else {
+        e->goodput_kbps += kAlpha * (sample.goodput_kbps - e->goodput_kbps);
+        e->rtt_ms += kAlpha * (sample.rtt_ms - e->rtt_ms);
+        e->retransmit_rate += kAlpha * (retransmit_rate - e->retransmit_rate);
+    }
+    if (e->count < UINT16_MAX) e->count++;
+    e->updated = static_cast<uint32_t>(time(nullptr));
+    dirty_ = true;
+}
+
+bool Store::save() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (path_.empty()) return false;
+    if (!dirty_) return true;
+
+    std::string data(kHeaderSize + entries_.size() * kEntrySize, '\0');
+    auto* out = reinterpret_cast<uint8_t*>(&data[0]);
+    put_u32(out, kMagic);
+    put_u16(out + 4, kVersion);
+    put_u32(out + 8, static_cast<uint32_t>(entries_.size()));
+    for (size_t i = 0; i < entries_.size(); i++) {
+        const Entry& e = entries_[i];
+        uint8_t* p = out + kHeaderSize + i * kEntrySize;
+        memcpy(p, &e.server_id, 8);
+        p[8] = e.network;
+        p[9] = e.cell;
+        put_u16(p + 10, e.count);
+        memcpy(p + 12, &e.goodput_kbps, 4);
+        memcpy(p + 16, &e.rtt_ms, 4);
+        memcpy(p + 20, &e.retransmit_rate, 4);
+        put_u32(p + 24, e.updated);
+    }
+
+    if (config_builder::write_file(data, path_) != config_builder::kOk) {
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
+
+} // namespace tuning_store
+
+namespace {
+tuning_store::Store g_store;
+}
+
+extern "C" {
+
+JNIEXPORT jboolean JNICALL
+Java_com_hiddify_hiddifyng_utils_ConfigOptimizer_openTuningStore(JNIEnv *env, jclass clazz,
+                                                                jstring path) {
+    const char* chars = env->GetStringUTFChars(path, nullptr);
+    bool ok = g_store.open(chars);
+    env->ReleaseStringUTFChars(path, chars);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * @return [mux concurrency (0 = disabled), buffer bytes] for the next session
+ */
+JNIEXPORT jintArray JNICALL
+Java_com_hiddify_hiddifyng_utils_ConfigOptimizer_selectTuning(JNIEnv *env, jclass clazz,
+                                                             jint network, jlong server_id,
+                                                             jint fallback_mux, jint fallback_buffer,
+                                                             jboolean pin_buffer) {
+    tuning_store::Settings settings = g_store.select(static_cast<uint8_t>(network), server_id,
+                                                     {fallback_mux, fallback_buffer},
+                                                     pin_buffer == JNI_TRUE);
+    jint values[] = {settings.mux_concurrency, settings.buffer_bytes};
+    jintArray result = env->NewIntArray(2);
+    env->SetIntArrayRegion(result, 0, 2, values);
+    return result;
+}
+
+JNIEXPORT void JNICALL
+Java_com_hiddify_hiddifyng_utils_ConfigOptimizer_recordTuning(JNIEnv *env, jclass clazz,
+                                                             jint network, jlong server_id,
+                                                             jint mux, jint buffer,
+                                                             jfloat goodput_kbps, jfloat rtt_ms,
+                                                             jfloat retransmit_rate) {
+    g_store.record(static_cast<uint8_t>(network), server_id, {mux, buffer},
+                   {goodput_kbps, rtt_ms, retransmit_rate});
+}
+
+JNIEXPORT jfloat JNICALL
+Java_com_hiddify_hiddifyng_utils_ConfigOptimizer_tunedGoodput(JNIEnv *env, jclass clazz,
+                                                             jint network, jlong server_id) {
+    return g_store.goodput_kbps(static_cast<uint8_t>(network), server_id);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_hiddify_hiddifyng_utils_ConfigOptimizer_saveTuningStore(JNIEnv *env, jclass clazz) {
+    return g_store.save() ? JNI_TRUE : JNI_FALSE;
+}
+
+} // extern "C"
@@ -0,0 +1,377 @@
+#include <jni.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/inet_diag.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "tunnel_sampler.h"
+#include "native_log.h"
+#include "proc_sockets.h"
+#include "xray_process.h"
+
+namespace tunnel_sampler {
+
+namespace {
+
+constexpr uint8_t kStateEstablished = 1;
+constexpr size_t kReceiveBuffer = 32 * 1024;
+constexpr int kNetlinkTimeoutMs = 1000;
+
+/**
+ * Leading part of the kernel's struct tcp_info, up to tcpi_delivery_rate
+ * (Linux 4.9). Declared here so the layout does not depend on which libc
+ * header is in use; older kernels fill a shorter prefix and leave the rest 0
+ */
+struct KernelTcpInfo {
+    uint8_t state;
+    uint8_t ca_state;
+    uint8_t retransmits;
+    uint8_t probes;
+    uint8_t backoff;
+    uint8_t options;
+    uint8_t wscale;
+    uint8_t flags;
+
+    uint32_t rto;
+    uint32_t ato;
+    uint32_t snd_mss;
+    uint32_t rcv_mss;
+
+    uint32_t unacked;
+    uint32_t sacked;
+    uint32_t lost;
+    uint32_t retrans;
+    uint32_t fackets;
+
+    uint32_t last_data_sent;
+    uint32_t last_ack_sent;
+    uint32_t last_data_recv;
+    uint32_t last_ack_recv;
+
+    uint32_t pmtu;
+    uint32_t rcv_ssthresh;
+    uint32_t rtt;
+    uint32_t rttvar;
+    uint32_t snd_ssthresh;
+    uint32_t snd_cwnd;
+    uint32_t advmss;
+    uint32_t reordering;
+
+    uint32_t rcv_rtt;
+    uint32_t rcv_space;
+
+    uint32_t total_retrans;
+
+    uint64_t pacing_rate;
+    uint64_t max_pacing_rate;
+    uint64_t bytes_acked;
+    uint64_t bytes_received;
+    uint32_t segs_out;
+    uint32_t segs_in;
+
+    uint32_t notsent_bytes;
+    uint32_t min_rtt;
+    uint32_t data_segs_in;
+    uint32_t data_segs_out;
+
+    uint64_t delivery_rate;
+};
+static_assert(sizeof(KernelTcpInfo) == 168, "tcp_info layout");
+
+TcpStats stats_of(uint64_t inode, const KernelTcpInfo& info) {
+    TcpStats stats;
+    stats.inode = inode;
+    stats.srtt_us = info.rtt;
+    stats.rttvar_us = info.rttvar;
+    stats.min_rtt_us = info.min_rtt;
+    stats.snd_cwnd = info.snd_cwnd;
+    stats.snd_mss = info.snd_mss;
+    stats.unacked = info.unacked;
+    stats.backoff = info.backoff;
+    stats.total_retrans = info.total_retrans;
+    stats.segs_out = info.segs_out;
+    stats.bytes_acked = info.bytes_acked;
+    stats.delivery_rate = info.delivery_rate;
+    return stats;
+}
+
+bool is_loopback_v4(uint32_t network_order) {
+    return (ntohl(network_order) >> 24) == 127;
+}
+
+bool is_loopback_v6(const in6_addr& address) {
+    if (IN6_IS_ADDR_LOOPBACK(&address)) return true;
+    if (!IN6_IS_ADDR_V4MAPPED(&address)) return false;
+    uint32_t v4;
+    memcpy(&v4, address.s6_addr + 12, sizeof(v4));
+    return is_loopback_v4(v4);
+}
+
+// Set once neither path worked, so the failure is logged once per process
+std::atomic<bool> g_unreadable_logged{false};
+
+/**
+ * Dump one address family's established TCP sockets with their tcp_info
+ * @return false if sock_diag is unavailable or refused
+ */
+bool dump_family(int netlink, int family, uint32_t sequence,
+                 const proc_sockets::Sockets& sockets, int server_port,
+                 std::vector<TcpStats>& out) {
+    struct {
+        nlmsghdr header;
+        inet_diag_req_v2 body;
+    } request{};
+    request.header.nlmsg_len = sizeof(request);
+    request.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = sequence;
+    request.body.sdiag_family = static_cast<uint8_t>(family);
+    request.body.sdiag_protocol = IPPROTO_TCP;
+    request.body.idiag_ext = 1 << (INET_DIAG_INFO - 1);
+    request.body.idiag_states = 1 << kStateEstablished;
+
+    sockaddr_nl kernel{};
+    kernel.nl_family = AF_NETLINK;
+    if (sendto(netlink, &request, sizeof(request), 0,
+               reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) < 0) {
+        return false;
+    }
+
+    std::vector<uint8_t> buffer(kReceiveBuffer);
+    while (true) {
+        ssize_t received = recv(netlink, buffer.data(), buffer.size(), 0);
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        auto* header = reinterpret_cast<nlmsghdr*>(buffer.data());
+        int remaining = static_cast<int>(received);
+        for (; NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+            if (header->nlmsg_seq != sequence) continue;
+            if (header->nlmsg_type == NLMSG_DONE) return true;
+            if (header->nlmsg_type == NLMSG_ERROR) {
+                auto* error = static_cast<nlmsgerr*>(NLMSG_DATA(header));
+                errno = -error->error;
+                return false;
+            }
+            if (header->nlmsg_type != SOCK_DIAG_BY_FAMILY) continue;
+
+            auto* message = static_cast<inet_diag_msg*>(NLMSG_DATA(header));
+            if (ntohs(message->id.idiag_dport) != server_port) continue;
+            if (sockets.count(message->idiag_inode) == 0) continue;
+            if (message->idiag_family == AF_INET) {
+                if (is_loopback_v4(message->id.idiag_dst[0])) continue;
+            } else {
+                in6_addr destination;
+                memcpy(&destination, message->id.idiag_dst, sizeof(destination));
+                if (is_loopback_v6(destination)) continue;
+            }
+
+            KernelTcpInfo info{};
+            bool found = false;
+            int length = static_cast<int>(NLMSG_PAYLOAD(header, sizeof(inet_diag_msg)));
+            for (auto* attribute = reinterpret_cast<rtattr*>(message + 1); RTA_OK(attribute, length);
+                 attribute = RTA_NEXT(attribute, length)) {
+                if (attribute->rta_type != INET_DIAG_INFO) continue;
+                memcpy(&info, RTA_DATA(attribute),
+                       std::min(static_cast<size_t>(RTA_PAYLOAD(attribute)), sizeof(info)));
+                found = true;
+            }
+            if (found) out.push_back(stats_of(message->idiag_inode, info));
+        }
+    }
+}
+
+bool read_sock_diag(const proc_sockets::Sockets& sockets, int server_port,
+                    std::vector<TcpStats>& out) {
+    int netlink = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (netlink < 0) return false;
+    timeval timeout{kNetlinkTimeoutMs / 1000, (kNetlinkTimeoutMs % 1000) * 1000};
+    setsockopt(netlink, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    bool ok = dump_family(netlink, AF_INET, 1, sockets, server_port, out) &&
+              dump_family(netlink, AF_INET6, 2, sockets, server_port, out);
+    int error = errno;
+    close(netlink);
+    errno = error;
+    return ok;
+}
+
+/**
+ * Duplicate each socket of the process into this one and read TCP_INFO;
+ * needs pidfd_getfd (Linux 5.6) and permission to trace the process
+ */
+bool read_duplicated(pid_t pid, const proc_sockets::Sockets& sockets, int server_port,
+                     std::vector<TcpStats>& out) {
+#if defined(SYS_pidfd_open) && defined(SYS_pidfd_getfd)
+    int pidfd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+    if (pidfd < 0) return false;
+
+    bool ok = true;
+    int error = 0;
+    for (const auto& [inode, fd] : sockets) {
+        int local = static_cast<int>(syscall(SYS_pidfd_getfd, pidfd, fd, 0));
+        if (local < 0) {
+            // The descriptor may have been closed since the listing; anything else is final
+            if (errno == EBADF) continue;
+            error = errno;
+            ok = false;
+            break;
+        }
+
+        KernelTcpInfo info{};
+        socklen_t length = sizeof(info);
+        sockaddr_storage peer{};
+        socklen_t peer_length = sizeof(peer);
+        if (getsockopt(local, IPPROTO_TCP, TCP_INFO, &info, &length) == 0 &&
+            info.state == kStateEstablished &&
+            getpeername(local, reinterpret_cast<sockaddr*>(&peer), &peer_length) == 0) {
+            bool matches = false;
+            if (peer.ss_family == AF_INET) {
+                const auto& in = reinterpret_cast<const sockaddr_in&>(peer);
+                matches = ntohs(in.sin_port) == server_port && !is_loopback_v4(in.sin_addr.s_addr);
+            } else if (peer.ss_family == AF_INET6) {
+                const auto& in6 = reinterpret_cast<const sockaddr_in6&>(peer);
+                matches = ntohs(in6.sin6_port) == server_port && !is_loopback_v6(in6.sin6_addr);
+            }
+            if (matches) out.push_back(stats_of(inode, info));
+        }
+        close(local);
+    }
+    close(pidfd);
+    errno = error;
+    return ok;
+#else
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+} // namespace
+
+bool read_process(pid_t pid, int server_port, std::vector<TcpStats>& out, Source& source) {
+    out.clear();
+    source = kNone;
+    proc_sockets::Sockets sockets;
+    if (!proc_sockets::list(pid, sockets)) return false;
+    if (sockets.empty()) return true;
+
+    // The core is this app's child, so duplicating its sockets needs no extra permission
+    // on most kernels; sock_diag is often refused to apps by SELinux
+    if (read_duplicated(pid, sockets, server_port, out)) {
+        source = kDuplicated;
+        return true;
+    }
+    int duplicate_error = errno;
+    out.clear();
+    if (read_sock_diag(sockets, server_port, out)) {
+        source = kSockDiag;
+        return true;
+    }
+    int diag_error = errno;
+    out.clear();
+    if (!g_unreadable_logged.exchange(true)) {
+        LOGW("Tunnel quality unavailable: TCP state of the core is not readable "
+             "(pidfd_getfd: %s, sock_diag: %s)", strerror(duplicate_error), strerror(diag_error));
+    }
+    return true;
+}
+
+void Sampler::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    previous_.clear();
+}
+
+bool Sampler::sample(pid_t pid, int server_port, Quality& out) {
+    out = Quality();
+    std::vector<TcpStats> tunnels;
+    if (!read_process(pid, server_port, tunnels, out.source)) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unordered_map<uint64_t, Counters> current;
+    const TcpStats* busiest = nullptr;
+    uint64_t busiest_acked = 0;
+    for (const TcpStats& tunnel : tunnels) {
+        // New tunnels count from zero, which is nearly all within the last interval
+        Counters before{0, 0, 0};
+        auto previous = previous_.find(tunnel.inode);
+        if (previous != previous_.end()) before = previous->second;
+        current[tunnel.inode] = {tunnel.bytes_acked, tunnel.segs_out, tunnel.total_retrans};
+
+        uint64_t acked = tunnel.bytes_acked >= before.bytes_acked ? tunnel.bytes_acked - before.bytes_acked : 0;
+        out.acked_bytes += static_cast<int64_t>(acked);
+        out.sent_segments += static_cast<uint32_t>(tunnel.segs_out - before.segs_out);
+        out.retransmitted_segments += static_cast<uint32_t>(tunnel.total_retrans - before.total_retrans);
+        out.delivery_rate += static_cast<int64_t>(tunnel.delivery_rate);
+        if (tunnel.backoff > 0) out.stalled++;
+
+        if (busiest == nullptr || acked > busiest_acked ||
+            (acked == busiest_acked && tunnel.bytes_acked > busiest->bytes_acked)) {
+            busiest = &tunnel;
+            busiest_acked = acked;
+        }
+    }
+    previous_.swap(current);
+
+    out.tunnels = static_cast<int>(tunnels.size());
+    if (busiest != nullptr) {
+        out.srtt_us = busiest->srtt_us;
+        out.rttvar_us = busiest->rttvar_us;
+        out.min_rtt_us = busiest->min_rtt_us;
+        out.cwnd_bytes = static_cast<int64_t>(busiest->snd_cwnd) * busiest->snd_mss;
+    }
+    return true;
+}
+
+} // namespace tunnel_sampler
+
+namespace {
+
+tunnel_sampler::Sampler g_sampler;
+
+// Longs per sample: source, tunnels, stalled, srtt us, rttvar us, min rtt us, cwnd bytes,
+// delivery rate bytes/s, acked bytes, sent segments, retransmitted segments
+constexpr size_t kResultStride = 11;
+
+} // namespace
+
+extern "C" {
+
+JNIEXPORT void JNICALL
+Java_com_hiddify_hiddifyng_utils_TunnelSampler_resetNative(JNIEnv *env, jclass clazz) {
+    g_sampler.reset();
+}
+
+/**
+ * Read the running core's tunnels to the server port
+ * @return kResultStride longs, or null when the core is not running
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_hiddify_hiddifyng_utils_TunnelSampler_sampleNative(JNIEnv *env, jclass clazz,
+                                                           jint server_port) {
+    tunnel_sampler::Quality quality;
+    if (!g_sampler.sample(xray_process_id(), server_port, quality)) return nullptr;
+
+    jlong values[kResultStride] = {quality.source, quality.tunnels, quality.stalled,
+                                   quality.srtt_us, quality.rttvar_us, quality.min_rtt_us,
+                                   quality.cwnd_bytes, quality.delivery_rate, quality.acked_bytes,
+                                   quality.sent_segments, quality.retransmitted_segments};
+    jlongArray array = env->NewLongArray(kResultStride);
+    if (array == nullptr) return nullptr;
+    env->SetLongArrayRegion(array, 0, kResultStride, values);
+    return array;
+}
+
+} // extern "C"
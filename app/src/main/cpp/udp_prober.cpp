@@ -0,0 +1,521 @@
+#include <jni.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "udp_prober.h"
+#include "dns_resolver.h"
+#include "native_log.h"
+
+namespace udp_prober {
+
+namespace {
+
+constexpr int kMaxCount = 100;
+constexpr int kReceiveBuffer = 512 * 1024;
+constexpr size_t kBatch = 32;           // datagrams per sendmmsg/recvmmsg
+constexpr size_t kProbeSize = 1200;     // servers drop Initials smaller than this
+constexpr size_t kReplySize = 1500;
+
+// A version of the reserved 0x?a?a?a?a pattern: never supported, always negotiated
+constexpr uint32_t kProbeVersion = 0x1a2a3a4a;
+constexpr uint8_t kLongHeaderInitial = 0xc0;  // long header, fixed bit, Initial
+
+int64_t now_ns(clockid_t clock = CLOCK_MONOTONIC) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+using dns_resolver::Address;
+
+bool same_endpoint(const Address& a, const sockaddr_storage& b) {
+    if (a.family() != b.ss_family) return false;
+    if (b.ss_family == AF_INET) {
+        const auto& x = reinterpret_cast<const sockaddr_in&>(a.storage);
+        const auto& y = reinterpret_cast<const sockaddr_in&>(b);
+        return x.sin_addr.s_addr == y.sin_addr.s_addr && x.sin_port == y.sin_port;
+    }
+    const auto& x = reinterpret_cast<const sockaddr_in6&>(a.storage);
+    const auto& y = reinterpret_cast<const sockaddr_in6&>(b);
+    return memcmp(&x.sin6_addr, &y.sin6_addr, sizeof(in6_addr)) == 0 && x.sin6_port == y.sin6_port;
+}
+
+/**
+ * Carried as the probe's source connection ID, which the server echoes back as
+ * the destination connection ID of its Version Negotiation
+ */
+struct Stamp {
+    uint32_t cookie;  // per sweep, rejects replies that belong to an earlier one
+    uint32_t index;
+    uint32_t sample;
+};
+
+// first byte, version, DCID length; the DCID follows, then SCID length and SCID
+constexpr size_t kDcidOffset = 6;
+constexpr size_t kDcidSize = 8;
+constexpr size_t kStampOffset = kDcidOffset + kDcidSize + 1;
+
+struct Probe {
+    int64_t sent_ns = 0;
+    int64_t rtt_ns = -1;
+};
+
+struct Host {
+    Address address;
+    std::vector<Probe> probes;
+    int sent = 0;
+    int received = 0;
+    uint32_t version = 0;
+    Status failure = kTimeout;
+};
+
+class Sweep {
+public:
+    Sweep(const std::vector<Target>& targets, const Options& options)
+        : targets_(targets), options_(options) {
+        options_.count = std::clamp(options_.count, 1, kMaxCount);
+        options_.interval_ms = std::max(0, options_.interval_ms);
+        options_.timeout_ms = std::max(1, options_.timeout_ms);
+        cookie_ = static_cast<uint32_t>(now_ns() ^ reinterpret_cast<uintptr_t>(this));
+        uint64_t seed = static_cast<uint64_t>(now_ns(CLOCK_REALTIME)) * 0x9e3779b97f4a7c15ull;
+        memcpy(dcid_.data(), &seed, kDcidSize);
+    }
+
+    ~Sweep() {
+        if (fd4_ >= 0) close(fd4_);
+        if (fd6_ >= 0) close(fd6_);
+    }
+
+    std::vector<Result> run() {
+        std::vector<std::string> names(targets_.size());
+        for (size_t i = 0; i < targets_.size(); i++) names[i] = targets_[i].host;
+        std::vector<dns_resolver::Answer> answers = dns_resolver::resolve(names);
+
+        hosts_.resize(targets_.size());
+        bool want4 = false;
+        bool want6 = false;
+        for (size_t i = 0; i < hosts_.size(); i++) {
+            Host& host = hosts_[i];
+            if (answers[i].status != dns_resolver::kOk) {
+                host.failure = kResolveFailed;
+                continue;
+            }
+            if (targets_[i].port <= 0 || targets_[i].port > 65535) {
+                host.failure = kError;
+                continue;
+            }
+            host.address = answers[i].addresses.front();
+            host.address.set_port(targets_[i].port);
+            host.probes.resize(static_cast<size_t>(options_.count));
+            (host.address.family() == AF_INET ? want4 : want6) = true;
+        }
+        if (want4) fd4_ = open_socket(AF_INET);
+        if (want6) fd6_ = open_socket(AF_INET6);
+
+        // Spread the first probes over one interval instead of a single burst
+        int64_t start = now_ns();
+        int64_t interval_ns = options_.interval_ms * 1000000ll;
+        std::vector<std::pair<int64_t, size_t>> schedule;  // (send at, host)
+        for (size_t i = 0; i < hosts_.size(); i++) {
+            if (hosts_[i].probes.empty()) continue;
+            if (socket_for(hosts_[i]) < 0) {
+                hosts_[i].failure = kError;
+                hosts_[i].probes.clear();
+                continue;
+            }
+            int64_t offset = interval_ns * static_cast<int64_t>(i) /
+                             static_cast<int64_t>(hosts_.size());
+            for (int k = 0; k < options_.count; k++) {
+                schedule.emplace_back(start + offset + k * interval_ns, i);
+            }
+        }
+        std::sort(schedule.begin(), schedule.end());
+
+        int64_t timeout_ns = options_.timeout_ms * 1000000ll;
+        int64_t last_deadline = 0;
+        size_t next = 0;
+        for (;;) {
+            int64_t now = now_ns();
+            size_t due = next;
+            while (due < schedule.size() && schedule[due].first <= now) due++;
+            if (due > next) {
+                send_probes(schedule, next, due);
+                next = due;
+                last_deadline = now_ns() + timeout_ns;
+            }
+            bool sending = next < schedule.size();
+            if (!sending && (outstanding_ == 0 || now >= last_deadline)) break;
+
+            int64_t wake = sending ? schedule[next].first : last_deadline;
+            int wait_ms = static_cast<int>(std::max<int64_t>(0, (wake - now + 999999) / 1000000));
+            pollfd fds[2];
+            nfds_t nfds = 0;
+            if (fd4_ >= 0) fds[nfds++] = {fd4_, POLLIN, 0};
+            if (fd6_ >= 0) fds[nfds++] = {fd6_, POLLIN, 0};
+            int n = poll(fds, nfds, wait_ms);
+            if (n < 0 && errno != EINTR) {
+                LOGE("UDP probe poll failed: %s", strerror(errno));
+                break;
+            }
+            for (nfds_t i = 0; n > 0 && i < nfds; i++) {
+                if (fds[i].revents & POLLERR) drain_errors(fds[i].fd);
+                if (fds[i].revents & POLLIN) drain_replies(fds[i].fd);
+            }
+        }
+
+        std::vector<Result> results(hosts_.size());
+        for (size_t i = 0; i < hosts_.size(); i++) results[i] = summarize(i);
+        return results;
+    }
+
+private:
+    int open_socket(int family) {
+        int fd = socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+        if (fd < 0) {
+            LOGW("No %s UDP socket: %s", family == AF_INET ? "IPv4" : "IPv6", strerror(errno));
+            return -1;
+        }
+        // Port and host unreachable errors arrive on the error queue
+        int on = 1;
+        if (family == AF_INET) {
+            setsockopt(fd, IPPROTO_IP, IP_RECVERR, &on, sizeof(on));
+        } else {
+            setsockopt(fd, IPPROTO_IPV6, IPV6_RECVERR, &on, sizeof(on));
+        }
+        setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &kReceiveBuffer, sizeof(kReceiveBuffer));
+        return fd;
+    }
+
+    int socket_for(const Host& host) const {
+        return host.address.family() == AF_INET ? fd4_ : fd6_;
+    }
+
+    void build_probe(uint8_t* packet, size_t index, uint32_t sample) const {
+        memset(packet, 0, kProbeSize);
+        packet[0] = kLongHeaderInitial;
+        uint32_t version = htonl(kProbeVersion);
+        memcpy(packet + 1, &version, sizeof(version));
+        packet[5] = kDcidSize;
+        memcpy(packet + kDcidOffset, dcid_.data(), kDcidSize);
+        packet[kStampOffset - 1] = sizeof(Stamp);
+        Stamp stamp{cookie_, static_cast<uint32_t>(index), sample};
+        memcpy(packet + kStampOffset, &stamp, sizeof(stamp));
+        // Token length 0 and a Length covering the padding, as an Initial would have
+        size_t length = kProbeSize - (kStampOffset + sizeof(Stamp) + 1 + 2);
+        packet[kStampOffset + sizeof(Stamp)] = 0;
+        packet[kStampOffset + sizeof(Stamp) + 1] = static_cast<uint8_t>(0x40 | (length >> 8));
+        packet[kStampOffset + sizeof(Stamp) + 2] = static_cast<uint8_t>(length & 0xff);
+    }
+
+    /** Send schedule[from, to), batching each socket's probes into sendmmsg calls */
+    void send_probes(const std::vector<std::pair<int64_t, size_t>>& schedule, size_t from, size_t to) {
+        for (int fd : {fd4_, fd6_}) {
+            if (fd < 0) continue;
+            for (size_t s = from; s < to; s++) {
+                size_t index = schedule[s].second;
+                Host& host = hosts_[index];
+                // A host that reported unreachable or refused gets no more probes
+                if (socket_for(host) != fd || (host.failure != kTimeout && host.received == 0)) {
+                    continue;
+                }
+                Queued& queued = queue_[queued_];
+                queued.index = index;
+                queued.sample = static_cast<uint32_t>(host.sent++);
+                build_probe(queued.packet.data(), index, queued.sample);
+                if (++queued_ == kBatch) flush(fd);
+            }
+            flush(fd);
+        }
+    }
+
+    void flush(int fd) {
+        if (queued_ == 0) return;
+        std::array<mmsghdr, kBatch> messages{};
+        std::array<iovec, kBatch> iovs{};
+        for (size_t i = 0; i < queued_; i++) {
+            Host& host = hosts_[queue_[i].index];
+            iovs[i] = {queue_[i].packet.data(), kProbeSize};
+            msghdr& header = messages[i].msg_hdr;
+            header.msg_name = &host.address.storage;
+            header.msg_namelen = host.address.length;
+            header.msg_iov = &iovs[i];
+            header.msg_iovlen = 1;
+        }
+
+        int64_t sent = now_ns();
+        int done = sendmmsg(fd, messages.data(), static_cast<unsigned>(queued_), 0);
+        int error = done < 0 ? errno : 0;
+        for (size_t i = 0; i < queued_; i++) {
+            Host& host = hosts_[queue_[i].index];
+            if (done >= 0 && i < static_cast<size_t>(done)) {
+                Probe& probe = host.probes[queue_[i].sample];
+                probe.sent_ns = sent;
+                outstanding_++;
+            } else if (error == ENETUNREACH || error == EHOSTUNREACH || error == EADDRNOTAVAIL) {
+                host.failure = kUnreachable;  // counted as sent and lost
+            } else if (error != 0 && error != EAGAIN && error != ENOBUFS) {
+                host.failure = kError;
+            }
+        }
+        queued_ = 0;
+    }
+
+    /** Locate the probe whose stamp starts at data; nullptr if it is not ours */
+    Probe* match(const uint8_t* data, int family, Host** owner) {
+        Stamp stamp;
+        memcpy(&stamp, data, sizeof(stamp));
+        if (stamp.cookie != cookie_ || stamp.index >= hosts_.size()) return nullptr;
+        Host& host = hosts_[stamp.index];
+        if (host.address.family() != family || stamp.sample >= host.probes.size()) return nullptr;
+        Probe& probe = host.probes[stamp.sample];
+        if (probe.sent_ns == 0) return nullptr;
+        *owner = &host;
+        return &probe;
+    }
+
+    void drain_replies(int fd) {
+        int family = fd == fd4_ ? AF_INET : AF_INET6;
+        std::array<mmsghdr, kBatch> messages{};
+        std::array<iovec, kBatch> iovs{};
+        std::array<sockaddr_storage, kBatch> names{};
+        for (;;) {
+            for (size_t i = 0; i < kBatch; i++) {
+                iovs[i] = {replies_[i].data(), kReplySize};
+                msghdr& header = messages[i].msg_hdr;
+                header.msg_name = &names[i];
+                header.msg_namelen = sizeof(names[i]);
+                header.msg_iov = &iovs[i];
+                header.msg_iovlen = 1;
+                header.msg_control = controls_[i].data();
+                header.msg_controllen = controls_[i].size();
+                header.msg_flags = 0;
+            }
+            int n = recvmmsg(fd, messages.data(), kBatch, MSG_DONTWAIT, nullptr);
+            if (n <= 0) return;
+            int64_t now = now_ns();
+            int64_t now_real = now_ns(CLOCK_REALTIME);
+            for (int i = 0; i < n; i++) {
+                receive(replies_[i].data(), messages[i].msg_len, messages[i].msg_hdr,
+                        names[i], family, now, now_real);
+            }
+            if (static_cast<size_t>(n) < kBatch) return;
+        }
+    }
+
+    void receive(const uint8_t* data, size_t length, const msghdr& header,
+                 const sockaddr_storage& from, int family, int64_t now, int64_t now_real) {
+        // Version Negotiation: long header, version 0, our SCID as its DCID, our DCID as its SCID
+        if (length < kStampOffset + sizeof(Stamp) + 4 || (data[0] & 0x80) == 0) return;
+        if (data[1] != 0 || data[2] != 0 || data[3] != 0 || data[4] != 0) return;
+        if (data[5] != sizeof(Stamp)) return;
+        size_t scid_length_at = 6 + sizeof(Stamp);
+        if (data[scid_length_at] != kDcidSize ||
+            memcmp(data + scid_length_at + 1, dcid_.data(), kDcidSize) != 0) {
+            return;
+        }
+        Host* host = nullptr;
+        Probe* probe = match(data + 6, family, &host);
+        if (probe == nullptr || probe->rtt_ns >= 0 || !same_endpoint(host->address, from)) return;
+
+        // The kernel stamps arrival on the realtime clock; only its lag behind now is
+        // used, so a clock step between send and receive does not skew the RTT
+        int64_t rtt = now - probe->sent_ns;
+        for (const cmsghdr* c = CMSG_FIRSTHDR(&header); c != nullptr;
+             c = CMSG_NXTHDR(const_cast<msghdr*>(&header), const_cast<cmsghdr*>(c))) {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+                timespec ts;
+                memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                int64_t stamped = static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+                int64_t kernel_rtt = rtt - (now_real - stamped);
+                if (kernel_rtt > 0 && kernel_rtt <= rtt) rtt = kernel_rtt;
+            }
+        }
+        if (rtt > options_.timeout_ms * 1000000ll) return;  // late: already lost
+
+        probe->rtt_ns = rtt;
+        host->received++;
+        outstanding_--;
+        size_t versions_at = scid_length_at + 1 + kDcidSize;
+        if (host->version == 0 && length >= versions_at + 4) {
+            uint32_t version;
+            memcpy(&version, data + versions_at, sizeof(version));
+            host->version = ntohl(version);
+        }
+    }
+
+    void drain_errors(int fd) {
+        int family = fd == fd4_ ? AF_INET : AF_INET6;
+        uint8_t buffer[kProbeSize];
+        char control[512];
+        for (;;) {
+            iovec iov{buffer, sizeof(buffer)};
+            msghdr message{};
+            message.msg_iov = &iov;
+            message.msg_iovlen = 1;
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            ssize_t n = recvmsg(fd, &message, MSG_ERRQUEUE | MSG_DONTWAIT);
+            if (n < 0) return;
+
+            int error = 0;
+            for (cmsghdr* c = CMSG_FIRSTHDR(&message); c != nullptr; c = CMSG_NXTHDR(&message, c)) {
+                if ((c->cmsg_level == IPPROTO_IP && c->cmsg_type == IP_RECVERR) ||
+                    (c->cmsg_level == IPPROTO_IPV6 && c->cmsg_type == IPV6_RECVERR)) {
+                    sock_extended_err extended;
+                    memcpy(&extended, CMSG_DATA(c), sizeof(extended));
+                    error = static_cast<int>(extended.ee_errno);
+                }
+            }
+            // The queued data is the probe the error refers to
+            if (static_cast<size_t>(n) < kStampOffset + sizeof(Stamp)) continue;
+            Host* host = nullptr;
+            Probe* probe = match(buffer + kStampOffset, family, &host);
+            if (probe == nullptr || probe->rtt_ns >= 0) continue;
+            probe->sent_ns = 0;
+            outstanding_--;
+            if (error == ECONNREFUSED) {
+                host->failure = kRefused;
+            } else if (error == EHOSTUNREACH || error == ENETUNREACH) {
+                host->failure = kUnreachable;
+            }
+        }
+    }
+
+    Result summarize(size_t index) const {
+        const Host& host = hosts_[index];
+        Result result;
+        result.index = index;
+        result.sent = host.sent;
+        result.received = host.received;
+        result.status = host.received > 0 ? kOk : host.failure;
+        result.quic_version = host.version;
+
+        int64_t total = 0;
+        int64_t previous = -1;
+        int64_t swing = 0;
+        int gaps = 0;
+        for (const Probe& probe : host.probes) {
+            if (probe.rtt_ns < 0) continue;
+            if (result.min_ns == 0 || probe.rtt_ns < result.min_ns) result.min_ns = probe.rtt_ns;
+            result.max_ns = std::max(result.max_ns, probe.rtt_ns);
+            total += probe.rtt_ns;
+            if (previous >= 0) {
+                swing += std::abs(probe.rtt_ns - previous);
+                gaps++;
+            }
+            previous = probe.rtt_ns;
+        }
+        if (host.received > 0) result.avg_ns = total / host.received;
+        if (gaps > 0) result.jitter_ns = swing / gaps;
+        return result;
+    }
+
+    const std::vector<Target>& targets_;
+    Options options_;
+    uint32_t cookie_ = 0;
+    std::array<uint8_t, kDcidSize> dcid_{};
+
+    int fd4_ = -1;
+    int fd6_ = -1;
+    std::vector<Host> hosts_;
+    int outstanding_ = 0;  // probes sent but neither answered nor failed
+
+    // Datagrams of one sendmmsg/recvmmsg batch
+    struct Queued {
+        size_t index;
+        uint32_t sample;
+        std::array<uint8_t, kProbeSize> packet;
+    };
+    std::array<Queued, kBatch> queue_{};
+    size_t queued_ = 0;
+    std::array<std::array<uint8_t, kReplySize>, kBatch> replies_{};
+    std::array<std::array<char, CMSG_SPACE(sizeof(timespec))>, kBatch> controls_{};
+};
+
+} // namespace
+
+std::vector<Result> run(const std::vector<Target>& targets, const Options& options) {
+    if (targets.empty()) return {};
+    Sweep sweep(targets, options);
+    return sweep.run();
+}
+
+} // namespace udp_prober
+
+namespace {
+
+// Longs per target: status, sent, received, min ns, avg ns, max ns, jitter ns, QUIC version
+constexpr size_t kResultStride = 8;
+
+} // namespace
+
+extern "C" {
+
+/**
+ * Send paced QUIC version-negotiation probe trains to host:port targets
+ * @return kResultStride longs per target in input order, or null
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_hiddify_hiddifyng_utils_PingUtils_probeUdpNative(JNIEnv *env, jclass clazz,
+                                                          jobjectArray hosts, jintArray ports,
+                                                          jint count, jint interval_ms,
+                                                          jint timeout_ms) {
+    jsize size = env->GetArrayLength(hosts);
+    if (env->GetArrayLength(ports) != size) return nullptr;
+    std::vector<jint> port_values(static_cast<size_t>(size));
+    env->GetIntArrayRegion(ports, 0, size, port_values.data());
+    std::vector<udp_prober::Target> targets(static_cast<size_t>(size));
+    for (jsize i = 0; i < size; i++) {
+        auto host = static_cast<jstring>(env->GetObjectArrayElement(hosts, i));
+        if (host != nullptr) {
+            const char* chars = env->GetStringUTFChars(host, nullptr);
+            targets[i].host = chars;
+            env->ReleaseStringUTFChars(host, chars);
+            env->DeleteLocalRef(host);
+        }
+        targets[i].port = port_values[i];
+    }
+
+    udp_prober::Options options;
+    options.count = count;
+    options.interval_ms = interval_ms;
+    options.timeout_ms = timeout_ms;
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<udp_prober::Result> results = udp_prober::run(targets, options);
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    std::vector<jlong> rows;
+    rows.reserve(results.size() * kResultStride);
+    int answered = 0;
+    for (const udp_prober::Result& result : results) {
+        jlong row[kResultStride] = {result.status, result.sent, result.received,
+                                    result.min_ns, result.avg_ns, result.max_ns,
+                                    result.jitter_ns, result.quic_version};
+        rows.insert(rows.end(), row, row + kResultStride);
+        if (result.status == udp_prober::kOk) answered++;
+    }
+    LOGI("UDP probe: %d/%d targets answered in %lld ms", answered, size,
+         static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()));
+
+    jlongArray array = env->NewLongArray(static_cast<jsize>(rows.size()));
+    if (array == nullptr) return nullptr;
+    env->SetLongArrayRegion(array, 0, static_cast<jsize>(rows.size()), rows.data());
+    return array;
+}
+
+} // extern "C"
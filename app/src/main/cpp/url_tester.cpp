@@ -0,0 +1,600 @@
+#include <jni.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string_view>
+#include <thread>
+
+#include "url_tester.h"
+#include "native_log.h"
+
+namespace url_tester {
+
+namespace {
+
+constexpr int kMaxEvents = 64;
+constexpr int kMaxInFlight = 512;
+constexpr int kMaxSamples = 20;
+constexpr size_t kReadyProbePorts = 8;  // inbounds tried while waiting for the core
+constexpr int kReadyPollMs = 20;
+constexpr size_t kMaxInput = 4096;     // status line and headers; bodies are counted, not kept
+constexpr int64_t kMinBodyBytes = 16 * 1024;  // less than this is not a throughput measurement
+constexpr size_t kReadChunk = 16 * 1024;
+
+int64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+struct Url {
+    std::string host;
+    int port = 80;
+    std::string path = "/";
+};
+
+/** http://host[:port][/path]; IPv6 literals in brackets */
+bool parse_url(const std::string& url, Url& out) {
+    constexpr std::string_view kScheme = "http://";
+    if (url.compare(0, kScheme.size(), kScheme) != 0) return false;
+    std::string rest = url.substr(kScheme.size());
+    size_t slash = rest.find('/');
+    std::string authority = rest.substr(0, slash);
+    if (slash != std::string::npos) out.path = rest.substr(slash);
+
+    size_t colon = std::string::npos;
+    if (!authority.empty() && authority[0] == '[') {
+        size_t close = authority.find(']');
+        if (close == std::string::npos) return false;
+        out.host = authority.substr(1, close - 1);
+        if (close + 1 < authority.size()) {
+            if (authority[close + 1] != ':') return false;
+            colon = close + 1;
+        }
+    } else {
+        colon = authority.rfind(':');
+        out.host = authority.substr(0, colon);
+    }
+    if (colon != std::string::npos) {
+        char* end = nullptr;
+        long port = strtol(authority.c_str() + colon + 1, &end, 10);
+        if (*end != '\0' || port <= 0 || port > 65535) return false;
+        out.port = static_cast<int>(port);
+    }
+    return !out.host.empty();
+}
+
+sockaddr_in loopback(int port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return address;
+}
+
+/** Poll the first few inbounds until one accepts; the core opens them together */
+bool wait_ready(const std::vector<int>& ports, int timeout_ms) {
+    int64_t deadline = now_ns() + timeout_ms * 1000000ll;
+    size_t probes = std::min(ports.size(), kReadyProbePorts);
+    for (;;) {
+        for (size_t i = 0; i < probes; i++) {
+            int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd < 0) return false;
+            sockaddr_in address = loopback(ports[i]);
+            bool open = connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+            close(fd);
+            if (open) return true;
+        }
+        if (now_ns() >= deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(kReadyPollMs));
+    }
+}
+
+enum Phase {
+    kConnecting,
+    kGreeting,      // sent the method offer, waiting for the choice
+    kConnectReply,  // sent CONNECT, waiting for the reply
+    kResponse,      // sent the HTTP request, waiting for the status line
+    kHeaders,       // body budget only: skipping to the end of the headers
+    kBody,          // body budget only: counting body bytes
+};
+
+struct Fetch {
+    int fd = -1;
+    Phase phase = kConnecting;
+    int64_t started_ns = 0;
+    int64_t deadline_ns = 0;
+    std::string input;
+    int attempts = 0;
+    int successes = 0;
+    int64_t best_ns = 0;
+    int64_t total_ns = 0;
+    int http_status = 0;
+    Status failure = kTimeout;
+    // Body of the running sample; bytes of the first read arrive before the clock starts
+    int64_t body_bytes = 0;
+    int64_t timed_bytes = 0;
+    int64_t body_first_ns = 0;
+    int64_t body_last_ns = 0;
+    int64_t total_body_bytes = 0;
+    int64_t total_body_ns = 0;
+};
+
+class Sweep {
+public:
+    Sweep(const std::vector<int>& ports, const Url& url, const Options& options)
+        : ports_(ports), url_(url), options_(options) {
+        options_.samples = std::clamp(options_.samples, 1, kMaxSamples);
+        options_.timeout_ms = std::max(1, options_.timeout_ms);
+        options_.max_in_flight = std::clamp(options_.max_in_flight, 1, kMaxInFlight);
+        options_.body_bytes = std::max<int64_t>(0, options_.body_bytes);
+        options_.body_ms = std::max(1, options_.body_ms);
+        build_requests();
+    }
+
+    ~Sweep() {
+        for (Fetch& fetch : fetches_) {
+            if (fetch.fd >= 0) close(fetch.fd);
+        }
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+    }
+
+    std::vector<Result> run() {
+        results_.resize(ports_.size());
+        fetches_.resize(ports_.size());
+        for (size_t i = 0; i < ports_.size(); i++) {
+            results_[i].index = i;
+            if (ports_[i] <= 0 || ports_[i] > 65535) {
+                results_[i].status = kError;
+                continue;
+            }
+            ready_.push_back(i);
+        }
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            LOGE("epoll_create1 failed: %s", strerror(errno));
+            return results_;
+        }
+
+        epoll_event events[kMaxEvents];
+        while (!ready_.empty() || in_flight_ > 0) {
+            launch();
+            if (in_flight_ == 0) continue;
+
+            int n = epoll_wait(epoll_fd_, events, kMaxEvents, wait_ms());
+            int64_t now = now_ns();
+            if (n < 0 && errno != EINTR) {
+                LOGE("epoll_wait failed: %s", strerror(errno));
+                break;
+            }
+            for (int i = 0; i < n; i++) {
+                auto index = static_cast<size_t>(events[i].data.u64);
+                if (fetches_[index].fd < 0) continue;
+                if (fetches_[index].phase == kConnecting) {
+                    connected(index);
+                } else {
+                    receive(index, now);
+                }
+            }
+            expire(now);
+        }
+        return results_;
+    }
+
+private:
+    void build_requests() {
+        // CONNECT by name so the server resolves the target, as real traffic does
+        in6_addr literal;
+        connect_request_ = {5, 1, 0};
+        if (inet_pton(AF_INET, url_.host.c_str(), &literal) == 1) {
+            connect_request_.push_back(1);
+            connect_request_.append(reinterpret_cast<const char*>(&literal), 4);
+        } else if (inet_pton(AF_INET6, url_.host.c_str(), &literal) == 1) {
+            connect_request_.push_back(4);
+            connect_request_.append(reinterpret_cast<const char*>(&literal), 16);
+        } else {
+            connect_request_.push_back(3);
+            connect_request_.push_back(static_cast<char>(std::min<size_t>(url_.host.size(), 255)));
+            connect_request_.append(url_.host, 0, 255);
+        }
+        connect_request_.push_back(static_cast<char>(url_.port >> 8));
+        connect_request_.push_back(static_cast<char>(url_.port & 0xff));
+
+        std::string host = url_.host.find(':') != std::string::npos ? "[" + url_.host + "]" : url_.host;
+        if (url_.port != 80) host += ":" + std::to_string(url_.port);
+        http_request_ = "GET " + url_.path + " HTTP/1.1\r\n"
+                        "Host: " + host + "\r\n"
+                        "User-Agent: Mozilla/5.0\r\n"
+                        "Accept: */*\r\n"
+                        "Connection: close\r\n\r\n";
+    }
+
+    void launch() {
+        while (in_flight_ < options_.max_in_flight && !ready_.empty()) {
+            size_t index = ready_.front();
+            ready_.pop_front();
+            Fetch& fetch = fetches_[index];
+
+            int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) {
+                finish_sample(index, false, kError, 0);
+                continue;
+            }
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+            fetch.phase = kConnecting;
+            fetch.input.clear();
+            fetch.body_bytes = 0;
+            fetch.timed_bytes = 0;
+            fetch.started_ns = now_ns();
+            fetch.deadline_ns = fetch.started_ns + options_.timeout_ms * 1000000ll;
+            sockaddr_in address = loopback(ports_[index]);
+            if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 &&
+                errno != EINPROGRESS) {
+                int error = errno;
+                close(fd);
+                finish_sample(index, false, error == ECONNREFUSED ? kRefused : kError, 0);
+                continue;
+            }
+            epoll_event event{};
+            event.events = EPOLLOUT;
+            event.data.u64 = index;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+                close(fd);
+                finish_sample(index, false, kError, 0);
+                continue;
+            }
+            fetch.fd = fd;
+            in_flight_++;
+        }
+    }
+
+    void connected(size_t index) {
+        Fetch& fetch = fetches_[index];
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(fetch.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            end(index, false, error == ECONNREFUSED ? kRefused : kError, 0);
+            return;
+        }
+        static const char kMethodOffer[] = {5, 1, 0};  // SOCKS5, one method: no auth
+        if (!write_all(index, kMethodOffer, sizeof(kMethodOffer))) return;
+        fetch.phase = kGreeting;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = index;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fetch.fd, &event);
+    }
+
+    bool write_all(size_t index, const char* data, size_t size) {
+        ssize_t n = send(fetches_[index].fd, data, size, MSG_NOSIGNAL);
+        if (n != static_cast<ssize_t>(size)) {
+            end(index, false, kProxyFailed, 0);
+            return false;
+        }
+        return true;
+    }
+
+    void receive(size_t index, int64_t now) {
+        Fetch& fetch = fetches_[index];
+        char buffer[kReadChunk];
+        for (;;) {
+            ssize_t n = recv(fetch.fd, buffer, sizeof(buffer), 0);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                if (fetch.phase == kBody) {
+                    // Server closed after a short body, or the path broke: keep what was timed
+                    finish_body(index);
+                } else {
+                    // The inbound closes when its outbound could not reach the target
+                    end(index, false, kProxyFailed, 0);
+                }
+                return;
+            }
+            if (n < 0) return;
+            if (fetch.phase == kBody) {
+                if (!count_body(index, n, now)) return;
+                continue;
+            }
+            fetch.input.append(buffer, static_cast<size_t>(n));
+            if (fetch.input.size() > kMaxInput) {
+                end(index, false, kBadResponse, 0);
+                return;
+            }
+            if (!advance(index, now)) return;
+        }
+    }
+
+    /** Run the SOCKS and HTTP steps the input allows; false once the fetch ended */
+    bool advance(size_t index, int64_t now) {
+        Fetch& fetch = fetches_[index];
+        for (;;) {
+            std::string& in = fetch.input;
+            if (fetch.phase == kGreeting) {
+                if (in.size() < 2) return true;
+                if (in[0] != 5 || in[1] != 0) {
+                    end(index, false, kProxyFailed, 0);
+                    return false;
+                }
+                in.erase(0, 2);
+                if (!write_all(index, connect_request_.data(), connect_request_.size())) return false;
+                fetch.phase = kConnectReply;
+            } else if (fetch.phase == kConnectReply) {
+                if (in.size() < 5) return true;
+                if (in[0] != 5 || in[1] != 0) {
+                    end(index, false, kProxyFailed, 0);
+                    return false;
+                }
+                size_t address = in[3] == 1 ? 4 : in[3] == 4 ? 16 : 1 + static_cast<uint8_t>(in[4]);
+                if (in.size() < 4 + address + 2) return true;
+                in.erase(0, 4 + address + 2);
+                if (!write_all(index, http_request_.data(), http_request_.size())) return false;
+                fetch.phase = kResponse;
+            } else if (fetch.phase == kResponse) {
+                size_t line = in.find("\r\n");
+                if (line == std::string::npos) return true;
+                // "HTTP/1.1 204 No Content"
+                int status = 0;
+                if (line >= 12 && in.compare(0, 5, "HTTP/") == 0) {
+                    status = atoi(in.c_str() + in.find(' ') + 1);
+                }
+                fetch.http_status = status;
+                if (options_.body_bytes == 0) {
+                    bool ok = status == 204;
+                    end(index, ok, ok ? kOk : kBadResponse, now - fetch.started_ns);
+                    return false;
+                }
+                if (status != 200 && status != 206) {
+                    end(index, false, kBadResponse, 0);
+                    return false;
+                }
+                fetch.phase = kHeaders;
+            } else {
+                size_t headers = in.find("\r\n\r\n");
+                if (headers == std::string::npos) return true;
+                fetch.phase = kBody;
+                fetch.deadline_ns = now + options_.body_ms * 1000000ll;
+                auto rest = static_cast<ssize_t>(in.size() - headers - 4);
+                in.clear();
+                return rest == 0 || count_body(index, rest, now);
+            }
+        }
+    }
+
+    /** Add n body bytes; false once the budget is met and the fetch ended */
+    bool count_body(size_t index, ssize_t n, int64_t now) {
+        Fetch& fetch = fetches_[index];
+        if (fetch.body_bytes == 0) {
+            fetch.body_first_ns = now;
+        } else {
+            fetch.timed_bytes += n;
+        }
+        fetch.body_bytes += n;
+        fetch.body_last_ns = now;
+        if (fetch.body_bytes < options_.body_bytes) return true;
+        finish_body(index);
+        return false;
+    }
+
+    /** End a body read; it counts if enough arrived to time */
+    void finish_body(size_t index) {
+        Fetch& fetch = fetches_[index];
+        int64_t elapsed = fetch.body_last_ns - fetch.body_first_ns;
+        bool measured = fetch.body_bytes >= std::min(kMinBodyBytes, options_.body_bytes) &&
+                        fetch.timed_bytes > 0 && elapsed > 0;
+        if (measured) {
+            fetch.total_body_bytes += fetch.timed_bytes;
+            fetch.total_body_ns += elapsed;
+        }
+        // Latency of a throughput fetch is its time to first byte
+        end(index, measured, measured ? kOk : kBadResponse, fetch.body_first_ns - fetch.started_ns);
+    }
+
+    /** Close the connection of the running sample and record it */
+    void end(size_t index, bool ok, Status status, int64_t elapsed_ns) {
+        Fetch& fetch = fetches_[index];
+        close(fetch.fd);  // also removes it from the epoll set
+        fetch.fd = -1;
+        in_flight_--;
+        finish_sample(index, ok, status, elapsed_ns);
+    }
+
+    void finish_sample(size_t index, bool ok, Status status, int64_t elapsed_ns) {
+        Fetch& fetch = fetches_[index];
+        fetch.attempts++;
+        if (ok) {
+            fetch.successes++;
+            fetch.total_ns += elapsed_ns;
+            if (fetch.best_ns == 0 || elapsed_ns < fetch.best_ns) fetch.best_ns = elapsed_ns;
+        } else {
+            fetch.failure = status;
+        }
+
+        // A closed inbound port will not open for the next sample
+        bool definitive = status == kRefused || status == kError;
+        if (fetch.attempts < options_.samples && !definitive) {
+            ready_.push_back(index);
+            return;
+        }
+
+        Result& result = results_[index];
+        result.status = fetch.successes > 0 ? kOk : fetch.failure;
+        result.http_status = fetch.http_status;
+        result.best_ns = fetch.best_ns;
+        result.mean_ns = fetch.successes > 0 ? fetch.total_ns / fetch.successes : 0;
+        result.successes = fetch.successes;
+        result.attempts = fetch.attempts;
+        result.body_bytes = fetch.total_body_bytes;
+        result.body_ns = fetch.total_body_ns;
+    }
+
+    void expire(int64_t now) {
+        for (size_t index = 0; index < fetches_.size(); index++) {
+            Fetch& fetch = fetches_[index];
+            if (fetch.fd < 0 || now < fetch.deadline_ns) continue;
+            if (fetch.phase == kBody) {
+                finish_body(index);  // the time budget ran out, not the server
+            } else {
+                end(index, false, kTimeout, 0);
+            }
+        }
+    }
+
+    int wait_ms() const {
+        if (!ready_.empty() && in_flight_ < options_.max_in_flight) return 0;
+        int64_t wake = INT64_MAX;
+        for (const Fetch& fetch : fetches_) {
+            if (fetch.fd >= 0) wake = std::min(wake, fetch.deadline_ns);
+        }
+        if (wake == INT64_MAX) return -1;
+        int64_t remaining = wake - now_ns();
+        return remaining <= 0 ? 0 : static_cast<int>((remaining + 999999) / 1000000);
+    }
+
+    const std::vector<int>& ports_;
+    Url url_;
+    Options options_;
+    std::string connect_request_;
+    std::string http_request_;
+
+    int epoll_fd_ = -1;
+    std::vector<Fetch> fetches_;
+    std::vector<Result> results_;
+    std::deque<size_t> ready_;
+    int in_flight_ = 0;
+};
+
+} // namespace
+
+std::vector<Result> run(const std::vector<int>& ports, const Options& options) {
+    Url url;
+    if (!parse_url(options.url, url)) {
+        LOGE("URL test needs an http:// URL, got %s", options.url.c_str());
+        return {};
+    }
+    if (ports.empty()) return {};
+    if (!wait_ready(ports, options.ready_timeout_ms)) {
+        LOGW("No batch inbound accepted within %d ms", options.ready_timeout_ms);
+    }
+    Sweep sweep(ports, url, options);
+    return sweep.run();
+}
+
+} // namespace url_tester
+
+namespace {
+
+// Longs per inbound: status, http status, best ns, mean ns, successes, attempts
+constexpr size_t kResultStride = 6;
+
+// Longs per inbound: status, http status, best time to first byte ns, body bytes, body ns
+constexpr size_t kThroughputStride = 5;
+
+} // namespace
+
+extern "C" {
+
+/**
+ * Fetch url through the SOCKS inbound on each 127.0.0.1 port concurrently
+ * @return kResultStride longs per port in input order, or null if the URL is unusable
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_hiddify_hiddifyng_core_XrayManager_urlTestNative(JNIEnv *env, jclass clazz,
+                                                          jintArray ports, jstring url,
+                                                          jint samples, jint timeout_ms,
+                                                          jint max_in_flight) {
+    jsize count = env->GetArrayLength(ports);
+    std::vector<jint> values(static_cast<size_t>(count));
+    env->GetIntArrayRegion(ports, 0, count, values.data());
+    std::vector<int> port_values(values.begin(), values.end());
+
+    url_tester::Options options;
+    const char* chars = env->GetStringUTFChars(url, nullptr);
+    options.url = chars;
+    env->ReleaseStringUTFChars(url, chars);
+    options.samples = samples;
+    options.timeout_ms = timeout_ms;
+    options.max_in_flight = max_in_flight;
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<url_tester::Result> results = url_tester::run(port_values, options);
+    if (results.size() != port_values.size()) return nullptr;
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    std::vector<jlong> rows;
+    rows.reserve(results.size() * kResultStride);
+    int passed = 0;
+    for (const url_tester::Result& result : results) {
+        jlong row[kResultStride] = {result.status, result.http_status, result.best_ns,
+                                    result.mean_ns, result.successes, result.attempts};
+        rows.insert(rows.end(), row, row + kResultStride);
+        if (result.status == url_tester::kOk) passed++;
+    }
+    LOGI("URL test: %d/%d inbounds passed in %lld ms", passed, count,
+         static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()));
+
+    jlongArray array = env->NewLongArray(static_cast<jsize>(rows.size()));
+    if (array == nullptr) return nullptr;
+    env->SetLongArrayRegion(array, 0, static_cast<jsize>(rows.size()), rows.data());
+    return array;
+}
+
+/**
+ * Download from url through the SOCKS inbound on each 127.0.0.1 port and time the body
+ * @param body_bytes Bytes to read per inbound; the read also stops after body_ms
+ * @return kThroughputStride longs per port in input order, or null if the URL is unusable
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_hiddify_hiddifyng_core_XrayManager_throughputTestNative(JNIEnv *env, jclass clazz,
+                                                                 jintArray ports, jstring url,
+                                                                 jlong body_bytes, jint body_ms,
+                                                                 jint timeout_ms, jint max_in_flight) {
+    jsize count = env->GetArrayLength(ports);
+    std::vector<jint> values(static_cast<size_t>(count));
+    env->GetIntArrayRegion(ports, 0, count, values.data());
+    std::vector<int> port_values(values.begin(), values.end());
+
+    url_tester::Options options;
+    const char* chars = env->GetStringUTFChars(url, nullptr);
+    options.url = chars;
+    env->ReleaseStringUTFChars(url, chars);
+    options.samples = 1;
+    options.timeout_ms = timeout_ms;
+    options.max_in_flight = max_in_flight;
+    options.body_bytes = body_bytes > 0 ? body_bytes : 1;
+    options.body_ms = body_ms;
+
+    std::vector<url_tester::Result> results = url_tester::run(port_values, options);
+    if (results.size() != port_values.size()) return nullptr;
+
+    std::vector<jlong> rows;
+    rows.reserve(results.size() * kThroughputStride);
+    int measured = 0;
+    for (const url_tester::Result& result : results) {
+        jlong row[kThroughputStride] = {result.status, result.http_status, result.best_ns,
+                                        result.body_bytes, result.body_ns};
+        rows.insert(rows.end(), row, row + kThroughputStride);
+        if (result.status == url_tester::kOk) measured++;
+    }
+    LOGI("Throughput test: %d/%d inbounds measured", measured, count);
+
+    jlongArray array = env->NewLongArray(static_cast<jsize>(rows.size()));
+    if (array == nullptr) return nullptr;
+    env->SetLongArrayRegion(array, 0, static_cast<jsize>(rows.size()), rows.data());
+    return array;
+}
+
+} // extern "C"
@@ -1,24 +1,31 @@
 #include <jni.h>
 #include <string>
-#include <android/log.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <fcntl.h>
 #include <pthread.h>
 #include <signal.h>
 #include <dirent.h>
+#include <time.h>
 #include <sys/system_properties.h>
+#include <algorithm>
+#include <vector>
 
-#define LOG_TAG "XrayCoreJNI"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#include "native_log.h"
+#include "xray_process.h"
 
 // Store Xray process ID
 static pid_t xray_pid = -1;
 static pthread_mutex_t pid_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Throwaway core running batch URL tests beside the main one
+static pid_t batch_pid = -1;
+static pthread_mutex_t batch_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 // Path to Xray binary
 static const char* XRAY_BIN = "libxray.so";
 static std::string xray_bin_path;
@@ -27,11 +34,22 @@ static std::string xray_bin_path;
 static bool prepare_xray_environment(JNIEnv *env, const std::string& internal_dir);
 static bool execute_xray(const std::string& config_path);
 static bool kill_xray_process();
+static bool kill_locked();
+static bool execute_batch_xray(const std::string& config_path);
+static bool kill_batch_process();
 static std::string get_xray_path(const std::string& internal_dir);
+static int64_t time_config_load(const std::string& config_path, int iterations);
 // Commenting out unused function declaration
 // static int copy_asset_to_file(JNIEnv *env, jobject context, const std::string& asset_name, 
 //                              const std::string& output_path);
 
+pid_t xray_process_id() {
+    pthread_mutex_lock(&pid_mutex);
+    pid_t pid = xray_pid;
+    pthread_mutex_unlock(&pid_mutex);
+    return pid;
+}
+
 extern "C" {
 
 /**
@@ -82,6 +100,33 @@ Java_com_hiddify_hiddifyng_core_XrayManager_stopXray(JNIEnv *env, jclass clazz)
     return success ? 0 : -1;
 }
 
+/**
+ * Start the batch test core with the given configuration
+ * It never replaces the main core; a previous batch core is stopped first
+ */
+JNIEXPORT jint JNICALL
+Java_com_hiddify_hiddifyng_core_XrayManager_startBatchXray(JNIEnv *env, jclass clazz, jstring config_path) {
+    const char *path = env->GetStringUTFChars(config_path, nullptr);
+    LOGI("Starting batch Xray with config: %s", path);
+    
+    bool success = execute_batch_xray(std::string(path));
+    env->ReleaseStringUTFChars(config_path, path);
+    
+    return success ? 0 : -1;
+}
+
+/**
+ * Stop the batch test core and reap it
+ */
+JNIEXPORT jint JNICALL
+Java_com_hiddify_hiddifyng_core_XrayManager_stopBatchXray(JNIEnv *env, jclass clazz) {
+    LOGI("Stopping batch Xray");
+    
+    bool success = kill_batch_process();
+    
+    return success ? 0 : -1;
+}
+
 /**
  * Get Xray version
  */
@@ -114,6 +159,33 @@ Java_com_hiddify_hiddifyng_core_XrayManager_checkVersion(JNIEnv *env, jclass cla
     return env->NewStringUTF(version.c_str());
 }
 
+/**
+ * Benchmark core startup on the JSON and protobuf forms of the same config
+ * Each form is loaded with `xray run -test`, which parses and builds the
+ * config and exits without opening listeners.
+ * @return [json median ns, pb median ns]; -1 for a form that failed to load
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_hiddify_hiddifyng_core_XrayManager_benchmarkConfigLoad(JNIEnv *env, jclass clazz,
+                                                               jstring json_path, jstring pb_path,
+                                                               jint iterations) {
+    const char *json = env->GetStringUTFChars(json_path, nullptr);
+    const char *pb = env->GetStringUTFChars(pb_path, nullptr);
+    
+    jlong results[2];
+    results[0] = time_config_load(json, iterations);
+    results[1] = time_config_load(pb, iterations);
+    LOGI("Config load benchmark: json=%lld ns, pb=%lld ns",
+         (long long) results[0], (long long) results[1]);
+    
+    env->ReleaseStringUTFChars(json_path, json);
+    env->ReleaseStringUTFChars(pb_path, pb);
+    
+    jlongArray array = env->NewLongArray(2);
+    env->SetLongArrayRegion(array, 0, 2, results);
+    return array;
+}
+
 /**
  * Update GeoIP and GeoSite databases
  */
@@ -168,9 +240,7 @@ static bool execute_xray(const std::string& config_path) {
     pthread_mutex_lock(&pid_mutex);
     
     // Make sure any existing Xray process is killed
-    if (xray_pid > 0) {
-        kill_xray_process();
-    }
+    kill_locked();
     
     pid_t pid = fork();
     
@@ -180,17 +250,9 @@ static bool execute_xray(const std::string& config_path) {
         pthread_mutex_unlock(&pid_mutex);
         return false;
     } else if (pid == 0) {
-        // Child process
-        LOGI("Starting Xray process with config: %s", config_path.c_str());
-        
-        // Execute Xray
-        if (execl(xray_bin_path.c_str(), XRAY_BIN, "run", "-c", config_path.c_str(), NULL) < 0) {
-            LOGE("Failed to execute Xray: %s", strerror(errno));
-            exit(1);
-        }
-        
-        // This should never be reached
-        exit(0);
+        // Child process: exec or exit without running the parent's atexit handlers
+        execl(xray_bin_path.c_str(), XRAY_BIN, "run", "-c", config_path.c_str(), NULL);
+        _exit(127);
     } else {
         // Parent process
         LOGI("Xray process started with PID: %d", pid);
@@ -205,34 +267,109 @@ static bool execute_xray(const std::string& config_path) {
  */
 static bool kill_xray_process() {
     pthread_mutex_lock(&pid_mutex);
-    
+    bool success = kill_locked();
+    pthread_mutex_unlock(&pid_mutex);
+    return success;
+}
+
+/**
+ * Stop and reap the main core: SIGTERM, SIGKILL if it outlives the grace period
+ * The caller holds pid_mutex
+ */
+static bool kill_locked() {
     if (xray_pid <= 0) {
         // No Xray process running
-        pthread_mutex_unlock(&pid_mutex);
         return true;
     }
     
     // Send SIGTERM to Xray process
-    if (kill(xray_pid, SIGTERM) < 0) {
+    if (kill(xray_pid, SIGTERM) < 0 && errno != ESRCH) {
         LOGE("Failed to kill Xray process (PID: %d): %s", xray_pid, strerror(errno));
-        pthread_mutex_unlock(&pid_mutex);
         return false;
     }
     
     LOGI("Sent SIGTERM to Xray process (PID: %d)", xray_pid);
     
-    // Wait a bit for process to exit
-    usleep(100000); // 100ms
-    
-    // Check if process is still running
-    if (kill(xray_pid, 0) == 0) {
+    // Reap it so restarts leave no zombies behind
+    bool exited = false;
+    for (int i = 0; i < 50 && !exited; i++) {
+        pid_t rc = waitpid(xray_pid, nullptr, WNOHANG);
+        exited = rc == xray_pid || (rc < 0 && errno == ECHILD);
+        if (!exited) usleep(10000); // 10ms
+    }
+    if (!exited) {
         // Process still exists, try SIGKILL
         LOGI("Xray process still running, sending SIGKILL");
         kill(xray_pid, SIGKILL);
+        while (waitpid(xray_pid, nullptr, 0) < 0 && errno == EINTR) {
+        }
     }
     
     xray_pid = -1;
-    pthread_mutex_unlock(&pid_mutex);
+    return true;
+}
+
+/**
+ * Fork the batch test core; its output is discarded
+ */
+static bool execute_batch_xray(const std::string& config_path) {
+    if (xray_bin_path.empty()) {
+        LOGE("Xray binary path not set");
+        return false;
+    }
+    kill_batch_process();
+    
+    pthread_mutex_lock(&batch_mutex);
+    pid_t pid = fork();
+    if (pid < 0) {
+        LOGE("Failed to fork batch Xray process: %s", strerror(errno));
+        pthread_mutex_unlock(&batch_mutex);
+        return false;
+    } else if (pid == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+        }
+        execl(xray_bin_path.c_str(), XRAY_BIN, "run", "-c", config_path.c_str(), NULL);
+        _exit(127);
+    }
+    
+    LOGI("Batch Xray process started with PID: %d", pid);
+    batch_pid = pid;
+    pthread_mutex_unlock(&batch_mutex);
+    return true;
+}
+
+/**
+ * Stop the batch test core: SIGTERM, SIGKILL if it outlives the grace period
+ */
+static bool kill_batch_process() {
+    pthread_mutex_lock(&batch_mutex);
+    
+    if (batch_pid <= 0) {
+        pthread_mutex_unlock(&batch_mutex);
+        return true;
+    }
+    
+    kill(batch_pid, SIGTERM);
+    
+    // Reap it so repeated tests leave no zombies behind
+    bool exited = false;
+    for (int i = 0; i < 50 && !exited; i++) {
+        pid_t rc = waitpid(batch_pid, nullptr, WNOHANG);
+        exited = rc == batch_pid || (rc < 0 && errno == ECHILD);
+        if (!exited) usleep(10000); // 10ms
+    }
+    if (!exited) {
+        LOGI("Batch Xray process still running, sending SIGKILL");
+        kill(batch_pid, SIGKILL);
+        while (waitpid(batch_pid, nullptr, 0) < 0 && errno == EINTR) {
+        }
+    }
+    
+    batch_pid = -1;
+    pthread_mutex_unlock(&batch_mutex);
     return true;
 }
 
@@ -243,6 +380,50 @@ static std::string get_xray_path(const std::string& internal_dir) {
     return internal_dir + "/bin/" + XRAY_BIN;
 }
 
+/**
+ * Median wall time of `xray run -test -c config_path` over several runs
+ * @return median in nanoseconds, or -1 if any run failed
+ */
+static int64_t time_config_load(const std::string& config_path, int iterations) {
+    if (xray_bin_path.empty() || iterations <= 0) {
+        return -1;
+    }
+    
+    std::vector<int64_t> samples;
+    for (int i = 0; i < iterations; i++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        
+        pid_t pid = fork();
+        if (pid < 0) {
+            LOGE("Failed to fork config test: %s", strerror(errno));
+            return -1;
+        } else if (pid == 0) {
+            int devnull = open("/dev/null", O_WRONLY);
+            if (devnull >= 0) {
+                dup2(devnull, STDOUT_FILENO);
+                dup2(devnull, STDERR_FILENO);
+            }
+            execl(xray_bin_path.c_str(), XRAY_BIN, "run", "-test", "-c", config_path.c_str(), NULL);
+            _exit(127);
+        }
+        
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            LOGE("Config test failed for %s", config_path.c_str());
+            return -1;
+        }
+        samples.push_back((end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec));
+    }
+    
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
 /**
  * Copy an asset file to internal storage
  * Currently not used but kept for future implementation
@@ -8,6 +8,7 @@ import androidx.work.ExistingPeriodicWorkPolicy
 import androidx.work.NetworkType
 import androidx.work.PeriodicWorkRequestBuilder
 import androidx.work.WorkManager
+import com.hiddify.hiddifyng.utils.PingUtils
 import com.hiddify.hiddifyng.utils.UpdateManager
 import com.hiddify.hiddifyng.worker.PingWorker
 import com.hiddify.hiddifyng.worker.SubscriptionWorker
@@ -47,6 +48,9 @@ class HiddifyNGApplication : Application() {
         super.onCreate()
         instance = this
         
+        // Ping results shared between the worker and the UI, kept across restarts
+        PingUtils.openProbeCache(this)
+        
         // Initialize background workers
         initializeWorkers()
         
@@ -19,8 +19,12 @@ import com.hiddify.hiddifyng.database.entity.Server
 import com.hiddify.hiddifyng.databinding.ActivityMainBinding
 import com.hiddify.hiddifyng.utils.ServerComparator
 import com.hiddify.hiddifyng.viewmodel.MainViewModel
+import com.hiddify.hiddifyng.viewmodel.ServerViewModel
+import kotlinx.coroutines.CancellationException
 import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.flow.toList
 import kotlinx.coroutines.launch
 import kotlinx.coroutines.withContext
 
@@ -32,6 +36,9 @@ class MainActivity : AppCompatActivity() {
     companion object {
         private const val TAG = "MainActivity"
         private const val REQUEST_CODE_VPN_PERMISSION = 1
+        
+        // Servers that must answer before connecting when none has a ping yet
+        private const val QUICK_CONNECT_CANDIDATES = 3
     }
     
     // View binding
@@ -39,6 +46,7 @@ class MainActivity : AppCompatActivity() {
     
     // ViewModel
     private lateinit var viewModel: MainViewModel
+    private lateinit var serverViewModel: ServerViewModel
     
     // XrayManager
     private lateinit var xrayManager: XrayManager
@@ -46,6 +54,9 @@ class MainActivity : AppCompatActivity() {
     // Server adapter
     private lateinit var serverAdapter: ServerAdapter
     
+    // Manual ping of the server list, if running
+    private var pingJob: Job? = null
+    
     override fun onCreate(savedInstanceState: Bundle?) {
         super.onCreate(savedInstanceState)
         
@@ -58,6 +69,7 @@ class MainActivity : AppCompatActivity() {
         
         // Initialize ViewModel
         viewModel = ViewModelProvider(this)[MainViewModel::class.java]
+        serverViewModel = ViewModelProvider(this)[ServerViewModel::class.java]
         
         // Initialize XrayManager
         xrayManager = XrayManager.getInstance(this)
@@ -189,7 +201,7 @@ class MainActivity : AppCompatActivity() {
         )
         
         // Sort by ping (lowest first)
-        return@withContext dummyServers.sortedWith(ServerComparator())
+        return@withContext dummyServers.sortedWith(ServerComparator.forServers(dummyServers))
     }
     
     /**
@@ -422,8 +434,16 @@ class MainActivity : AppCompatActivity() {
                     return@launch
                 }
                 
-                // Find server with lowest ping
-                val bestServer = servers.minByOrNull { it.avgPing ?: Int.MAX_VALUE }
+                // Find server with lowest ping; with none measured yet, ping only until a few answer
+                val bestServer = if (servers.any { (it.avgPing ?: 0) > 0 }) {
+                    servers.minByOrNull { it.avgPing?.takeIf { ping -> ping > 0 } ?: Int.MAX_VALUE }
+                } else {
+                    serverViewModel.pingAllServers(servers, QUICK_CONNECT_CANDIDATES)
+                        .toList()
+                        .filter { it.second > 0 }
+                        .minByOrNull { it.second }
+                        ?.first
+                }
                 
                 bestServer?.let {
                     withContext(Dispatchers.Main) {
@@ -496,7 +516,7 @@ class MainActivity : AppCompatActivity() {
             R.id.menu_ping -> {
                 // Manually trigger ping for all servers
                 Toast.makeText(this, "Pinging servers...", Toast.LENGTH_SHORT).show()
-                // Trigger ping worker
+                pingServers()
                 true
             }
             R.id.menu_update -> {
@@ -509,6 +529,35 @@ class MainActivity : AppCompatActivity() {
         }
     }
     
+    /**
+     * Ping every listed server, updating each row as its result arrives
+     */
+    private fun pingServers() {
+        pingJob?.cancel()
+        pingJob = CoroutineScope(Dispatchers.Main).launch {
+            try {
+                val servers = serverAdapter.currentList
+                var reachable = 0
+                serverViewModel.pingAllServers(servers).collect { (server, ping) ->
+                    serverAdapter.updatePing(server.id, ping)
+                    if (ping > 0) reachable++
+                }
+                Toast.makeText(this@MainActivity, "$reachable of ${servers.size} servers reachable",
+                    Toast.LENGTH_SHORT).show()
+            } catch (e: CancellationException) {
+                throw e
+            } catch (e: Exception) {
+                Log.e(TAG, "Error pinging servers", e)
+                Toast.makeText(this@MainActivity, "Error pinging servers", Toast.LENGTH_SHORT).show()
+            }
+        }
+    }
+    
+    override fun onDestroy() {
+        pingJob?.cancel()
+        super.onDestroy()
+    }
+    
     /**
      * Handle new intent (e.g., deeplinks while app is running)
      */
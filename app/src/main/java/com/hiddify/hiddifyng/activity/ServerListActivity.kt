@@ -18,7 +18,7 @@ import androidx.recyclerview.widget.RecyclerView
 import com.google.android.material.floatingactionbutton.FloatingActionButton
 import com.hiddify.hiddifyng.R
 import com.hiddify.hiddifyng.database.entity.Server
-import com.hiddify.hiddifyng.protocols.ProtocolHandler
+import com.hiddify.hiddifyng.utils.ShareLinkCodec
 import com.hiddify.hiddifyng.viewmodel.MainViewModel
 import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.Dispatchers
@@ -301,35 +301,25 @@ class ServerListActivity : AppCompatActivity() {
                 val url = urlEditText?.text?.toString() ?: ""
                 
                 if (url.isNotEmpty()) {
-                    // Try to parse URL as server
+                    // Try to parse URL as server; a paste may hold several links, one per line
                     try {
-                        // Extract protocol
-                        val protocolStr = url.substringBefore("://")
+                        val links = url.lines().map { it.trim() }.filter { it.isNotEmpty() }
+                        val servers = ShareLinkCodec.parseAll(links).filterNotNull()
                         
-                        if (protocolStr.isNotEmpty()) {
-                            val handler = ProtocolHandler.getHandler(protocolStr)
-                            val server = handler.parseUrl(url)
+                        if (servers.isNotEmpty()) {
+                            // Add servers to database
+                            servers.forEach { viewModel.addServer(it) }
                             
-                            if (server != null) {
-                                // Add server to database
-                                viewModel.addServer(server)
-                                
-                                Toast.makeText(
-                                    this,
-                                    "Server imported successfully",
-                                    Toast.LENGTH_SHORT
-                                ).show()
-                            } else {
-                                Toast.makeText(
-                                    this,
-                                    "Failed to parse server URL",
-                                    Toast.LENGTH_SHORT
-                                ).show()
-                            }
+                            Toast.makeText(
+                                this,
+                                if (servers.size == 1) "Server imported successfully"
+                                else "${servers.size} servers imported successfully",
+                                Toast.LENGTH_SHORT
+                            ).show()
                         } else {
                             Toast.makeText(
                                 this,
-                                "Invalid server URL",
+                                "Failed to parse server URL",
                                 Toast.LENGTH_SHORT
                             ).show()
                         }
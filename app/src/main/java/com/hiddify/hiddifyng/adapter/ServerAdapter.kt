@@ -18,6 +18,10 @@ class ServerAdapter(private val onServerClick: (Server) -> Unit) :
     // Currently selected server
     private var selectedServerId: Long = -1
     
+    // Pings measured since the list was submitted, shown instead of the item's avgPing
+    // until a submitted list carries them; null marks a server that did not answer
+    private val pingOverrides = HashMap<Long, Int?>()
+    
     override fun onCreateViewHolder(parent: ViewGroup, viewType: Int): ServerViewHolder {
         val binding = ItemServerBinding.inflate(
             LayoutInflater.from(parent.context),
@@ -29,7 +33,7 @@ class ServerAdapter(private val onServerClick: (Server) -> Unit) :
     
     override fun onBindViewHolder(holder: ServerViewHolder, position: Int) {
         val server = getItem(position)
-        holder.bind(server, selectedServerId == server.id)
+        holder.bind(server, displayedPing(server), selectedServerId == server.id)
         
         // Set click listener
         holder.itemView.setOnClickListener {
@@ -37,6 +41,39 @@ class ServerAdapter(private val onServerClick: (Server) -> Unit) :
         }
     }
     
+    override fun onBindViewHolder(holder: ServerViewHolder, position: Int, payloads: MutableList<Any>) {
+        // A ping result rebinds only the ping, not the whole row
+        if (payloads.isNotEmpty() && payloads.all { it == PAYLOAD_PING }) {
+            holder.bindPing(displayedPing(getItem(position)))
+        } else {
+            onBindViewHolder(holder, position)
+        }
+    }
+    
+    /**
+     * Show a server's ping as soon as it is measured, without resubmitting the list
+     * @param serverId Server ID
+     * @param ping Ping in milliseconds, or 0 or less if the server did not answer
+     */
+    fun updatePing(serverId: Long, ping: Int) {
+        val position = currentList.indexOfFirst { it.id == serverId }
+        if (position == -1) return
+        
+        // Items stay as submitted, so DiffUtil still sees the change when the
+        // database delivers the new ping
+        pingOverrides[serverId] = ping.takeIf { it > 0 }
+        notifyItemChanged(position, PAYLOAD_PING)
+    }
+    
+    override fun onCurrentListChanged(previousList: MutableList<Server>, currentList: MutableList<Server>) {
+        // Drop overrides the new list already shows, or whose server is gone
+        val pings = currentList.associate { it.id to it.avgPing }
+        pingOverrides.entries.removeAll { (id, ping) -> !pings.containsKey(id) || pings[id] == ping }
+    }
+    
+    private fun displayedPing(server: Server): Int? =
+        if (pingOverrides.containsKey(server.id)) pingOverrides[server.id] else server.avgPing
+    
     /**
      * Set selected server
      * @param server Server to select
@@ -79,26 +116,36 @@ class ServerAdapter(private val onServerClick: (Server) -> Unit) :
         /**
          * Bind server data to view
          * @param server Server data
+         * @param ping Ping to show, which may be newer than server.avgPing
          * @param isSelected Whether this server is selected
          */
-        fun bind(server: Server, isSelected: Boolean) {
+        fun bind(server: Server, ping: Int?, isSelected: Boolean) {
             binding.apply {
                 // Set server basic info
                 serverName.text = server.name
                 serverAddress.text = server.address
                 protocolTag.text = server.protocol.uppercase()
                 
-                // Set ping value with color based on value
-                server.avgPing?.let { ping ->
-                    pingValue.text = "$ping ms"
-                    pingValue.setTextColor(getPingColor(ping, binding.root.context))
+                bindPing(ping)
+                
+                // Set selected indicator
+                selectedIndicator.visibility = if (isSelected) View.VISIBLE else View.GONE
+            }
+        }
+        
+        /**
+         * Set ping value with color based on value
+         * @param ping Ping in milliseconds, or null if unknown
+         */
+        fun bindPing(ping: Int?) {
+            binding.apply {
+                ping?.let {
+                    pingValue.text = "$it ms"
+                    pingValue.setTextColor(getPingColor(it, binding.root.context))
                 } ?: run {
                     pingValue.text = "-- ms"
                     pingValue.setTextColor(0xFFCCCCCC.toInt())
                 }
-                
-                // Set selected indicator
-                selectedIndicator.visibility = if (isSelected) View.VISIBLE else View.GONE
             }
         }
         
@@ -118,6 +165,8 @@ class ServerAdapter(private val onServerClick: (Server) -> Unit) :
     }
     
     companion object {
+        private const val PAYLOAD_PING = "ping"
+        
         /**
          * DiffUtil for efficient RecyclerView updates
          */
@@ -0,0 +1,135 @@
+package com.hiddify.hiddifyng.core
+
+import com.hiddify.hiddifyng.database.entity.Server
+import com.hiddify.hiddifyng.utils.flow
+import com.hiddify.hiddifyng.utils.parseHost
+import com.hiddify.hiddifyng.utils.parsePort
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Flattens Server entities into the binary record layout read by native code
+ * All records share one direct ByteBuffer so JNI can read them without copying
+ * Layout must stay in sync with cpp/include/server_record.h
+ */
+object NativeServerRecords {
+    private const val MAGIC = 0x31525653 // "SVR1"
+    private const val BUFFER_HEADER_SIZE = 8
+    private const val RECORD_HEADER_SIZE = 30
+    private const val FIELD_HEADER_SIZE = 4
+    private const val MAX_FIELD_LENGTH = 0xFFFF
+
+    // Field ids (server_record::Field)
+    private const val FIELD_NAME = 0
+    private const val FIELD_PROTOCOL = 1
+    private const val FIELD_ADDRESS = 2
+    private const val FIELD_USER_ID = 3
+    private const val FIELD_PASSWORD = 4
+    private const val FIELD_SECURITY_TYPE = 5
+    private const val FIELD_TLS_SERVER_NAME = 6
+    private const val FIELD_TLS_FINGERPRINT = 7
+    private const val FIELD_NETWORK = 8
+    private const val FIELD_WS_PATH = 9
+    private const val FIELD_HEADER = 10
+    private const val FIELD_REALITY_PUBLIC_KEY = 11
+    private const val FIELD_REALITY_SHORT_ID = 12
+    private const val FIELD_REALITY_SPIDER_X = 13
+    private const val FIELD_HYSTERIA_PROTOCOL = 14
+    private const val FIELD_HYSTERIA_OBFS = 15
+    private const val FIELD_XHTTP_HOST = 16
+    private const val FIELD_XHTTP_PATH = 17
+    private const val FIELD_FLOW = 18
+
+    // Record flags (server_record::Flags)
+    private const val FLAG_TLS = 1
+    private const val FLAG_FAVORITE = 1 shl 1
+    private const val FLAG_SELECTED = 1 shl 2
+
+    /**
+     * Encode servers into a direct buffer
+     * @param servers Servers to encode, in the order native code should see them
+     * @return Direct buffer positioned at 0; its limit is the encoded length
+     */
+    fun encode(servers: List<Server>): ByteBuffer {
+        val fieldsPerServer = servers.map { collectFields(it) }
+        val totalSize = BUFFER_HEADER_SIZE + fieldsPerServer.sumOf { recordSize(it) }
+
+        val buffer = ByteBuffer.allocateDirect(totalSize).order(ByteOrder.LITTLE_ENDIAN)
+        buffer.putInt(MAGIC)
+        buffer.putInt(servers.size)
+
+        servers.forEachIndexed { index, server ->
+            val fields = fieldsPerServer[index]
+            buffer.putInt(recordSize(fields))
+            buffer.putLong(server.id)
+            buffer.putInt(resolvePort(server))
+            buffer.putInt(server.hysteriaUpMbps ?: 0)
+            buffer.putInt(server.hysteriaDownMbps ?: 0)
+            buffer.putInt(flagsOf(server))
+            buffer.putShort(fields.size.toShort())
+
+            for ((id, value) in fields) {
+                buffer.put(id.toByte())
+                buffer.put(0)
+                buffer.putShort(value.size.toShort())
+                buffer.put(value)
+            }
+        }
+
+        buffer.flip()
+        return buffer
+    }
+
+    /**
+     * Port the config should dial: the explicit port, else one embedded in the address
+     */
+    fun resolvePort(server: Server): Int {
+        return if (server.port > 0) server.port else parsePort(server.address) ?: 443
+    }
+
+    private fun recordSize(fields: List<Pair<Int, ByteArray>>): Int {
+        return RECORD_HEADER_SIZE + fields.sumOf { FIELD_HEADER_SIZE + it.second.size }
+    }
+
+    private fun flagsOf(server: Server): Int {
+        var flags = 0
+        if (server.tls) flags = flags or FLAG_TLS
+        if (server.favorite) flags = flags or FLAG_FAVORITE
+        if (server.isSelected) flags = flags or FLAG_SELECTED
+        return flags
+    }
+
+    private fun collectFields(server: Server): List<Pair<Int, ByteArray>> {
+        val fields = mutableListOf<Pair<Int, ByteArray>>()
+
+        fun add(id: Int, value: String?) {
+            if (value.isNullOrEmpty()) return
+            val bytes = value.toByteArray(Charsets.UTF_8)
+            if (bytes.size <= MAX_FIELD_LENGTH) {
+                fields.add(id to bytes)
+            }
+        }
+
+        add(FIELD_NAME, server.name)
+        add(FIELD_PROTOCOL, server.protocol.lowercase())
+        add(FIELD_ADDRESS, parseHost(server.address))
+        add(FIELD_USER_ID, server.userId)
+        add(FIELD_PASSWORD, server.password)
+        add(FIELD_SECURITY_TYPE, server.securityType)
+        add(FIELD_TLS_SERVER_NAME, server.tlsServerName)
+        add(FIELD_TLS_FINGERPRINT, server.tlsFingerprint)
+        add(FIELD_NETWORK, server.network?.lowercase())
+        add(FIELD_WS_PATH, server.wsPath)
+        add(FIELD_HEADER, server.header)
+        add(FIELD_REALITY_PUBLIC_KEY, server.realityPublicKey)
+        add(FIELD_REALITY_SHORT_ID, server.realityShortId)
+        add(FIELD_REALITY_SPIDER_X, server.realitySpiderX)
+        add(FIELD_HYSTERIA_PROTOCOL, server.hysteriaProtocol)
+        add(FIELD_HYSTERIA_OBFS, server.hysteriaObfs)
+        add(FIELD_XHTTP_HOST, server.xhttpHost)
+        add(FIELD_XHTTP_PATH, server.xhttpPath)
+        add(FIELD_FLOW, server.flow)
+
+        return fields
+    }
+}
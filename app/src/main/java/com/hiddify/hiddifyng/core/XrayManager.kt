@@ -1,17 +1,27 @@
 package com.hiddify.hiddifyng.core
 
+import android.app.ActivityManager
 import android.content.Context
 import android.util.Log
+import com.hiddify.hiddifyng.database.AppDatabase
 import com.hiddify.hiddifyng.database.entity.Server
-import com.hiddify.hiddifyng.core.protocols.ProtocolHandler
+import com.hiddify.hiddifyng.protocols.ProtocolHandler
+import com.hiddify.hiddifyng.utils.AdaptiveConnectionManager
+import com.hiddify.hiddifyng.utils.ConfigOptimizer
+import com.hiddify.hiddifyng.utils.CoroutineManager
+import com.hiddify.hiddifyng.utils.MuxTuner
+import com.hiddify.hiddifyng.utils.TunnelSampler
 import com.hiddify.hiddifyng.utils.host
 import com.hiddify.hiddifyng.utils.port
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.launch
 import kotlinx.coroutines.withContext
-import org.json.JSONObject
 import java.io.File
 import java.io.FileOutputStream
 import java.io.InputStream
+import java.nio.ByteBuffer
+import java.util.concurrent.ConcurrentHashMap
 
 /**
  * Manager for Xray core functionality
@@ -22,6 +32,48 @@ class XrayManager private constructor(private val context: Context) {
         private const val TAG = "XrayManager"
         private const val CONFIG_DIR = "xray_config"
         private const val CONFIG_FILE = "config.json"
+        private const val CONFIG_FILE_PB = "config.pb"
+        private const val BATCH_CONFIG_FILE = "batch.json"
+        private const val BATCH_CONFIG_FILE_PB = "batch.pb"
+        private const val ROUTING_DIR = "routing"
+        
+        // Per-network, per-server mux and buffer statistics of past sessions (tuning_store)
+        private const val TUNING_STORE_FILE = "tuning.bin"
+        
+        // AEAD seal rates measured once per device build (aead_bench)
+        private const val CIPHER_BENCHMARK_FILE = "cipher_benchmark.txt"
+        
+        // Local SOCKS inbound of generated configs (config_builder::kDefaultSocksPort)
+        private const val SOCKS_PORT = 10808
+        
+        // URL tests: server i of a batch is reached through 127.0.0.1:(BATCH_BASE_PORT + i)
+        private const val BATCH_BASE_PORT = 20808
+        private const val URL_TEST_URL = "http://www.gstatic.com/generate_204"
+        private const val URL_TEST_SAMPLES = 2
+        private const val URL_TEST_TIMEOUT_MS = 5000
+        private const val URL_TEST_MAX_IN_FLIGHT = 64
+        private const val URL_TEST_RESULT_STRIDE = 6
+        
+        // Throughput tests: a bounded download per server, one at a time so the
+        // servers do not split the local link between them
+        private const val THROUGHPUT_TEST_URL = "http://cachefly.cachefly.net/10mb.test"
+        private const val THROUGHPUT_TEST_BYTES = 1L * 1024 * 1024
+        private const val THROUGHPUT_TEST_MS = 3000
+        private const val THROUGHPUT_TEST_TIMEOUT_MS = 5000
+        private const val THROUGHPUT_TEST_MAX_IN_FLIGHT = 1
+        private const val THROUGHPUT_RESULT_STRIDE = 5
+        
+        // Memory the core may spend on balanced outbounds; each costs ~384 KB natively
+        private const val BALANCER_MEMORY_BUDGET = 4L * 1024 * 1024
+        private const val BALANCER_MEMORY_BUDGET_LOW_RAM = 1L * 1024 * 1024
+        
+        // Native config generator status codes (config_builder::Status)
+        private const val NATIVE_OK = 0
+        private const val NATIVE_UNSUPPORTED = -2
+        
+        init {
+            System.loadLibrary("xray-core-jni")
+        }
         
         // Singleton instance
         @Volatile
@@ -34,11 +86,278 @@ class XrayManager private constructor(private val context: Context) {
             INSTANCE ?: synchronized(this) {
                 INSTANCE ?: XrayManager(context.applicationContext).also { INSTANCE = it }
             }
+        
+        @JvmStatic
+        private external fun initXrayEnvironment(context: Context, internalDir: String): Int
+        
+        @JvmStatic
+        @JvmName("startXray")
+        private external fun nativeStartXray(configPath: String): Int
+        
+        @JvmStatic
+        @JvmName("stopXray")
+        private external fun nativeStopXray(): Int
+        
+        @JvmStatic
+        @JvmName("startBatchXray")
+        private external fun nativeStartBatchXray(configPath: String): Int
+        
+        @JvmStatic
+        @JvmName("stopBatchXray")
+        private external fun nativeStopBatchXray(): Int
+        
+        @JvmStatic
+        private external fun urlTestNative(
+            ports: IntArray,
+            url: String,
+            samples: Int,
+            timeoutMs: Int,
+            maxInFlight: Int
+        ): LongArray?
+        
+        @JvmStatic
+        private external fun throughputTestNative(
+            ports: IntArray,
+            url: String,
+            bodyBytes: Long,
+            bodyMs: Int,
+            timeoutMs: Int,
+            maxInFlight: Int
+        ): LongArray?
+        
+        @JvmStatic
+        private external fun writeNativeConfig(
+            records: ByteBuffer,
+            length: Int,
+            routingDir: String,
+            format: Int,
+            muxConcurrency: Int,
+            bufferSize: Int,
+            vmessSecurity: String,
+            outputPath: String
+        ): Int
+        
+        @JvmStatic
+        private external fun writeNativeBalancedConfig(
+            records: ByteBuffer,
+            length: Int,
+            routingDir: String,
+            format: Int,
+            memoryBudget: Long,
+            muxConcurrency: Int,
+            bufferSize: Int,
+            vmessSecurity: String,
+            outputPath: String
+        ): Int
+        
+        @JvmStatic
+        private external fun buildNativeOutbounds(
+            records: ByteBuffer,
+            length: Int,
+            muxConcurrency: Int
+        ): Array<String?>?
+        
+        @JvmStatic
+        private external fun writeNativeBatchConfig(
+            records: ByteBuffer,
+            length: Int,
+            format: Int,
+            basePort: Int,
+            outputPath: String
+        ): Int
+        
+        @JvmStatic
+        private external fun validateConfig(configPath: String): Array<String>
+        
+        @JvmStatic
+        private external fun minimizeConfig(inputPath: String, outputPath: String): LongArray?
+        
+        @JvmStatic
+        private external fun benchmarkConfigLoad(jsonPath: String, pbPath: String, iterations: Int): LongArray
+    }
+    
+    /**
+     * On-disk config format handed to the core
+     * PROTOBUF is emitted natively and skips JSON parsing at core startup
+     */
+    enum class ConfigFormat(val nativeId: Int) {
+        JSON(0),
+        PROTOBUF(1)
+    }
+    
+    /**
+     * Problem found by the native pre-launch validator
+     * @param code One of the CODE_* constants
+     * @param path Location in the config, e.g. "outbounds[0].settings.vnext[0].port"
+     */
+    data class ConfigIssue(val code: Int, val path: String, val message: String) {
+        companion object {
+            const val CODE_SYNTAX = 1
+            const val CODE_MISSING_FIELD = 2
+            const val CODE_INVALID_VALUE = 3
+            const val CODE_INVALID_USER_ID = 4
+            const val CODE_INVALID_REALITY_KEY = 5
+            const val CODE_INVALID_SHORT_ID = 6
+            const val CODE_INVALID_PORT = 7
+            const val CODE_DUPLICATE_TAG = 8
+            const val CODE_DANGLING_REFERENCE = 9
+            const val CODE_UNREADABLE = 10
+        }
+    }
+    
+    /**
+     * What the native minimizer stripped from a JSON config before launch
+     * @param parseNsBefore Native JSON parse time of the original, a proxy for core startup
+     */
+    data class ConfigMinimization(
+        val bytesBefore: Long,
+        val bytesAfter: Long,
+        val parseNsBefore: Long,
+        val parseNsAfter: Long,
+        val outboundsRemoved: Int,
+        val balancersRemoved: Int,
+        val rulesRemoved: Int,
+        val ruleEntriesRemoved: Int,
+        val dnsServersRemoved: Int,
+        val observatoryRemoved: Boolean
+    )
+    
+    /**
+     * Fetch of the URL-test target through one server
+     * @param status One of the STATUS_* constants (url_tester::Status)
+     * @param httpStatus Status code of the last response, 0 if none arrived
+     */
+    data class UrlTestResult(
+        val index: Int,
+        val status: Int,
+        val httpStatus: Int,
+        val bestNs: Long,
+        val meanNs: Long,
+        val successes: Int,
+        val attempts: Int
+    ) {
+        val passed: Boolean
+            get() = status == STATUS_OK
+        
+        /** Fastest fetch in whole milliseconds (at least 1) */
+        val latencyMs: Int
+            get() = (bestNs / 1_000_000).toInt().coerceAtLeast(1)
+        
+        companion object {
+            const val STATUS_OK = 0
+            const val STATUS_TIMEOUT = 1
+            const val STATUS_REFUSED = 2
+            const val STATUS_PROXY_FAILED = 3
+            const val STATUS_BAD_RESPONSE = 4
+            const val STATUS_ERROR = 5
+        }
+    }
+    
+    /**
+     * Burst download through one server
+     * @param status One of the UrlTestResult.STATUS_* constants (url_tester::Status)
+     * @param firstByteNs Time from the local connect to the first body byte
+     * @param bodyBytes Body bytes timed, excluding the first read that starts the clock
+     * @param bodyNs Time from the first body byte to the last
+     */
+    data class ThroughputResult(
+        val index: Int,
+        val status: Int,
+        val httpStatus: Int,
+        val firstByteNs: Long,
+        val bodyBytes: Long,
+        val bodyNs: Long
+    ) {
+        val measured: Boolean
+            get() = status == UrlTestResult.STATUS_OK && bodyNs > 0
+        
+        /** Goodput in kilobits per second, 0 if not measured */
+        val kbps: Int
+            get() = if (measured) (bodyBytes * 8_000_000 / bodyNs).toInt() else 0
     }
     
     // Current state
     private var isRunning = false
     private var currentServerId: Long = -1L
+    private var environmentReady = false
+    
+    // Live mux tuning; recommendations apply from the next start per server
+    private val muxTuner = MuxTuner()
+    private val muxConcurrency = ConcurrentHashMap<Long, Int>()
+    
+    // Mux and buffer choice per session, learned from the feedback of past sessions,
+    // and the VMess cipher the device seals fastest
+    private val configOptimizer = ConfigOptimizer(
+        File(context.filesDir, TUNING_STORE_FILE),
+        File(context.filesDir, CIPHER_BENCHMARK_FILE)
+    )
+    private val connectionMonitor by lazy {
+        AdaptiveConnectionManager(context).also { it.startMonitoring() }
+    }
+    
+    // What the running session was started with, for its feedback on stop
+    private var sessionServer: Server? = null
+    private var sessionNetworkType = AdaptiveConnectionManager.TYPE_NONE
+    private var sessionTuning: ConfigOptimizer.TunedSettings? = null
+    
+    init {
+        // Benchmark the ciphers once per device build, before the first start needs them
+        CoroutineManager.ioScope.launch { configOptimizer.cipherBenchmark }
+    }
+    
+    /**
+     * Stream and tunnel counts of the running core, updated every few seconds
+     */
+    val muxStats: StateFlow<MuxTuner.MuxStats?>
+        get() = muxTuner.stats
+    
+    // Passive RTT, window and loss of the live tunnels; no probe traffic
+    private val tunnelSampler = TunnelSampler()
+    
+    /**
+     * Kernel TCP state of the running core's tunnels to the server, updated every few seconds
+     */
+    val tunnelQuality: StateFlow<TunnelSampler.TunnelQuality?>
+        get() = tunnelSampler.quality
+    
+    /**
+     * Config format used for the next start
+     * Servers the native emitter cannot express fall back to JSON
+     */
+    @Volatile
+    var configFormat: ConfigFormat = ConfigFormat.JSON
+    
+    /**
+     * Issues that blocked the last launch; empty after a successful start
+     */
+    @Volatile
+    var lastConfigIssues: List<ConfigIssue> = emptyList()
+        private set
+    
+    /**
+     * Strip unreferenced outbounds, balancers, rules and DNS servers from JSON
+     * configs before launch
+     */
+    @Volatile
+    var minimizeConfigs: Boolean = true
+    
+    /**
+     * Savings of the last minimized launch, null if it was not minimized
+     */
+    @Volatile
+    var lastMinimization: ConfigMinimization? = null
+        private set
+    
+    /**
+     * Memory budget for balanced mode; bounds how many servers go behind the balancer
+     */
+    @Volatile
+    var balancerMemoryBudget: Long =
+        if ((context.getSystemService(Context.ACTIVITY_SERVICE) as ActivityManager).isLowRamDevice) {
+            BALANCER_MEMORY_BUDGET_LOW_RAM
+        } else {
+            BALANCER_MEMORY_BUDGET
+        }
     
     /**
      * Start Xray service with specified server
@@ -58,23 +377,29 @@ class XrayManager private constructor(private val context: Context) {
                     stopXray()
                 }
                 
-                // Generate configuration
-                val config = generateConfig(serverId)
-                if (config.isEmpty()) {
-                    Log.e(TAG, "Failed to generate configuration for server ID: $serverId")
+                val server = getServerById(serverId)
+                if (server == null) {
+                    Log.e(TAG, "Server not found: $serverId")
                     return@withContext false
                 }
                 
-                // Write configuration to file
-                writeConfigFile(config)
+                // Generate the config natively, as protobuf when enabled and JSON otherwise
+                val tuning = tuneSession(server)
+                val fileName = if (configFormat == ConfigFormat.PROTOBUF) CONFIG_FILE_PB else CONFIG_FILE
+                val configFile = writeNativeConfigFile(server, configFormat, configFile(fileName), tuning)
+                if (configFile == null) {
+                    Log.e(TAG, "Failed to generate configuration for server ID: $serverId")
+                    return@withContext false
+                }
                 
                 // Start Xray service
-                val result = startXrayWithConfig(config)
+                val result = startXrayWithConfig(configFile)
                 
                 // Handle the result
                 return@withContext if (result) {
                     isRunning = true
                     currentServerId = serverId
+                    startSession(server, tuning)
                     Log.i(TAG, "Xray started successfully with server ID: $serverId")
                     true
                 } else {
@@ -88,6 +413,63 @@ class XrayManager private constructor(private val context: Context) {
         }
     }
     
+    /**
+     * Start Xray with the best servers behind a leastPing balancer
+     * The core health-checks them itself and fails over without a restart
+     * @param serverIds Server IDs ordered best first; the budget decides how many are used
+     * @return true if started successfully, false otherwise
+     */
+    suspend fun startBalancedXray(serverIds: List<Long>): Boolean {
+        return withContext(Dispatchers.IO) {
+            try {
+                // Keep the caller's best-first order; servers deleted meanwhile drop out
+                val servers = serverIds.mapNotNull { getServerById(it) }
+                if (servers.size < serverIds.size) {
+                    Log.w(TAG, "${serverIds.size - servers.size} of ${serverIds.size} balanced servers no longer exist")
+                }
+                if (servers.isEmpty()) {
+                    Log.e(TAG, "No servers available for balanced configuration")
+                    return@withContext false
+                }
+                
+                if (isRunning) {
+                    stopXray()
+                }
+                
+                // Traffic mostly stays on the best server, so it decides the tuning
+                val tuning = tuneSession(servers.first())
+                val records = NativeServerRecords.encode(servers)
+                val output = configFile(if (configFormat == ConfigFormat.PROTOBUF) CONFIG_FILE_PB else CONFIG_FILE)
+                val routingDir = File(context.filesDir, ROUTING_DIR)
+                val count = writeNativeBalancedConfig(
+                    records, records.limit(), routingDir.absolutePath,
+                    configFormat.nativeId, balancerMemoryBudget,
+                    tuning.muxConcurrency, tuning.bufferSize, configOptimizer.preferredAead.orEmpty(),
+                    output.absolutePath
+                )
+                if (count <= 0) {
+                    // Nothing expressible natively; run the best server alone
+                    Log.w(TAG, "Balanced config generation failed with status $count")
+                    return@withContext startXray(servers.first().id)
+                }
+                
+                return@withContext if (startXrayWithConfig(output)) {
+                    isRunning = true
+                    currentServerId = servers.first().id
+                    startSession(servers.first(), tuning)
+                    Log.i(TAG, "Xray started with $count balanced servers")
+                    true
+                } else {
+                    Log.e(TAG, "Failed to start Xray in balanced mode")
+                    false
+                }
+            } catch (e: Exception) {
+                Log.e(TAG, "Error starting balanced Xray", e)
+                return@withContext false
+            }
+        }
+    }
+    
     /**
      * Stop Xray service
      * @return true if stopped successfully, false otherwise
@@ -95,6 +477,7 @@ class XrayManager private constructor(private val context: Context) {
     suspend fun stopXray(): Boolean {
         return withContext(Dispatchers.IO) {
             try {
+                endSession()
                 val result = stopXrayService()
                 
                 return@withContext if (result) {
@@ -129,6 +512,47 @@ class XrayManager private constructor(private val context: Context) {
         return currentServerId
     }
     
+    /**
+     * Measure core startup with the JSON and protobuf forms of one config
+     * Both forms are emitted natively from the same server and routing lists,
+     * so the difference is purely the core's config loading cost
+     * @param serverId Server to build the config for
+     * @param iterations Number of loads per format; the median is reported
+     * @return Pair of (JSON, protobuf) median load times in nanoseconds, or null on failure
+     */
+    suspend fun benchmarkConfigFormats(serverId: Long, iterations: Int = 5): Pair<Long, Long>? =
+        withContext(Dispatchers.IO) {
+            try {
+                if (!ensureEnvironment()) {
+                    return@withContext null
+                }
+                
+                val server = getServerById(serverId) ?: return@withContext null
+                val untuned = ConfigOptimizer.TunedSettings(0, 0)
+                val jsonFile = writeNativeConfigFile(
+                    server, ConfigFormat.JSON, File(context.cacheDir, "benchmark.json"), untuned, fallback = false
+                ) ?: return@withContext null
+                val pbFile = writeNativeConfigFile(
+                    server, ConfigFormat.PROTOBUF, File(context.cacheDir, "benchmark.pb"), untuned, fallback = false
+                ) ?: return@withContext null
+                
+                val results = benchmarkConfigLoad(jsonFile.absolutePath, pbFile.absolutePath, iterations)
+                jsonFile.delete()
+                pbFile.delete()
+                
+                if (results[0] < 0 || results[1] < 0) {
+                    Log.e(TAG, "Config load benchmark failed")
+                    return@withContext null
+                }
+                
+                Log.i(TAG, "Config load: JSON ${results[0] / 1000} us, protobuf ${results[1] / 1000} us")
+                return@withContext Pair(results[0], results[1])
+            } catch (e: Exception) {
+                Log.e(TAG, "Error benchmarking config formats", e)
+                return@withContext null
+            }
+        }
+    
     /**
      * Update routing rules without restarting
      * @return true if updated successfully, false otherwise
@@ -138,117 +562,354 @@ class XrayManager private constructor(private val context: Context) {
         return@withContext false
     }
     
-    /**
-     * Generate Xray configuration for a server
-     * @param serverId ID of the server
-     * @return JSON string configuration, or empty string if failed
-     */
-    private suspend fun generateConfig(serverId: Long): String = withContext(Dispatchers.IO) {
-        try {
-            // Get server from database
-            val server = getServerById(serverId) ?: return@withContext ""
-            
-            // Create protocol handler for server
-            val protocolHandler = getProtocolHandler(server)
-            
-            // Generate full configuration
-            val config = generateFullConfig(server, protocolHandler)
-            
-            return@withContext config.toString()
-        } catch (e: Exception) {
-            Log.e(TAG, "Error generating configuration", e)
-            return@withContext ""
-        }
-    }
-    
     /**
      * Get server by ID from database
      * @param serverId ID of the server
      * @return Server object, or null if not found
      */
     private suspend fun getServerById(serverId: Long): Server? = withContext(Dispatchers.IO) {
-        // This would be implemented to get server from database
-        return@withContext createDummyServer()
+        return@withContext AppDatabase.getInstance(context).serverDao().getServerByIdSync(serverId)
     }
     
     /**
-     * Create a protocol handler for server
-     * @param server Server object
-     * @return ProtocolHandler for the server
+     * Generate the config natively, without a JSON intermediate for PROTOBUF
+     * @param server Server to connect through
+     * @param format Output format
+     * @param output Destination file
+     * @param tuning Mux concurrency and socket buffers; 0 keeps mux off and kernel buffers
+     * @param fallback When the native builder cannot express the server, retry a PROTOBUF
+     * request as native JSON and a JSON one with the protocol's own handler
+     * @return The written file (a JSON sibling of output after a fallback), or null if the
+     * server is unsupported or generation failed
      */
-    private fun getProtocolHandler(server: Server): ProtocolHandler {
-        // This would be implemented to create appropriate protocol handler
-        return object : ProtocolHandler() {
-            override fun getProtocolName(): String = "dummy"
-            
-            override fun createOutboundConfig(): JSONObject {
-                return JSONObject()
+    private fun writeNativeConfigFile(
+        server: Server,
+        format: ConfigFormat,
+        output: File,
+        tuning: ConfigOptimizer.TunedSettings,
+        fallback: Boolean = true
+    ): File? {
+        val records = NativeServerRecords.encode(listOf(server))
+        val routingDir = File(context.filesDir, ROUTING_DIR)
+        
+        return when (val status = writeNativeConfig(
+            records, records.limit(), routingDir.absolutePath, format.nativeId,
+            tuning.muxConcurrency, tuning.bufferSize, configOptimizer.preferredAead.orEmpty(),
+            output.absolutePath
+        )) {
+            NATIVE_OK -> {
+                Log.d(TAG, "Native $format configuration written to ${output.absolutePath}")
+                output
+            }
+            NATIVE_UNSUPPORTED -> {
+                Log.i(TAG, "Native $format generation does not support ${server.protocol}/${server.network}")
+                val json = File(output.parentFile, "${output.nameWithoutExtension}.json")
+                when {
+                    !fallback -> null
+                    format == ConfigFormat.PROTOBUF -> writeNativeConfigFile(server, ConfigFormat.JSON, json, tuning)
+                    else -> writeHandlerConfigFile(server, json)
+                }
+            }
+            else -> {
+                Log.e(TAG, "Native config generation failed with status $status")
+                null
             }
         }
     }
     
     /**
-     * Generate full Xray configuration
-     * @param server Server object
-     * @param protocolHandler Protocol handler for the server
-     * @return JSON configuration
+     * Config from the protocol's own handler, for servers the native builder cannot express
+     * (Hysteria); it is validated like any JSON config before launch
+     * @return The written file, or null if no handler produced a config
      */
-    private fun generateFullConfig(server: Server, protocolHandler: ProtocolHandler): JSONObject {
-        val config = JSONObject()
+    private fun writeHandlerConfigFile(server: Server, output: File): File? {
+        val config = try {
+            ProtocolHandler.getHandler(server.protocol).generateConfig(server)
+        } catch (e: IllegalArgumentException) {
+            Log.e(TAG, "No config generator for ${server.protocol}/${server.network}")
+            return null
+        }
+        if (config.isBlank() || config == "{}") {
+            Log.e(TAG, "${server.protocol} handler produced no configuration for ${server.name}")
+            return null
+        }
         
-        // This would be implemented to generate full configuration
+        output.writeText(config)
+        Log.d(TAG, "${server.protocol} handler configuration written to ${output.absolutePath}")
+        return output
+    }
+    
+    /**
+     * Mux concurrency and socket buffers to generate for a server on the current network
+     */
+    private fun tuneSession(server: Server): ConfigOptimizer.TunedSettings {
+        // One stream per tunnel is what running without mux already gives
+        val observed = muxConcurrency[server.id]?.let { if (it > 1) it else 0 }
+        sessionNetworkType = connectionMonitor.connectionType.value
+        return configOptimizer.tuneSession(
+            server, sessionNetworkType, connectionMonitor.connectionQuality.value, observed
+        )
+    }
+    
+    /**
+     * Observe the freshly started core
+     */
+    private fun startSession(server: Server, tuning: ConfigOptimizer.TunedSettings) {
+        sessionServer = server
+        sessionTuning = tuning
+        val serverPort = NativeServerRecords.resolvePort(server)
+        muxTuner.start(SOCKS_PORT, serverPort, tuning.muxConcurrency.coerceAtLeast(1))
+        tunnelSampler.start(serverPort)
+    }
+    
+    /**
+     * Stop observing the core, keep the tuner's last recommendation for the server
+     * that is being stopped and report how the session's settings performed
+     */
+    private fun endSession() {
+        muxTuner.stop()
+        tunnelSampler.stop()
+        val recommended = muxTuner.recommendedConcurrency.value
+        if (currentServerId >= 0 && recommended > 0) {
+            muxConcurrency[currentServerId] = recommended
+        }
+        
+        val server = sessionServer
+        val tuning = sessionTuning
+        val totals = tunnelSampler.sessionTotals
+        sessionServer = null
+        sessionTuning = null
+        if (server == null || tuning == null || totals == null) return
         
-        return config
+        configOptimizer.recordSessionFeedback(
+            server, sessionNetworkType, tuning, totals.goodputKbps, totals.rttMs, totals.retransmitRate
+        )
+        Log.i(TAG, "Session on ${server.name}: ${totals.goodputKbps.toInt()} kbps, " +
+                "RTT ${totals.rttMs.toInt()} ms with mux ${tuning.muxConcurrency}, " +
+                "buffers ${tuning.bufferSize / 1024} KB")
     }
     
     /**
-     * Write configuration to file
-     * @param config JSON string configuration
+     * Get a file in the config directory, creating the directory if needed
      */
-    private fun writeConfigFile(config: String) {
-        try {
-            val configDir = File(context.filesDir, CONFIG_DIR)
-            configDir.mkdirs()
-            
-            val configFile = File(configDir, CONFIG_FILE)
-            configFile.writeText(config)
-            
-            Log.d(TAG, "Configuration written to ${configFile.absolutePath}")
-        } catch (e: Exception) {
-            Log.e(TAG, "Error writing configuration file", e)
+    private fun configFile(name: String): File {
+        val configDir = File(context.filesDir, CONFIG_DIR)
+        configDir.mkdirs()
+        return File(configDir, name)
+    }
+    
+    /**
+     * Prepare the native Xray environment once per process
+     * @return true if the core binary is ready to run
+     */
+    private fun ensureEnvironment(): Boolean {
+        if (!environmentReady) {
+            environmentReady = initXrayEnvironment(context, context.filesDir.absolutePath) == 0
         }
+        return environmentReady
     }
     
     /**
      * Start Xray with configuration
-     * @param config JSON string configuration
+     * The core picks the loader from the file extension (.json or .pb)
+     * @param configFile Config file to run
      * @return true if started successfully, false otherwise
      */
-    private fun startXrayWithConfig(config: String): Boolean {
-        // This would be implemented to start Xray via JNI
-        return true
+    private fun startXrayWithConfig(configFile: File): Boolean {
+        if (!ensureEnvironment()) {
+            Log.e(TAG, "Xray environment is not ready")
+            return false
+        }
+        
+        // Protobuf configs are built from validated records natively;
+        // JSON ones are checked here instead of by a failed core launch
+        if (configFile.extension == "json") {
+            val issues = checkConfig(configFile)
+            lastConfigIssues = issues
+            if (issues.isNotEmpty()) {
+                issues.forEach { Log.e(TAG, "Invalid config at ${it.path}: ${it.message}") }
+                return false
+            }
+            lastMinimization = if (minimizeConfigs) minimize(configFile) else null
+        } else {
+            lastConfigIssues = emptyList()
+            lastMinimization = null
+        }
+        
+        return nativeStartXray(configFile.absolutePath) == 0
     }
     
     /**
-     * Stop Xray service
-     * @return true if stopped successfully, false otherwise
+     * Run the native validator over a JSON config file
+     * @return Issues found, empty if the config can be launched
      */
-    private fun stopXrayService(): Boolean {
-        // This would be implemented to stop Xray via JNI
-        return true
+    fun checkConfig(configFile: File): List<ConfigIssue> {
+        val flat = validateConfig(configFile.absolutePath)
+        return (flat.indices step 3).map { i ->
+            ConfigIssue(flat[i].toInt(), flat[i + 1], flat[i + 2])
+        }
+    }
+    
+    /**
+     * Generate the proxy outbound of every server in one native pass
+     * Each outbound is a JSON object tagged "proxy", as in single-server configs
+     * @param muxConcurrency 0 leaves mux disabled
+     * @return One outbound per server, in order; null where the server cannot be
+     * expressed natively and needs its Kotlin protocol handler
+     */
+    fun buildOutbounds(servers: List<Server>, muxConcurrency: Int = 0): List<String?> {
+        if (servers.isEmpty()) return emptyList()
+        val records = NativeServerRecords.encode(servers)
+        val outbounds = buildNativeOutbounds(records, records.limit(), muxConcurrency)
+        if (outbounds == null) {
+            Log.e(TAG, "Native outbound generation rejected the server records")
+            return List(servers.size) { null }
+        }
+        return outbounds.toList()
+    }
+    
+    /**
+     * Write a config that reaches every server through its own local SOCKS port
+     * Server i listens on basePort + i; servers that cannot be expressed natively
+     * leave their port unused
+     * @return The config file, or null if no server could be included
+     */
+    fun writeBatchConfig(servers: List<Server>, basePort: Int): File? {
+        if (servers.isEmpty()) return null
+        val records = NativeServerRecords.encode(servers)
+        val output = configFile(
+            if (configFormat == ConfigFormat.PROTOBUF) BATCH_CONFIG_FILE_PB else BATCH_CONFIG_FILE
+        )
+        val count = writeNativeBatchConfig(
+            records, records.limit(), configFormat.nativeId, basePort, output.absolutePath
+        )
+        if (count <= 0) {
+            Log.w(TAG, "Batch config generation failed with status $count")
+            return null
+        }
+        Log.d(TAG, "Batch config with $count of ${servers.size} servers written to ${output.absolutePath}")
+        return output
+    }
+    
+    /**
+     * Measure latency through the tunnel of every server at once
+     * A throwaway core gets one SOCKS inbound per server (see writeBatchConfig), the
+     * URL is fetched through all of them concurrently and the core is stopped again;
+     * the running tunnel is left alone
+     * @param url Plain http:// URL that answers 204
+     * @return One result per server in order, empty if the test could not run
+     */
+    suspend fun urlTest(
+        servers: List<Server>,
+        url: String = URL_TEST_URL,
+        samples: Int = URL_TEST_SAMPLES
+    ): List<UrlTestResult> = withContext(Dispatchers.IO) {
+        if (servers.isEmpty() || !ensureEnvironment()) return@withContext emptyList()
+        
+        val config = writeBatchConfig(servers, BATCH_BASE_PORT) ?: return@withContext emptyList()
+        if (nativeStartBatchXray(config.absolutePath) != 0) {
+            Log.e(TAG, "Failed to start the batch core")
+            return@withContext emptyList()
+        }
+        
+        val rows = try {
+            urlTestNative(
+                IntArray(servers.size) { BATCH_BASE_PORT + it },
+                url,
+                samples,
+                URL_TEST_TIMEOUT_MS,
+                URL_TEST_MAX_IN_FLIGHT
+            )
+        } catch (e: Exception) {
+            Log.e(TAG, "URL test failed", e)
+            null
+        } finally {
+            nativeStopBatchXray()
+        } ?: return@withContext emptyList()
+        
+        (0 until rows.size / URL_TEST_RESULT_STRIDE).map { i ->
+            val row = i * URL_TEST_RESULT_STRIDE
+            UrlTestResult(
+                index = i,
+                status = rows[row].toInt(),
+                httpStatus = rows[row + 1].toInt(),
+                bestNs = rows[row + 2],
+                meanNs = rows[row + 3],
+                successes = rows[row + 4].toInt(),
+                attempts = rows[row + 5].toInt()
+            )
+        }
     }
     
     /**
-     * Create dummy server for testing
-     * @return Dummy server
+     * Measure goodput through the tunnel of each server
+     * Runs a throwaway batch core like urlTest and downloads a bounded burst of the URL
+     * through each server in turn
+     * @param url Plain http:// URL of a large file that answers 200
+     * @return One result per server in order, empty if the test could not run
      */
-    private fun createDummyServer(): Server {
-        return Server(
-            id = 1,
-            name = "Dummy Server",
-            protocol = "vless",
-            address = "example.com:443",
-            port = 443
+    suspend fun throughputTest(
+        servers: List<Server>,
+        url: String = THROUGHPUT_TEST_URL
+    ): List<ThroughputResult> = withContext(Dispatchers.IO) {
+        if (servers.isEmpty() || !ensureEnvironment()) return@withContext emptyList()
+        
+        val config = writeBatchConfig(servers, BATCH_BASE_PORT) ?: return@withContext emptyList()
+        if (nativeStartBatchXray(config.absolutePath) != 0) {
+            Log.e(TAG, "Failed to start the batch core")
+            return@withContext emptyList()
+        }
+        
+        val rows = try {
+            throughputTestNative(
+                IntArray(servers.size) { BATCH_BASE_PORT + it },
+                url,
+                THROUGHPUT_TEST_BYTES,
+                THROUGHPUT_TEST_MS,
+                THROUGHPUT_TEST_TIMEOUT_MS,
+                THROUGHPUT_TEST_MAX_IN_FLIGHT
+            )
+        } catch (e: Exception) {
+            Log.e(TAG, "Throughput test failed", e)
+            null
+        } finally {
+            nativeStopBatchXray()
+        } ?: return@withContext emptyList()
+        
+        (0 until rows.size / THROUGHPUT_RESULT_STRIDE).map { i ->
+            val row = i * THROUGHPUT_RESULT_STRIDE
+            ThroughputResult(
+                index = i,
+                status = rows[row].toInt(),
+                httpStatus = rows[row + 1].toInt(),
+                firstByteNs = rows[row + 2],
+                bodyBytes = rows[row + 3],
+                bodyNs = rows[row + 4]
+            )
+        }
+    }
+    
+    /**
+     * Minimize a JSON config in place
+     * @return Savings, or null if the file was left as it was
+     */
+    fun minimize(configFile: File): ConfigMinimization? {
+        val stats = minimizeConfig(configFile.absolutePath, configFile.absolutePath) ?: return null
+        val result = ConfigMinimization(
+            stats[0], stats[1], stats[2], stats[3],
+            stats[4].toInt(), stats[5].toInt(), stats[6].toInt(), stats[7].toInt(), stats[8].toInt(),
+            stats[9] != 0L
         )
+        Log.d(TAG, "Minimized config: ${result.bytesBefore} -> ${result.bytesAfter} bytes, " +
+            "parse ${result.parseNsBefore / 1000} -> ${result.parseNsAfter / 1000} us")
+        return result
+    }
+    
+    /**
+     * Stop Xray service
+     * @return true if stopped successfully, false otherwise
+     */
+    private fun stopXrayService(): Boolean {
+        return nativeStopXray() == 0
     }
 }
\ No newline at end of file
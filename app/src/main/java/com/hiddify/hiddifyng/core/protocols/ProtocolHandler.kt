@@ -1,6 +1,7 @@
 package com.hiddify.hiddifyng.core.protocols
 
 import com.hiddify.hiddifyng.database.entity.Server
+import com.hiddify.hiddifyng.utils.ShareLinkCodec
 import org.json.JSONObject
 
 /**
@@ -26,8 +27,8 @@ abstract class ProtocolHandler {
      * @return Server object with extracted parameters, or null if parsing failed
      */
     open fun parseUri(uri: String): Server? {
-        // Base implementation, to be overridden by subclasses
-        return null
+        // All protocols share the native share-link codec
+        return ShareLinkCodec.parse(uri)
     }
     
     /**
@@ -36,8 +37,8 @@ abstract class ProtocolHandler {
      * @return URI string, or null if generation failed
      */
     open fun generateUri(server: Server): String? {
-        // Base implementation, to be overridden by subclasses
-        return null
+        // All protocols share the native share-link codec
+        return ShareLinkCodec.generate(server)
     }
     
     /**
@@ -21,7 +21,7 @@ import kotlinx.coroutines.launch
  */
 @Database(
     entities = [Server::class, ServerGroup::class, AppSettings::class],
-    version = 1,
+    version = 6,
     exportSchema = true
 )
 abstract class AppDatabase : RoomDatabase() {
@@ -45,6 +45,7 @@ abstract class AppDatabase : RoomDatabase() {
                     AppDatabase::class.java,
                     "hiddify_database"
                 )
+                    .addMigrations(MIGRATION_1_2, MIGRATION_2_3, MIGRATION_3_4, MIGRATION_4_5, MIGRATION_5_6)
                     .fallbackToDestructiveMigration()
                     .addCallback(object : RoomDatabase.Callback() {
                         override fun onCreate(db: SupportSQLiteDatabase) {
@@ -74,7 +75,40 @@ abstract class AppDatabase : RoomDatabase() {
          */
         private val MIGRATION_1_2 = object : Migration(1, 2) {
             override fun migrate(database: SupportSQLiteDatabase) {
-                // Migration code will be added when needed
+                // TLS handshake phases measured by the ping worker
+                database.execSQL("ALTER TABLE servers ADD COLUMN tlsConnectMs INTEGER")
+                database.execSQL("ALTER TABLE servers ADD COLUMN tlsHelloMs INTEGER")
+                database.execSQL("ALTER TABLE servers ADD COLUMN tlsHandshakeMs INTEGER")
+            }
+        }
+        
+        private val MIGRATION_2_3 = object : Migration(2, 3) {
+            override fun migrate(database: SupportSQLiteDatabase) {
+                // Per-server latency histogram
+                database.execSQL("ALTER TABLE servers ADD COLUMN latencySketch BLOB")
+            }
+        }
+        
+        private val MIGRATION_3_4 = object : Migration(3, 4) {
+            override fun migrate(database: SupportSQLiteDatabase) {
+                // Throughput estimate from burst downloads through the tunnel
+                database.execSQL("ALTER TABLE servers ADD COLUMN bandwidthKbps INTEGER")
+                database.execSQL("ALTER TABLE servers ADD COLUMN bandwidthMeasuredAt INTEGER")
+            }
+        }
+        
+        internal val MIGRATION_4_5 = object : Migration(4, 5) {
+            override fun migrate(database: SupportSQLiteDatabase) {
+                // UDP path quality of QUIC servers
+                database.execSQL("ALTER TABLE servers ADD COLUMN udpLossPercent INTEGER")
+                database.execSQL("ALTER TABLE servers ADD COLUMN udpJitterMs INTEGER")
+            }
+        }
+        
+        internal val MIGRATION_5_6 = object : Migration(5, 6) {
+            override fun migrate(database: SupportSQLiteDatabase) {
+                // URL test latency, kept apart from the probe ping
+                database.execSQL("ALTER TABLE servers ADD COLUMN urlTestMs INTEGER")
             }
         }
     }
@@ -0,0 +1,161 @@
+package com.hiddify.hiddifyng.database
+
+import android.content.Context
+import android.os.SystemClock
+import android.util.Log
+import androidx.room.Room
+import androidx.room.withTransaction
+import com.hiddify.hiddifyng.database.entity.Server
+
+/**
+ * Collects probe results of a sweep and writes them in one transaction
+ * Each row update on its own is an implicit transaction with its own journal sync, which on
+ * big server lists costs more than the probes did. Results are kept per server, later ones
+ * replacing earlier ones of the same kind, and flushed together; Room's prepared statement
+ * for each kind of update is rebound per row inside the transaction
+ * @param flushIntervalMs How long results may wait before flushIfDue writes them
+ */
+class ProbeResultWriter(
+    private val database: AppDatabase,
+    private val flushIntervalMs: Long = FLUSH_INTERVAL_MS
+) {
+    companion object {
+        private const val TAG = "ProbeResultWriter"
+        
+        // Long enough that a sweep usually flushes once, short enough to survive being killed
+        const val FLUSH_INTERVAL_MS = 10_000L
+        
+        private const val BENCHMARK_DATABASE = "probe_write_benchmark"
+        
+        /**
+         * Time writing one ping per server row by row and as one batch
+         * Uses a scratch database file so the real one is untouched and journal syncs are counted
+         * @param count Number of server rows
+         * @return Pair of (row by row, batched) nanoseconds, or null on failure
+         */
+        suspend fun benchmarkWrites(context: Context, count: Int = 1000): Pair<Long, Long>? {
+            context.deleteDatabase(BENCHMARK_DATABASE)
+            val scratch = Room.databaseBuilder(context.applicationContext, AppDatabase::class.java, BENCHMARK_DATABASE)
+                .build()
+            return try {
+                val dao = scratch.serverDao()
+                val ids = dao.insertAll(List(count) { Server(name = "benchmark $it", address = "10.0.0.1") })
+                
+                val rowStart = SystemClock.elapsedRealtimeNanos()
+                var changed = 0
+                for ((i, id) in ids.withIndex()) {
+                    changed += dao.updatePing(id, 100 + i % 50)
+                }
+                val rowNs = SystemClock.elapsedRealtimeNanos() - rowStart
+                
+                val writer = ProbeResultWriter(scratch)
+                val batchStart = SystemClock.elapsedRealtimeNanos()
+                for ((i, id) in ids.withIndex()) {
+                    writer.ping(id, 200 + i % 50)
+                }
+                writer.flush()
+                val batchNs = SystemClock.elapsedRealtimeNanos() - batchStart
+                
+                // A timing of writes that changed nothing measures nothing
+                val stored = ids.withIndex().count { (i, id) -> dao.getServerByIdSync(id)?.avgPing == 200 + i % 50 }
+                if (changed != count || stored != count) {
+                    Log.e(TAG, "Write benchmark changed $changed rows row by row and $stored batched of $count")
+                    return null
+                }
+                
+                Log.i(TAG, "Writing $count pings: row by row ${rowNs / 1_000_000} ms, " +
+                        "batched ${batchNs / 1_000_000} ms")
+                Pair(rowNs, batchNs)
+            } catch (e: Exception) {
+                Log.e(TAG, "Write benchmark failed", e)
+                null
+            } finally {
+                scratch.close()
+                context.deleteDatabase(BENCHMARK_DATABASE)
+            }
+        }
+    }
+    
+    /**
+     * Everything a sweep learned about one server; null fields are left alone
+     */
+    private class Pending {
+        var ping: Int? = null
+        var latencySketch: ByteArray? = null
+        var tlsConnectMs: Int? = null
+        var tlsHelloMs: Int = 0
+        var tlsHandshakeMs: Int? = null
+        var bandwidthKbps: Int? = null
+        var bandwidthMeasuredAt: Long = 0
+        var udpLossPercent: Int? = null
+        var udpJitterMs: Int = 0
+        var urlTestMs: Int? = null
+    }
+    
+    private val lock = Any()
+    private var pending = LinkedHashMap<Long, Pending>()
+    private var lastFlush = SystemClock.elapsedRealtime()
+    
+    fun ping(serverId: Long, ping: Int) = update(serverId) { it.ping = ping }
+    
+    fun latencySketch(serverId: Long, sketch: ByteArray) = update(serverId) { it.latencySketch = sketch }
+    
+    fun tlsTiming(serverId: Long, connectMs: Int, helloMs: Int, handshakeMs: Int?) = update(serverId) {
+        it.tlsConnectMs = connectMs
+        it.tlsHelloMs = helloMs
+        it.tlsHandshakeMs = handshakeMs
+    }
+    
+    fun bandwidth(serverId: Long, kbps: Int, measuredAt: Long) = update(serverId) {
+        it.bandwidthKbps = kbps
+        it.bandwidthMeasuredAt = measuredAt
+    }
+    
+    fun udpStats(serverId: Long, lossPercent: Int, jitterMs: Int) = update(serverId) {
+        it.udpLossPercent = lossPercent
+        it.udpJitterMs = jitterMs
+    }
+    
+    fun urlTest(serverId: Long, latencyMs: Int) = update(serverId) { it.urlTestMs = latencyMs }
+    
+    private fun update(serverId: Long, change: (Pending) -> Unit) {
+        synchronized(lock) {
+            change(pending.getOrPut(serverId) { Pending() })
+        }
+    }
+    
+    /**
+     * Flush if results have waited flushIntervalMs since the last flush
+     */
+    suspend fun flushIfDue() {
+        if (SystemClock.elapsedRealtime() - lastFlush >= flushIntervalMs) flush()
+    }
+    
+    /**
+     * Write everything collected so far in one transaction
+     * @return Number of servers written
+     */
+    suspend fun flush(): Int {
+        val batch = synchronized(lock) {
+            lastFlush = SystemClock.elapsedRealtime()
+            pending.also { pending = LinkedHashMap() }
+        }
+        if (batch.isEmpty()) return 0
+        
+        val started = SystemClock.elapsedRealtimeNanos()
+        val dao = database.serverDao()
+        database.withTransaction {
+            for ((id, result) in batch) {
+                result.ping?.let { dao.updatePing(id, it) }
+                result.latencySketch?.let { dao.updateLatencySketch(id, it) }
+                result.tlsConnectMs?.let { dao.updateTlsTiming(id, it, result.tlsHelloMs, result.tlsHandshakeMs) }
+                result.bandwidthKbps?.let { dao.updateBandwidth(id, it, result.bandwidthMeasuredAt) }
+                result.udpLossPercent?.let { dao.updateUdpStats(id, it, result.udpJitterMs) }
+                result.urlTestMs?.let { dao.updateUrlTest(id, it) }
+            }
+        }
+        Log.d(TAG, "Wrote probe results of ${batch.size} servers in " +
+                "${(SystemClock.elapsedRealtimeNanos() - started) / 1_000_000} ms")
+        return batch.size
+    }
+}
@@ -15,9 +15,12 @@ interface ServerDao {
     @Query("SELECT * FROM server WHERE id = :serverId")
     fun getServerById(serverId: Long): LiveData<Server?>
     
-    @Query("SELECT * FROM server WHERE id = :serverId")
+    @Query("SELECT * FROM servers WHERE id = :serverId")
     suspend fun getServerByIdSync(serverId: Long): Server?
     
+    @Query("SELECT * FROM servers ORDER BY name ASC")
+    suspend fun getAllServersSync(): List<Server>
+    
     @Query("SELECT * FROM server WHERE groupId = :groupId ORDER BY name ASC")
     fun getServersByGroup(groupId: Long): LiveData<List<Server>>
     
@@ -42,6 +45,22 @@ interface ServerDao {
     @Query("DELETE FROM server WHERE groupId = :groupId")
     suspend fun deleteByGroup(groupId: Long)
     
-    @Query("UPDATE server SET ping = :ping WHERE id = :serverId")
-    suspend fun updatePing(serverId: Long, ping: Int)
+    /** @return Number of rows changed */
+    @Query("UPDATE servers SET avgPing = :ping WHERE id = :serverId")
+    suspend fun updatePing(serverId: Long, ping: Int): Int
+    
+    @Query("UPDATE servers SET tlsConnectMs = :connectMs, tlsHelloMs = :helloMs, tlsHandshakeMs = :handshakeMs WHERE id = :serverId")
+    suspend fun updateTlsTiming(serverId: Long, connectMs: Int, helloMs: Int, handshakeMs: Int?)
+    
+    @Query("UPDATE servers SET latencySketch = :sketch WHERE id = :serverId")
+    suspend fun updateLatencySketch(serverId: Long, sketch: ByteArray?)
+    
+    @Query("UPDATE servers SET bandwidthKbps = :kbps, bandwidthMeasuredAt = :measuredAt WHERE id = :serverId")
+    suspend fun updateBandwidth(serverId: Long, kbps: Int, measuredAt: Long)
+    
+    @Query("UPDATE servers SET udpLossPercent = :lossPercent, udpJitterMs = :jitterMs WHERE id = :serverId")
+    suspend fun updateUdpStats(serverId: Long, lossPercent: Int, jitterMs: Int)
+    
+    @Query("UPDATE servers SET urlTestMs = :latencyMs WHERE id = :serverId")
+    suspend fun updateUrlTest(serverId: Long, latencyMs: Int)
 }
\ No newline at end of file
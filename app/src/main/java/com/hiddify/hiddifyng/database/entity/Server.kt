@@ -53,6 +53,25 @@ data class Server(
     var avgPing: Int? = null,
     var extraParams: String? = null,
     
+    // TLS handshake phases from the last probe, in milliseconds from connect start
+    var tlsConnectMs: Int? = null,
+    var tlsHelloMs: Int? = null,
+    var tlsHandshakeMs: Int? = null,
+    
+    // Latency histogram merged across probe runs (see LatencySketch)
+    var latencySketch: ByteArray? = null,
+    
+    // Rolling goodput estimate through the tunnel and when it was last measured
+    var bandwidthKbps: Int? = null,
+    var bandwidthMeasuredAt: Long? = null,
+    
+    // QUIC servers: loss and jitter of the last UDP probe train
+    var udpLossPercent: Int? = null,
+    var udpJitterMs: Int? = null,
+    
+    // Last URL test: a whole HTTP fetch through the tunnel, in milliseconds
+    var urlTestMs: Int? = null,
+    
     // Status flags
     var favorite: Boolean = false,
     var isSelected: Boolean = false,
@@ -64,4 +83,34 @@ data class Server(
      */
     val displayName: String
         get() = if (name.isNotEmpty()) name else address
+    
+    /**
+     * The generated equals/hashCode would compare latencySketch by reference,
+     * so a server reloaded from the database never equals the one in the list;
+     * compare the sketch by content and everything else field by field
+     */
+    override fun equals(other: Any?): Boolean {
+        if (this === other) return true
+        if (other !is Server) return false
+        return fields() == other.fields() && latencySketch.contentEquals(other.latencySketch)
+    }
+    
+    override fun hashCode(): Int = 31 * fields().hashCode() + latencySketch.contentHashCode()
+    
+    /** Every constructor property except latencySketch */
+    private fun fields(): List<Any?> = listOf(
+        id, name, protocol, address, port,
+        userId, password, securityType,
+        tls, tlsServerName, tlsFingerprint,
+        network, wsPath, header,
+        realityPublicKey, realityShortId, realitySpiderX,
+        hysteriaProtocol, hysteriaObfs, hysteriaUpMbps, hysteriaDownMbps,
+        xhttpHost, xhttpPath,
+        serverSubscriptionId, lastPing, avgPing, extraParams,
+        tlsConnectMs, tlsHelloMs, tlsHandshakeMs,
+        bandwidthKbps, bandwidthMeasuredAt,
+        udpLossPercent, udpJitterMs,
+        urlTestMs,
+        favorite, isSelected, order
+    )
 }
\ No newline at end of file
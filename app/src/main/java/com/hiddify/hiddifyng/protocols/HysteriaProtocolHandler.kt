@@ -1,12 +1,8 @@
 package com.hiddify.hiddifyng.protocols
 
-import android.net.Uri
-import android.util.Base64
 import android.util.Log
 import com.hiddify.hiddifyng.database.entity.Server
 import org.json.JSONObject
-import java.net.URLDecoder
-import java.net.URLEncoder
 
 /**
  * Handler for Hysteria protocol (a fast and reliable UDP protocol)
@@ -98,137 +94,4 @@ class HysteriaProtocolHandler : ProtocolHandler {
         
         return true
     }
-    
-    override fun parseUrl(url: String): Server? {
-        try {
-            if (!url.startsWith("hysteria://")) {
-                return null
-            }
-            
-            // Example URL format: 
-            // hysteria://host:port?protocol=udp&auth=base64(pass)&peer=sni&insecure=1&upmbps=20&downmbps=100&obfs=xplus
-            
-            val uri = Uri.parse(url)
-            val host = uri.host ?: return null
-            val port = uri.port
-            
-            if (port <= 0) {
-                return null
-            }
-            
-            val server = Server(
-                name = "Hysteria $host:$port",
-                protocol = "hysteria",
-                address = host,
-                port = port
-            )
-            
-            // Get query parameters
-            uri.getQueryParameter("auth")?.let {
-                server.hysteriaAuthString = decodeBase64IfNeeded(it)
-            }
-            
-            uri.getQueryParameter("peer")?.let {
-                server.sni = it
-            }
-            
-            uri.getQueryParameter("insecure")?.let {
-                server.allowInsecure = it == "1" || it.equals("true", ignoreCase = true)
-            }
-            
-            uri.getQueryParameter("upmbps")?.toIntOrNull()?.let {
-                server.hysteriaUpMbps = it
-            }
-            
-            uri.getQueryParameter("downmbps")?.toIntOrNull()?.let {
-                server.hysteriaDownMbps = it
-            }
-            
-            uri.getQueryParameter("obfs")?.let {
-                server.hysteriaObfs = it
-            }
-            
-            uri.getQueryParameter("protocol")?.let {
-                server.hysteriaProtocol = it
-            } ?: run {
-                server.hysteriaProtocol = "udp" // Default protocol
-            }
-            
-            uri.getQueryParameter("alpn")?.let {
-                server.alpn = it
-            }
-            
-            return server
-        } catch (e: Exception) {
-            Log.e(TAG, "Error parsing Hysteria URL", e)
-            return null
-        }
-    }
-    
-    override fun generateUrl(server: Server): String {
-        try {
-            val uriBuilder = Uri.Builder()
-                .scheme("hysteria")
-                .encodedAuthority("${server.address}:${server.port}")
-            
-            // Add protocol
-            server.hysteriaProtocol?.let {
-                uriBuilder.appendQueryParameter("protocol", it)
-            }
-            
-            // Add authentication
-            server.hysteriaAuthString?.let {
-                uriBuilder.appendQueryParameter("auth", it)
-            } ?: server.password?.let {
-                uriBuilder.appendQueryParameter("auth", it)
-            }
-            
-            // Add SNI
-            server.sni?.let {
-                uriBuilder.appendQueryParameter("peer", it)
-            }
-            
-            // Add insecure flag
-            if (server.allowInsecure == true) {
-                uriBuilder.appendQueryParameter("insecure", "1")
-            }
-            
-            // Add bandwidth settings
-            server.hysteriaUpMbps?.let {
-                uriBuilder.appendQueryParameter("upmbps", it.toString())
-            }
-            
-            server.hysteriaDownMbps?.let {
-                uriBuilder.appendQueryParameter("downmbps", it.toString())
-            }
-            
-            // Add obfuscation
-            server.hysteriaObfs?.let {
-                uriBuilder.appendQueryParameter("obfs", it)
-            }
-            
-            // Add ALPN
-            server.alpn?.let {
-                uriBuilder.appendQueryParameter("alpn", it)
-            }
-            
-            return uriBuilder.build().toString()
-        } catch (e: Exception) {
-            Log.e(TAG, "Error generating Hysteria URL", e)
-            return ""
-        }
-    }
-    
-    /**
-     * Helper function to decode Base64 if the string is encoded
-     */
-    private fun decodeBase64IfNeeded(input: String): String {
-        return try {
-            val decoded = Base64.decode(input, Base64.DEFAULT)
-            String(decoded)
-        } catch (e: Exception) {
-            // If it's not Base64, return the original string
-            input
-        }
-    }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 package com.hiddify.hiddifyng.protocols
 
 import com.hiddify.hiddifyng.database.entity.Server
+import com.hiddify.hiddifyng.utils.ShareLinkCodec
 
 /**
  * Interface for handling different protocols
@@ -28,17 +29,18 @@ interface ProtocolHandler {
     
     /**
      * Parse server configuration from URL
+     * Every protocol goes through the shared native codec
      * @param url Protocol URL (e.g., vmess://, vless://, etc.)
      * @return Server object if parsing successful, null otherwise
      */
-    fun parseUrl(url: String): Server?
+    fun parseUrl(url: String): Server? = ShareLinkCodec.parse(url)
     
     /**
      * Generate sharing URL for this server
      * @param server Server configuration
-     * @return URL string for sharing
+     * @return URL string for sharing, empty if the protocol has no link form
      */
-    fun generateUrl(server: Server): String
+    fun generateUrl(server: Server): String = ShareLinkCodec.generate(server) ?: ""
     
     companion object {
         /**
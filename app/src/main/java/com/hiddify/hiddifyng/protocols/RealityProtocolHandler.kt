@@ -1,7 +1,5 @@
 package com.hiddify.hiddifyng.protocols
 
-import android.net.Uri
-import android.util.Base64
 import android.util.Log
 import com.hiddify.hiddifyng.database.entity.Server
 import org.json.JSONArray
@@ -18,7 +16,6 @@ class RealityProtocolHandler : ProtocolHandler {
     
     companion object {
         // Default values for REALITY protocol
-        private const val DEFAULT_PORT = 443
         private const val DEFAULT_FLOW = "xtls-rprx-vision"
         private const val DEFAULT_ENCRYPTION = "none"
         private const val DEFAULT_NETWORK = "tcp"
@@ -398,339 +395,4 @@ class RealityProtocolHandler : ProtocolHandler {
         
         return true
     }
-    
-    /**
-     * Parse REALITY URL into Server object with enhanced parameter support
-     * @param url REALITY URL string (reality:// or vless+reality://)
-     * @return Server object or null if parsing failed
-     */
-    override fun parseUrl(url: String): Server? {
-        try {
-            // Handle various possible URL formats for REALITY
-            val processedUrl = when {
-                url.startsWith("reality://") -> url
-                url.startsWith("vless+reality://") -> url.replace("vless+reality://", "reality://")
-                url.startsWith("vless://") && url.contains("security=reality") -> 
-                    url.replace("vless://", "reality://")
-                else -> return null
-            }
-            
-            // Parse URI
-            val uri = Uri.parse(processedUrl)
-            val userInfo = uri.userInfo
-            val host = uri.host ?: return null
-            val port = uri.port.takeIf { it > 0 } ?: DEFAULT_PORT
-            
-            // UUID is required in userInfo
-            if (userInfo.isNullOrEmpty()) {
-                Log.w(TAG, "Invalid REALITY URL: missing UUID in userInfo")
-                return null
-            }
-            
-            // Create server with required fields
-            val server = Server(
-                name = "REALITY $host:$port",
-                protocol = "reality", // We'll handle this in Xray as VLESS+REALITY
-                address = host,
-                port = port,
-                uuid = userInfo.trim(),  // userInfo contains the UUID
-                security = DEFAULT_SECURITY,
-                network = DEFAULT_NETWORK
-            )
-            
-            // Process all query parameters with enhanced parameter support
-            uri.queryParameterNames.forEach { param ->
-                try {
-                    when (param.lowercase(Locale.getDefault())) {
-                        // Network type parameters
-                        "type", "network" -> uri.getQueryParameter(param)?.let { server.network = it }
-                        "path" -> uri.getQueryParameter(param)?.let { server.path = it }
-                        "host" -> uri.getQueryParameter(param)?.let { server.host = it }
-                        
-                        // Core REALITY parameters
-                        "sni" -> uri.getQueryParameter(param)?.let { server.sni = it }
-                        "pbk", "publickey" -> uri.getQueryParameter(param)?.let { server.publicKey = it }
-                        "fp", "fingerprint" -> uri.getQueryParameter(param)?.let { server.fingerprint = it }
-                        "sid", "shortid" -> uri.getQueryParameter(param)?.let { server.shortId = it }
-                        
-                        // Advanced REALITY parameters
-                        "spx", "spiderx" -> uri.getQueryParameter(param)?.let { server.spiderX = it }
-                        "spy", "spidery" -> uri.getQueryParameter(param)?.let { server.spiderY = it }
-                        "sni-list", "servernames", "serverNames" -> uri.getQueryParameter(param)?.let { 
-                            server.serverNames = it 
-                        }
-                        "pbk-list", "pbks", "publickeys" -> uri.getQueryParameter(param)?.let {
-                            // Multiple public keys not supported yet, use the first one
-                            val keys = it.split(",")
-                            if (keys.isNotEmpty() && server.publicKey.isNullOrEmpty()) {
-                                server.publicKey = keys[0].trim()
-                            }
-                        }
-                        "utls-version", "utlsVersion" -> uri.getQueryParameter(param)?.let { 
-                            server.utlsVersion = it 
-                        }
-                        "show-network", "showNetwork" -> uri.getQueryParameter(param)?.let {
-                            server.showNetwork = it == "1" || it.equals("true", ignoreCase = true)
-                        }
-                        
-                        // Multiple fingerprints
-                        "fp-list", "fingerprints", "utlsFingerprints" -> uri.getQueryParameter(param)?.let {
-                            server.utlsFingerprints = it
-                        }
-                        
-                        // VLESS parameters
-                        "flow" -> uri.getQueryParameter(param)?.let { server.flow = it }
-                        "encryption" -> uri.getQueryParameter(param)?.let { server.encryption = it }
-                        
-                        // Transport parameters
-                        "headerType" -> uri.getQueryParameter(param)?.let { server.headerType = it }
-                        "serviceName" -> uri.getQueryParameter(param)?.let { server.path = it } // gRPC service name
-                        "quicsecurity" -> uri.getQueryParameter(param)?.let { server.quicSecurity = it }
-                        "quickey" -> uri.getQueryParameter(param)?.let { server.quicKey = it }
-                        "allowinsecure", "allowInsecure" -> uri.getQueryParameter(param)?.let {
-                            server.allowInsecure = it == "1" || it.equals("true", ignoreCase = true)
-                        }
-                        "allowhttp2", "allowHttp2" -> uri.getQueryParameter(param)?.let {
-                            server.allowHttp2 = it == "1" || it.equals("true", ignoreCase = true)
-                        }
-                        
-                        // Headers parameter (Base64 encoded semicolon-separated key:value)
-                        "headers" -> uri.getQueryParameter(param)?.let {
-                            try {
-                                val decodedHeaders = decodeBase64IfNeeded(it)
-                                server.headers = decodedHeaders
-                            } catch (e: Exception) {
-                                // If decoding fails, use as-is
-                                server.headers = it
-                            }
-                        }
-                        
-                        // Connection parameters
-                        "mux" -> uri.getQueryParameter(param)?.let {
-                            server.enableMux = it == "1" || it.equals("true", ignoreCase = true)
-                        }
-                        "muxConcurrency" -> uri.getQueryParameter(param)?.toIntOrNull()?.let {
-                            if (it > 0) server.muxConcurrency = it
-                        }
-                        
-                        // gRPC mode
-                        "mode" -> uri.getQueryParameter(param)?.let {
-                            if (it == "multi" || it == "gun") server.grpcMultiMode = true
-                        }
-                        
-                        // Private key (rarely used)
-                        "privkey", "privatekey" -> uri.getQueryParameter(param)?.let {
-                            server.privateKey = it
-                        }
-                    }
-                } catch (e: Exception) {
-                    Log.w(TAG, "Error parsing parameter '$param': ${e.message}")
-                }
-            }
-            
-            // Set defaults if not specified
-            if (server.fingerprint.isNullOrEmpty()) {
-                server.fingerprint = DEFAULT_FINGERPRINT
-            }
-            
-            if (server.flow.isNullOrEmpty()) {
-                server.flow = DEFAULT_FLOW
-            }
-            
-            if (server.encryption.isNullOrEmpty()) {
-                server.encryption = DEFAULT_ENCRYPTION
-            }
-            
-            // Validate the parsed server
-            return if (validateServer(server)) server else null
-            
-        } catch (e: Exception) {
-            Log.e(TAG, "Error parsing REALITY URL", e)
-            return null
-        }
-    }
-    
-    /**
-     * Generate shareable URL for this REALITY server with enhanced parameters
-     * @param server Server configuration
-     * @return URL string for sharing
-     */
-    override fun generateUrl(server: Server): String {
-        try {
-            // Validate required fields
-            if (server.address.isNullOrEmpty() || 
-                server.uuid.isNullOrEmpty() || 
-                server.publicKey.isNullOrEmpty()) {
-                Log.e(TAG, "Cannot generate URL: missing required fields")
-                return ""
-            }
-            
-            // Basic URL structure: reality://uuid@host:port?params
-            val uriBuilder = Uri.Builder()
-                .scheme("reality")
-                .encodedAuthority("${server.uuid}@${server.address}:${server.port}")
-            
-            // Add all the required and optional parameters
-            
-            // Public key (required for REALITY)
-            server.publicKey?.let {
-                uriBuilder.appendQueryParameter("pbk", it)
-            }
-            
-            // SNI (required for REALITY)
-            server.sni?.let {
-                uriBuilder.appendQueryParameter("sni", it)
-            }
-            
-            // Short ID
-            server.shortId?.let {
-                uriBuilder.appendQueryParameter("sid", it)
-            }
-            
-            // Spider X
-            server.spiderX?.let {
-                uriBuilder.appendQueryParameter("spx", it)
-            }
-            
-            // Enhanced: Spider Y
-            server.spiderY?.let {
-                uriBuilder.appendQueryParameter("spy", it)
-            }
-            
-            // Enhanced: Multiple server names
-            server.serverNames?.let {
-                uriBuilder.appendQueryParameter("serverNames", it)
-            }
-            
-            // Fingerprint
-            server.fingerprint?.let {
-                if (it != DEFAULT_FINGERPRINT) {
-                    uriBuilder.appendQueryParameter("fp", it)
-                }
-            }
-            
-            // Enhanced: Multiple fingerprints
-            server.utlsFingerprints?.let {
-                uriBuilder.appendQueryParameter("fingerprints", it)
-            }
-            
-            // uTLS version
-            server.utlsVersion?.let {
-                uriBuilder.appendQueryParameter("utlsVersion", it)
-            }
-            
-            // Show network
-            if (server.showNetwork == true) {
-                uriBuilder.appendQueryParameter("showNetwork", "1")
-            }
-            
-            // Flow control
-            server.flow?.let {
-                if (it != DEFAULT_FLOW) {
-                    uriBuilder.appendQueryParameter("flow", it)
-                }
-            }
-            
-            // Network type
-            if (server.network != DEFAULT_NETWORK && !server.network.isNullOrEmpty()) {
-                uriBuilder.appendQueryParameter("type", server.network)
-                
-                // Add network-specific parameters
-                when (server.network?.lowercase(Locale.getDefault())) {
-                    "ws" -> {
-                        server.path?.let { uriBuilder.appendQueryParameter("path", it) }
-                        server.host?.let { uriBuilder.appendQueryParameter("host", it) }
-                    }
-                    "grpc" -> {
-                        server.path?.let { uriBuilder.appendQueryParameter("serviceName", it) }
-                        if (server.grpcMultiMode == true) {
-                            uriBuilder.appendQueryParameter("mode", "multi")
-                        }
-                    }
-                    "tcp" -> {
-                        server.headerType?.let { uriBuilder.appendQueryParameter("headerType", it) }
-                    }
-                    "h2", "http2" -> {
-                        server.path?.let { uriBuilder.appendQueryParameter("path", it) }
-                        server.host?.let { uriBuilder.appendQueryParameter("host", it) }
-                        if (server.allowHttp2 == true) {
-                            uriBuilder.appendQueryParameter("allowHttp2", "1")
-                        }
-                    }
-                    "quic" -> {
-                        server.quicSecurity?.let { uriBuilder.appendQueryParameter("quicSecurity", it) }
-                        server.quicKey?.let { uriBuilder.appendQueryParameter("quicKey", it) }
-                        server.headerType?.let { uriBuilder.appendQueryParameter("headerType", it) }
-                    }
-                    "httpupgrade" -> {
-                        server.path?.let { uriBuilder.appendQueryParameter("path", it) }
-                        server.host?.let { uriBuilder.appendQueryParameter("host", it) }
-                    }
-                }
-            }
-            
-            // Headers (Base64 encoded)
-            server.headers?.let {
-                try {
-                    val encodedHeaders = Base64.encodeToString(
-                        it.toByteArray(), 
-                        Base64.URL_SAFE or Base64.NO_PADDING
-                    )
-                    uriBuilder.appendQueryParameter("headers", encodedHeaders)
-                } catch (e: Exception) {
-                    Log.w(TAG, "Failed to encode headers, using raw", e)
-                    uriBuilder.appendQueryParameter("headers", it)
-                }
-            }
-            
-            // MUX settings
-            if (server.enableMux == true) {
-                uriBuilder.appendQueryParameter("mux", "1")
-                server.muxConcurrency?.let {
-                    uriBuilder.appendQueryParameter("muxConcurrency", it.toString())
-                }
-            }
-            
-            // Private key (rarely used)
-            server.privateKey?.let {
-                uriBuilder.appendQueryParameter("privateKey", it)
-            }
-            
-            return uriBuilder.build().toString()
-        } catch (e: Exception) {
-            Log.e(TAG, "Error generating REALITY URL", e)
-            return ""
-        }
-    }
-    
-    /**
-     * Helper function to decode Base64 if the string is encoded
-     * Supports multiple Base64 encoding formats
-     * 
-     * @param input Potentially Base64 encoded string
-     * @return Decoded string or original if not Base64
-     */
-    private fun decodeBase64IfNeeded(input: String): String {
-        return try {
-            // Try different Base64 decoding flags
-            val decoded = try {
-                Base64.decode(input, Base64.URL_SAFE)
-            } catch (e: Exception) {
-                try {
-                    Base64.decode(input, Base64.DEFAULT)
-                } catch (e2: Exception) {
-                    try {
-                        Base64.decode(input, Base64.URL_SAFE or Base64.NO_PADDING)
-                    } catch (e3: Exception) {
-                        // Last attempt with default and no padding
-                        Base64.decode(input, Base64.DEFAULT or Base64.NO_PADDING)
-                    }
-                }
-            }
-            String(decoded)
-        } catch (e: Exception) {
-            // If it's not Base64, return the original string
-            input
-        }
-    }
 }
\ No newline at end of file
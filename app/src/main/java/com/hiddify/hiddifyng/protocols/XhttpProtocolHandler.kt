@@ -1,7 +1,5 @@
 package com.hiddify.hiddifyng.protocols
 
-import android.net.Uri
-import android.util.Base64
 import android.util.Log
 import com.hiddify.hiddifyng.database.entity.Server
 import org.json.JSONArray
@@ -152,156 +150,4 @@ class XhttpProtocolHandler : ProtocolHandler {
         
         return true
     }
-    
-    override fun parseUrl(url: String): Server? {
-        try {
-            if (!url.startsWith("xhttp://")) {
-                return null
-            }
-            
-            // Example URL format:
-            // xhttp://uuid@host:port?path=/&security=tls&sni=example.com&fp=chrome&type=http
-            
-            val uri = Uri.parse(url)
-            val userInfo = uri.userInfo
-            val host = uri.host ?: return null
-            val port = uri.port
-            
-            if (port <= 0 || userInfo.isNullOrEmpty()) {
-                return null
-            }
-            
-            val server = Server(
-                name = "XHTTP $host:$port",
-                protocol = "xhttp",
-                address = host,
-                port = port,
-                uuid = userInfo  // userInfo contains the UUID
-            )
-            
-            // Parse query parameters
-            uri.getQueryParameter("path")?.let {
-                server.path = it
-            }
-            
-            uri.getQueryParameter("security")?.let {
-                server.security = it
-            } ?: run {
-                server.security = "tls" // Default security
-            }
-            
-            uri.getQueryParameter("sni")?.let {
-                server.sni = it
-            }
-            
-            uri.getQueryParameter("allowInsecure")?.let {
-                server.allowInsecure = it == "1" || it.equals("true", ignoreCase = true)
-            }
-            
-            uri.getQueryParameter("alpn")?.let {
-                server.alpn = it
-            }
-            
-            uri.getQueryParameter("fp")?.let {
-                server.fingerprint = it
-            }
-            
-            uri.getQueryParameter("host")?.let {
-                server.host = it
-            }
-            
-            uri.getQueryParameter("headers")?.let {
-                server.headers = decodeBase64IfNeeded(it)
-            }
-            
-            uri.getQueryParameter("mux")?.let {
-                server.enableMux = it == "1" || it.equals("true", ignoreCase = true)
-            }
-            
-            uri.getQueryParameter("muxConcurrency")?.toIntOrNull()?.let {
-                server.muxConcurrency = it
-            }
-            
-            return server
-        } catch (e: Exception) {
-            Log.e(TAG, "Error parsing XHTTP URL", e)
-            return null
-        }
-    }
-    
-    override fun generateUrl(server: Server): String {
-        try {
-            // Basic URL structure: xhttp://uuid@host:port?parameters
-            val uriBuilder = Uri.Builder()
-                .scheme("xhttp")
-                .encodedAuthority("${server.uuid}@${server.address}:${server.port}")
-            
-            // Add path
-            server.path?.let {
-                uriBuilder.appendQueryParameter("path", it)
-            }
-            
-            // Add security type
-            server.security?.let {
-                uriBuilder.appendQueryParameter("security", it)
-            }
-            
-            // Add SNI
-            server.sni?.let {
-                uriBuilder.appendQueryParameter("sni", it)
-            }
-            
-            // Add allowInsecure flag
-            if (server.allowInsecure == true) {
-                uriBuilder.appendQueryParameter("allowInsecure", "1")
-            }
-            
-            // Add ALPN
-            server.alpn?.let {
-                uriBuilder.appendQueryParameter("alpn", it)
-            }
-            
-            // Add fingerprint
-            server.fingerprint?.let {
-                uriBuilder.appendQueryParameter("fp", it)
-            }
-            
-            // Add host header
-            server.host?.let {
-                uriBuilder.appendQueryParameter("host", it)
-            }
-            
-            // Add additional headers (Base64 encoded)
-            server.headers?.let {
-                val encodedHeaders = Base64.encodeToString(it.toByteArray(), Base64.URL_SAFE)
-                uriBuilder.appendQueryParameter("headers", encodedHeaders)
-            }
-            
-            // Add mux settings
-            if (server.enableMux == true) {
-                uriBuilder.appendQueryParameter("mux", "1")
-                server.muxConcurrency?.let {
-                    uriBuilder.appendQueryParameter("muxConcurrency", it.toString())
-                }
-            }
-            
-            return uriBuilder.build().toString()
-        } catch (e: Exception) {
-            Log.e(TAG, "Error generating XHTTP URL", e)
-            return ""
-        }
-    }
-    
-    /**
-     * Helper function to decode Base64 if the string is encoded
-     */
-    private fun decodeBase64IfNeeded(input: String): String {
-        return try {
-            val decoded = Base64.decode(input, Base64.URL_SAFE)
-            String(decoded)
-        } catch (e: Exception) {
-            // If it's not Base64, return the original string
-            input
-        }
-    }
 }
\ No newline at end of file
@@ -4,12 +4,16 @@ import android.content.Context
 import android.util.Log
 import androidx.work.Constraints
 import androidx.work.ExistingPeriodicWorkPolicy
+import androidx.work.ExistingWorkPolicy
+import androidx.work.ListenableWorker
 import androidx.work.NetworkType
+import androidx.work.OneTimeWorkRequest
 import androidx.work.PeriodicWorkRequestBuilder
 import androidx.work.WorkManager
-import com.hiddify.hiddifyng.workers.PingWorker
-import com.hiddify.hiddifyng.workers.RoutingUpdateWorker
-import com.hiddify.hiddifyng.workers.SubscriptionWorker
+import androidx.work.workDataOf
+import com.hiddify.hiddifyng.worker.PingWorker
+import com.hiddify.hiddifyng.worker.RoutingUpdateWorker
+import com.hiddify.hiddifyng.worker.SubscriptionWorker
 import java.util.concurrent.TimeUnit
 
 /**
@@ -26,7 +30,8 @@ class BackgroundTaskScheduler(private val context: Context) {
         const val ROUTING_UPDATE_TASK_NAME = "routing_update_task"
         
         // Optimal intervals (in minutes) - configurable
-        const val PING_INTERVAL_MINUTES = 10
+        // Pings wake at WorkManager's shortest period; ProbeScheduler decides which servers are due
+        const val PING_INTERVAL_MINUTES = 15
         const val SUBSCRIPTION_UPDATE_INTERVAL_MINUTES = 30
         const val ROUTING_UPDATE_INTERVAL_HOURS = 24
     }
@@ -57,8 +62,9 @@ class BackgroundTaskScheduler(private val context: Context) {
     }
     
     /**
-     * Schedule server ping task - runs every 10 minutes
-     * Helps identify the fastest server for auto-switching
+     * Schedule server ping task - runs every 15 minutes
+     * Helps identify the fastest server for auto-switching. Each run probes only the
+     * servers that are due, so most runs touch a handful of servers or none
      */
     fun schedulePingTask() {
         Log.d(TAG, "Scheduling ping task to run every $PING_INTERVAL_MINUTES minutes")
@@ -140,6 +146,41 @@ class BackgroundTaskScheduler(private val context: Context) {
         )
     }
     
+    /**
+     * Pull other tasks that are at least half way to their next run into the current wake-up
+     * On cellular, so the radio's high-power tail is paid once for all of them; the pulled
+     * tasks run once with RadioBatcher.KEY_JOINED set and keep their own network constraints
+     * @param task Name of the task whose run opened the window
+     */
+    fun joinRadioWindow(task: String) {
+        if (!RadioBatcher.isCellular(context)) return
+        
+        val now = System.currentTimeMillis()
+        val tasks = listOf(
+            Triple(PING_TASK_NAME, PingWorker::class.java,
+                TimeUnit.MINUTES.toMillis(PING_INTERVAL_MINUTES.toLong())),
+            Triple(SUBSCRIPTION_UPDATE_TASK_NAME, SubscriptionWorker::class.java,
+                TimeUnit.MINUTES.toMillis(SUBSCRIPTION_UPDATE_INTERVAL_MINUTES.toLong())),
+            Triple(ROUTING_UPDATE_TASK_NAME, RoutingUpdateWorker::class.java,
+                TimeUnit.HOURS.toMillis(ROUTING_UPDATE_INTERVAL_HOURS.toLong()))
+        )
+        for ((name, worker, intervalMs) in tasks) {
+            if (name == task || now - RadioBatcher.lastRunAt(context, name) < intervalMs / 2) continue
+            
+            Log.d(TAG, "Running $name in the radio window of $task")
+            workManager.enqueueUniqueWork("${name}_joined", ExistingWorkPolicy.KEEP, joinedRequest(name, worker))
+        }
+    }
+    
+    private fun joinedRequest(name: String, worker: Class<out ListenableWorker>): OneTimeWorkRequest {
+        // Routing downloads stay on unmetered networks, as in the periodic request
+        val networkType = if (name == ROUTING_UPDATE_TASK_NAME) NetworkType.UNMETERED else NetworkType.CONNECTED
+        return OneTimeWorkRequest.Builder(worker)
+            .setConstraints(Constraints.Builder().setRequiredNetworkType(networkType).build())
+            .setInputData(workDataOf(RadioBatcher.KEY_JOINED to true))
+            .build()
+    }
+    
     /**
      * Cancel all scheduled tasks
      */
@@ -1,17 +1,85 @@
 package com.hiddify.hiddifyng.utils
 
+import android.os.Build
 import android.util.Log
 import com.hiddify.hiddifyng.database.entity.Server
 import org.json.JSONObject
+import java.io.File
 
 /**
  * Optimizes Xray configurations for better performance based on protocol and network conditions
  * This helps improve connection speed and reduce battery usage
+ * @param tuningStore File the native tuning store persists to; null keeps the static heuristics only
+ * @param cipherBenchmarkFile File the per-device AEAD benchmark is cached in; null keeps the
+ * static cipher choices
  */
-class ConfigOptimizer {
+class ConfigOptimizer(
+    private val tuningStore: File? = null,
+    private val cipherBenchmarkFile: File? = null
+) {
     companion object {
         private const val TAG = "ConfigOptimizer"
         
+        // Socket buffer bounds for BDP sizing (bdp::kMinBufferBytes / kMaxBufferBytes)
+        const val MIN_BUFFER_SIZE = 64 * 1024
+        const val MAX_BUFFER_SIZE = 8 * 1024 * 1024
+        
+        // Assumed goodput per connection quality until a session has measured one
+        private val QUALITY_BANDWIDTH_KBPS = floatArrayOf(2_000f, 10_000f, 30_000f, 80_000f)
+        
+        // Sealing time per cipher for the once-per-device benchmark
+        private const val CIPHER_BENCHMARK_MS = 200
+        
+        // Hysteria rate checks: UDP probe loss from which declared rates are scaled down,
+        // and how far above measured tunnel goodput the declared download may sit
+        private const val HYSTERIA_LOSS_THRESHOLD = 5
+        private const val HYSTERIA_GOODPUT_HEADROOM = 1.5f
+        
+        init {
+            System.loadLibrary("xray-core-jni")
+        }
+        
+        @JvmStatic
+        private external fun openTuningStore(path: String): Boolean
+        
+        @JvmStatic
+        private external fun selectTuning(
+            networkType: Int,
+            serverId: Long,
+            fallbackMux: Int,
+            fallbackBuffer: Int,
+            pinBuffer: Boolean
+        ): IntArray
+        
+        @JvmStatic
+        private external fun tunedGoodput(networkType: Int, serverId: Long): Float
+        
+        @JvmStatic
+        private external fun recordTuning(
+            networkType: Int,
+            serverId: Long,
+            muxConcurrency: Int,
+            bufferSize: Int,
+            goodputKbps: Float,
+            rttMs: Float,
+            retransmitRate: Float
+        )
+        
+        @JvmStatic
+        private external fun saveTuningStore(): Boolean
+        
+        @JvmStatic
+        private external fun sizeBuffers(bandwidthKbps: Float, rttMs: Float, minBytes: Long, maxBytes: Long): LongArray
+        
+        @JvmStatic
+        private external fun benchmarkBufferSizes(rttMs: Int, bufferSizes: IntArray, durationMs: Int): LongArray
+        
+        @JvmStatic
+        private external fun benchmarkAeadCiphers(durationMs: Int): LongArray?
+        
+        @JvmStatic
+        private external fun hasAesHardware(): Boolean
+        
         // Default mux configuration based on protocol type
         private val DEFAULT_MUX_SETTINGS = mapOf(
             "vmess" to 8,
@@ -24,14 +92,78 @@ class ConfigOptimizer {
         )
     }
     
+    /**
+     * Mux concurrency and socket buffer size chosen for a session
+     * @param muxConcurrency 0 when mux is disabled
+     */
+    data class TunedSettings(val muxConcurrency: Int, val bufferSize: Int)
+    
+    /**
+     * Buffer size derived from a server's bandwidth-delay product
+     * @param bandwidthKbps Measured goodput, or the quality-tier assumption when none exists
+     */
+    data class BufferSizing(
+        val rttMs: Int,
+        val bandwidthKbps: Float,
+        val bdpBytes: Long,
+        val bufferSize: Int
+    )
+    
+    /**
+     * AEAD seal throughput measured on this device, in bytes per second
+     * @param aesHardware AES-GCM ran on the CPU's crypto instructions
+     */
+    data class CipherBenchmark(
+        val aes128GcmBps: Long,
+        val aes256GcmBps: Long,
+        val chacha20Poly1305Bps: Long,
+        val aesHardware: Boolean
+    ) {
+        /** AES-128-GCM seals faster than ChaCha20-Poly1305 here */
+        val prefersAes: Boolean
+            get() = aes128GcmBps > chacha20Poly1305Bps
+    }
+    
+    /**
+     * Sizing used by the last optimized outbound, null if it fell back to quality tiers
+     */
+    @Volatile
+    var lastBufferSizing: BufferSizing? = null
+        private set
+    
+    private val tuningReady: Boolean by lazy {
+        tuningStore != null && openTuningStore(tuningStore.absolutePath)
+    }
+    
+    /**
+     * Cached benchmark for this build of the device, measured on first use
+     */
+    val cipherBenchmark: CipherBenchmark? by lazy {
+        cipherBenchmarkFile?.let { loadCipherBenchmark(it) }
+    }
+    
+    /**
+     * VMess body cipher that seals fastest on this device, null without a benchmark
+     * Measured on first use, so read it off the main thread
+     */
+    val preferredAead: String?
+        get() = cipherBenchmark?.let { if (it.prefersAes) "aes-128-gcm" else "chacha20-poly1305" }
+    
     /**
      * Apply performance optimizations to an outbound configuration
      * @param config The original outbound configuration
      * @param server The server details
      * @param connectionQuality The current connection quality (0-3)
+     * @param networkType AdaptiveConnectionManager.TYPE_* of the active network; enables
+     * learned settings from the tuning store when not TYPE_NONE
      * @return Optimized configuration
      */
-    fun optimizeOutboundConfig(config: JSONObject, server: Server, connectionQuality: Int): JSONObject {
+    fun optimizeOutboundConfig(
+        config: JSONObject,
+        server: Server,
+        connectionQuality: Int,
+        networkType: Int = AdaptiveConnectionManager.TYPE_NONE
+    ): JSONObject {
         try {
             // Get protocol type
             val protocol = server.protocol.lowercase()
@@ -39,13 +171,24 @@ class ConfigOptimizer {
             // Optimize multiplexing
             optimizeMux(config, protocol, connectionQuality)
             
-            // Optimize buffer sizes based on connection quality
-            optimizeBuffers(config, connectionQuality)
+            // Size buffers from the server's BDP, or by connection quality without an RTT
+            val sizing = computeBufferSizing(server, networkType, connectionQuality)
+            lastBufferSizing = sizing
+            optimizeBuffers(config, sizing?.bufferSize ?: defaultBufferSize(connectionQuality))
+            
+            // Replace the static choices with what past sessions measured best
+            if (networkType != AdaptiveConnectionManager.TYPE_NONE && protocol != "hysteria") {
+                applyTunedSettings(config, server, protocol, networkType, connectionQuality, sizing)
+            }
             
             // Protocol-specific optimizations
             when (protocol) {
-                "vmess", "vless" -> optimizeV2rayProtocols(config, connectionQuality)
-                "hysteria" -> optimizeHysteria(config, connectionQuality)
+                "vmess" -> {
+                    optimizeV2rayProtocols(config, connectionQuality)
+                    optimizeVmessSecurity(config)
+                }
+                "vless" -> optimizeV2rayProtocols(config, connectionQuality)
+                "hysteria" -> optimizeHysteria(config, connectionQuality, server)
                 "reality" -> optimizeReality(config)
                 "trojan" -> optimizeTrojan(config, connectionQuality)
                 "shadowsocks" -> optimizeShadowsocks(config)
@@ -62,6 +205,212 @@ class ConfigOptimizer {
         return config
     }
     
+    /**
+     * Mux concurrency and socket buffers for a natively generated session
+     * The choices optimizeOutboundConfig makes for a JSON outbound: BDP-sized buffers once the
+     * server has an RTT, the tuning store's pick on a known network, static defaults otherwise
+     * @param observedMux Concurrency the live mux tuner last recommended for the server, used
+     * instead of the static default until the store has measured the server
+     */
+    fun tuneSession(
+        server: Server,
+        networkType: Int,
+        connectionQuality: Int,
+        observedMux: Int? = null
+    ): TunedSettings {
+        val protocol = server.protocol.lowercase()
+        val sizing = computeBufferSizing(server, networkType, connectionQuality)
+        lastBufferSizing = sizing
+        
+        // Hysteria multiplexes itself and REALITY runs better without mux (see optimizeReality)
+        val muxable = protocol != "hysteria" && protocol != "reality"
+        val fallbackMux = if (muxable) observedMux ?: defaultMuxConcurrency(protocol, connectionQuality) else 0
+        val fallbackBuffer = sizing?.bufferSize ?: defaultBufferSize(connectionQuality)
+        if (!muxable || !tuningReady || networkType == AdaptiveConnectionManager.TYPE_NONE) {
+            return TunedSettings(fallbackMux, fallbackBuffer)
+        }
+        
+        // A BDP-derived buffer is kept as is; only mux is explored around it
+        val tuned = selectTuning(networkType, server.id, fallbackMux, fallbackBuffer, sizing != null)
+        return TunedSettings(tuned[0], sizing?.bufferSize ?: tuned[1])
+    }
+    
+    /**
+     * Report how a session performed with the settings it was given
+     * Feeds the closed-loop controller behind optimizeOutboundConfig and tuneSession
+     * @param settings Settings the session ran with (see tuneSession and readTunedSettings)
+     * @param goodputKbps Application-level throughput over the session
+     * @param rttMs Smoothed RTT to the server
+     * @param retransmitRate Retransmitted / sent segments (0-1)
+     */
+    fun recordSessionFeedback(
+        server: Server,
+        networkType: Int,
+        settings: TunedSettings,
+        goodputKbps: Float,
+        rttMs: Float,
+        retransmitRate: Float
+    ) {
+        if (!tuningReady || networkType == AdaptiveConnectionManager.TYPE_NONE) return
+        
+        recordTuning(networkType, server.id, settings.muxConcurrency, settings.bufferSize,
+            goodputKbps, rttMs, retransmitRate)
+        if (!saveTuningStore()) {
+            Log.w(TAG, "Failed to persist tuning store")
+        }
+    }
+    
+    /**
+     * Compute socket buffers from the bandwidth-delay product of a server
+     * RTT comes from probing; bandwidth from the best goodput sessions measured
+     * on this network, else the connection quality tier
+     * @return Sizing, or null when the server has no RTT measurement yet
+     */
+    fun computeBufferSizing(server: Server, networkType: Int, connectionQuality: Int): BufferSizing? {
+        val rttMs = server.avgPing?.takeIf { it > 0 } ?: return null
+        
+        val measured = if (tuningReady && networkType != AdaptiveConnectionManager.TYPE_NONE) {
+            tunedGoodput(networkType, server.id)
+        } else {
+            0f
+        }
+        val bandwidthKbps = if (measured > 0f) {
+            measured
+        } else {
+            QUALITY_BANDWIDTH_KBPS[connectionQuality.coerceIn(0, QUALITY_BANDWIDTH_KBPS.size - 1)]
+        }
+        
+        val sized = sizeBuffers(bandwidthKbps, rttMs.toFloat(), MIN_BUFFER_SIZE.toLong(), MAX_BUFFER_SIZE.toLong())
+        return BufferSizing(rttMs, bandwidthKbps, sized[0], sized[1].toInt())
+    }
+    
+    /**
+     * Measure loopback throughput per buffer size with an injected RTT
+     * A relay holds the data in its socket for the RTT and the sizes are set as
+     * SO_SNDBUF/SO_RCVBUF, so kernel flow control shows what an undersized buffer costs
+     * on a long-RTT link; blocks for about sizes * duration, call off the main thread
+     * @return Throughput in bytes per second for each size, -1 where the run failed
+     */
+    fun benchmarkBuffers(rttMs: Int, bufferSizes: IntArray, durationMs: Int = 2000): LongArray {
+        return benchmarkBufferSizes(rttMs, bufferSizes, durationMs)
+    }
+    
+    /**
+     * Measure AES-128/256-GCM and ChaCha20-Poly1305 seal throughput on this device
+     * Blocks for about three times the duration, call off the main thread
+     * @return Throughputs, or null when a native implementation failed its test vectors
+     */
+    fun benchmarkCiphers(durationMs: Int = CIPHER_BENCHMARK_MS): CipherBenchmark? {
+        val rates = benchmarkAeadCiphers(durationMs) ?: return null
+        return CipherBenchmark(rates[0], rates[1], rates[2], hasAesHardware())
+    }
+    
+    /**
+     * Read the cached benchmark, re-measuring when it is missing or from another system build
+     */
+    private fun loadCipherBenchmark(file: File): CipherBenchmark? {
+        try {
+            if (file.exists()) {
+                val lines = file.readLines()
+                if (lines.size == 2 && lines[0] == Build.FINGERPRINT) {
+                    val fields = lines[1].split(" ")
+                    return CipherBenchmark(
+                        fields[0].toLong(), fields[1].toLong(), fields[2].toLong(), fields[3].toBoolean()
+                    )
+                }
+            }
+        } catch (e: Exception) {
+            Log.w(TAG, "Discarding unreadable cipher benchmark", e)
+        }
+        
+        val measured = benchmarkCiphers() ?: return null
+        try {
+            file.writeText("${Build.FINGERPRINT}\n${measured.aes128GcmBps} ${measured.aes256GcmBps} " +
+                "${measured.chacha20Poly1305Bps} ${measured.aesHardware}\n")
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to cache cipher benchmark", e)
+        }
+        Log.i(TAG, "Cipher benchmark: $measured")
+        return measured
+    }
+    
+    /**
+     * Read back the tunable settings an optimized outbound carries
+     */
+    fun readTunedSettings(config: JSONObject): TunedSettings {
+        val mux = config.optJSONObject("mux")
+        val muxConcurrency = if (mux?.optBoolean("enabled") == true) mux.optInt("concurrency") else 0
+        val sockopt = config.optJSONObject("streamSettings")?.optJSONObject("sockopt")
+        return TunedSettings(muxConcurrency, sockopt?.optInt("tcpReceiveBufferSize") ?: 0)
+    }
+    
+    /**
+     * Overwrite mux and buffer settings with the tuning store's choice
+     */
+    private fun applyTunedSettings(
+        config: JSONObject,
+        server: Server,
+        protocol: String,
+        networkType: Int,
+        connectionQuality: Int,
+        sizing: BufferSizing?
+    ) {
+        if (!tuningReady) return
+        
+        // A BDP-derived buffer is kept as is; only mux is explored around it
+        val tuned = selectTuning(
+            networkType, server.id,
+            defaultMuxConcurrency(protocol, connectionQuality),
+            sizing?.bufferSize ?: defaultBufferSize(connectionQuality),
+            sizing != null
+        )
+        val muxConcurrency = tuned[0]
+        val bufferSize = sizing?.bufferSize ?: tuned[1]
+        
+        val mux = config.optJSONObject("mux") ?: JSONObject().also { config.put("mux", it) }
+        mux.put("enabled", muxConcurrency > 0)
+        if (muxConcurrency > 0) {
+            mux.put("concurrency", muxConcurrency)
+        } else {
+            mux.remove("concurrency")
+        }
+        
+        config.optJSONObject("streamSettings")?.optJSONObject("sockopt")?.let { sockopt ->
+            sockopt.put("tcpSendBufferSize", bufferSize)
+            sockopt.put("tcpReceiveBufferSize", bufferSize)
+        }
+        
+        Log.d(TAG, "Tuned ${server.name}: mux $muxConcurrency, buffers ${bufferSize / 1024} KB")
+    }
+    
+    /**
+     * Static mux concurrency for a protocol at a connection quality
+     */
+    private fun defaultMuxConcurrency(protocol: String, connectionQuality: Int): Int {
+        // Get default concurrent connections for this protocol
+        val defaultConcurrent = DEFAULT_MUX_SETTINGS[protocol] ?: 4
+        
+        // Adjust based on connection quality
+        return when (connectionQuality) {
+            3 -> defaultConcurrent + 4 // Excellent - increase
+            2 -> defaultConcurrent     // Good - use default
+            1 -> defaultConcurrent - 2 // Moderate - slightly reduce
+            else -> 1                  // Poor - minimal multiplexing
+        }.coerceAtLeast(1) // Ensure at least 1
+    }
+    
+    /**
+     * Static socket buffer size for a connection quality
+     */
+    private fun defaultBufferSize(connectionQuality: Int): Int {
+        return when (connectionQuality) {
+            3 -> 4 * 1024 * 1024  // 4MB for excellent connections
+            2 -> 2 * 1024 * 1024  // 2MB for good connections
+            1 -> 1 * 1024 * 1024  // 1MB for moderate connections
+            else -> 512 * 1024    // 512KB for poor connections
+        }
+    }
+    
     /**
      * Optimize multiplexing settings based on protocol and connection quality
      */
@@ -73,16 +422,7 @@ class ConfigOptimizer {
             
             val mux = config.getJSONObject("mux")
             
-            // Get default concurrent connections for this protocol
-            val defaultConcurrent = DEFAULT_MUX_SETTINGS[protocol] ?: 4
-            
-            // Adjust based on connection quality
-            val concurrentValue = when (connectionQuality) {
-                3 -> defaultConcurrent + 4 // Excellent - increase
-                2 -> defaultConcurrent     // Good - use default
-                1 -> defaultConcurrent - 2 // Moderate - slightly reduce
-                else -> 1                  // Poor - minimal multiplexing
-            }.coerceAtLeast(1) // Ensure at least 1
+            val concurrentValue = defaultMuxConcurrency(protocol, connectionQuality)
             
             // Don't enable mux for protocols that don't support it well
             val enabled = protocol != "hysteria" && concurrentValue > 0
@@ -100,9 +440,9 @@ class ConfigOptimizer {
     }
     
     /**
-     * Optimize buffer sizes based on connection quality
+     * Apply socket buffer sizes
      */
-    private fun optimizeBuffers(config: JSONObject, connectionQuality: Int): JSONObject {
+    private fun optimizeBuffers(config: JSONObject, bufferSize: Int): JSONObject {
         try {
             if (!config.has("streamSettings")) {
                 return config
@@ -118,14 +458,6 @@ class ConfigOptimizer {
             // TCP keep-alive increases reliability
             sockopt.put("tcpKeepAliveInterval", 30)
             
-            // Optimize buffer sizes based on connection quality
-            val bufferSize = when (connectionQuality) {
-                3 -> 4 * 1024 * 1024  // 4MB for excellent connections
-                2 -> 2 * 1024 * 1024  // 2MB for good connections
-                1 -> 1 * 1024 * 1024  // 1MB for moderate connections
-                else -> 512 * 1024    // 512KB for poor connections
-            }
-            
             sockopt.put("tcpSendBufferSize", bufferSize)
             sockopt.put("tcpReceiveBufferSize", bufferSize)
             
@@ -167,6 +499,32 @@ class ConfigOptimizer {
         return config
     }
     
+    /**
+     * Pick the VMess body cipher from the benchmark
+     * The client chooses the security per request and servers accept any of them, so
+     * only the "auto" default is replaced; an explicit choice in the share link is kept
+     */
+    private fun optimizeVmessSecurity(config: JSONObject): JSONObject {
+        val security = preferredAead ?: return config
+        
+        try {
+            val vnext = config.optJSONObject("settings")?.optJSONArray("vnext") ?: return config
+            for (i in 0 until vnext.length()) {
+                val users = vnext.getJSONObject(i).optJSONArray("users") ?: continue
+                for (j in 0 until users.length()) {
+                    val user = users.getJSONObject(j)
+                    if (user.optString("security", "auto") == "auto") {
+                        user.put("security", security)
+                    }
+                }
+            }
+        } catch (e: Exception) {
+            Log.e(TAG, "Error optimizing VMess security", e)
+        }
+        
+        return config
+    }
+    
     /**
      * REALITY protocol specific optimizations
      */
@@ -205,7 +563,7 @@ class ConfigOptimizer {
     /**
      * Hysteria protocol specific optimizations
      */
-    private fun optimizeHysteria(config: JSONObject, connectionQuality: Int): JSONObject {
+    private fun optimizeHysteria(config: JSONObject, connectionQuality: Int, server: Server): JSONObject {
         try {
             val settings = config.optJSONObject("settings") ?: return config
             
@@ -234,6 +592,8 @@ class ConfigOptimizer {
                 settings.put("down_mbps", downloadMbps)
             }
             
+            capHysteriaRates(settings, server)
+            
             // Enable optimizations
             settings.put("fast_open", true)
             settings.put("hopInterval", 30)
@@ -245,6 +605,32 @@ class ConfigOptimizer {
         return config
     }
     
+    /**
+     * Keep declared Hysteria rates within what the path has shown it carries
+     * Hysteria sends at the declared rate whatever the loss, so a rate above the path's
+     * capacity only adds loss: rates are scaled down by the loss UDP probes saw, and the
+     * download is held near the goodput last measured through the tunnel
+     */
+    private fun capHysteriaRates(settings: JSONObject, server: Server) {
+        val loss = server.udpLossPercent ?: 0
+        val lossScale = if (loss >= HYSTERIA_LOSS_THRESHOLD) (100 - loss.coerceAtMost(90)) / 100f else 1f
+        val goodputMbps = server.bandwidthKbps?.takeIf { it > 0 }?.let { it / 1000f * HYSTERIA_GOODPUT_HEADROOM }
+        
+        for (key in listOf("up_mbps", "down_mbps")) {
+            val declared = settings.optInt(key, 0)
+            if (declared <= 0) continue
+            
+            var rate = declared * lossScale
+            if (key == "down_mbps" && goodputMbps != null) rate = minOf(rate, goodputMbps)
+            val capped = rate.toInt().coerceAtLeast(1)
+            if (capped < declared) {
+                settings.put(key, capped)
+                Log.i(TAG, "Hysteria $key for ${server.name} capped $declared -> $capped " +
+                        "(UDP loss $loss%, goodput ${server.bandwidthKbps ?: "-"} kbps)")
+            }
+        }
+    }
+    
     /**
      * Trojan protocol specific optimizations
      */
@@ -294,8 +680,13 @@ class ConfigOptimizer {
                     if (server.has("method")) {
                         val method = server.getString("method")
                         if (!method.contains("chacha20") && !method.contains("aes-")) {
-                            // Suggest a better cipher
-                            server.put("method", "chacha20-ietf-poly1305")
+                            // Suggest the AEAD that seals fastest on this device
+                            val fastest = if (cipherBenchmark?.prefersAes == true) {
+                                "aes-128-gcm"
+                            } else {
+                                "chacha20-ietf-poly1305"
+                            }
+                            server.put("method", fastest)
                         }
                     }
                 }
@@ -0,0 +1,86 @@
+package com.hiddify.hiddifyng.utils
+
+import android.util.Log
+
+/**
+ * Per-server latency histograms (latency_sketch)
+ * Sketches are opaque blobs stored on the server row; samples from each probe run
+ * are merged in and older runs fade out, so percentiles track recent behaviour
+ */
+object LatencySketch {
+    private const val TAG = "LatencySketch"
+    private val QUANTILES = doubleArrayOf(0.5, 0.9, 0.99)
+    
+    init {
+        System.loadLibrary("xray-core-jni")
+    }
+    
+    @JvmStatic
+    private external fun mergeNative(sketch: ByteArray?, samplesNs: LongArray): ByteArray?
+    
+    @JvmStatic
+    private external fun quantilesNative(sketches: Array<ByteArray?>, quantiles: DoubleArray): LongArray?
+    
+    /**
+     * Latency percentiles of one sketch in milliseconds
+     */
+    data class Percentiles(
+        val p50Ms: Int,
+        val p90Ms: Int,
+        val p99Ms: Int
+    ) {
+        /** How far the slow tail sits above the typical sample */
+        val spreadMs: Int
+            get() = (p90Ms - p50Ms).coerceAtLeast(0)
+    }
+    
+    /**
+     * Add latency samples to a sketch
+     * @param sketch Stored sketch, or null to start a new one
+     * @param samplesNs Samples in nanoseconds
+     * @return The updated sketch, or the input unchanged if merging failed
+     */
+    fun merge(sketch: ByteArray?, samplesNs: LongArray): ByteArray? {
+        if (samplesNs.isEmpty()) return sketch
+        
+        return try {
+            mergeNative(sketch, samplesNs)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error merging latency samples", e)
+            sketch
+        }
+    }
+    
+    /**
+     * Read p50/p90/p99 from many sketches in one native call
+     * @return One entry per sketch in input order, null for missing or empty sketches
+     */
+    fun percentiles(sketches: List<ByteArray?>): List<Percentiles?> {
+        if (sketches.isEmpty()) return emptyList()
+        
+        val values = try {
+            quantilesNative(sketches.toTypedArray(), QUANTILES)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error reading latency sketches", e)
+            null
+        }
+        if (values == null || values.size != sketches.size * QUANTILES.size) {
+            return List(sketches.size) { null }
+        }
+        
+        return sketches.indices.map { i ->
+            val row = i * QUANTILES.size
+            if (values[row] < 0) {
+                null
+            } else {
+                Percentiles(
+                    p50Ms = toMs(values[row]),
+                    p90Ms = toMs(values[row + 1]),
+                    p99Ms = toMs(values[row + 2])
+                )
+            }
+        }
+    }
+    
+    private fun toMs(us: Long): Int = ((us + 500) / 1000).toInt().coerceAtLeast(1)
+}
@@ -0,0 +1,106 @@
+package com.hiddify.hiddifyng.utils
+
+import android.util.Log
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.flow.MutableStateFlow
+import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.flow.asStateFlow
+import kotlinx.coroutines.isActive
+import kotlinx.coroutines.launch
+
+/**
+ * Adaptive mux concurrency from live stream counts
+ * Samples the running core's sockets natively and recommends the concurrency
+ * that keeps p95 request latency low: backs off when multiplexed tunnels stall
+ * (head-of-line blocking), grows while bursts of streams force new tunnels.
+ * Recommendations apply on the next reconnect. Android 10 and later deny apps
+ * the kernel socket tables; the tuner then reports itself unavailable and
+ * recommends nothing.
+ */
+class MuxTuner {
+    companion object {
+        private const val TAG = "MuxTuner"
+        private const val SAMPLE_INTERVAL_MS = 2000L
+
+        init {
+            System.loadLibrary("xray-core-jni")
+        }
+
+        @JvmStatic
+        private external fun resetTuner(runningConcurrency: Int)
+
+        @JvmStatic
+        private external fun sampleCore(inboundPort: Int, serverPort: Int): IntArray?
+    }
+
+    /**
+     * One observation of the running core
+     * @param stalledTunnels Tunnels retransmitting or with a deep send queue
+     */
+    data class MuxStats(
+        val streams: Int,
+        val tunnels: Int,
+        val stalledTunnels: Int,
+        val queuedKb: Int
+    )
+
+    private val _stats = MutableStateFlow<MuxStats?>(null)
+    val stats: StateFlow<MuxStats?> = _stats.asStateFlow()
+
+    // 0 when there is no recommendation
+    private val _recommendedConcurrency = MutableStateFlow(0)
+    val recommendedConcurrency: StateFlow<Int> = _recommendedConcurrency.asStateFlow()
+
+    private val _available = MutableStateFlow(true)
+
+    /**
+     * False once the core's sockets turned out to be unreadable on this device
+     */
+    val available: StateFlow<Boolean> = _available.asStateFlow()
+
+    private var job: Job? = null
+
+    /**
+     * Start observing a core that was launched with the given concurrency
+     * @param inboundPort Local inbound the app's streams arrive on
+     * @param serverPort Port of the proxy server the tunnels connect to
+     * @param runningConcurrency Mux concurrency in the running config
+     */
+    fun start(inboundPort: Int, serverPort: Int, runningConcurrency: Int) {
+        stop()
+        resetTuner(runningConcurrency)
+        _stats.value = null
+        _recommendedConcurrency.value = runningConcurrency
+        _available.value = true
+
+        job = CoroutineManager.ioScope.launch {
+            while (isActive) {
+                delay(SAMPLE_INTERVAL_MS)
+                val sample = sampleCore(inboundPort, serverPort) ?: break
+                if (sample[5] == 0) {
+                    // An empty table would read as an idle link and shrink the mux
+                    Log.w(TAG, "Socket tables are not readable, mux tuning unavailable")
+                    _available.value = false
+                    _recommendedConcurrency.value = 0
+                    break
+                }
+
+                _stats.value = MuxStats(sample[0], sample[1], sample[2], sample[3])
+                if (sample[4] != _recommendedConcurrency.value) {
+                    Log.i(TAG, "Mux concurrency $runningConcurrency -> ${sample[4]} " +
+                        "(${sample[0]} streams, ${sample[2]}/${sample[1]} tunnels stalled)")
+                    _recommendedConcurrency.value = sample[4]
+                }
+            }
+        }
+    }
+
+    /**
+     * Stop observing; the last recommendation stays available
+     */
+    fun stop() {
+        job?.cancel()
+        job = null
+    }
+}
@@ -1,13 +1,21 @@
 package com.hiddify.hiddifyng.utils
 
+import android.content.Context
+import android.net.ConnectivityManager
 import android.util.Log
+import androidx.annotation.Keep
+import com.hiddify.hiddifyng.core.NativeServerRecords
 import com.hiddify.hiddifyng.database.entity.Server
-import java.io.IOException
-import java.net.InetAddress
-import java.net.InetSocketAddress
-import java.net.Socket
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.flow.Flow
+import kotlinx.coroutines.flow.buffer
+import kotlinx.coroutines.flow.channelFlow
+import kotlinx.coroutines.flow.flowOn
+import kotlinx.coroutines.isActive
+import kotlinx.coroutines.launch
+import java.io.File
 import java.util.concurrent.TimeUnit
-import kotlin.math.min
+import java.util.concurrent.atomic.AtomicInteger
 
 /**
  * Utility for ping testing servers
@@ -17,42 +25,721 @@ object PingUtils {
     private const val TAG = "PingUtils"
     private const val TIMEOUT_MS = 5000
     private const val NUM_SAMPLES = 3 // Number of ping samples to average
-    private const val FAILED_PING = -1
+    const val FAILED_PING = -1
+    
+    // Native TCP sweeps (connect_prober): per-connect timeout and sockets open at once
+    private const val PROBE_TIMEOUT_MS = 2000
+    private const val PROBE_MAX_IN_FLIGHT = 256
+    private const val PROBE_RESULT_STRIDE = 6
+    
+    // Probe outcomes (connect_prober::Status)
+    const val PROBE_OK = 0
+    const val PROBE_TIMEOUT = 1
+    const val PROBE_REFUSED = 2
+    const val PROBE_UNREACHABLE = 3
+    const val PROBE_RESOLVE_FAILED = 4
+    const val PROBE_ERROR = 5
+    
+    // Native ICMP echoes (icmp_prober): spacing between echoes to one host
+    private const val ICMP_INTERVAL_MS = 200
+    private const val ICMP_RESULT_STRIDE = 7
+    
+    // Echo outcomes (icmp_prober::Status)
+    const val ICMP_OK = 0
+    const val ICMP_TIMEOUT = 1
+    const val ICMP_UNREACHABLE = 2
+    const val ICMP_RESOLVE_FAILED = 3
+    const val ICMP_UNSUPPORTED = 4
+    const val ICMP_ERROR = 5
+    
+    // Native TLS handshake timing (tls_prober)
+    private const val TLS_TIMEOUT_MS = 3000
+    private const val TLS_MAX_IN_FLIGHT = 64
+    private const val TLS_RESULT_STRIDE = 7
+    private const val DEFAULT_FINGERPRINT = "chrome"
+    
+    // Handshake outcomes (tls_prober::Status)
+    const val TLS_OK = 0
+    const val TLS_TIMEOUT = 1
+    const val TLS_REFUSED = 2
+    const val TLS_UNREACHABLE = 3
+    const val TLS_RESOLVE_FAILED = 4
+    const val TLS_HANDSHAKE_FAILED = 5
+    const val TLS_ERROR = 6
+    
+    // Native QUIC probe trains (udp_prober): probes per server and their spacing
+    private const val UDP_PROBE_COUNT = 10
+    private const val UDP_INTERVAL_MS = 20
+    private const val UDP_TIMEOUT_MS = 1000
+    private const val UDP_RESULT_STRIDE = 8
+    
+    // Probe train outcomes (udp_prober::Status)
+    const val UDP_OK = 0
+    const val UDP_TIMEOUT = 1
+    const val UDP_REFUSED = 2
+    const val UDP_UNREACHABLE = 3
+    const val UDP_RESOLVE_FAILED = 4
+    const val UDP_ERROR = 5
+    
+    // Transport classes for endpoint grouping (endpoint_dedup::Transport)
+    const val TRANSPORT_TCP = 0
+    const val TRANSPORT_UDP = 1
+    
+    // Shared probe result cache (probe_cache); a cached failure reads as FAILED_PING
+    private const val PROBE_CACHE_FILE = "probe_cache.bin"
+    const val CACHE_MISS = 0
+    
+    init {
+        System.loadLibrary("xray-core-jni")
+    }
+    
+    @JvmStatic
+    private external fun probeTcpNative(
+        hosts: Array<String>,
+        ports: IntArray,
+        samples: Int,
+        timeoutMs: Int,
+        maxInFlight: Int,
+        sink: Any
+    ): Int
+    
+    @JvmStatic
+    private external fun probeIcmpNative(
+        hosts: Array<String>,
+        count: Int,
+        intervalMs: Int,
+        timeoutMs: Int
+    ): LongArray?
+    
+    @JvmStatic
+    private external fun probeTlsNative(
+        hosts: Array<String>,
+        ports: IntArray,
+        snis: Array<String>,
+        fingerprints: Array<String>,
+        timeoutMs: Int,
+        maxInFlight: Int
+    ): LongArray?
+    
+    @JvmStatic
+    private external fun probeUdpNative(
+        hosts: Array<String>,
+        ports: IntArray,
+        count: Int,
+        intervalMs: Int,
+        timeoutMs: Int
+    ): LongArray?
+    
+    @JvmStatic
+    private external fun groupEndpointsNative(
+        hosts: Array<String>,
+        ports: IntArray,
+        transports: IntArray
+    ): IntArray?
+    
+    @JvmStatic
+    private external fun setDnsServersNative(servers: Array<String>)
+    
+    @JvmStatic
+    private external fun openProbeCacheNative(path: String): Boolean
+    
+    @JvmStatic
+    private external fun lookupProbeCacheNative(hosts: Array<String>, ports: IntArray, transport: Int): IntArray?
+    
+    @JvmStatic
+    private external fun storeProbeCacheNative(hosts: Array<String>, ports: IntArray, transport: Int, pings: IntArray)
+    
+    /**
+     * Point native probe lookups (dns_resolver) at the active network's DNS servers
+     * With Private DNS on, or no servers known, lookups go through the system resolver
+     * instead, so probes never send plain-text queries the user opted out of
+     */
+    fun configureDns(context: Context) {
+        try {
+            val connectivityManager = context.getSystemService(Context.CONNECTIVITY_SERVICE) as ConnectivityManager
+            val servers = connectivityManager.activeNetwork
+                ?.let { connectivityManager.getLinkProperties(it) }
+                ?.takeUnless { it.isPrivateDnsActive }
+                ?.dnsServers
+                ?.mapNotNull { it.hostAddress }
+                ?: emptyList()
+            setDnsServersNative(servers.toTypedArray())
+        } catch (e: Exception) {
+            Log.e(TAG, "Error reading DNS servers", e)
+        }
+    }
+    
+    /**
+     * Map the probe result cache shared by the ping worker and the UI
+     * It lives in a file, so results survive the process; call once at startup
+     */
+    fun openProbeCache(context: Context) {
+        try {
+            val path = File(context.filesDir, PROBE_CACHE_FILE).absolutePath
+            if (!openProbeCacheNative(path)) {
+                Log.w(TAG, "Probe cache unavailable, every ping will probe")
+            }
+        } catch (e: Exception) {
+            Log.e(TAG, "Error opening probe cache", e)
+        }
+    }
+    
+    /**
+     * Results another caller measured recently enough to reuse instead of probing
+     * Successes stay fresh for two minutes, failures for 30 seconds
+     * @return Per target the ping in milliseconds, FAILED_PING for a recent failure,
+     * or CACHE_MISS
+     */
+    fun cachedPings(targets: List<Pair<String, Int>>, transport: Int): IntArray {
+        if (targets.isEmpty()) return IntArray(0)
+        
+        return try {
+            lookupProbeCacheNative(
+                targets.map { it.first }.toTypedArray(),
+                targets.map { it.second }.toIntArray(),
+                transport
+            )
+        } catch (e: Exception) {
+            Log.e(TAG, "Probe cache lookup failed", e)
+            null
+        } ?: IntArray(targets.size) { CACHE_MISS }
+    }
+    
+    /**
+     * Leave results for other callers; a ping of 0 or less records a failure
+     */
+    fun cachePings(targets: List<Pair<String, Int>>, pings: List<Int>, transport: Int) {
+        if (targets.isEmpty() || targets.size != pings.size) return
+        
+        try {
+            storeProbeCacheNative(
+                targets.map { it.first }.toTypedArray(),
+                targets.map { it.second }.toIntArray(),
+                transport,
+                pings.toIntArray()
+            )
+        } catch (e: Exception) {
+            Log.e(TAG, "Probe cache store failed", e)
+        }
+    }
+    
+    /**
+     * TCP connect result for one probed target
+     * @param index Position of the target in the list passed to probeTcp
+     * @param bestNs Fastest completed connect, 0 if none completed
+     * @param samplesNs Every completed connect in order, for the server's latency sketch
+     */
+    data class TcpProbeResult(
+        val index: Int,
+        val status: Int,
+        val bestNs: Long,
+        val meanNs: Long,
+        val successes: Int,
+        val attempts: Int,
+        val samplesNs: LongArray = LongArray(0)
+    ) {
+        val reachable: Boolean
+            get() = status == PROBE_OK
+        
+        /** Fastest connect in whole milliseconds (at least 1), or FAILED_PING */
+        val pingMs: Int
+            get() = if (reachable) TimeUnit.NANOSECONDS.toMillis(bestNs).toInt().coerceAtLeast(1) else FAILED_PING
+    }
+    
+    /**
+     * ICMP echo statistics for one host
+     * @param index Position of the host in the list passed to probeIcmp
+     * @param jitterNs Mean difference between consecutive round trips
+     */
+    data class IcmpProbeResult(
+        val index: Int,
+        val status: Int,
+        val sent: Int,
+        val received: Int,
+        val minNs: Long,
+        val avgNs: Long,
+        val maxNs: Long,
+        val jitterNs: Long
+    ) {
+        val reachable: Boolean
+            get() = status == ICMP_OK
+        
+        /** Share of echoes lost, 0 to 100 */
+        val lossPercent: Int
+            get() = if (sent > 0) (sent - received) * 100 / sent else 100
+        
+        /** Fastest round trip in whole milliseconds (at least 1), or FAILED_PING */
+        val pingMs: Int
+            get() = if (reachable) TimeUnit.NANOSECONDS.toMillis(minNs).toInt().coerceAtLeast(1) else FAILED_PING
+    }
+    
+    /**
+     * UDP round-trip statistics for one QUIC server
+     * @param index Position of the target in the list passed to probeUdp
+     * @param jitterNs Mean difference between consecutive round trips
+     * @param quicVersion First QUIC version the server offered, 0 if it never answered
+     */
+    data class UdpProbeResult(
+        val index: Int,
+        val status: Int,
+        val sent: Int,
+        val received: Int,
+        val minNs: Long,
+        val avgNs: Long,
+        val maxNs: Long,
+        val jitterNs: Long,
+        val quicVersion: Int
+    ) {
+        val reachable: Boolean
+            get() = status == UDP_OK
+        
+        /** Share of probes lost, 0 to 100 */
+        val lossPercent: Int
+            get() = if (sent > 0) (sent - received) * 100 / sent else 100
+        
+        /** Fastest round trip in whole milliseconds (at least 1), or FAILED_PING */
+        val pingMs: Int
+            get() = if (reachable) TimeUnit.NANOSECONDS.toMillis(minNs).toInt().coerceAtLeast(1) else FAILED_PING
+        
+        val jitterMs: Int
+            get() = TimeUnit.NANOSECONDS.toMillis(jitterNs).toInt()
+    }
+    
+    /**
+     * Endpoint and ClientHello shape for a handshake probe
+     * @param fingerprint uTLS fingerprint name the hello imitates
+     */
+    data class TlsTarget(
+        val host: String,
+        val port: Int,
+        val sni: String,
+        val fingerprint: String
+    )
+    
+    /**
+     * TLS handshake phases for one target, each measured from the start of the TCP connect
+     * @param handshakeNs End of the server's first flight, 0 if it did not finish
+     * @param version Negotiated protocol version, 0x0304 for TLS 1.3
+     */
+    data class TlsProbeResult(
+        val index: Int,
+        val status: Int,
+        val connectNs: Long,
+        val firstByteNs: Long,
+        val serverHelloNs: Long,
+        val handshakeNs: Long,
+        val version: Int,
+        val cipher: Int
+    ) {
+        val completed: Boolean
+            get() = status == TLS_OK && handshakeNs > 0
+        
+        val connectMs: Int
+            get() = toMs(connectNs)
+        
+        val helloMs: Int
+            get() = toMs(serverHelloNs)
+        
+        /** End of the server's first flight in milliseconds, or null if it did not finish */
+        val handshakeMs: Int?
+            get() = if (handshakeNs > 0) toMs(handshakeNs) else null
+        
+        private fun toMs(ns: Long): Int = TimeUnit.NANOSECONDS.toMillis(ns).toInt().coerceAtLeast(1)
+    }
+    
+    /**
+     * Decodes the native result rows; only ever called from native code
+     */
+    private class TcpProbeSink(
+        samples: Int,
+        private val onResults: (List<TcpProbeResult>) -> Boolean
+    ) {
+        // Each row carries one column per requested sample after the fixed fields
+        private val stride = PROBE_RESULT_STRIDE + samples.coerceAtLeast(1)
+        
+        @Keep
+        fun onResults(rows: LongArray): Boolean {
+            val results = (0 until rows.size / stride).map { i ->
+                val row = i * stride
+                val successes = rows[row + 4].toInt()
+                TcpProbeResult(
+                    index = rows[row].toInt(),
+                    status = rows[row + 1].toInt(),
+                    bestNs = rows[row + 2],
+                    meanNs = rows[row + 3],
+                    successes = successes,
+                    attempts = rows[row + 5].toInt(),
+                    samplesNs = rows.copyOfRange(
+                        row + PROBE_RESULT_STRIDE,
+                        row + PROBE_RESULT_STRIDE + successes.coerceIn(0, stride - PROBE_RESULT_STRIDE)
+                    )
+                )
+            }
+            return onResults(results)
+        }
+    }
+    
+    /**
+     * Probe many host:port targets concurrently from one native event loop
+     * Blocks the calling thread; results arrive in completion order, not list order
+     * @param onResults Called with each batch of finished targets; return false to stop early
+     * @return Number of targets reported
+     */
+    fun probeTcp(
+        targets: List<Pair<String, Int>>,
+        samples: Int = NUM_SAMPLES,
+        timeoutMs: Int = PROBE_TIMEOUT_MS,
+        maxInFlight: Int = PROBE_MAX_IN_FLIGHT,
+        onResults: (List<TcpProbeResult>) -> Boolean
+    ): Int {
+        if (targets.isEmpty()) return 0
+        
+        return try {
+            probeTcpNative(
+                targets.map { it.first }.toTypedArray(),
+                targets.map { it.second }.toIntArray(),
+                samples,
+                timeoutMs,
+                maxInFlight,
+                TcpProbeSink(samples, onResults)
+            )
+        } catch (e: Exception) {
+            Log.e(TAG, "TCP probe failed", e)
+            0
+        }
+    }
+    
+    /**
+     * Send ICMP echoes to many hosts at once over unprivileged ping sockets
+     * Blocks for about (count - 1) * intervalMs + timeoutMs
+     * @return One result per host in input order, empty if the probe could not run
+     */
+    fun probeIcmp(
+        hosts: List<String>,
+        count: Int = NUM_SAMPLES,
+        intervalMs: Int = ICMP_INTERVAL_MS,
+        timeoutMs: Int = PROBE_TIMEOUT_MS
+    ): List<IcmpProbeResult> {
+        if (hosts.isEmpty()) return emptyList()
+        
+        val rows = try {
+            probeIcmpNative(hosts.toTypedArray(), count, intervalMs, timeoutMs)
+        } catch (e: Exception) {
+            Log.e(TAG, "ICMP probe failed", e)
+            null
+        } ?: return emptyList()
+        
+        return (0 until rows.size / ICMP_RESULT_STRIDE).map { i ->
+            val row = i * ICMP_RESULT_STRIDE
+            IcmpProbeResult(
+                index = i,
+                status = rows[row].toInt(),
+                sent = rows[row + 1].toInt(),
+                received = rows[row + 2].toInt(),
+                minNs = rows[row + 3],
+                avgNs = rows[row + 4],
+                maxNs = rows[row + 5],
+                jitterNs = rows[row + 6]
+            )
+        }
+    }
+    
+    /**
+     * UDP probe target for a server that listens with plain QUIC
+     * @return null for TCP servers and for QUIC servers whose packets are obfuscated,
+     * which never answer a probe
+     */
+    fun udpTargetOf(server: Server): Pair<String, Int>? {
+        val protocol = server.protocol.lowercase()
+        if (!protocol.startsWith("hysteria") && protocol != "tuic") return null
+        if (!server.hysteriaObfs.isNullOrEmpty()) return null
+        if (server.hysteriaProtocol.let { it != null && it != "udp" }) return null
+        
+        val host = parseHost(server.address)
+        if (host.isEmpty()) return null
+        return host to NativeServerRecords.resolvePort(server)
+    }
+    
+    /**
+     * Send paced trains of QUIC version-negotiation probes to many servers at once
+     * Blocks for about (count - 1) * intervalMs + timeoutMs
+     * @return One result per target in input order, empty if the probe could not run
+     */
+    fun probeUdp(
+        targets: List<Pair<String, Int>>,
+        count: Int = UDP_PROBE_COUNT,
+        intervalMs: Int = UDP_INTERVAL_MS,
+        timeoutMs: Int = UDP_TIMEOUT_MS
+    ): List<UdpProbeResult> {
+        if (targets.isEmpty()) return emptyList()
+        
+        val rows = try {
+            probeUdpNative(
+                targets.map { it.first }.toTypedArray(),
+                targets.map { it.second }.toIntArray(),
+                count,
+                intervalMs,
+                timeoutMs
+            )
+        } catch (e: Exception) {
+            Log.e(TAG, "UDP probe failed", e)
+            null
+        } ?: return emptyList()
+        
+        return (0 until rows.size / UDP_RESULT_STRIDE).map { i ->
+            val row = i * UDP_RESULT_STRIDE
+            UdpProbeResult(
+                index = i,
+                status = rows[row].toInt(),
+                sent = rows[row + 1].toInt(),
+                received = rows[row + 2].toInt(),
+                minNs = rows[row + 3],
+                avgNs = rows[row + 4],
+                maxNs = rows[row + 5],
+                jitterNs = rows[row + 6],
+                quicVersion = rows[row + 7].toInt()
+            )
+        }
+    }
+    
+    /**
+     * Targets grouped by the endpoint they resolve to
+     * @param members Target indices of each group, the one to probe first
+     */
+    data class EndpointGroups(val members: List<List<Int>>) {
+        /** Index of the target to probe for each group */
+        val representatives: List<Int>
+            get() = members.map { it.first() }
+        
+        /** Targets that need no probe of their own */
+        val duplicates: Int
+            get() = members.sumOf { it.size } - members.size
+    }
+    
+    /**
+     * Group targets that reach the same resolved address set and port over one transport,
+     * so each endpoint is probed once however many servers list it
+     * Resolves every host through dns_resolver, leaving the answers cached for the probe
+     * @param transport TRANSPORT_TCP or TRANSPORT_UDP
+     * @return Groups in order of their first target; one group per target if grouping failed
+     */
+    fun groupEndpoints(targets: List<Pair<String, Int>>, transport: Int): EndpointGroups {
+        if (targets.isEmpty()) return EndpointGroups(emptyList())
+        
+        val firsts = try {
+            groupEndpointsNative(
+                targets.map { it.first }.toTypedArray(),
+                targets.map { it.second }.toIntArray(),
+                IntArray(targets.size) { transport }
+            )
+        } catch (e: Exception) {
+            Log.e(TAG, "Endpoint grouping failed", e)
+            null
+        } ?: return EndpointGroups(targets.indices.map { listOf(it) })
+        
+        val groups = LinkedHashMap<Int, MutableList<Int>>()
+        for ((i, first) in firsts.withIndex()) {
+            groups.getOrPut(first) { mutableListOf() }.add(i)
+        }
+        return EndpointGroups(groups.values.toList())
+    }
+    
+    /**
+     * Handshake probe target for a server that speaks TLS over TCP
+     * @return null for plain and QUIC-based servers
+     */
+    fun tlsTargetOf(server: Server): TlsTarget? {
+        val protocol = server.protocol.lowercase()
+        val reality = server.securityType == "reality" || protocol == "reality"
+        if (!server.tls && !reality) return null
+        if (protocol.startsWith("hysteria") || protocol == "tuic") return null
+        
+        val host = parseHost(server.address)
+        if (host.isEmpty()) return null
+        return TlsTarget(
+            host = host,
+            port = NativeServerRecords.resolvePort(server),
+            sni = server.tlsServerName?.takeIf { it.isNotEmpty() } ?: host,
+            fingerprint = server.tlsFingerprint?.takeIf { it.isNotEmpty() } ?: DEFAULT_FINGERPRINT
+        )
+    }
+    
+    /**
+     * Time the TLS handshake of many targets at once, up to the server's first flight
+     * Blocks until every target finishes or times out
+     * @return One result per target in input order, empty if the probe could not run
+     */
+    fun probeTls(
+        targets: List<TlsTarget>,
+        timeoutMs: Int = TLS_TIMEOUT_MS,
+        maxInFlight: Int = TLS_MAX_IN_FLIGHT
+    ): List<TlsProbeResult> {
+        if (targets.isEmpty()) return emptyList()
+        
+        val rows = try {
+            probeTlsNative(
+                targets.map { it.host }.toTypedArray(),
+                targets.map { it.port }.toIntArray(),
+                targets.map { it.sni }.toTypedArray(),
+                targets.map { it.fingerprint }.toTypedArray(),
+                timeoutMs,
+                maxInFlight
+            )
+        } catch (e: Exception) {
+            Log.e(TAG, "TLS probe failed", e)
+            null
+        } ?: return emptyList()
+        
+        return (0 until rows.size / TLS_RESULT_STRIDE).map { i ->
+            val row = i * TLS_RESULT_STRIDE
+            TlsProbeResult(
+                index = i,
+                status = rows[row].toInt(),
+                connectNs = rows[row + 1],
+                firstByteNs = rows[row + 2],
+                serverHelloNs = rows[row + 3],
+                handshakeNs = rows[row + 4],
+                version = rows[row + 5].toInt(),
+                cipher = rows[row + 6].toInt()
+            )
+        }
+    }
     
     /**
      * Ping a server using the most appropriate method based on server type
+     * A result the ping worker or an earlier call left in the probe cache is reused
+     * while fresh; new results are left there in turn
      * Returns the ping time in milliseconds, or FAILED_PING if failed
      */
     suspend fun pingServer(server: Server): Int {
         val host = parseHost(server.address)
-        val port = parsePort(server.address)
+        val port = NativeServerRecords.resolvePort(server)
         
         if (host.isEmpty() || port <= 0) {
             Log.e(TAG, "Invalid server address: ${server.address}")
             return FAILED_PING
         }
         
-        // Try multiple ping methods and take the best result
-        val results = mutableListOf<Int>()
+        // QUIC servers do not listen on TCP; their own UDP port is the only honest probe
+        val udpTarget = udpTargetOf(server)
+        val target = udpTarget ?: (host to port)
+        val transport = if (udpTarget != null) TRANSPORT_UDP else TRANSPORT_TCP
+        val cached = cachedPings(listOf(target), transport).first()
+        if (cached != CACHE_MISS) {
+            Log.d(TAG, "Cached ping of ${target.first}:${target.second}: $cached ms")
+            return cached
+        }
         
-        // Try TCP ping (most reliable for VPN servers)
-        val tcpPing = pingTcp(host, port)
-        if (tcpPing > 0) results.add(tcpPing)
+        val ping = if (udpTarget != null) {
+            probeUdp(listOf(udpTarget)).firstOrNull()?.pingMs ?: FAILED_PING
+        } else {
+            probeServer(host, port)
+        }
+        cachePings(listOf(target), listOf(ping), transport)
+        return ping
+    }
+    
+    /**
+     * Ping many servers at once, emitting each server's result the moment it is known
+     * Cached results come first, then TCP connects in completion order as the native sweep
+     * reports them, QUIC servers when their probe trains end, and last the ICMP and HTTP
+     * fallbacks of servers whose connect failed. Servers sharing an endpoint are probed once.
+     * The flow buffers one result per server, so the sweep never waits on a slow collector
+     * @param stopAfterReachable Stop probing once this many servers answered; 0 probes all
+     * @return Flow of (server, ping in milliseconds or FAILED_PING), at most one per server
+     */
+    fun pingServers(servers: List<Server>, stopAfterReachable: Int = 0): Flow<Pair<Server, Int>> = channelFlow {
+        val reachable = AtomicInteger()
         
-        // Try ICMP ping if TCP failed
-        if (results.isEmpty()) {
-            val icmpPing = pingIcmp(host)
-            if (icmpPing > 0) results.add(icmpPing)
+        // Hands one result to the collector; false once no more are wanted
+        fun report(server: Server, ping: Int): Boolean {
+            trySend(server to ping)
+            if (ping > 0 && stopAfterReachable > 0 && reachable.incrementAndGet() >= stopAfterReachable) {
+                close()
+            }
+            return !isClosedForSend
         }
         
-        // Try HTTP ping as a fallback
-        if (results.isEmpty() && isCommonHttpPort(port)) {
-            val httpPing = pingHttp(host, port)
-            if (httpPing > 0) results.add(httpPing)
+        val udpEndpoints = LinkedHashMap<Pair<String, Int>, MutableList<Server>>()
+        val tcpEndpoints = LinkedHashMap<Pair<String, Int>, MutableList<Server>>()
+        for (server in servers) {
+            val host = parseHost(server.address)
+            val port = NativeServerRecords.resolvePort(server)
+            val udpTarget = udpTargetOf(server)
+            when {
+                host.isEmpty() || port <= 0 -> report(server, FAILED_PING)
+                udpTarget != null -> udpEndpoints.getOrPut(udpTarget) { mutableListOf() }.add(server)
+                else -> tcpEndpoints.getOrPut(host to port) { mutableListOf() }.add(server)
+            }
+        }
+        
+        // Endpoints measured moments ago by the worker or an earlier run are not probed again
+        fun uncached(endpoints: Map<Pair<String, Int>, List<Server>>, transport: Int): List<Pair<String, Int>> {
+            val targets = endpoints.keys.toList()
+            val cached = cachedPings(targets, transport)
+            return targets.filterIndexed { i, target ->
+                if (cached[i] == CACHE_MISS) return@filterIndexed true
+                endpoints.getValue(target).forEach { report(it, cached[i]) }
+                false
+            }
         }
+        val udpTargets = uncached(udpEndpoints, TRANSPORT_UDP)
+        val tcpTargets = uncached(tcpEndpoints, TRANSPORT_TCP)
+        if (isClosedForSend) return@channelFlow
         
-        // Return the minimum successful ping value or FAILED_PING
-        return if (results.isNotEmpty()) results.minOrNull() ?: FAILED_PING else FAILED_PING
+        // Probe trains run alongside the TCP sweep; they cannot be cut short, so a stop
+        // only drops their results
+        if (udpTargets.isNotEmpty()) {
+            launch {
+                val results = probeUdp(udpTargets)
+                val pings = udpTargets.indices.map { results.getOrNull(it)?.pingMs ?: FAILED_PING }
+                cachePings(udpTargets, pings, TRANSPORT_UDP)
+                for ((i, target) in udpTargets.withIndex()) {
+                    udpEndpoints.getValue(target).forEach { report(it, pings[i]) }
+                }
+            }
+        }
+        
+        val answered = HashSet<Int>()
+        probeTcp(tcpTargets) { results ->
+            val fresh = results.filter { it.reachable }
+            cachePings(fresh.map { tcpTargets[it.index] }, fresh.map { it.pingMs }, TRANSPORT_TCP)
+            for (result in fresh) {
+                answered.add(result.index)
+                tcpEndpoints.getValue(tcpTargets[result.index]).forEach { report(it, result.pingMs) }
+            }
+            isActive && !isClosedForSend // stop once enough answered or the collector is gone
+        }
+        
+        // Connects that failed, or never finished because the sweep could not run, fall back
+        for ((i, target) in tcpTargets.withIndex()) {
+            if (i in answered || isClosedForSend) continue
+            launch {
+                val ping = probeFallback(target.first, target.second)
+                cachePings(listOf(target), listOf(ping), TRANSPORT_TCP)
+                tcpEndpoints.getValue(target).forEach { report(it, ping) }
+            }
+        }
+    }.buffer(servers.size.coerceAtLeast(1)).flowOn(Dispatchers.IO)
+    
+    /**
+     * Probe a TCP server directly, trying TCP, ICMP and HTTP in turn
+     */
+    private fun probeServer(host: String, port: Int): Int {
+        // Try TCP ping (most reliable for VPN servers)
+        val tcpPing = pingTcp(host, port)
+        return if (tcpPing > 0) tcpPing else probeFallback(host, port)
+    }
+    
+    /**
+     * Ping a server whose TCP connect failed, by ICMP and then HTTP on common web ports
+     * @return Ping in milliseconds, or FAILED_PING
+     */
+    private fun probeFallback(host: String, port: Int): Int {
+        val icmpPing = pingIcmp(host)
+        if (icmpPing > 0) return icmpPing
+        
+        return if (isCommonHttpPort(port)) pingHttp(host, port) else FAILED_PING
     }
     
     /**
@@ -87,115 +774,49 @@ object PingUtils {
         }
     }
     
-    /**
-     * Parse port from server address
-     */
-    private fun parsePort(address: String): Int {
-        try {
-            // Extract port from address formats:
-            // host:port, [2001:db8::1]:port
-            val portStr = when {
-                address.contains("]:") -> {
-                    // IPv6 with port
-                    address.substringAfterLast("]:")
-                }
-                address.contains(":") && !address.startsWith("[") -> {
-                    // IPv4 with port or hostname:port
-                    address.substringAfterLast(":")
-                }
-                else -> {
-                    // Default to common ports
-                    return 443 // Default to HTTPS port
-                }
-            }
-            
-            return portStr.trim().toIntOrNull() ?: 443
-        } catch (e: Exception) {
-            Log.e(TAG, "Error parsing port from address: $address", e)
-            return 443 // Default to HTTPS port
-        }
-    }
-    
     /**
      * Perform a TCP ping
      */
     private fun pingTcp(host: String, port: Int): Int {
         var bestTime = FAILED_PING
-        var socket: Socket? = null
         
-        for (i in 0 until NUM_SAMPLES) {
-            try {
-                val startTime = System.nanoTime()
-                socket = Socket()
-                socket.connect(InetSocketAddress(host, port), TIMEOUT_MS)
-                val endTime = System.nanoTime()
-                
-                val timeMs = TimeUnit.NANOSECONDS.toMillis(endTime - startTime)
-                
-                // Update best time
-                if (bestTime == FAILED_PING || timeMs < bestTime) {
-                    bestTime = timeMs.toInt()
-                }
-                
-                Log.d(TAG, "TCP ping to $host:$port - $timeMs ms")
-            } catch (e: Exception) {
-                Log.d(TAG, "TCP ping to $host:$port failed", e)
-            } finally {
-                try {
-                    socket?.close()
-                } catch (e: IOException) {
-                    // Ignore
-                }
-            }
-            
-            // Small delay between samples
-            Thread.sleep(100)
+        probeTcp(listOf(host to port)) { results ->
+            results.firstOrNull()?.let { bestTime = it.pingMs }
+            true
+        }
+        
+        if (bestTime != FAILED_PING) {
+            Log.d(TAG, "TCP ping to $host:$port - $bestTime ms")
+        } else {
+            Log.d(TAG, "TCP ping to $host:$port failed")
         }
         
         return bestTime
     }
     
     /**
-     * Perform an ICMP ping (requires root)
+     * Perform an ICMP ping
      */
     private fun pingIcmp(host: String): Int {
-        try {
-            val runtime = Runtime.getRuntime()
-            var pingTimeout = min(TIMEOUT_MS, 5000).toString()
-            
-            // Determine OS and adjust command
-            val pingCommand = if (System.getProperty("os.name").lowercase().contains("windows")) {
-                // Windows ping
-                "ping -n 1 -w $pingTimeout $host"
-            } else {
-                // Linux/Android ping
-                "ping -c 1 -W $pingTimeout $host"
-            }
-            
-            val startTime = System.nanoTime()
-            val process = runtime.exec(pingCommand)
-            val exitValue = process.waitFor()
-            val endTime = System.nanoTime()
-            
-            return if (exitValue == 0) {
-                // Ping succeeded
-                val timeMs = TimeUnit.NANOSECONDS.toMillis(endTime - startTime)
-                Log.d(TAG, "ICMP ping to $host - $timeMs ms")
-                timeMs.toInt()
-            } else {
-                Log.d(TAG, "ICMP ping to $host failed with exit code $exitValue")
-                FAILED_PING
-            }
-        } catch (e: Exception) {
-            Log.d(TAG, "ICMP ping to $host failed", e)
-            return FAILED_PING
+        val result = probeIcmp(listOf(host)).firstOrNull() ?: return FAILED_PING
+        
+        if (result.reachable) {
+            Log.d(TAG, "ICMP ping to $host - ${result.pingMs} ms, ${result.lossPercent}% loss, " +
+                    "jitter ${TimeUnit.NANOSECONDS.toMicros(result.jitterNs)} us")
+        } else {
+            Log.d(TAG, "ICMP ping to $host failed with status ${result.status}")
         }
+        
+        return result.pingMs
     }
     
     /**
      * Perform an HTTP ping
+     * HEAD requests to http or, on port 443, https; also the ping worker's fallback
+     * for servers whose TCP probe failed
+     * @return Fastest of NUM_SAMPLES requests in milliseconds, or FAILED_PING
      */
-    private fun pingHttp(host: String, port: Int): Int {
+    fun pingHttp(host: String, port: Int): Int {
         var bestTime = FAILED_PING
         
         for (i in 0 until NUM_SAMPLES) {
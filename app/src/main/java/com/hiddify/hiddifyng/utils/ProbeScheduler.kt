@@ -0,0 +1,114 @@
+package com.hiddify.hiddifyng.utils
+
+import android.util.Log
+import com.hiddify.hiddifyng.database.entity.Server
+import java.io.File
+
+/**
+ * Picks which servers a ping run probes (probe_scheduler)
+ * Steady, idle and dead servers are re-probed less and less often, so a run spends its
+ * budget on favorites, the selected server, jittery servers and stale entries
+ * @param stateFile File the per-server probe history persists to
+ */
+class ProbeScheduler(private val stateFile: File) {
+    companion object {
+        private const val TAG = "ProbeScheduler"
+        
+        // Servers already known that one run may probe; servers never probed come on top
+        const val PROBE_BUDGET = 32
+        
+        // probe_scheduler::Flags
+        private const val FLAG_FAVORITE = 1
+        private const val FLAG_SELECTED = 2
+        
+        init {
+            System.loadLibrary("xray-core-jni")
+        }
+        
+        @JvmStatic
+        private external fun openNative(path: String): Boolean
+        
+        @JvmStatic
+        private external fun planNative(serverIds: LongArray, flags: IntArray, budget: Int): LongArray?
+        
+        @JvmStatic
+        private external fun nextDueNative(serverIds: LongArray, flags: IntArray): Int
+        
+        @JvmStatic
+        private external fun recordNative(serverIds: LongArray, latenciesMs: FloatArray)
+        
+        @JvmStatic
+        private external fun saveNative(): Boolean
+    }
+    
+    /**
+     * Servers due for a probe, most urgent first
+     * Servers missing from the list are forgotten
+     * @param servers Every configured server
+     * @param budget Most servers with a probe history to return
+     * @return Subset of servers; all of them if the scheduler is unavailable
+     */
+    fun plan(servers: List<Server>, budget: Int = PROBE_BUDGET): List<Server> {
+        if (servers.isEmpty()) return servers
+        
+        return try {
+            open()
+            val ids = planNative(idsOf(servers), flagsOf(servers), budget) ?: return servers
+            val byId = servers.associateBy { it.id }
+            ids.mapNotNull { byId[it] }
+        } catch (e: Exception) {
+            Log.e(TAG, "Error planning probes", e)
+            servers
+        }
+    }
+    
+    /**
+     * @return Seconds until the next server falls due, 0 if one already is
+     */
+    fun secondsUntilDue(servers: List<Server>): Int {
+        if (servers.isEmpty()) return 0
+        
+        return try {
+            open()
+            nextDueNative(idsOf(servers), flagsOf(servers))
+        } catch (e: Exception) {
+            Log.e(TAG, "Error reading probe schedule", e)
+            0
+        }
+    }
+    
+    /**
+     * Fold a run's outcomes into the schedule and persist it
+     * @param latenciesMs Measured latency per server ID, negative for servers that did not answer
+     */
+    fun record(latenciesMs: Map<Long, Int>) {
+        if (latenciesMs.isEmpty()) return
+        
+        try {
+            open()
+            val ids = latenciesMs.keys.toLongArray()
+            recordNative(ids, FloatArray(ids.size) { latenciesMs.getValue(ids[it]).toFloat() })
+            if (!saveNative()) {
+                Log.w(TAG, "Failed to persist probe schedule")
+            }
+        } catch (e: Exception) {
+            Log.e(TAG, "Error recording probe results", e)
+        }
+    }
+    
+    // Loads the file on first use only; a corrupt one leaves an empty schedule to start over with
+    private fun open() {
+        if (!openNative(stateFile.absolutePath)) {
+            Log.w(TAG, "Probe history unreadable, starting over")
+        }
+    }
+    
+    private fun idsOf(servers: List<Server>): LongArray =
+        LongArray(servers.size) { servers[it].id }
+    
+    private fun flagsOf(servers: List<Server>): IntArray =
+        IntArray(servers.size) {
+            (if (servers[it].favorite) FLAG_FAVORITE else 0) or
+                (if (servers[it].isSelected) FLAG_SELECTED else 0)
+        }
+}
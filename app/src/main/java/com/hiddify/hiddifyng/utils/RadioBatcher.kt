@@ -0,0 +1,125 @@
+package com.hiddify.hiddifyng.utils
+
+import android.content.Context
+import android.net.ConnectivityManager
+import android.net.NetworkCapabilities
+import android.os.Process
+import android.os.SystemClock
+import android.util.Log
+
+/**
+ * Coalesces background network work into shared radio wake-ups
+ * A cellular radio stays in its high-power state for several seconds after the last packet,
+ * so workers that wake at different times each pay that tail. On cellular the first worker
+ * to wake pulls the others that are close to due into the same wake-up (see
+ * BackgroundTaskScheduler.joinRadioWindow), and the network phase of every worker is wrapped
+ * in begin/end so the resulting active-radio window is measured and logged
+ */
+object RadioBatcher {
+    private const val TAG = "RadioBatcher"
+    private const val PREFS_NAME = "radio_batcher"
+    
+    // Typical LTE/NR inactivity timer before the radio leaves its connected state
+    const val RADIO_TAIL_MS = 10_000L
+    
+    // Input flag of work enqueued to join another task's window
+    const val KEY_JOINED = "radio_joined"
+    
+    /**
+     * One active-radio window: from the first task's start to the last task's end
+     * @param activeMs From the first start to the last end, including gaps shorter than the tail
+     * @param tasks Tasks that ran in the window, in start order
+     */
+    data class Window(
+        val startedAt: Long,
+        val activeMs: Long,
+        val tasks: List<String>,
+        val rxBytes: Long,
+        val txBytes: Long
+    ) {
+        /** Estimated time in the high-power state, including the tail after the last packet */
+        val radioMs: Long
+            get() = activeMs + RADIO_TAIL_MS
+    }
+    
+    private val lock = Any()
+    private var running = 0
+    private var windowStart = 0L
+    private var windowEnd = 0L
+    private var windowTasks = mutableListOf<String>()
+    private var rxStart = 0L
+    private var txStart = 0L
+    
+    /** Most recent window, updated whenever its last running task ends */
+    @Volatile
+    var lastWindow: Window? = null
+        private set
+    
+    /**
+     * Whether the active network is cellular, where wake-ups are worth coalescing
+     */
+    fun isCellular(context: Context): Boolean {
+        val connectivity = context.getSystemService(ConnectivityManager::class.java) ?: return false
+        val capabilities = connectivity.activeNetwork?.let { connectivity.getNetworkCapabilities(it) }
+            ?: return false
+        return capabilities.hasTransport(NetworkCapabilities.TRANSPORT_CELLULAR)
+    }
+    
+    /**
+     * Wall-clock time a task last began network work, 0 if never
+     */
+    fun lastRunAt(context: Context, task: String): Long =
+        context.getSharedPreferences(PREFS_NAME, Context.MODE_PRIVATE).getLong(task, 0L)
+    
+    /**
+     * Mark the start of a task's network work
+     * A task starting within RADIO_TAIL_MS of the previous window's end extends that window,
+     * since the radio has not dropped back to idle yet
+     */
+    fun begin(context: Context, task: String) {
+        context.getSharedPreferences(PREFS_NAME, Context.MODE_PRIVATE)
+            .edit()
+            .putLong(task, System.currentTimeMillis())
+            .apply()
+        
+        synchronized(lock) {
+            val now = SystemClock.elapsedRealtime()
+            if (running == 0 && (windowStart == 0L || now - windowEnd > RADIO_TAIL_MS)) {
+                windowStart = now
+                windowTasks = mutableListOf()
+                rxStart = uidRxBytes()
+                txStart = uidTxBytes()
+            }
+            running++
+            windowTasks.add(task)
+        }
+    }
+    
+    /**
+     * Mark the end of a task's network work; logs the window once no task is running
+     */
+    fun end(task: String) {
+        val window = synchronized(lock) {
+            if (running == 0) return
+            running--
+            windowEnd = SystemClock.elapsedRealtime()
+            if (running > 0) return
+            Window(
+                startedAt = System.currentTimeMillis() - (windowEnd - windowStart),
+                activeMs = windowEnd - windowStart,
+                tasks = windowTasks.toList(),
+                rxBytes = uidRxBytes() - rxStart,
+                txBytes = uidTxBytes() - txStart
+            )
+        }
+        lastWindow = window
+        Log.i(TAG, "Radio window after $task: ${window.activeMs} ms active (~${window.radioMs} ms with tail), " +
+                "tasks ${window.tasks}, ${window.rxBytes} bytes in, ${window.txBytes} bytes out")
+    }
+    
+    private fun uidRxBytes(): Long =
+        android.net.TrafficStats.getUidRxBytes(Process.myUid()).coerceAtLeast(0L)
+    
+    private fun uidTxBytes(): Long =
+        android.net.TrafficStats.getUidTxBytes(Process.myUid()).coerceAtLeast(0L)
+}
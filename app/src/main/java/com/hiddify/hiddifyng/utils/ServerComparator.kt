@@ -3,9 +3,17 @@ package com.hiddify.hiddifyng.utils
 import com.hiddify.hiddifyng.database.entity.Server
 
 /**
- * Comparator for sorting servers by ping time and favorites
+ * Comparator for sorting servers by ping time, goodput and favorites
+ * @param spreadMs Tail penalty per server id (p90 - p50 of its latency sketch); build
+ * with forServers so a jittery server ranks behind a steady one with the same ping
+ * @param unmeasuredTransferMs Transfer time assumed for servers whose goodput was never
+ * measured; forServers uses the median of the measured ones, so measuring a server moves
+ * it by how it compares to the others rather than only ever making it look worse
  */
-class ServerComparator : Comparator<Server> {
+class ServerComparator(
+    private val spreadMs: Map<Long, Int> = emptyMap(),
+    private val unmeasuredTransferMs: Long = 0
+) : Comparator<Server> {
     override fun compare(a: Server?, b: Server?): Int {
         // Handle null values (should not happen in practice)
         if (a == null && b == null) return 0
@@ -16,10 +24,64 @@ class ServerComparator : Comparator<Server> {
         if (a.favorite && !b.favorite) return -1
         if (!a.favorite && b.favorite) return 1
         
-        // Then sort by ping (null ping values go to the end)
-        val aPing = a.avgPing ?: Int.MAX_VALUE
-        val bPing = b.avgPing ?: Int.MAX_VALUE
+        // Then sort by latency (servers never measured go to the end)
+        return rankOf(a).compareTo(rankOf(b))
+    }
+    
+    /**
+     * Ranking key: latency plus the server's tail spread plus its transfer time
+     */
+    fun rankOf(server: Server): Int {
+        val latency = latencyOf(server)
+        if (latency == Int.MAX_VALUE) return latency
+        val transferMs = transferMsOf(server) ?: unmeasuredTransferMs
+        return (latency.toLong() + (spreadMs[server.id] ?: 0) + transferMs)
+            .coerceAtMost(Int.MAX_VALUE - 1L).toInt()
+    }
+    
+    companion object {
+        // Payload whose transfer time is added to latency: a typical page load, so a
+        // low-RTT server with a starved link ranks behind a slightly farther fast one
+        private const val REFERENCE_TRANSFER_KBITS = 256L * 8
+        
+        /**
+         * Time to move the reference payload at the server's measured goodput
+         * @return null for servers never measured
+         */
+        fun transferMsOf(server: Server): Long? {
+            val kbps = server.bandwidthKbps?.takeIf { it > 0 } ?: return null
+            return REFERENCE_TRANSFER_KBITS * 1000 / kbps
+        }
+        
+        /**
+         * Comparator that also weighs each server's latency sketch and ranks servers
+         * without a goodput measurement at the median transfer time of those with one
+         * Reads every sketch's percentiles in one native call
+         */
+        fun forServers(servers: Collection<Server>): ServerComparator {
+            val transfers = servers.mapNotNull { transferMsOf(it) }.sorted()
+            val medianTransferMs = if (transfers.isEmpty()) 0L else transfers[transfers.size / 2]
+            if (servers.none { it.latencySketch != null }) {
+                return ServerComparator(unmeasuredTransferMs = medianTransferMs)
+            }
+            
+            val percentiles = LatencySketch.percentiles(servers.map { it.latencySketch })
+            val spreads = servers.zip(percentiles)
+                .mapNotNull { (server, p) -> p?.let { server.id to it.spreadMs } }
+                .toMap()
+            return ServerComparator(spreads, medianTransferMs)
+        }
         
-        return aPing.compareTo(bPing)
+        /**
+         * Latency used for ranking: the time to a usable TLS session
+         * That is the measured handshake when there is one; a bare connect time is doubled,
+         * since a TLS 1.3 handshake costs one more round trip. URL test times (urlTestMs)
+         * include the fetch and only exist for servers whose tunnel was tested, so they
+         * gate auto-connect instead of entering the rank
+         */
+        fun latencyOf(server: Server): Int {
+            server.tlsHandshakeMs?.let { return it }
+            return server.avgPing?.let { it * 2 } ?: Int.MAX_VALUE
+        }
     }
 }
\ No newline at end of file
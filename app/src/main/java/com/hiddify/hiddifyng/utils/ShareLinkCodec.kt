@@ -0,0 +1,268 @@
+package com.hiddify.hiddifyng.utils
+
+import android.util.Log
+import com.hiddify.hiddifyng.database.entity.Server
+import org.json.JSONObject
+
+/**
+ * Share links (vmess://, vless://, trojan://, ss://, hysteria://, reality://, xhttp://)
+ * parsed and generated by the native codec in cpp/share_link.cpp
+ * Column layout must stay in sync with share_link::Field and share_link::Number
+ */
+object ShareLinkCodec {
+    private const val TAG = "ShareLinkCodec"
+
+    // share_link::Scheme, by index; reality links become protocol "reality"
+    private val SCHEMES = arrayOf("vmess", "vless", "trojan", "shadowsocks", "hysteria", "reality", "xhttp")
+    private const val SCHEME_REALITY = 5
+
+    // String columns (share_link::Field)
+    private const val FIELD_NAME = 0
+    private const val FIELD_ADDRESS = 1
+    private const val FIELD_USER_ID = 2
+    private const val FIELD_PASSWORD = 3
+    private const val FIELD_METHOD = 4
+    private const val FIELD_NETWORK = 5
+    private const val FIELD_SECURITY = 6
+    private const val FIELD_SNI = 7
+    private const val FIELD_ALPN = 8
+    private const val FIELD_FINGERPRINT = 9
+    private const val FIELD_FLOW = 10
+    private const val FIELD_PATH = 11
+    private const val FIELD_HOST = 12
+    private const val FIELD_SERVICE_NAME = 13
+    private const val FIELD_HEADER_TYPE = 14
+    private const val FIELD_PUBLIC_KEY = 15
+    private const val FIELD_SHORT_ID = 16
+    private const val FIELD_SPIDER_X = 17
+    private const val FIELD_HYSTERIA_PROTOCOL = 18
+    private const val FIELD_OBFS = 19
+    private const val FIELD_ENCRYPTION = 20
+    private const val FIELD_COUNT = 21
+
+    // Int columns (share_link::Number)
+    private const val NUMBER_PORT = 0
+    private const val NUMBER_ALTER_ID = 1
+    private const val NUMBER_UP_MBPS = 2
+    private const val NUMBER_DOWN_MBPS = 3
+    private const val NUMBER_INSECURE = 4
+    private const val NUMBER_COUNT = 5
+
+    // parseNative prefixes each link's numbers with its scheme
+    private const val NUMBER_STRIDE = NUMBER_COUNT + 1
+
+    init {
+        System.loadLibrary("xray-core-jni")
+    }
+
+    @JvmStatic
+    private external fun parseNative(links: Array<String>, numbers: IntArray): Array<String?>?
+
+    @JvmStatic
+    private external fun generateNative(scheme: Int, fields: Array<String?>, numbers: IntArray): String?
+
+    @JvmStatic
+    private external fun benchmarkNative(links: Array<String>, durationMs: Int): LongArray?
+
+    /**
+     * Codec cost per link
+     * @param nativeParseNs Codec alone, without the JNI crossing
+     * @param nativeEndToEndNs parseAll(), including JNI and building the Server entities
+     */
+    data class ShareLinkBenchmark(
+        val links: Int,
+        val parsed: Int,
+        val nativeParseNs: Long,
+        val nativeGenerateNs: Long,
+        val nativeEndToEndNs: Long
+    )
+
+    /**
+     * Parse one share link
+     * @return Server, or null if the link is malformed or of an unknown scheme
+     */
+    fun parse(url: String): Server? = parseAll(listOf(url)).firstOrNull()
+
+    /**
+     * Parse many share links in one native call
+     * @return One entry per link, in order, null where a link did not parse
+     */
+    fun parseAll(urls: List<String>): List<Server?> {
+        if (urls.isEmpty()) return emptyList()
+
+        val numbers = IntArray(urls.size * NUMBER_STRIDE)
+        val fields = try {
+            parseNative(urls.toTypedArray(), numbers)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error parsing share links", e)
+            null
+        } ?: return List(urls.size) { null }
+
+        return List(urls.size) { i ->
+            val scheme = numbers[i * NUMBER_STRIDE]
+            if (scheme in SCHEMES.indices) {
+                toServer(scheme, fields, i * FIELD_COUNT, numbers, i * NUMBER_STRIDE + 1)
+            } else {
+                null
+            }
+        }
+    }
+
+    /**
+     * Generate the share link for a server
+     * @return Link, or null if the server's protocol has no link form
+     */
+    fun generate(server: Server): String? {
+        val scheme = schemeOf(server)
+        if (scheme < 0) return null
+
+        val extra = try {
+            JSONObject(server.extraParams ?: "{}")
+        } catch (e: Exception) {
+            JSONObject()
+        }
+        val fields = arrayOfNulls<String>(FIELD_COUNT)
+        fields[FIELD_NAME] = server.name
+        fields[FIELD_ADDRESS] = parseHost(server.address)
+        fields[FIELD_USER_ID] = server.userId
+        fields[FIELD_PASSWORD] = server.password
+        fields[FIELD_METHOD] = server.securityType?.takeIf { it != "reality" }
+        fields[FIELD_NETWORK] = server.network
+        fields[FIELD_SECURITY] = when {
+            scheme == SCHEME_REALITY -> "reality"
+            server.tls -> "tls"
+            else -> null
+        }
+        fields[FIELD_SNI] = server.tlsServerName
+        fields[FIELD_ALPN] = extra.optString("alpn", null)
+        fields[FIELD_FINGERPRINT] = server.tlsFingerprint ?: extra.optString("fingerprint", null)
+        fields[FIELD_FLOW] = extra.optString("flow", null)
+        if (server.network == "grpc") {
+            fields[FIELD_SERVICE_NAME] = server.wsPath
+        } else {
+            fields[FIELD_PATH] = server.xhttpPath ?: server.wsPath
+        }
+        fields[FIELD_HOST] = server.xhttpHost ?: server.header
+        fields[FIELD_HEADER_TYPE] = extra.optString("headerType", null)
+        fields[FIELD_PUBLIC_KEY] = server.realityPublicKey
+        fields[FIELD_SHORT_ID] = server.realityShortId
+        fields[FIELD_SPIDER_X] = server.realitySpiderX
+        fields[FIELD_HYSTERIA_PROTOCOL] = server.hysteriaProtocol
+        fields[FIELD_OBFS] = server.hysteriaObfs
+        fields[FIELD_ENCRYPTION] = extra.optString("encryption", null)
+
+        val numbers = IntArray(NUMBER_COUNT)
+        numbers[NUMBER_PORT] = if (server.port > 0) server.port else parsePort(server.address) ?: 443
+        numbers[NUMBER_ALTER_ID] = extra.optInt("alterId", 0)
+        numbers[NUMBER_UP_MBPS] = server.hysteriaUpMbps ?: 0
+        numbers[NUMBER_DOWN_MBPS] = server.hysteriaDownMbps ?: 0
+        numbers[NUMBER_INSECURE] = if (extra.optBoolean("allowInsecure", false)) 1 else 0
+
+        return try {
+            generateNative(scheme, fields, numbers)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error generating share link", e)
+            null
+        }
+    }
+
+    /**
+     * Time the native codec alone and through parseAll() on the same links
+     * @param durationMs Time budget for the native run and for the end-to-end measurement
+     */
+    fun benchmark(urls: List<String>, durationMs: Int = 200): ShareLinkBenchmark? {
+        if (urls.isEmpty()) return null
+
+        val native = try {
+            benchmarkNative(urls.toTypedArray(), durationMs)
+        } catch (e: Exception) {
+            Log.e(TAG, "Error benchmarking share link codec", e)
+            null
+        } ?: return null
+
+        val endToEndNs = timePerLink(urls, durationMs) { parseAll(urls) }
+
+        val result = ShareLinkBenchmark(
+            links = urls.size,
+            parsed = native[0].toInt(),
+            nativeParseNs = native[1],
+            nativeGenerateNs = native[2],
+            nativeEndToEndNs = endToEndNs
+        )
+        Log.i(TAG, "Share link benchmark: $result")
+        return result
+    }
+
+    private fun toServer(
+        scheme: Int,
+        fields: Array<String?>,
+        fieldBase: Int,
+        numbers: IntArray,
+        numberBase: Int
+    ): Server {
+        fun field(index: Int): String? = fields[fieldBase + index]
+        fun number(index: Int): Int = numbers[numberBase + index]
+
+        val protocol = SCHEMES[scheme]
+        val network = field(FIELD_NETWORK)
+        val path = field(FIELD_PATH)
+        val host = field(FIELD_HOST)
+        val isXhttp = protocol == "xhttp"
+
+        // Fields the entity has no column for, read back through ServerExtensions
+        val extra = JSONObject()
+        field(FIELD_FLOW)?.let { extra.put("flow", it) }
+        field(FIELD_FINGERPRINT)?.let { extra.put("fingerprint", it) }
+        field(FIELD_ALPN)?.let { extra.put("alpn", it) }
+        field(FIELD_HEADER_TYPE)?.let { extra.put("headerType", it) }
+        field(FIELD_ENCRYPTION)?.let { extra.put("encryption", it) }
+        if (number(NUMBER_ALTER_ID) > 0) extra.put("alterId", number(NUMBER_ALTER_ID))
+        if (number(NUMBER_INSECURE) != 0) extra.put("allowInsecure", true)
+
+        return Server(
+            name = field(FIELD_NAME) ?: "",
+            protocol = protocol,
+            address = field(FIELD_ADDRESS) ?: "",
+            port = number(NUMBER_PORT),
+            userId = field(FIELD_USER_ID),
+            password = field(FIELD_PASSWORD),
+            securityType = field(FIELD_METHOD) ?: field(FIELD_SECURITY)?.takeIf { it == "reality" },
+            tls = field(FIELD_SECURITY) == "tls",
+            tlsServerName = field(FIELD_SNI),
+            tlsFingerprint = field(FIELD_FINGERPRINT),
+            network = network,
+            wsPath = if (network == "grpc") field(FIELD_SERVICE_NAME) ?: path else path.takeUnless { isXhttp },
+            header = host.takeUnless { isXhttp },
+            realityPublicKey = field(FIELD_PUBLIC_KEY),
+            realityShortId = field(FIELD_SHORT_ID),
+            realitySpiderX = field(FIELD_SPIDER_X),
+            hysteriaProtocol = field(FIELD_HYSTERIA_PROTOCOL),
+            hysteriaObfs = field(FIELD_OBFS),
+            hysteriaUpMbps = number(NUMBER_UP_MBPS).takeIf { it > 0 },
+            hysteriaDownMbps = number(NUMBER_DOWN_MBPS).takeIf { it > 0 },
+            xhttpHost = host.takeIf { isXhttp },
+            xhttpPath = path.takeIf { isXhttp },
+            extraParams = extra.toString()
+        )
+    }
+
+    private fun schemeOf(server: Server): Int {
+        val protocol = when (val name = server.protocol.lowercase()) {
+            "ss" -> "shadowsocks"
+            "vless" -> if (server.securityType == "reality") "reality" else name
+            else -> name
+        }
+        return SCHEMES.indexOf(protocol)
+    }
+
+    private inline fun timePerLink(urls: List<String>, durationMs: Int, pass: () -> Unit): Long {
+        val deadline = System.nanoTime() + durationMs * 1_000_000L
+        val start = System.nanoTime()
+        var links = 0L
+        do {
+            pass()
+            links += urls.size
+        } while (System.nanoTime() < deadline)
+        return (System.nanoTime() - start) / links
+    }
+}
@@ -0,0 +1,177 @@
+package com.hiddify.hiddifyng.utils
+
+import android.util.Log
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.flow.MutableStateFlow
+import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.flow.asStateFlow
+import kotlinx.coroutines.isActive
+import kotlinx.coroutines.launch
+import java.util.concurrent.TimeUnit
+
+/**
+ * Live path quality of the connected server, read without probe traffic
+ * Samples the kernel's TCP state of the running core's tunnels natively (tunnel_sampler):
+ * RTT and its variance, congestion window, retransmissions and delivery rate of the
+ * connections the user's traffic is actually on
+ */
+class TunnelSampler {
+    companion object {
+        private const val TAG = "TunnelSampler"
+        private const val SAMPLE_INTERVAL_MS = 2000L
+        private const val RESULT_STRIDE = 11
+        
+        // Where the numbers came from (tunnel_sampler::Source)
+        const val SOURCE_NONE = 0
+        const val SOURCE_SOCK_DIAG = 1
+        const val SOURCE_DUPLICATED = 2
+        
+        init {
+            System.loadLibrary("xray-core-jni")
+        }
+        
+        @JvmStatic
+        private external fun resetNative()
+        
+        @JvmStatic
+        private external fun sampleNative(serverPort: Int): LongArray?
+    }
+    
+    /**
+     * One observation of the core's tunnels to the server
+     * RTT and window are those of the tunnel that carried the most data since the last
+     * sample; counters are deltas over the sample interval
+     * @param stalled Tunnels waiting on a retransmission timeout
+     * @param deliveryRate Bytes per second the tunnels were delivering, summed
+     */
+    data class TunnelQuality(
+        val source: Int,
+        val tunnels: Int,
+        val stalled: Int,
+        val srttUs: Long,
+        val rttVarUs: Long,
+        val minRttUs: Long,
+        val cwndBytes: Long,
+        val deliveryRate: Long,
+        val ackedBytes: Long,
+        val sentSegments: Long,
+        val retransmittedSegments: Long
+    ) {
+        /** Whether any tunnel could be read */
+        val available: Boolean
+            get() = source != SOURCE_NONE && tunnels > 0
+        
+        val rttMs: Int
+            get() = TimeUnit.MICROSECONDS.toMillis(srttUs).toInt()
+        
+        val jitterMs: Int
+            get() = TimeUnit.MICROSECONDS.toMillis(rttVarUs).toInt()
+        
+        /** Share of segments sent in the interval that were retransmissions, 0 to 100 */
+        val retransmitPercent: Int
+            get() = if (sentSegments > 0) (retransmittedSegments * 100 / sentSegments).toInt() else 0
+        
+        val deliveryKbps: Int
+            get() = (deliveryRate * 8 / 1000).toInt()
+    }
+    
+    /**
+     * Totals over the intervals since start in which the tunnels delivered data
+     * Idle intervals are left out so goodput reflects the path, not the user's traffic
+     */
+    data class SessionTotals(
+        val activeMs: Long,
+        val ackedBytes: Long,
+        val sentSegments: Long,
+        val retransmittedSegments: Long,
+        val srttSumUs: Long,
+        val intervals: Int
+    ) {
+        /** Kilobits per second over the active intervals */
+        val goodputKbps: Float
+            get() = if (activeMs > 0) ackedBytes * 8f / activeMs else 0f
+        
+        val rttMs: Float
+            get() = if (intervals > 0) srttSumUs / intervals / 1000f else 0f
+        
+        /** Retransmitted / sent segments, 0 to 1 */
+        val retransmitRate: Float
+            get() = if (sentSegments > 0) retransmittedSegments.toFloat() / sentSegments else 0f
+    }
+    
+    private val _quality = MutableStateFlow<TunnelQuality?>(null)
+    val quality: StateFlow<TunnelQuality?> = _quality.asStateFlow()
+    
+    /**
+     * Totals of the current or last session, null until a tunnel delivered data
+     */
+    @Volatile
+    var sessionTotals: SessionTotals? = null
+        private set
+    
+    private var job: Job? = null
+    
+    /**
+     * Start sampling the running core's tunnels
+     * @param serverPort Port of the proxy server the tunnels connect to
+     */
+    fun start(serverPort: Int) {
+        stop()
+        resetNative()
+        _quality.value = null
+        sessionTotals = null
+        
+        job = CoroutineManager.ioScope.launch {
+            var reported = false
+            while (isActive) {
+                delay(SAMPLE_INTERVAL_MS)
+                val row = sampleNative(serverPort) ?: break
+                if (row.size < RESULT_STRIDE) break
+                
+                val quality = TunnelQuality(
+                    source = row[0].toInt(),
+                    tunnels = row[1].toInt(),
+                    stalled = row[2].toInt(),
+                    srttUs = row[3],
+                    rttVarUs = row[4],
+                    minRttUs = row[5],
+                    cwndBytes = row[6],
+                    deliveryRate = row[7],
+                    ackedBytes = row[8],
+                    sentSegments = row[9],
+                    retransmittedSegments = row[10]
+                )
+                _quality.value = quality
+                if (quality.available && quality.ackedBytes > 0) {
+                    accumulate(quality)
+                }
+                if (quality.available && !reported) {
+                    Log.i(TAG, "Tunnel RTT ${quality.rttMs} ms +/- ${quality.jitterMs} ms over " +
+                            "${quality.tunnels} tunnels (source ${quality.source})")
+                    reported = true
+                }
+            }
+        }
+    }
+    
+    private fun accumulate(quality: TunnelQuality) {
+        val totals = sessionTotals ?: SessionTotals(0, 0, 0, 0, 0, 0)
+        sessionTotals = SessionTotals(
+            activeMs = totals.activeMs + SAMPLE_INTERVAL_MS,
+            ackedBytes = totals.ackedBytes + quality.ackedBytes,
+            sentSegments = totals.sentSegments + quality.sentSegments,
+            retransmittedSegments = totals.retransmittedSegments + quality.retransmittedSegments,
+            srttSumUs = totals.srttSumUs + quality.srttUs,
+            intervals = totals.intervals + 1
+        )
+    }
+    
+    /**
+     * Stop sampling; the last observation and the session totals stay available
+     */
+    fun stop() {
+        job?.cancel()
+        job = null
+    }
+}
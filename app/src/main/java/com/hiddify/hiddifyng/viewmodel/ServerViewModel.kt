@@ -6,9 +6,15 @@ import androidx.lifecycle.LiveData
 import androidx.lifecycle.MutableLiveData
 import androidx.lifecycle.viewModelScope
 import com.hiddify.hiddifyng.database.AppDatabase
+import com.hiddify.hiddifyng.database.ProbeResultWriter
 import com.hiddify.hiddifyng.database.entity.Server
 import com.hiddify.hiddifyng.utils.PingUtils
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.NonCancellable
+import kotlinx.coroutines.flow.Flow
+import kotlinx.coroutines.flow.onCompletion
+import kotlinx.coroutines.flow.onEach
+import kotlinx.coroutines.flow.toList
 import kotlinx.coroutines.launch
 import kotlinx.coroutines.withContext
 
@@ -62,32 +68,35 @@ class ServerViewModel(application: Application) : AndroidViewModel(application)
         }
     }
     
+    /**
+     * Ping servers and update database, streaming each result as soon as it is measured
+     * Results are written in batches while the sweep runs and the rest when it ends
+     * @param servers Servers to ping
+     * @param stopAfterReachable Stop once this many servers answered; 0 pings all
+     * @return Flow of (server, ping in milliseconds or -1) in completion order
+     */
+    fun pingAllServers(servers: List<Server>, stopAfterReachable: Int = 0): Flow<Pair<Server, Int>> {
+        val writer = ProbeResultWriter(database)
+        return PingUtils.pingServers(servers, stopAfterReachable)
+            .onEach { (server, pingTime) ->
+                writer.ping(server.id, if (pingTime > 0) pingTime else Int.MAX_VALUE)
+                writer.flushIfDue()
+            }
+            .onCompletion {
+                withContext(NonCancellable + Dispatchers.IO) {
+                    writer.flush()
+                    // Update best server after pinging
+                    updateBestServer()
+                }
+            }
+    }
+    
     /**
      * Ping all servers and update database
      */
     suspend fun pingAllServersAsync(): List<Pair<Server, Int>> = withContext(Dispatchers.IO) {
         val servers = serverDao.getAllServers().value ?: emptyList()
-        val results = mutableListOf<Pair<Server, Int>>()
-        
-        for (server in servers) {
-            try {
-                val pingTime = PingUtils.pingServer(server)
-                if (pingTime > 0) {
-                    serverDao.updatePing(server.id, pingTime)
-                    results.add(Pair(server, pingTime))
-                } else {
-                    serverDao.updatePing(server.id, Int.MAX_VALUE)
-                    results.add(Pair(server, -1))
-                }
-            } catch (e: Exception) {
-                results.add(Pair(server, -1))
-            }
-        }
-        
-        // Update best server after pinging
-        updateBestServer()
-        
-        return@withContext results
+        return@withContext pingAllServers(servers).toList()
     }
     
     /**
@@ -1,21 +1,35 @@
 package com.hiddify.hiddifyng.worker
 
 import android.content.Context
+import android.net.ConnectivityManager
 import android.util.Log
 import androidx.work.CoroutineWorker
 import androidx.work.WorkerParameters
+import com.hiddify.hiddifyng.core.NativeServerRecords
+import com.hiddify.hiddifyng.core.XrayManager
+import com.hiddify.hiddifyng.database.AppDatabase
+import com.hiddify.hiddifyng.database.ProbeResultWriter
 import com.hiddify.hiddifyng.database.entity.Server
+import com.hiddify.hiddifyng.utils.BackgroundTaskScheduler
+import com.hiddify.hiddifyng.utils.LatencySketch
+import com.hiddify.hiddifyng.utils.PingUtils
+import com.hiddify.hiddifyng.utils.ProbeScheduler
+import com.hiddify.hiddifyng.utils.RadioBatcher
+import com.hiddify.hiddifyng.utils.ServerComparator
+import com.hiddify.hiddifyng.utils.parseHost
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.NonCancellable
+import kotlinx.coroutines.async
+import kotlinx.coroutines.awaitAll
+import kotlinx.coroutines.isActive
 import kotlinx.coroutines.withContext
-import java.io.IOException
-import java.net.InetSocketAddress
-import java.net.Socket
-import java.net.URL
-import kotlin.math.min
+import java.io.File
+import kotlin.math.roundToInt
 
 /**
  * Worker for pinging servers and updating ping statistics
- * Runs every 10 minutes to find the best server for auto-connection
+ * Runs every 15 minutes to find the best server for auto-connection; each run probes only
+ * the servers ProbeScheduler finds due, so stable and unused servers are pinged rarely
  */
 class PingWorker(
     private val context: Context,
@@ -24,13 +38,30 @@ class PingWorker(
     companion object {
         private const val TAG = "PingWorker"
         private const val PING_COUNT = 3
-        private const val SOCKET_TIMEOUT = 5000 // 5 seconds
+        private const val MAX_BALANCED_SERVERS = 16
+        private const val PROBE_SCHEDULE_FILE = "probe_schedule.bin"
+        
+        // URL tests load a page through each tunnel, so only the best-ranked probed servers get one
+        private const val URL_TEST_CANDIDATES = 6
+        
+        // Throughput tests move up to a megabyte each, so only a few stale servers per run
+        private const val THROUGHPUT_CANDIDATES = 4
+        private const val THROUGHPUT_MAX_AGE_MS = 6 * 60 * 60 * 1000L
+        private const val BANDWIDTH_ALPHA = 0.5f
     }
     
     // Store parameters for child worker creation
     private val workerParams = params
     
+    // Probe results are written per stage in one transaction, not row by row
+    private val results by lazy { ProbeResultWriter(AppDatabase.getInstance(context)) }
+    
     override suspend fun doWork(): Result = withContext(Dispatchers.IO) {
+        // On cellular, bring subscription and routing updates into this wake-up
+        if (!inputData.getBoolean(RadioBatcher.KEY_JOINED, false)) {
+            BackgroundTaskScheduler(context).joinRadioWindow(BackgroundTaskScheduler.PING_TASK_NAME)
+        }
+        RadioBatcher.begin(context, BackgroundTaskScheduler.PING_TASK_NAME)
         try {
             Log.i(TAG, "Starting server ping operation")
             
@@ -41,154 +72,223 @@ class PingWorker(
                 return@withContext Result.success()
             }
             
-            // Ping each server
-            var bestServer: Server? = null
-            var bestPing = Int.MAX_VALUE
+            // Probe only the servers whose last result has gone stale
+            val scheduler = ProbeScheduler(File(context.filesDir, PROBE_SCHEDULE_FILE))
+            val due = scheduler.plan(servers)
+            if (due.isEmpty()) {
+                Log.i(TAG, "No server due for a ping, next in ${scheduler.secondsUntilDue(servers)} s")
+                return@withContext Result.success()
+            }
+            Log.i(TAG, "Pinging ${due.size} of ${servers.size} servers")
+            
+            // Resolve through the current network's servers; answers are cached across sweeps
+            PingUtils.configureDns(context)
             
-            for (server in servers) {
-                val pingResult = pingServer(server)
-                
-                // Update server with ping result
-                if (pingResult > 0) {
-                    updateServerPing(server.id, pingResult)
-                    
-                    // Check if this is the best server
-                    if (pingResult < bestPing) {
-                        bestPing = pingResult
-                        bestServer = server
+            // QUIC servers answer only on UDP; the rest get a TCP connect
+            val quic = due.mapNotNull { server -> PingUtils.udpTargetOf(server)?.let { server to it } }
+            val quicIds = quic.mapTo(HashSet()) { it.first.id }
+            val tcpServers = due.filter { it.id !in quicIds }
+            val targets = tcpServers.map { parseHost(it.address) to NativeServerRecords.resolvePort(it) }
+            
+            // Servers that resolve to the same address and port are probed once and share the result
+            val quicGroups = PingUtils.groupEndpoints(quic.map { it.second }, PingUtils.TRANSPORT_UDP)
+            val tcpGroups = PingUtils.groupEndpoints(targets, PingUtils.TRANSPORT_TCP)
+            
+            // Endpoints the UI or an earlier run measured moments ago are not probed again
+            val quicTargets = quicGroups.representatives.map { quic[it].second }
+            val tcpTargets = tcpGroups.representatives.map { targets[it] }
+            val quicCached = PingUtils.cachedPings(quicTargets, PingUtils.TRANSPORT_UDP)
+            val tcpCached = PingUtils.cachedPings(tcpTargets, PingUtils.TRANSPORT_TCP)
+            val quicProbed = quicCached.indices.filter { quicCached[it] == PingUtils.CACHE_MISS }
+            val tcpProbed = tcpCached.indices.filter { tcpCached[it] == PingUtils.CACHE_MISS }
+            Log.i(TAG, "Probing ${quicProbed.size + tcpProbed.size} endpoints for ${due.size} servers, " +
+                    "skipping ${quicGroups.duplicates + tcpGroups.duplicates} duplicates and " +
+                    "${quicTargets.size + tcpTargets.size - quicProbed.size - tcpProbed.size} cached endpoints")
+            
+            // The UDP trains run alongside the TCP sweep, so the radio wakes for one burst
+            val udpSweep = async { PingUtils.probeUdp(quicProbed.map { quicTargets[it] }) }
+            
+            // Fresh cached results stand in for a probe; cached failures already include the fallbacks
+            val reachable = mutableListOf<Pair<Server, Int>>()
+            for ((group, ping) in quicCached.withIndex()) {
+                if (ping <= 0) continue
+                quicGroups.members[group].forEach { reachable.add(quic[it].first to ping) }
+            }
+            for ((group, ping) in tcpCached.withIndex()) {
+                if (ping <= 0) continue
+                tcpGroups.members[group].forEach { reachable.add(tcpServers[it] to ping) }
+            }
+            
+            // Probe every other TCP endpoint in one native sweep; results stream in as connects finish
+            val samples = mutableListOf<Pair<Server, LongArray>>()
+            val failedGroups = mutableListOf<Int>()
+            val answered = HashSet<Int>()
+            
+            PingUtils.probeTcp(tcpProbed.map { tcpTargets[it] }, samples = PING_COUNT) { results ->
+                // Share successes as they arrive, so a "test all" started meanwhile need not wait
+                val fresh = results.filter { it.reachable }
+                PingUtils.cachePings(fresh.map { tcpTargets[tcpProbed[it.index]] }, fresh.map { it.pingMs },
+                    PingUtils.TRANSPORT_TCP)
+                fresh.mapTo(answered) { it.index }
+                for (result in results) {
+                    val group = tcpProbed[result.index]
+                    if (!result.reachable) {
+                        failedGroups.add(group)
+                        continue
+                    }
+                    for (member in tcpGroups.members[group]) {
+                        val server = tcpServers[member]
+                        reachable.add(server to result.pingMs)
+                        samples.add(server to result.samplesNs)
                     }
                 }
+                isActive // stop the sweep if the worker was cancelled
             }
             
-            // If auto-connect is enabled and we found a best server, connect to it
-            if (bestServer != null && isAutoConnectEnabled()) {
-                Log.i(TAG, "Best server: ${bestServer.name} with ping $bestPing ms")
-                connectToBestServer(bestServer.id)
+            val udpResults = udpSweep.await()
+            PingUtils.cachePings(
+                udpResults.map { quicTargets[quicProbed[it.index]] },
+                udpResults.map { it.pingMs },
+                PingUtils.TRANSPORT_UDP
+            )
+            for (result in udpResults) {
+                if (!result.reachable) continue
+                for (member in quicGroups.members[quicProbed[result.index]]) {
+                    val server = quic[member].first
+                    reachable.add(server to result.pingMs)
+                    updateServerUdpStats(server, result)
+                }
             }
             
-            return@withContext Result.success()
-        } catch (e: Exception) {
-            Log.e(TAG, "Error in ping worker", e)
-            return@withContext Result.failure()
-        }
-    }
-    
-    /**
-     * Ping a server using multiple methods and return the best result
-     * @param server Server to ping
-     * @return Ping time in milliseconds, or -1 if failed
-     */
-    private suspend fun pingServer(server: Server): Int = withContext(Dispatchers.IO) {
-        try {
-            Log.d(TAG, "Pinging server: ${server.name}")
+            for ((server, pingResult) in reachable) {
+                updateServerPing(server.id, pingResult)
+            }
+            for ((server, samplesNs) in samples) {
+                updateServerSketch(server, samplesNs)
+            }
+            results.flushIfDue()
             
-            // Try multiple ping methods and use the best result
-            val tcpPing = tcpPing(server)
-            val httpPing = httpPing(server)
+            // HTTP is only worth trying where the TCP probe failed: once per endpoint, on its own
+            // port, all at once, and shared by the servers behind it like the TCP result
+            val httpPings = failedGroups.map { group ->
+                async { group to PingUtils.pingHttp(tcpTargets[group].first, tcpTargets[group].second) }
+            }.awaitAll()
+            for ((group, pingResult) in httpPings) {
+                if (pingResult <= 0) continue
+                for (member in tcpGroups.members[group]) {
+                    val server = tcpServers[member]
+                    updateServerPing(server.id, pingResult)
+                    reachable.add(server to pingResult)
+                }
+            }
             
-            // Use the best ping result that was successful
-            val pingResults = listOf(tcpPing, httpPing).filter { it > 0 }
+            // Leave the rest of this run's results, after their fallbacks, for the UI and the next run
+            val pingOf = reachable.associate { (server, ping) -> server.id to ping }
+            val unanswered = tcpProbed.indices.filter { it !in answered }.map { tcpProbed[it] }
+            PingUtils.cachePings(
+                unanswered.map { tcpTargets[it] },
+                unanswered.map { pingOf[tcpServers[tcpGroups.representatives[it]].id] ?: PingUtils.FAILED_PING },
+                PingUtils.TRANSPORT_TCP
+            )
             
-            return@withContext if (pingResults.isNotEmpty()) {
-                // Use the minimum ping value
-                pingResults.minOrNull() ?: -1
-            } else {
-                -1
+            // Outcomes at the probe level feed the schedule; the tunnel tests below do not
+            val outcomes = due.associate { it.id to -1 }.toMutableMap()
+            for ((server, ping) in reachable) {
+                outcomes[server.id] = ping
             }
-        } catch (e: Exception) {
-            Log.e(TAG, "Error pinging server: ${server.name}", e)
-            return@withContext -1
-        }
-    }
-    
-    /**
-     * Ping a server using TCP socket
-     * @param server Server to ping
-     * @return Average ping time in milliseconds, or -1 if failed
-     */
-    private suspend fun tcpPing(server: Server): Int = withContext(Dispatchers.IO) {
-        try {
-            var totalTime = 0L
-            var successCount = 0
-            
-            // Extract host and port from server address
-            val host = server.address.split(":")[0]
-            val port = server.port ?: 443 // Default to 443 if port not specified
-            
-            // Ping multiple times and calculate average
-            for (i in 0 until PING_COUNT) {
-                val socket = Socket()
-                val startTime = System.currentTimeMillis()
-                
-                try {
-                    socket.connect(InetSocketAddress(host, port), SOCKET_TIMEOUT)
-                    val endTime = System.currentTimeMillis()
-                    socket.close()
-                    
-                    val pingTime = endTime - startTime
-                    totalTime += pingTime
-                    successCount++
-                    
-                    Log.d(TAG, "TCP ping ${i + 1} to ${server.name}: $pingTime ms")
-                } catch (e: IOException) {
-                    Log.e(TAG, "TCP ping ${i + 1} to ${server.name} failed", e)
+            scheduler.record(outcomes)
+            results.flushIfDue()
+            
+            // Time TLS handshakes on the servers that answered, so ranking sees more than the SYN-ACK
+            // Servers with the same endpoint, SNI and fingerprint send the same hello
+            val handshakes = reachable
+                .mapNotNull { (server, _) -> PingUtils.tlsTargetOf(server)?.let { it to server } }
+                .groupBy({ it.first }, { it.second })
+                .toList()
+            for (result in PingUtils.probeTls(handshakes.map { it.first })) {
+                if (result.status == PingUtils.TLS_OK) {
+                    for (server in handshakes[result.index].second) {
+                        updateServerHandshake(server, result)
+                    }
                 }
             }
+            results.flushIfDue()
             
-            return@withContext if (successCount > 0) {
-                (totalTime / successCount).toInt()
-            } else {
-                -1
+            // Fetch through the tunnels of the best-ranked servers probed this run; where it works,
+            // the fetch time is stored beside the probe ping and servers whose tunnel fails drop out
+            // of the ranking. Skipped on metered networks, like the throughput test below
+            val metered = isNetworkMetered()
+            val tunneled = mutableListOf<Pair<Server, Int>>()
+            if (reachable.isNotEmpty() && !metered) {
+                val comparator = ServerComparator.forServers(reachable.map { it.first })
+                val tested = reachable
+                    .sortedBy { (server, ping) -> comparator.rankOf(server.copy(avgPing = ping)) }
+                    .take(URL_TEST_CANDIDATES)
+                val urlTests = XrayManager.getInstance(context).urlTest(tested.map { it.first })
+                for (result in urlTests) {
+                    if (!result.passed) continue
+                    updateServerUrlTest(tested[result.index].first, result.latencyMs)
+                    tunneled.add(tested[result.index])
+                }
+                // If no tunnel worked the core is more likely at fault than every server
+                if (tunneled.isNotEmpty()) {
+                    val failed = urlTests.filter { !it.passed }.mapTo(HashSet()) { tested[it.index].first.id }
+                    reachable.removeAll { (server, _) -> server.id in failed }
+                    Log.i(TAG, "URL test passed for ${tunneled.size} of ${tested.size} servers")
+                }
             }
-        } catch (e: Exception) {
-            Log.e(TAG, "Error in TCP ping to ${server.name}", e)
-            return@withContext -1
-        }
-    }
-    
-    /**
-     * Ping a server using HTTP request
-     * @param server Server to ping
-     * @return Average ping time in milliseconds, or -1 if failed
-     */
-    private suspend fun httpPing(server: Server): Int = withContext(Dispatchers.IO) {
-        try {
-            var totalTime = 0L
-            var successCount = 0
-            
-            // Extract host from server address
-            val host = server.address.split(":")[0]
+            results.flushIfDue()
             
-            // Ping multiple times and calculate average
-            for (i in 0 until PING_COUNT) {
-                val startTime = System.currentTimeMillis()
-                
-                try {
-                    val url = URL("https://$host")
-                    val connection = url.openConnection()
-                    connection.connectTimeout = SOCKET_TIMEOUT
-                    connection.readTimeout = SOCKET_TIMEOUT
-                    connection.getInputStream().close()
-                    
-                    val endTime = System.currentTimeMillis()
-                    val pingTime = endTime - startTime
-                    totalTime += pingTime
-                    successCount++
-                    
-                    Log.d(TAG, "HTTP ping ${i + 1} to ${server.name}: $pingTime ms")
-                } catch (e: Exception) {
-                    Log.e(TAG, "HTTP ping ${i + 1} to ${server.name} failed", e)
+            // Burst-download through the best tunnels whose goodput estimate has gone stale,
+            // so ranking weighs bandwidth as well as latency; skipped on metered networks
+            if (tunneled.isNotEmpty() && !metered) {
+                val now = System.currentTimeMillis()
+                val comparator = ServerComparator.forServers(tunneled.map { it.first })
+                val stale = tunneled
+                    .filter { (server, _) -> now - (server.bandwidthMeasuredAt ?: 0L) > THROUGHPUT_MAX_AGE_MS }
+                    .sortedBy { (server, ping) -> comparator.rankOf(server.copy(avgPing = ping)) }
+                    .take(THROUGHPUT_CANDIDATES)
+                    .map { it.first }
+                for (result in XrayManager.getInstance(context).throughputTest(stale)) {
+                    if (result.measured) {
+                        updateServerBandwidth(stale[result.index], result.kbps, now)
+                    }
                 }
             }
+            results.flush()
             
-            return@withContext if (successCount > 0) {
-                (totalTime / successCount).toInt()
-            } else {
-                -1
+            // Servers skipped this run compete with their last known ping
+            val probed = due.mapTo(HashSet()) { it.id }
+            val candidates = reachable + servers.mapNotNull { server ->
+                server.avgPing?.takeIf { server.id !in probed && it > 0 }?.let { server to it }
+            }
+            
+            // If switching to the best server is enabled, connect to the best servers behind a balancer
+            if (candidates.isNotEmpty() && isAutoSwitchEnabled()) {
+                val comparator = ServerComparator.forServers(candidates.map { it.first })
+                val ranked = candidates
+                    .sortedBy { (server, ping) -> comparator.rankOf(server.copy(avgPing = ping)) }
+                    .take(MAX_BALANCED_SERVERS)
+                val (bestServer, bestPing) = ranked.first()
+                Log.i(TAG, "Best server: ${bestServer.name} with ping $bestPing ms")
+                connectToBestServers(ranked.map { it.first.id })
             }
+            
+            return@withContext Result.success()
         } catch (e: Exception) {
-            Log.e(TAG, "Error in HTTP ping to ${server.name}", e)
-            return@withContext -1
+            Log.e(TAG, "Error in ping worker", e)
+            return@withContext Result.failure()
+        } finally {
+            RadioBatcher.end(BackgroundTaskScheduler.PING_TASK_NAME)
+            
+            // Keep what was measured even if the sweep failed or was cancelled
+            withContext(NonCancellable) {
+                try {
+                    results.flush()
+                } catch (e: Exception) {
+                    Log.e(TAG, "Error writing probe results", e)
+                }
+            }
         }
     }
     
@@ -197,36 +297,109 @@ class PingWorker(
      * @return List of servers
      */
     private suspend fun getAllServers(): List<Server> = withContext(Dispatchers.IO) {
-        // This would be implemented to get servers from database
-        // For now, we'll just return an empty list
-        return@withContext emptyList<Server>()
+        return@withContext AppDatabase.getInstance(context).serverDao().getAllServersSync()
     }
     
     /**
-     * Update server ping result in database
+     * Queue a server ping result for the database
      * @param serverId Server ID
      * @param pingResult Ping result in milliseconds
      */
-    private suspend fun updateServerPing(serverId: Long, pingResult: Int) = withContext(Dispatchers.IO) {
-        // This would be implemented to update server ping in database
+    private fun updateServerPing(serverId: Long, pingResult: Int) {
+        results.ping(serverId, pingResult)
         Log.d(TAG, "Updated server $serverId with ping $pingResult ms")
     }
     
     /**
-     * Check if auto-connect is enabled in settings
-     * @return true if auto-connect is enabled, false otherwise
+     * Store the latency of a fetch through the server's tunnel
+     * @param server Tested server; its field is updated in place
+     * @param latencyMs Time from the local connect to the response status line
+     */
+    private fun updateServerUrlTest(server: Server, latencyMs: Int) {
+        server.urlTestMs = latencyMs
+        results.urlTest(server.id, latencyMs)
+        Log.d(TAG, "Server ${server.id} URL test $latencyMs ms")
+    }
+    
+    /**
+     * Merge a run's connect samples into the server's latency sketch
+     * @param server Probed server; its sketch is updated in place for ranking
+     * @param samplesNs Completed connect times in nanoseconds
+     */
+    private fun updateServerSketch(server: Server, samplesNs: LongArray) {
+        val sketch = LatencySketch.merge(server.latencySketch, samplesNs) ?: return
+        server.latencySketch = sketch
+        results.latencySketch(server.id, sketch)
+        Log.d(TAG, "Merged ${samplesNs.size} samples into server ${server.id} sketch (${sketch.size} bytes)")
+    }
+    
+    /**
+     * Store the TLS handshake phases of a server
+     * @param server Probed server; its fields are updated in place for ranking
+     * @param result Handshake probe result
+     */
+    private fun updateServerHandshake(server: Server, result: PingUtils.TlsProbeResult) {
+        server.tlsConnectMs = result.connectMs
+        server.tlsHelloMs = result.helloMs
+        server.tlsHandshakeMs = result.handshakeMs
+        results.tlsTiming(server.id, result.connectMs, result.helloMs, result.handshakeMs)
+        Log.d(TAG, "Updated server ${server.id} handshake: connect ${result.connectMs} ms, " +
+                "hello ${result.helloMs} ms, flight ${result.handshakeMs} ms")
+    }
+    
+    /**
+     * Store the UDP path quality of a QUIC server
+     * @param server Probed server; its fields are updated in place for config generation
+     * @param result Probe train result
+     */
+    private fun updateServerUdpStats(server: Server, result: PingUtils.UdpProbeResult) {
+        server.udpLossPercent = result.lossPercent
+        server.udpJitterMs = result.jitterMs
+        results.udpStats(server.id, result.lossPercent, result.jitterMs)
+        Log.d(TAG, "Updated server ${server.id} UDP: ${result.received}/${result.sent} answered, " +
+                "jitter ${result.jitterMs} ms, QUIC version 0x${Integer.toHexString(result.quicVersion)}")
+    }
+    
+    /**
+     * Fold a throughput measurement into the server's rolling goodput estimate
+     * @param server Tested server; its fields are updated in place for ranking
+     * @param kbps Measured goodput in kilobits per second
+     * @param measuredAt Wall-clock time of the test in milliseconds
+     */
+    private fun updateServerBandwidth(server: Server, kbps: Int, measuredAt: Long) {
+        val estimate = server.bandwidthKbps
+            ?.let { (it + (kbps - it) * BANDWIDTH_ALPHA).roundToInt() }
+            ?: kbps
+        server.bandwidthKbps = estimate
+        server.bandwidthMeasuredAt = measuredAt
+        results.bandwidth(server.id, estimate, measuredAt)
+        Log.d(TAG, "Server ${server.id} goodput $kbps kbps, estimate $estimate kbps")
+    }
+    
+    /**
+     * Whether the active network bills by volume
+     */
+    private fun isNetworkMetered(): Boolean {
+        val connectivity = context.getSystemService(ConnectivityManager::class.java) ?: return true
+        return connectivity.isActiveNetworkMetered
+    }
+    
+    /**
+     * Check if switching to the best server is enabled in settings
+     * @return true if the ping results may pick the connected servers, false otherwise
      */
-    private fun isAutoConnectEnabled(): Boolean {
-        // This would be implemented to check auto-connect setting
-        return false
+    private suspend fun isAutoSwitchEnabled(): Boolean {
+        val settings = AppDatabase.getInstance(context).appSettingsDao().getSettings()
+        return settings?.autoSwitchToBestServer == true
     }
     
     /**
-     * Connect to the best server
-     * @param serverId Server ID to connect to
+     * Connect to the best servers
+     * Failover between them happens inside the core, not on the next ping cycle
+     * @param serverIds Server IDs ordered best first
      */
-    private suspend fun connectToBestServer(serverId: Long) = withContext(Dispatchers.IO) {
-        // This would be implemented to connect to the server
-        Log.i(TAG, "Connecting to best server with ID $serverId")
+    private suspend fun connectToBestServers(serverIds: List<Long>) = withContext(Dispatchers.IO) {
+        Log.i(TAG, "Connecting to ${serverIds.size} best servers, best ID ${serverIds.first()}")
+        XrayManager.getInstance(context).startBalancedXray(serverIds)
     }
 }
\ No newline at end of file
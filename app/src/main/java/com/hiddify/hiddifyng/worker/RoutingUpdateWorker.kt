@@ -5,9 +5,12 @@ import android.util.Log
 import androidx.work.CoroutineWorker
 import androidx.work.WorkerParameters
 import com.hiddify.hiddifyng.database.AppDatabase
+import com.hiddify.hiddifyng.utils.BackgroundTaskScheduler
+import com.hiddify.hiddifyng.utils.RadioBatcher
 import com.hiddify.hiddifyng.utils.RoutingManager
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.withContext
+import java.util.concurrent.TimeUnit
 
 /**
  * Background worker for updating routing rules
@@ -23,6 +26,21 @@ class RoutingUpdateWorker(
     
     override suspend fun doWork(): Result {
         return withContext(Dispatchers.IO) {
+            val task = BackgroundTaskScheduler.ROUTING_UPDATE_TASK_NAME
+            val joined = inputData.getBoolean(RadioBatcher.KEY_JOINED, false)
+            
+            // A recent run in another task's radio window already covered this period; retries still run
+            val sinceLastRun = System.currentTimeMillis() - RadioBatcher.lastRunAt(context, task)
+            if (!joined && runAttemptCount == 0 && sinceLastRun < TimeUnit.HOURS.toMillis(
+                    BackgroundTaskScheduler.ROUTING_UPDATE_INTERVAL_HOURS / 2L)) {
+                Log.i(TAG, "Routing rules checked ${sinceLastRun / 1000} s ago, skipping")
+                return@withContext Result.success()
+            }
+            if (!joined) {
+                BackgroundTaskScheduler(context).joinRadioWindow(task)
+            }
+            
+            RadioBatcher.begin(context, task)
             try {
                 Log.i(TAG, "Starting routing rules update")
                 
@@ -74,6 +92,8 @@ class RoutingUpdateWorker(
             } catch (e: Exception) {
                 Log.e(TAG, "Error during routing update worker execution", e)
                 return@withContext Result.failure()
+            } finally {
+                RadioBatcher.end(task)
             }
         }
     }
@@ -4,10 +4,15 @@ import android.content.Context
 import android.util.Log
 import androidx.work.CoroutineWorker
 import androidx.work.WorkerParameters
+import com.hiddify.hiddifyng.database.entity.Server
+import com.hiddify.hiddifyng.utils.BackgroundTaskScheduler
+import com.hiddify.hiddifyng.utils.RadioBatcher
+import com.hiddify.hiddifyng.utils.ShareLinkCodec
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.withContext
 import java.net.URL
 import java.util.Base64
+import java.util.concurrent.TimeUnit
 
 /**
  * Worker for updating server subscriptions
@@ -25,6 +30,21 @@ class SubscriptionWorker(
     private val workerParams = params
     
     override suspend fun doWork(): Result = withContext(Dispatchers.IO) {
+        val task = BackgroundTaskScheduler.SUBSCRIPTION_UPDATE_TASK_NAME
+        val joined = inputData.getBoolean(RadioBatcher.KEY_JOINED, false)
+        
+        // A recent run in another task's radio window already covered this period; retries still run
+        val sinceLastRun = System.currentTimeMillis() - RadioBatcher.lastRunAt(context, task)
+        if (!joined && runAttemptCount == 0 && sinceLastRun < TimeUnit.MINUTES.toMillis(
+                BackgroundTaskScheduler.SUBSCRIPTION_UPDATE_INTERVAL_MINUTES / 2L)) {
+            Log.i(TAG, "Subscriptions updated ${sinceLastRun / 1000} s ago, skipping")
+            return@withContext Result.success()
+        }
+        if (!joined) {
+            BackgroundTaskScheduler(context).joinRadioWindow(task)
+        }
+        
+        RadioBatcher.begin(context, task)
         try {
             Log.i(TAG, "Starting subscription update operation")
             
@@ -84,6 +104,8 @@ class SubscriptionWorker(
         } catch (e: Exception) {
             Log.e(TAG, "Error in subscription worker", e)
             return@withContext Result.failure()
+        } finally {
+            RadioBatcher.end(task)
         }
     }
     
@@ -124,8 +146,6 @@ class SubscriptionWorker(
      */
     private suspend fun parseSubscriptionContent(content: String): List<Server> = withContext(Dispatchers.IO) {
         try {
-            val servers = mutableListOf<Server>()
-            
             // Check if content is base64 encoded
             val decodedContent = if (isBase64Encoded(content)) {
                 try {
@@ -137,21 +157,9 @@ class SubscriptionWorker(
                 content
             }
             
-            // Split content into lines
-            val lines = decodedContent.split("\n")
-            
-            for (line in lines) {
-                val trimmedLine = line.trim()
-                if (trimmedLine.isEmpty()) continue
-                
-                // Parse server URI
-                val server = parseServerUri(trimmedLine)
-                if (server != null) {
-                    servers.add(server)
-                }
-            }
-            
-            return@withContext servers
+            // One share link per line, parsed together in a single native call
+            val links = decodedContent.lines().map { it.trim() }.filter { it.isNotEmpty() }
+            return@withContext ShareLinkCodec.parseAll(links).filterNotNull()
         } catch (e: Exception) {
             Log.e(TAG, "Error parsing subscription content", e)
             return@withContext emptyList()
@@ -168,39 +176,6 @@ class SubscriptionWorker(
         return content.matches(base64Pattern.toRegex())
     }
     
-    /**
-     * Parse server URI
-     * @param uri Server URI
-     * @return Server object, or null if parsing failed
-     */
-    private fun parseServerUri(uri: String): Server? {
-        try {
-            // Get protocol from URI
-            val protocolEnd = uri.indexOf("://")
-            if (protocolEnd <= 0) return null
-            
-            val protocol = uri.substring(0, protocolEnd).toLowerCase()
-            
-            // Create appropriate protocol handler
-            val protocolHandler = when (protocol) {
-                "vmess" -> VmessProtocolHandler()
-                "vless" -> VlessProtocolHandler()
-                "trojan" -> TrojanProtocolHandler()
-                "ss", "shadowsocks" -> ShadowsocksProtocolHandler()
-                "hysteria" -> HysteriaProtocolHandler()
-                "reality" -> RealityProtocolHandler()
-                "xhttp" -> XhttpProtocolHandler()
-                else -> null
-            }
-            
-            // Parse server URI using protocol handler
-            return protocolHandler?.parseUri(uri)
-        } catch (e: Exception) {
-            Log.e(TAG, "Error parsing server URI", e)
-            return null
-        }
-    }
-    
     /**
      * Get servers by subscription ID
      * @param subscriptionId Subscription ID
@@ -321,98 +296,4 @@ class SubscriptionWorker(
         val url: String,
         val lastUpdate: Long
     )
-    
-    /**
-     * Data class for server
-     */
-    data class Server(
-        var id: Long = 0,
-        var name: String = "",
-        var protocol: String = "",
-        var address: String = "",
-        var port: Int = 0,
-        var serverSubscriptionId: Long? = null,
-        var lastPing: Long? = null,
-        var avgPing: Int? = null,
-        var favorite: Boolean = false,
-        var isSelected: Boolean = false,
-        var order: Int = 0
-    )
-    
-    /**
-     * Interface for protocol handlers
-     */
-    interface ProtocolHandler {
-        fun parseUri(uri: String): Server?
-    }
-    
-    /**
-     * VMess protocol handler
-     */
-    class VmessProtocolHandler : ProtocolHandler {
-        override fun parseUri(uri: String): Server? {
-            // This would be implemented to parse VMess URI
-            return null
-        }
-    }
-    
-    /**
-     * VLESS protocol handler
-     */
-    class VlessProtocolHandler : ProtocolHandler {
-        override fun parseUri(uri: String): Server? {
-            // This would be implemented to parse VLESS URI
-            return null
-        }
-    }
-    
-    /**
-     * Trojan protocol handler
-     */
-    class TrojanProtocolHandler : ProtocolHandler {
-        override fun parseUri(uri: String): Server? {
-            // This would be implemented to parse Trojan URI
-            return null
-        }
-    }
-    
-    /**
-     * Shadowsocks protocol handler
-     */
-    class ShadowsocksProtocolHandler : ProtocolHandler {
-        override fun parseUri(uri: String): Server? {
-            // This would be implemented to parse Shadowsocks URI
-            return null
-        }
-    }
-    
-    /**
-     * Hysteria protocol handler
-     */
-    class HysteriaProtocolHandler : ProtocolHandler {
-        override fun parseUri(uri: String): Server? {
-            // This would be implemented to parse Hysteria URI
-            return null
-        }
-    }
-    
-    /**
-     * REALITY protocol handler
-     */
-    class RealityProtocolHandler : ProtocolHandler {
-        override fun parseUri(uri: String): Server? {
-            // This would be implemented to parse REALITY URI
-            return null
-        }
-    }
-    
-    /**
-     * XHTTP protocol handler
-     */
-    class XhttpProtocolHandler : ProtocolHandler {
-        override fun parseUri(uri: String): Server? {
-            // This would be implemented to parse XHTTP URI
-            return null
-        }
-    }
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "bdp.h"
+#include "stand_ins.h"
+
+/**
+ * BDP sizing arithmetic, and the buffer benchmark's delaying relay: with
+ * the delay held at the socket, throughput has to follow the buffer size
+ * instead of running at loopback speed
+ */
+namespace {
+
+void sizes_from_the_bandwidth_delay_product() {
+    // 10 Mbit/s over 100 ms keeps 125 000 bytes in flight
+    bdp::Sizing sizing = bdp::size_buffers(10000, 100, 0, 0);
+    CHECK(sizing.bdp_bytes == 125000);
+    CHECK(sizing.buffer_bytes == 16 * bdp::kBufferGranularity);
+
+    CHECK(bdp::size_buffers(100, 5, 0, 0).buffer_bytes == bdp::kMinBufferBytes);
+    CHECK(bdp::size_buffers(1e6, 500, 0, 0).buffer_bytes == bdp::kMaxBufferBytes);
+    CHECK(bdp::size_buffers(1e6, 500, 0, 1024 * 1024).buffer_bytes == 1024 * 1024);
+
+    bdp::Sizing unknown = bdp::size_buffers(0, 100, 0, 0);
+    CHECK(unknown.bdp_bytes == 0);
+    CHECK(unknown.buffer_bytes == bdp::kMinBufferBytes);
+}
+
+void throughput_follows_the_buffer_at_a_fixed_rtt() {
+    constexpr int kRttMs = 40;
+    constexpr int kSmall = 128 * 1024;
+    constexpr int kLarge = 1024 * 1024;
+
+    int64_t small = bdp::benchmark_window(kRttMs, kSmall, 500);
+    int64_t large = bdp::benchmark_window(kRttMs, kLarge, 500);
+    CHECK(small > 0);
+    CHECK(large > 0);
+
+    // The kernel doubles SO_RCVBUF for its own overhead, so allow up to
+    // four buffers per RTT; loopback alone would run far above that
+    CHECK(small < static_cast<int64_t>(kSmall) * 4 * 1000 / kRttMs);
+    CHECK(large > small * 3);
+}
+
+void rejects_invalid_arguments() {
+    CHECK(bdp::benchmark_window(-1, 64 * 1024, 100) == -1);
+    CHECK(bdp::benchmark_window(10, 0, 100) == -1);
+    CHECK(bdp::benchmark_window(10, 64 * 1024, 0) == -1);
+}
+
+} // namespace
+
+int main() {
+    sizes_from_the_bandwidth_delay_product();
+    throughput_follows_the_buffer_at_a_fixed_rtt();
+    rejects_invalid_arguments();
+    return 0;
+}
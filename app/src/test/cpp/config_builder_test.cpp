@@ -0,0 +1,253 @@
+#include "config_builder.h"
+#include "json_reader.h"
+#include "stand_ins.h"
+
+/**
+ * config_builder's default config for every protocol it covers: the proxy
+ * outbound has to carry the record's protocol, credentials and transport,
+ * both forms must emit, and records it cannot express must come back as
+ * kUnsupported so the app can fall back
+ */
+namespace {
+
+using config_builder::ConfigSpec;
+using config_builder::Format;
+using server_record::ServerRecord;
+
+constexpr char kUuid[] = "b831381d-6324-4d53-ad4f-8cda48b30811";
+constexpr char kRoutingDir[] = "/nonexistent";
+
+ServerRecord record(std::string_view protocol, std::string_view network) {
+    ServerRecord server;
+    server.id = 1;
+    server.port = 443;
+    server.fields[server_record::kProtocol] = protocol;
+    server.fields[server_record::kAddress] = "proxy.example.com";
+    server.fields[server_record::kNetwork] = network;
+    return server;
+}
+
+/** Build and emit both forms; returns the JSON proxy outbound */
+JsonValue build(const ServerRecord& server, ConfigSpec& spec, JsonValue& document) {
+    CHECK(config_builder::build_default(server, kRoutingDir, spec) == config_builder::kOk);
+
+    std::string pb;
+    CHECK(config_builder::emit(spec, Format::kProtobuf, pb) == config_builder::kOk);
+    CHECK(!pb.empty());
+
+    std::string json;
+    std::string error;
+    CHECK(config_builder::emit(spec, Format::kJson, json) == config_builder::kOk);
+    CHECK(JsonValue::parse(json, document, error));
+
+    const JsonValue* outbounds = document.find("outbounds");
+    CHECK(outbounds != nullptr && outbounds->is_array() && !outbounds->items().empty());
+    const JsonValue& proxy = outbounds->items()[0];
+    CHECK(proxy.string_at("tag") == "proxy");
+    return proxy;
+}
+
+JsonValue build(const ServerRecord& server) {
+    ConfigSpec spec;
+    JsonValue document;
+    return build(server, spec, document);
+}
+
+const JsonValue& first(const JsonValue& object, std::string_view list) {
+    const JsonValue* items = object.find(list);
+    CHECK(items != nullptr && items->items().size() == 1);
+    return items->items()[0];
+}
+
+/** The single user of a vnext outbound */
+const JsonValue& first_user(const JsonValue& outbound) {
+    return first(first(*outbound.find("settings"), "vnext"), "users");
+}
+
+/** The single server of a trojan or shadowsocks outbound */
+const JsonValue& first_server(const JsonValue& outbound) {
+    return first(*outbound.find("settings"), "servers");
+}
+
+const JsonValue& stream(const JsonValue& outbound) {
+    const JsonValue* settings = outbound.find("streamSettings");
+    CHECK(settings != nullptr);
+    return *settings;
+}
+
+void vless_over_tls() {
+    ServerRecord server = record("vless", "tcp");
+    server.flags = server_record::kFlagTls;
+    server.fields[server_record::kUserId] = kUuid;
+    server.fields[server_record::kTlsServerName] = "sni.example.com";
+    server.fields[server_record::kFlow] = "xtls-rprx-vision";
+
+    JsonValue proxy = build(server);
+    CHECK(proxy.string_at("protocol") == "vless");
+    CHECK(first_user(proxy).string_at("id") == kUuid);
+    CHECK(first_user(proxy).string_at("encryption") == "none");
+    CHECK(first_user(proxy).string_at("flow") == "xtls-rprx-vision");
+    CHECK(stream(proxy).string_at("security") == "tls");
+    CHECK(stream(proxy).find("tlsSettings")->string_at("serverName") == "sni.example.com");
+}
+
+void vmess_over_websocket() {
+    ServerRecord server = record("vmess", "ws");
+    server.fields[server_record::kUserId] = kUuid;
+    server.fields[server_record::kWsPath] = "/ray";
+    server.fields[server_record::kHeader] = "cdn.example.com";
+
+    JsonValue proxy = build(server);
+    CHECK(proxy.string_at("protocol") == "vmess");
+    CHECK(first_user(proxy).string_at("id") == kUuid);
+    CHECK(first_user(proxy).string_at("security") == "auto");
+    CHECK(stream(proxy).string_at("network") == "ws");
+    CHECK(stream(proxy).find("wsSettings")->string_at("path") == "/ray");
+    CHECK(stream(proxy).find("wsSettings")->string_at("host") == "cdn.example.com");
+}
+
+void vmess_takes_the_preferred_aead_only_for_auto() {
+    ServerRecord automatic = record("vmess", "tcp");
+    automatic.fields[server_record::kUserId] = kUuid;
+    ServerRecord chosen = automatic;
+    chosen.fields[server_record::kSecurityType] = "zero";
+
+    for (const ServerRecord* candidate : {&automatic, &chosen}) {
+        ConfigSpec spec;
+        CHECK(config_builder::build_default(*candidate, kRoutingDir, spec) == config_builder::kOk);
+        config_builder::apply_vmess_security(spec, "aes-128-gcm");
+
+        std::string json;
+        std::string error;
+        JsonValue document;
+        CHECK(config_builder::emit(spec, Format::kJson, json) == config_builder::kOk);
+        CHECK(JsonValue::parse(json, document, error));
+        const JsonValue& proxy = document.find("outbounds")->items()[0];
+        std::string_view expected = candidate == &automatic ? "aes-128-gcm" : "zero";
+        CHECK(first_user(proxy).string_at("security") == expected);
+    }
+}
+
+void trojan_over_grpc() {
+    ServerRecord server = record("trojan", "grpc");
+    server.flags = server_record::kFlagTls;
+    server.fields[server_record::kPassword] = "secret";
+    server.fields[server_record::kWsPath] = "tunnel";
+
+    JsonValue proxy = build(server);
+    CHECK(proxy.string_at("protocol") == "trojan");
+    CHECK(first_server(proxy).string_at("password") == "secret");
+    CHECK(stream(proxy).string_at("network") == "grpc");
+    CHECK(stream(proxy).find("grpcSettings")->string_at("serviceName") == "tunnel");
+}
+
+void shadowsocks_aead_and_2022() {
+    for (const char* method : {"aes-256-gcm", "2022-blake3-aes-128-gcm"}) {
+        ServerRecord shadowsocks = record("shadowsocks", "tcp");
+        shadowsocks.fields[server_record::kSecurityType] = method;
+        shadowsocks.fields[server_record::kPassword] = "c2VjcmV0LWtleS0xNi1ieQ==";
+
+        JsonValue proxy = build(shadowsocks);
+        CHECK(proxy.string_at("protocol") == "shadowsocks");
+        CHECK(first_server(proxy).string_at("method") == method);
+        CHECK(first_server(proxy).string_at("password") == "c2VjcmV0LWtleS0xNi1ieQ==");
+    }
+
+    ServerRecord server = record("shadowsocks", "tcp");
+    server.fields[server_record::kSecurityType] = "2022-blake3-aes-128-gcm";
+    server.fields[server_record::kPassword] = "c2VjcmV0LWtleS0xNi1ieQ==";
+    ConfigSpec spec;
+    CHECK(config_builder::build_default(server, kRoutingDir, spec) == config_builder::kOk);
+    std::string pb;
+    CHECK(config_builder::emit(spec, Format::kProtobuf, pb) == config_builder::kOk);
+    CHECK(pb.find("xray.proxy.shadowsocks_2022.ClientConfig") != std::string::npos);
+}
+
+void reality() {
+    ServerRecord server = record("reality", "tcp");
+    server.fields[server_record::kUserId] = kUuid;
+    server.fields[server_record::kTlsServerName] = "www.example.com";
+    server.fields[server_record::kRealityPublicKey] = "Z84J2IelR9ch3k8VtlVhhs5ycBUlXA7wHBWcBrjqnAw";
+    server.fields[server_record::kRealityShortId] = "6ba85179e30d4fc2";
+
+    JsonValue proxy = build(server);
+    CHECK(proxy.string_at("protocol") == "vless");
+    CHECK(stream(proxy).string_at("security") == "reality");
+    const JsonValue* settings = stream(proxy).find("realitySettings");
+    CHECK(settings->string_at("publicKey") == "Z84J2IelR9ch3k8VtlVhhs5ycBUlXA7wHBWcBrjqnAw");
+    CHECK(settings->string_at("shortId") == "6ba85179e30d4fc2");
+    CHECK(settings->string_at("fingerprint") == "chrome");
+}
+
+void xhttp_is_json_only() {
+    ServerRecord server = record("xhttp", "");
+    server.flags = server_record::kFlagTls;
+    server.fields[server_record::kUserId] = kUuid;
+    server.fields[server_record::kXhttpHost] = "cdn.example.com";
+    server.fields[server_record::kXhttpPath] = "/split";
+
+    ConfigSpec spec;
+    CHECK(config_builder::build_default(server, kRoutingDir, spec) == config_builder::kOk);
+    std::string out;
+    CHECK(config_builder::emit(spec, Format::kProtobuf, out) == config_builder::kUnsupported);
+
+    std::string error;
+    JsonValue document;
+    CHECK(config_builder::emit(spec, Format::kJson, out) == config_builder::kOk);
+    CHECK(JsonValue::parse(out, document, error));
+    const JsonValue& proxy = document.find("outbounds")->items()[0];
+    CHECK(proxy.string_at("protocol") == "vless");
+    CHECK(stream(proxy).string_at("network") == "xhttp");
+    CHECK(stream(proxy).find("xhttpSettings")->string_at("host") == "cdn.example.com");
+    CHECK(stream(proxy).find("xhttpSettings")->string_at("path") == "/split");
+}
+
+void tuning_reaches_the_outbound() {
+    ServerRecord server = record("trojan", "tcp");
+    server.fields[server_record::kPassword] = "secret";
+
+    ConfigSpec spec;
+    JsonValue document;
+    build(server, spec, document);
+    config_builder::apply_mux(spec, 8);
+    config_builder::apply_socket_buffers(spec, 1024 * 1024);
+
+    std::string json;
+    std::string error;
+    CHECK(config_builder::emit(spec, Format::kJson, json) == config_builder::kOk);
+    CHECK(JsonValue::parse(json, document, error));
+    const JsonValue& proxy = document.find("outbounds")->items()[0];
+    CHECK(proxy.find("mux")->find("concurrency")->as_number() == 8);
+    const JsonValue* sockopt = stream(proxy).find("sockopt");
+    CHECK(sockopt != nullptr);
+    CHECK(sockopt->find("tcpSendBufferSize")->as_number() == 1024 * 1024);
+    CHECK(sockopt->find("tcpReceiveBufferSize")->as_number() == 1024 * 1024);
+}
+
+void unsupported_and_invalid_records() {
+    ServerRecord hysteria = record("hysteria", "");
+    hysteria.fields[server_record::kPassword] = "secret";
+    ConfigSpec spec;
+    CHECK(!config_builder::is_supported(hysteria));
+    CHECK(config_builder::build_default(hysteria, kRoutingDir, spec) == config_builder::kUnsupported);
+
+    ServerRecord missing_id = record("vless", "tcp");
+    ConfigSpec rejected;
+    CHECK(config_builder::build_default(missing_id, kRoutingDir, rejected) ==
+          config_builder::kInvalidInput);
+}
+
+} // namespace
+
+int main() {
+    vless_over_tls();
+    vmess_over_websocket();
+    vmess_takes_the_preferred_aead_only_for_auto();
+    trojan_over_grpc();
+    shadowsocks_aead_and_2022();
+    reality();
+    xhttp_is_json_only();
+    tuning_reaches_the_outbound();
+    unsupported_and_invalid_records();
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include "connect_prober.h"
+#include "dns_resolver.h"
+#include "stand_ins.h"
+
+/**
+ * connect_prober::run on loopback. 127.0.0.2 is made a black hole by a
+ * listener whose accept queue is full, so SYNs to it are dropped the way a
+ * dead path drops them; the Happy Eyeballs race has to leave it for
+ * 127.0.0.1 after the attempt delay instead of waiting out the timeout.
+ */
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BlackHole {
+    int listener = -1;
+    std::vector<int> fillers;
+
+    explicit BlackHole(int port) {
+        listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        CHECK(listener >= 0);
+        int on = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        CHECK(inet_pton(AF_INET, "127.0.0.2", &address.sin_addr) == 1);
+        CHECK(bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+        CHECK(listen(listener, 0) == 0);
+        for (int i = 0; i < 4; i++) {
+            int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+            fillers.push_back(fd);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    ~BlackHole() {
+        for (int fd : fillers) close(fd);
+        close(listener);
+    }
+};
+
+std::vector<connect_prober::Result> probe(const std::vector<connect_prober::Target>& targets,
+                                          const connect_prober::Options& options) {
+    std::vector<connect_prober::Result> results(targets.size());
+    size_t delivered = connect_prober::run(targets, options, [&](const std::vector<connect_prober::Result>& batch) {
+        for (const connect_prober::Result& result : batch) results[result.index] = result;
+        return true;
+    });
+    CHECK(delivered == targets.size());
+    return results;
+}
+
+void race_skips_a_black_holed_address() {
+    int port = 0;
+    int live = stand_ins::listen_on("127.0.0.1", 64, port);
+    BlackHole hole(port);
+
+    connect_prober::Options options;
+    options.samples = 3;
+    options.timeout_ms = 2000;
+    options.attempt_delay_ms = 100;
+
+    // Control: the black hole alone never completes
+    connect_prober::Options short_timeout = options;
+    short_timeout.samples = 1;
+    short_timeout.timeout_ms = 300;
+    std::vector<connect_prober::Result> control = probe({{"127.0.0.2", port}}, short_timeout);
+    CHECK(control[0].status == connect_prober::kTimeout);
+
+    // The name lists the black hole first
+    auto started = Clock::now();
+    std::vector<connect_prober::Result> results = probe({{"bh.test", port}}, options);
+    auto elapsed = Clock::now() - started;
+
+    CHECK(results[0].status == connect_prober::kOk);
+    CHECK(results[0].successes == 3);
+    CHECK(results[0].samples_ns.size() == 3);
+    // Samples time the winning connect from its own start, so none carries
+    // the black hole; the sweep pays one attempt delay, not a timeout
+    CHECK(results[0].best_ns < 50 * 1000000ll);
+    CHECK(*std::max_element(results[0].samples_ns.begin(), results[0].samples_ns.end()) < 50 * 1000000ll);
+    CHECK(elapsed >= std::chrono::milliseconds(100));
+    CHECK(elapsed < std::chrono::milliseconds(1000));
+    close(live);
+}
+
+void classifies_refused_and_unresolvable_targets() {
+    connect_prober::Options options;
+    options.samples = 2;
+    options.timeout_ms = 1000;
+    std::vector<connect_prober::Result> results =
+        probe({{"127.0.0.1", stand_ins::closed_port()}, {"nx.test", 443}}, options);
+
+    CHECK(results[0].status == connect_prober::kRefused);
+    CHECK(results[0].successes == 0);
+    CHECK(results[1].status == connect_prober::kResolveFailed);
+}
+
+void sweeps_targets_in_parallel_up_to_the_cap() {
+    constexpr size_t kTargets = 24;
+    std::vector<int> listeners;
+    std::vector<connect_prober::Target> targets;
+    for (size_t i = 0; i < kTargets; i++) {
+        int port = 0;
+        listeners.push_back(stand_ins::listen_on("127.0.0.1", 64, port));
+        targets.push_back({"127.0.0.1", port});
+    }
+
+    connect_prober::Options options;
+    options.samples = 4;
+    options.max_in_flight = 5;
+    std::vector<connect_prober::Result> results = probe(targets, options);
+    for (size_t i = 0; i < kTargets; i++) {
+        const connect_prober::Result& result = results[i];
+        CHECK(result.index == i);
+        CHECK(result.status == connect_prober::kOk);
+        CHECK(result.successes == 4);
+        CHECK(result.attempts == 4);
+        CHECK(result.samples_ns.size() == 4);
+        int64_t sum = 0;
+        for (int64_t sample : result.samples_ns) sum += sample;
+        CHECK(result.best_ns == *std::min_element(result.samples_ns.begin(), result.samples_ns.end()));
+        CHECK(result.mean_ns == sum / 4);
+    }
+    for (int fd : listeners) close(fd);
+}
+
+void sink_stops_the_sweep() {
+    constexpr size_t kTargets = 16;
+    std::vector<int> listeners;
+    std::vector<connect_prober::Target> targets;
+    for (size_t i = 0; i < kTargets; i++) {
+        int port = 0;
+        listeners.push_back(stand_ins::listen_on("127.0.0.1", 64, port));
+        targets.push_back({"127.0.0.1", port});
+    }
+
+    // One target at a time, so the first report arrives with the rest still pending
+    connect_prober::Options options;
+    options.samples = 2;
+    options.max_in_flight = 1;
+    size_t reports = 0;
+    size_t delivered = connect_prober::run(targets, options, [&](const std::vector<connect_prober::Result>& batch) {
+        reports++;
+        return false;
+    });
+    CHECK(reports == 1);
+    CHECK(delivered >= 1);
+    CHECK(delivered < kTargets);
+    for (int fd : listeners) close(fd);
+}
+
+} // namespace
+
+int main() {
+    stand_ins::Dns dns({{"bh.test", {"127.0.0.2", "127.0.0.1"}}});
+    CHECK(dns_resolver::set_servers({dns.server()}));
+    dns_resolver::clear_cache();
+
+    race_skips_a_black_holed_address();
+    classifies_refused_and_unresolvable_targets();
+    sweeps_targets_in_parallel_up_to_the_cap();
+    sink_stops_the_sweep();
+    return 0;
+}
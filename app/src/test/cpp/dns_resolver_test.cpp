@@ -0,0 +1,106 @@
+#include "dns_resolver.h"
+#include "stand_ins.h"
+
+/**
+ * dns_resolver's answer cache against the stand-in server: repeated lookups
+ * are answered without a query, answers expire with their TTL (raised to
+ * the 30 s floor when shorter), and NXDOMAIN is kept for the negative TTL
+ */
+namespace {
+
+using Records = std::map<std::string, std::vector<std::string>>;
+
+dns_resolver::Answer resolve(const stand_ins::Dns& dns, const std::string& host) {
+    dns_resolver::Options options;
+    options.servers = {dns.server()};
+    std::vector<dns_resolver::Answer> answers = dns_resolver::resolve({host}, options);
+    CHECK(answers.size() == 1);
+    return answers[0];
+}
+
+std::string first_address(const dns_resolver::Answer& answer) {
+    CHECK(!answer.addresses.empty());
+    const auto& v4 = reinterpret_cast<const sockaddr_in&>(answer.addresses[0].storage);
+    CHECK(v4.sin_family == AF_INET);
+    char text[INET_ADDRSTRLEN];
+    CHECK(inet_ntop(AF_INET, &v4.sin_addr, text, sizeof(text)) != nullptr);
+    return text;
+}
+
+void repeated_lookups_hit_the_cache() {
+    dns_resolver::clear_cache();
+    stand_ins::Dns dns(Records{{"cached.test", {"192.0.2.10"}}});
+
+    dns_resolver::Answer answer = resolve(dns, "cached.test");
+    CHECK(answer.status == dns_resolver::kOk);
+    CHECK(first_address(answer) == "192.0.2.10");
+    int asked = dns.queries("cached.test");
+    CHECK(asked > 0);
+
+    // Case and a trailing dot do not make a new name
+    for (const char* host : {"cached.test", "CACHED.test."}) {
+        answer = resolve(dns, host);
+        CHECK(answer.status == dns_resolver::kOk);
+        CHECK(first_address(answer) == "192.0.2.10");
+    }
+    CHECK(dns.queries("cached.test") == asked);
+}
+
+void answers_expire_with_their_ttl() {
+    dns_resolver::clear_cache();
+    stand_ins::Dns dns(Records{{"ttl.test", {"192.0.2.20"}}}, 120);
+
+    CHECK(resolve(dns, "ttl.test").status == dns_resolver::kOk);
+    int asked = dns.queries("ttl.test");
+
+    dns_resolver::age_cache(119);
+    CHECK(resolve(dns, "ttl.test").status == dns_resolver::kOk);
+    CHECK(dns.queries("ttl.test") == asked);
+
+    dns_resolver::age_cache(2);
+    CHECK(resolve(dns, "ttl.test").status == dns_resolver::kOk);
+    CHECK(dns.queries("ttl.test") > asked);
+}
+
+void short_ttls_are_kept_for_the_floor() {
+    dns_resolver::clear_cache();
+    stand_ins::Dns dns(Records{{"short.test", {"192.0.2.30"}}}, 1);
+
+    CHECK(resolve(dns, "short.test").status == dns_resolver::kOk);
+    int asked = dns.queries("short.test");
+
+    dns_resolver::age_cache(29);
+    CHECK(resolve(dns, "short.test").status == dns_resolver::kOk);
+    CHECK(dns.queries("short.test") == asked);
+
+    dns_resolver::age_cache(2);
+    CHECK(resolve(dns, "short.test").status == dns_resolver::kOk);
+    CHECK(dns.queries("short.test") > asked);
+}
+
+void missing_names_expire_with_the_negative_ttl() {
+    dns_resolver::clear_cache();
+    stand_ins::Dns dns(Records{});
+
+    CHECK(resolve(dns, "missing.test").status == dns_resolver::kNotFound);
+    int asked = dns.queries("missing.test");
+    CHECK(asked > 0);
+
+    dns_resolver::age_cache(59);
+    CHECK(resolve(dns, "missing.test").status == dns_resolver::kNotFound);
+    CHECK(dns.queries("missing.test") == asked);
+
+    dns_resolver::age_cache(2);
+    CHECK(resolve(dns, "missing.test").status == dns_resolver::kNotFound);
+    CHECK(dns.queries("missing.test") > asked);
+}
+
+} // namespace
+
+int main() {
+    repeated_lookups_hit_the_cache();
+    answers_expire_with_their_ttl();
+    short_ttls_are_kept_for_the_floor();
+    missing_names_expire_with_the_negative_ttl();
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "dns_resolver.h"
+#include "endpoint_dedup.h"
+#include "stand_ins.h"
+
+/**
+ * endpoint_dedup's grouping against the stand-in DNS server: names that
+ * resolve to the same address set share a group with each other and with
+ * the literal address, while a different port, transport or address set
+ * keeps them apart; names that do not resolve are grouped by name
+ */
+namespace {
+
+using endpoint_dedup::Endpoint;
+using Records = std::map<std::string, std::vector<std::string>>;
+
+void groups_by_transport_port_and_address_set() {
+    dns_resolver::clear_cache();
+    stand_ins::Dns dns(Records{
+        {"a.test", {"192.0.2.1", "192.0.2.2"}},
+        {"b.test", {"192.0.2.2", "192.0.2.1"}},
+        {"c.test", {"192.0.2.1"}},
+        {"d.test", {"192.0.2.1", "192.0.2.2", "192.0.2.3"}},
+    });
+    CHECK(dns_resolver::set_servers({dns.server()}));
+
+    std::vector<Endpoint> endpoints = {
+        {"a.test", 443, endpoint_dedup::kTcp},
+        {"b.test", 443, endpoint_dedup::kTcp},      // same set, other order
+        {"A.TEST.", 443, endpoint_dedup::kTcp},
+        {"a.test", 8443, endpoint_dedup::kTcp},     // other port
+        {"a.test", 443, endpoint_dedup::kUdp},      // other transport
+        {"c.test", 443, endpoint_dedup::kTcp},      // a subset stays apart
+        {"192.0.2.1", 443, endpoint_dedup::kTcp},
+        {"d.test", 443, endpoint_dedup::kTcp},      // a superset stays apart
+        {"gone.test", 443, endpoint_dedup::kTcp},
+        {"GONE.test.", 443, endpoint_dedup::kTcp},
+        {"other.test", 443, endpoint_dedup::kTcp},
+    };
+
+    endpoint_dedup::Stats stats;
+    std::vector<size_t> groups = endpoint_dedup::group(endpoints, &stats);
+    CHECK((groups == std::vector<size_t>{0, 0, 0, 3, 4, 5, 5, 7, 8, 8, 10}));
+    CHECK(stats.endpoints == endpoints.size());
+    CHECK(stats.groups == 7);
+    CHECK(stats.unresolved == 3);
+
+    // The lookups are left in the cache for the probe that follows
+    int asked = dns.queries("a.test");
+    CHECK(asked > 0);
+    endpoint_dedup::group({{"a.test", 443, endpoint_dedup::kTcp}});
+    CHECK(dns.queries("a.test") == asked);
+}
+
+void empty_input() {
+    endpoint_dedup::Stats stats;
+    stats.groups = 5;
+    CHECK(endpoint_dedup::group({}, &stats).empty());
+    CHECK(stats.endpoints == 0);
+    CHECK(stats.groups == 0);
+    CHECK(stats.unresolved == 0);
+}
+
+} // namespace
+
+int main() {
+    groups_by_transport_port_and_address_set();
+    empty_input();
+    return 0;
+}
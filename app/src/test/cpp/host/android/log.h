@@ -0,0 +1,29 @@
+#ifndef HIDDIFYNG_TEST_ANDROID_LOG_H
+#define HIDDIFYNG_TEST_ANDROID_LOG_H
+
+#include <stdarg.h>
+#include <stdio.h>
+
+/**
+ * Host stand-in for the NDK logger: warnings and errors go to stderr,
+ * everything else is dropped
+ */
+enum {
+    ANDROID_LOG_DEBUG = 3,
+    ANDROID_LOG_INFO = 4,
+    ANDROID_LOG_WARN = 5,
+    ANDROID_LOG_ERROR = 6,
+};
+
+static inline int __android_log_print(int priority, const char* tag, const char* format, ...) {
+    if (priority < ANDROID_LOG_WARN) return 0;
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "[%s] ", tag);
+    int written = vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+    return written;
+}
+
+#endif // HIDDIFYNG_TEST_ANDROID_LOG_H
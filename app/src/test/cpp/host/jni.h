@@ -0,0 +1,74 @@
+#ifndef HIDDIFYNG_TEST_JNI_H
+#define HIDDIFYNG_TEST_JNI_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Just enough of jni.h to compile the native sources on the host
+ *
+ * Tests call the C++ APIs directly; the JNI entry points are only compiled,
+ * so every JNIEnv method aborts.
+ */
+typedef uint8_t jboolean;
+typedef int8_t jbyte;
+typedef uint16_t jchar;
+typedef int32_t jint;
+typedef int64_t jlong;
+typedef float jfloat;
+typedef double jdouble;
+typedef jint jsize;
+
+class _jobject {};
+typedef _jobject* jobject;
+typedef jobject jclass;
+typedef jobject jstring;
+typedef jobject jarray;
+typedef jobject jobjectArray;
+typedef jobject jbyteArray;
+typedef jobject jintArray;
+typedef jobject jlongArray;
+typedef jobject jfloatArray;
+typedef jobject jdoubleArray;
+
+struct _jmethodID;
+typedef _jmethodID* jmethodID;
+
+#define JNI_FALSE 0
+#define JNI_TRUE 1
+#define JNIEXPORT __attribute__((visibility("default")))
+#define JNICALL
+
+struct JNIEnv {
+    jsize GetArrayLength(jarray) { abort(); }
+    jobject GetObjectArrayElement(jobjectArray, jsize) { abort(); }
+    void GetByteArrayRegion(jbyteArray, jsize, jsize, jbyte*) { abort(); }
+    void GetIntArrayRegion(jintArray, jsize, jsize, jint*) { abort(); }
+    void GetLongArrayRegion(jlongArray, jsize, jsize, jlong*) { abort(); }
+    void GetFloatArrayRegion(jfloatArray, jsize, jsize, jfloat*) { abort(); }
+    void GetDoubleArrayRegion(jdoubleArray, jsize, jsize, jdouble*) { abort(); }
+    jbyteArray NewByteArray(jsize) { abort(); }
+    jintArray NewIntArray(jsize) { abort(); }
+    jlongArray NewLongArray(jsize) { abort(); }
+    jobjectArray NewObjectArray(jsize, jclass, jobject) { abort(); }
+    void SetByteArrayRegion(jbyteArray, jsize, jsize, const jbyte*) { abort(); }
+    void SetIntArrayRegion(jintArray, jsize, jsize, const jint*) { abort(); }
+    void SetLongArrayRegion(jlongArray, jsize, jsize, const jlong*) { abort(); }
+    const char* GetStringUTFChars(jstring, jboolean*) { abort(); }
+    void ReleaseStringUTFChars(jstring, const char*) { abort(); }
+    jsize GetStringLength(jstring) { abort(); }
+    const jchar* GetStringCritical(jstring, jboolean*) { abort(); }
+    void ReleaseStringCritical(jstring, const jchar*) { abort(); }
+    jstring NewString(const jchar*, jsize) { abort(); }
+    jstring NewStringUTF(const char*) { abort(); }
+    void* GetDirectBufferAddress(jobject) { abort(); }
+    void SetObjectArrayElement(jobjectArray, jsize, jobject) { abort(); }
+    jclass FindClass(const char*) { abort(); }
+    jclass GetObjectClass(jobject) { abort(); }
+    jmethodID GetMethodID(jclass, const char*, const char*) { abort(); }
+    jboolean CallBooleanMethod(jobject, jmethodID, ...) { abort(); }
+    void DeleteLocalRef(jobject) { abort(); }
+    jboolean ExceptionCheck() { abort(); }
+};
+
+#endif // HIDDIFYNG_TEST_JNI_H
@@ -0,0 +1,60 @@
+#include "dns_resolver.h"
+#include "icmp_prober.h"
+#include "stand_ins.h"
+
+/**
+ * icmp_prober::run against loopback, which answers every echo: each host
+ * gets all its echoes back, matched to the right input index, with RTT
+ * statistics that agree with each other. Where the sandbox refuses
+ * datagram ICMP sockets the prober has to say so rather than time out
+ */
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void loopback_answers_every_echo() {
+    icmp_prober::Options options;
+    options.count = 5;
+    options.interval_ms = 20;
+    options.timeout_ms = 1000;
+
+    auto started = Clock::now();
+    std::vector<icmp_prober::Result> results =
+        icmp_prober::run({"127.0.0.1", "nx.test", "loop.test"}, options);
+    auto elapsed = Clock::now() - started;
+    CHECK(results.size() == 3);
+    CHECK(results[1].index == 1);
+    CHECK(results[1].status == icmp_prober::kResolveFailed);
+    if (results[0].status == icmp_prober::kUnsupported) {
+        fprintf(stderr, "datagram ICMP sockets are not permitted here, skipping\n");
+        CHECK(results[2].status == icmp_prober::kUnsupported);
+        return;
+    }
+
+    for (size_t i : {0, 2}) {
+        const icmp_prober::Result& result = results[i];
+        CHECK(result.index == i);
+        CHECK(result.status == icmp_prober::kOk);
+        CHECK(result.sent == 5);
+        CHECK(result.received == 5);
+        CHECK(result.min_ns > 0);
+        CHECK(result.min_ns <= result.avg_ns);
+        CHECK(result.avg_ns <= result.max_ns);
+        CHECK(result.jitter_ns <= result.max_ns - result.min_ns);
+        CHECK(result.max_ns < 50 * 1000000ll);
+    }
+    // Echoes are paced, but a sweep that got every reply does not wait out the timeout
+    CHECK(elapsed >= std::chrono::milliseconds(4 * 20));
+    CHECK(elapsed < std::chrono::milliseconds(1000));
+}
+
+} // namespace
+
+int main() {
+    stand_ins::Dns dns(std::map<std::string, std::vector<std::string>>{{"loop.test", {"127.0.0.1"}}});
+    CHECK(dns_resolver::set_servers({dns.server()}));
+    dns_resolver::clear_cache();
+
+    loopback_answers_every_echo();
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include "latency_sketch.h"
+#include "stand_ins.h"
+
+/**
+ * latency_sketch's histogram: quantiles land within the 3% bucket width of
+ * the true sample, merging is the same as adding every sample to one
+ * sketch, old samples decay away past kDecayThreshold, and the serialized
+ * form round-trips while malformed blobs are rejected
+ */
+namespace {
+
+using latency_sketch::Sketch;
+
+/** True if value is within 3% of expected */
+bool close_to(int64_t value, int64_t expected) {
+    return std::abs(value - expected) * 100 <= expected * 3;
+}
+
+void small_values_are_exact() {
+    Sketch sketch;
+    CHECK(sketch.quantile(0.5) == -1);
+    for (int64_t us = 0; us < 32; us++) sketch.add(us);
+    CHECK(sketch.count() == 32);
+    CHECK(sketch.quantile(0) == 0);
+    CHECK(sketch.quantile(0.5) == 15);
+    CHECK(sketch.quantile(1) == 31);
+}
+
+void quantiles_within_the_bucket_width() {
+    // 1 ms to 200 ms in 1 ms steps: quantile q is about q * 200 ms
+    Sketch sketch;
+    for (int64_t ms = 1; ms <= 200; ms++) sketch.add(ms * 1000);
+    CHECK(close_to(sketch.quantile(0.1), 20000));
+    CHECK(close_to(sketch.quantile(0.5), 100000));
+    CHECK(close_to(sketch.quantile(0.9), 180000));
+    CHECK(close_to(sketch.quantile(1), 200000));
+
+    // Out of range values are clamped rather than dropped
+    Sketch extremes;
+    extremes.add(-5);
+    extremes.add(int64_t{1} << 40);
+    CHECK(extremes.quantile(0) == 0);
+    CHECK(extremes.quantile(1) > (int64_t{1} << (latency_sketch::kMaxExponent - 1)));
+    CHECK(extremes.quantile(1) < (int64_t{1} << latency_sketch::kMaxExponent));
+}
+
+void merging_matches_adding() {
+    Sketch fast;
+    Sketch slow;
+    Sketch both;
+    for (int i = 0; i < 100; i++) {
+        fast.add(10000 + i * 10);
+        slow.add(50000 + i * 50);
+        both.add(10000 + i * 10);
+        both.add(50000 + i * 50);
+    }
+    fast.merge(slow);
+    CHECK(fast.count() == 200);
+    for (double q : {0.0, 0.25, 0.5, 0.75, 0.99, 1.0}) CHECK(fast.quantile(q) == both.quantile(q));
+    CHECK(close_to(fast.quantile(0.25), 10500));
+    CHECK(close_to(fast.quantile(0.75), 52500));
+
+    // Past the threshold the merged counts are halved
+    Sketch more = both;
+    more.merge(both);
+    CHECK(more.count() <= latency_sketch::kDecayThreshold);
+    CHECK(more.quantile(0.5) == both.quantile(0.5));
+}
+
+void old_outliers_decay() {
+    Sketch sketch;
+    sketch.add(30 * 1000 * 1000);
+    for (uint32_t i = 0; i < latency_sketch::kDecayThreshold; i++) sketch.add(5000);
+    CHECK(sketch.count() == latency_sketch::kDecayThreshold / 2);
+    CHECK(close_to(sketch.quantile(1), 5000));
+}
+
+void encoding_round_trips() {
+    Sketch sketch;
+    for (int64_t ms = 20; ms < 80; ms += 3) sketch.add(ms * 1000);
+    std::string blob;
+    sketch.encode(blob);
+    CHECK(blob.size() < 100);
+
+    Sketch decoded;
+    CHECK(decoded.decode(reinterpret_cast<const uint8_t*>(blob.data()), blob.size()));
+    CHECK(decoded.count() == sketch.count());
+    for (double q : {0.0, 0.5, 0.9, 1.0}) CHECK(decoded.quantile(q) == sketch.quantile(q));
+
+    std::string empty;
+    Sketch().encode(empty);
+    CHECK(decoded.decode(reinterpret_cast<const uint8_t*>(empty.data()), empty.size()));
+    CHECK(decoded.count() == 0);
+}
+
+void malformed_blobs_are_rejected() {
+    std::string blob;
+    Sketch sketch;
+    sketch.add(1000);
+    sketch.encode(blob);
+
+    std::string wrong_version = blob;
+    wrong_version[0] = 9;
+    std::string truncated = blob.substr(0, blob.size() - 1);
+    std::string past_the_end = blob.substr(0, 1) + "\xff\x7f\x01";
+    std::string zero_count = blob.substr(0, 1) + std::string("\x00\x00", 2);
+    for (const std::string& bad : {wrong_version, truncated, past_the_end, zero_count}) {
+        Sketch decoded;
+        decoded.add(1);
+        CHECK(!decoded.decode(reinterpret_cast<const uint8_t*>(bad.data()), bad.size()));
+        CHECK(decoded.count() == 0);
+    }
+    Sketch decoded;
+    CHECK(!decoded.decode(nullptr, 0));
+}
+
+} // namespace
+
+int main() {
+    small_values_are_exact();
+    quantiles_within_the_bucket_width();
+    merging_matches_adding();
+    old_outliers_decay();
+    encoding_round_trips();
+    malformed_blobs_are_rejected();
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include <fcntl.h>
+
+#include "probe_cache.h"
+#include "stand_ins.h"
+
+/**
+ * probe_cache's shared table: results stay fresh for 2 min, or 30 s for a
+ * failure; a second mapping of the file sees them; a full probe window
+ * evicts its oldest entry; and a reader racing a writer only ever sees
+ * whole entries
+ */
+namespace {
+
+using probe_cache::Cache;
+using probe_cache::Key;
+
+constexpr int64_t kT0 = 1700000000000;
+constexpr size_t kSlotCount = 4096;
+constexpr size_t kProbeLength = 8;
+
+std::string temp_path() {
+    char path[] = "/tmp/probe_cache_testXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+    unlink(path);
+    return path;
+}
+
+/** The cache's own FNV-1a, to find hosts that share a home slot */
+size_t home_slot(const Key& key) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](uint8_t byte) {
+        hash ^= byte;
+        hash *= 0x100000001b3ull;
+    };
+    for (char c : key.host) mix(static_cast<uint8_t>(std::tolower(static_cast<unsigned char>(c))));
+    mix(0);
+    mix(static_cast<uint8_t>(key.port >> 8));
+    mix(static_cast<uint8_t>(key.port));
+    mix(static_cast<uint8_t>(key.transport));
+    return (hash != 0 ? hash : 1) & (kSlotCount - 1);
+}
+
+void entries_expire_by_outcome() {
+    std::string path = temp_path();
+    Cache cache;
+    Key key{"fresh.test", 443, 0};
+    CHECK(cache.lookup(key, kT0) == probe_cache::kMiss);
+    cache.store(key, 80, kT0);
+    CHECK(cache.lookup(key, kT0) == probe_cache::kMiss);  // not open yet
+
+    CHECK(cache.open(path));
+    cache.store(key, 80, kT0);
+    CHECK(cache.lookup(key, kT0 + probe_cache::kFreshReachableMs) == 80);
+    CHECK(cache.lookup(key, kT0 + probe_cache::kFreshReachableMs + 1) == probe_cache::kMiss);
+    // Set back the clock and the entry is not trusted
+    CHECK(cache.lookup(key, kT0 - 1) == probe_cache::kMiss);
+
+    CHECK(cache.lookup({"FRESH.test", 443, 0}, kT0) == 80);
+    CHECK(cache.lookup({"fresh.test", 8443, 0}, kT0) == probe_cache::kMiss);
+    CHECK(cache.lookup({"fresh.test", 443, 1}, kT0) == probe_cache::kMiss);
+
+    cache.store(key, 0, kT0);
+    CHECK(cache.lookup(key, kT0 + probe_cache::kFreshFailedMs) == probe_cache::kFailed);
+    CHECK(cache.lookup(key, kT0 + probe_cache::kFreshFailedMs + 1) == probe_cache::kMiss);
+    unlink(path.c_str());
+}
+
+void shared_through_the_file() {
+    std::string path = temp_path();
+    {
+        Cache writer;
+        CHECK(writer.open(path));
+        CHECK(!writer.open(path + ".other"));
+        writer.store({"shared.test", 443, 0}, 45, kT0);
+
+        Cache reader;
+        CHECK(reader.open(path));
+        CHECK(reader.lookup({"shared.test", 443, 0}, kT0) == 45);
+        writer.store({"shared.test", 443, 0}, 55, kT0);
+        CHECK(reader.lookup({"shared.test", 443, 0}, kT0) == 55);
+    }
+
+    Cache reopened;
+    CHECK(reopened.open(path));
+    CHECK(reopened.lookup({"shared.test", 443, 0}, kT0) == 55);
+
+    // A file that is not a table is reset
+    int fd = open(path.c_str(), O_WRONLY | O_TRUNC);
+    CHECK(fd >= 0);
+    CHECK(write(fd, "garbage", 7) == 7);
+    close(fd);
+    Cache reset;
+    CHECK(reset.open(path));
+    CHECK(reset.lookup({"shared.test", 443, 0}, kT0) == probe_cache::kMiss);
+    reset.store({"shared.test", 443, 0}, 65, kT0);
+    CHECK(reset.lookup({"shared.test", 443, 0}, kT0) == 65);
+    unlink(path.c_str());
+}
+
+/** One more key than a probe window holds, all with the same home slot */
+std::vector<Key> colliding_keys() {
+    std::map<size_t, std::vector<Key>> homes;
+    for (int i = 0;; i++) {
+        Key key{"h" + std::to_string(i) + ".test", 443, 0};
+        std::vector<Key>& same = homes[home_slot(key)];
+        same.push_back(key);
+        if (same.size() == kProbeLength + 1) return same;
+    }
+}
+
+void full_window_evicts_the_oldest() {
+    std::vector<Key> keys = colliding_keys();
+    std::string path = temp_path();
+    Cache cache;
+    CHECK(cache.open(path));
+    for (size_t i = 0; i < kProbeLength; i++) {
+        cache.store(keys[i], 10 + static_cast<int32_t>(i), kT0 + static_cast<int64_t>(i));
+    }
+    // A new result for a stored key reuses its slot
+    cache.store(keys[0], 20, kT0 + kProbeLength);
+    cache.store(keys[kProbeLength], 30, kT0 + kProbeLength + 1);
+
+    int64_t now = kT0 + kProbeLength + 1;
+    CHECK(cache.lookup(keys[kProbeLength], now) == 30);
+    CHECK(cache.lookup(keys[0], now) == 20);
+    CHECK(cache.lookup(keys[1], now) == probe_cache::kMiss);
+    for (size_t i = 2; i < kProbeLength; i++) {
+        CHECK(cache.lookup(keys[i], now) == 10 + static_cast<int32_t>(i));
+    }
+    unlink(path.c_str());
+}
+
+void readers_never_see_half_written_entries() {
+    std::vector<Key> keys = colliding_keys();
+    const Key& first = keys[0];
+    const Key& second = keys[kProbeLength];
+    std::string path = temp_path();
+    Cache cache;
+    CHECK(cache.open(path));
+
+    // The window is full of newer entries, so the two older keys keep
+    // evicting each other from the same slot
+    cache.store(first, 100, kT0 - 1000);
+    for (size_t i = 1; i < kProbeLength; i++) cache.store(keys[i], 50, kT0);
+
+    std::atomic<bool> stopping{false};
+    std::thread writer([&] {
+        for (int32_t i = 0; !stopping; i++) {
+            if (i & 1) {
+                cache.store(first, 100 + i % 100, kT0 - 1000);
+            } else {
+                cache.store(second, 300 + i % 100, kT0 - 1000);
+            }
+        }
+    });
+
+    // A torn read would pair the first key with the second key's ping; a
+    // miss is fine, the slot may hold the other key or be mid-write
+    int hits = 0;
+    for (int i = 0; i < 200000; i++) {
+        int32_t ping = cache.lookup(first, kT0);
+        CHECK(ping == probe_cache::kMiss || (ping >= 100 && ping < 200));
+        if (ping != probe_cache::kMiss) hits++;
+    }
+    stopping = true;
+    writer.join();
+    CHECK(hits > 0);
+    unlink(path.c_str());
+}
+
+} // namespace
+
+int main() {
+    entries_expire_by_outcome();
+    shared_through_the_file();
+    full_window_evicts_the_oldest();
+    readers_never_see_half_written_entries();
+    return 0;
+}
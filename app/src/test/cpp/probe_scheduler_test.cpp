@@ -0,0 +1,142 @@
+#include "probe_scheduler.h"
+#include "stand_ins.h"
+
+/**
+ * probe_scheduler's refresh intervals, worked out by hand from the
+ * constants: 15 min for a jittery server, 4x that for a steady one, 4x
+ * again for one the user is unlikely to pick, halved for favorites and
+ * quartered for the selected server; failures back off from 15 min by
+ * doubling, capped at a day, or at an hour for important servers
+ */
+namespace {
+
+using probe_scheduler::Candidate;
+using probe_scheduler::Scheduler;
+
+constexpr uint32_t kT0 = 1700000000;
+constexpr uint32_t kMinute = 60;
+constexpr uint32_t kHour = 60 * kMinute;
+
+/** Several identical answers: known, steady, no jitter */
+void steady(Scheduler& scheduler, int64_t id, float latency_ms) {
+    for (int i = 0; i < 5; i++) scheduler.record(id, latency_ms, kT0);
+}
+
+void failing(Scheduler& scheduler, int64_t id, int failures) {
+    for (int i = 0; i < failures; i++) scheduler.record(id, -1, kT0);
+}
+
+uint32_t interval_of(Scheduler& scheduler, const Candidate& server) {
+    return scheduler.next_due({server}, kT0);
+}
+
+void new_servers_are_always_due() {
+    Scheduler scheduler;
+    steady(scheduler, 1, 40);
+    std::vector<int64_t> plan = scheduler.plan({{1, 0}, {2, 0}, {3, 0}}, 0, kT0);
+    CHECK((plan == std::vector<int64_t>{2, 3}));
+    CHECK(scheduler.next_due({{1, 0}, {2, 0}}, kT0) == 0);
+}
+
+void intervals_follow_jitter_and_importance() {
+    Scheduler scheduler;
+    steady(scheduler, 1, 40);
+    CHECK(interval_of(scheduler, {1, 0}) == 1 * kHour);
+    CHECK(interval_of(scheduler, {1, probe_scheduler::kFavorite}) == 30 * kMinute);
+    CHECK(interval_of(scheduler, {1, probe_scheduler::kSelected}) == 15 * kMinute);
+
+    // Swinging between 20 and 200 ms is far past the 25% jitter mark
+    for (int i = 0; i < 10; i++) scheduler.record(2, i % 2 == 0 ? 20.0f : 200.0f, kT0);
+    CHECK(interval_of(scheduler, {2, 0}) == 15 * kMinute);
+
+    // Due exactly at the interval, not a second before
+    CHECK(scheduler.plan({{1, 0}}, 10, kT0 + kHour - 1).empty());
+    CHECK((scheduler.plan({{1, 0}}, 10, kT0 + kHour) == std::vector<int64_t>{1}));
+}
+
+void servers_outside_the_fastest_wait_longer() {
+    // The 17th fastest is the first not counted as a likely pick
+    Scheduler scheduler;
+    std::vector<Candidate> servers;
+    for (int64_t id = 1; id <= 17; id++) {
+        steady(scheduler, id, static_cast<float>(10 * id));
+        servers.push_back({id, 0});
+    }
+
+    std::vector<int64_t> plan = scheduler.plan(servers, 100, kT0 + kHour);
+    CHECK(plan.size() == 16);
+    CHECK(std::find(plan.begin(), plan.end(), 17) == plan.end());
+    CHECK(scheduler.plan(servers, 100, kT0 + 4 * kHour - 1).size() == 16);
+    CHECK(scheduler.plan(servers, 100, kT0 + 4 * kHour).size() == 17);
+
+    // A favorite is never idle
+    servers[16].flags = probe_scheduler::kFavorite;
+    CHECK(scheduler.plan(servers, 100, kT0 + kHour).size() == 17);
+}
+
+void failures_back_off_exponentially() {
+    Scheduler scheduler;
+    failing(scheduler, 1, 1);
+    CHECK(interval_of(scheduler, {1, 0}) == 15 * kMinute);
+    failing(scheduler, 1, 2);
+    CHECK(interval_of(scheduler, {1, 0}) == 1 * kHour);
+    failing(scheduler, 1, 20);
+    CHECK(interval_of(scheduler, {1, 0}) == 24 * kHour);
+
+    // Important servers are retried within the hour, then by their own factor
+    CHECK(interval_of(scheduler, {1, probe_scheduler::kFavorite}) == 30 * kMinute);
+    CHECK(interval_of(scheduler, {1, probe_scheduler::kSelected}) == 15 * kMinute);
+
+    // One answer resets the backoff
+    steady(scheduler, 1, 40);
+    CHECK(interval_of(scheduler, {1, 0}) == 1 * kHour);
+}
+
+void most_urgent_first_within_the_budget() {
+    Scheduler scheduler;
+    steady(scheduler, 1, 40);
+    steady(scheduler, 2, 40);
+    steady(scheduler, 3, 40);
+    // Equally overdue; the selected server outweighs the favorite, which outweighs the rest
+    std::vector<Candidate> servers = {{1, 0}, {2, probe_scheduler::kFavorite},
+                                      {3, probe_scheduler::kSelected}, {4, 0}};
+    std::vector<int64_t> plan = scheduler.plan(servers, 2, kT0 + 2 * kHour);
+    CHECK((plan == std::vector<int64_t>{3, 2, 4}));
+}
+
+void forgets_deleted_servers_and_persists() {
+    char path[] = "/tmp/probe_scheduler_testXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+    unlink(path);
+
+    {
+        Scheduler scheduler;
+        CHECK(scheduler.open(path));
+        steady(scheduler, 1, 40);
+        steady(scheduler, 2, 40);
+        failing(scheduler, 3, 3);
+        CHECK(scheduler.plan({{1, 0}, {3, 0}}, 10, kT0).empty());
+        CHECK(scheduler.save());
+    }
+
+    Scheduler reopened;
+    CHECK(reopened.open(path));
+    CHECK(interval_of(reopened, {1, 0}) == 1 * kHour);
+    CHECK(interval_of(reopened, {3, 0}) == 1 * kHour);
+    CHECK((reopened.plan({{1, 0}, {2, 0}}, 10, kT0) == std::vector<int64_t>{2}));
+    unlink(path);
+}
+
+} // namespace
+
+int main() {
+    new_servers_are_always_due();
+    intervals_follow_jitter_and_importance();
+    servers_outside_the_fastest_wait_longer();
+    failures_back_off_exponentially();
+    most_urgent_first_within_the_budget();
+    forgets_deleted_servers_and_persists();
+    return 0;
+}
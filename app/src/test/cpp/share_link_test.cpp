@@ -0,0 +1,146 @@
+#include "share_link.h"
+#include "stand_ins.h"
+#include "text_codec.h"
+
+/**
+ * share_link::parse and generate: the authority forms, where only reality://
+ * may leave the port out (443), and round trips of the vmess and ss bodies
+ */
+namespace {
+
+share_link::Link parsed(const char* uri) {
+    share_link::Link link;
+    CHECK(share_link::parse(uri, link));
+    return link;
+}
+
+bool parses(const char* uri) {
+    share_link::Link link;
+    return share_link::parse(uri, link);
+}
+
+void reality_defaults_to_443() {
+    share_link::Link link = parsed("reality://uuid-1@example.com?pbk=key&sid=ab#home");
+    CHECK(link.scheme == share_link::kReality);
+    CHECK(link.get(share_link::kAddress) == "example.com");
+    CHECK(link.number(share_link::kPort) == 443);
+    CHECK(link.get(share_link::kUserId) == "uuid-1");
+    CHECK(link.get(share_link::kPublicKey) == "key");
+
+    CHECK(parsed("vless+reality://uuid-1@[2001:db8::1]?pbk=key").number(share_link::kPort) == 443);
+    CHECK(parsed("reality://uuid-1@example.com:8443?pbk=key").number(share_link::kPort) == 8443);
+
+    // The default fills a missing port, not a malformed one
+    CHECK(!parses("reality://uuid-1@example.com:?pbk=key"));
+    CHECK(!parses("reality://uuid-1@example.com:0?pbk=key"));
+    CHECK(!parses("reality://uuid-1@:443?pbk=key"));
+}
+
+void other_schemes_require_a_port() {
+    CHECK(!parses("vless://uuid-1@example.com?security=tls"));
+    CHECK(!parses("trojan://secret@[2001:db8::1]?sni=example.com"));
+    CHECK(!parses("hysteria://example.com?auth=x"));
+
+    share_link::Link link = parsed("trojan://secret@[2001:db8::1]:443?sni=example.com");
+    CHECK(link.get(share_link::kAddress) == "2001:db8::1");
+    CHECK(link.number(share_link::kPort) == 443);
+}
+
+/** Regenerate the link and parse it again; every field must survive */
+void check_round_trip(const share_link::Link& link) {
+    std::string uri;
+    share_link::generate(link, uri);
+    share_link::Link again = parsed(uri.c_str());
+    CHECK(again.scheme == link.scheme);
+    for (int i = 0; i < share_link::kFieldCount; i++) CHECK(again.fields[i] == link.fields[i]);
+    for (int i = 0; i < share_link::kNumberCount; i++) CHECK(again.numbers[i] == link.numbers[i]);
+}
+
+std::string base64(const std::string& text, bool url_safe = false, bool pad = true) {
+    std::string out;
+    text_codec::base64_encode(text, out, url_safe, pad);
+    return out;
+}
+
+void vmess_base64_json_round_trips() {
+    std::string json = R"({"v":"2","ps":"home vmess","add":"example.com","port":"8443",)"
+                       R"("id":"uuid-1","aid":0,"net":"ws","type":"none","host":"cdn.example.com",)"
+                       R"("path":"/ws","tls":"tls","sni":"example.com","fp":"chrome"})";
+    std::string uri = "vmess://" + base64(json);
+    share_link::Link link = parsed(uri.c_str());
+    CHECK(link.scheme == share_link::kVmess);
+    CHECK(link.get(share_link::kName) == "home vmess");
+    CHECK(link.get(share_link::kAddress) == "example.com");
+    CHECK(link.number(share_link::kPort) == 8443);  // a string port, as v2rayN writes it
+    CHECK(link.get(share_link::kUserId) == "uuid-1");
+    CHECK(link.get(share_link::kMethod) == "auto");
+    CHECK(link.get(share_link::kNetwork) == "ws");
+    CHECK(link.get(share_link::kPath) == "/ws");
+    CHECK(link.get(share_link::kHost) == "cdn.example.com");
+    CHECK(link.get(share_link::kSecurity) == "tls");
+    check_round_trip(link);
+
+    // Unpadded, and "tls":"none" means no TLS
+    std::string plain = R"({"add":"10.0.0.1","port":443,"id":"uuid-2","tls":"none"})";
+    share_link::Link bare = parsed(("vmess://" + base64(plain, false, false)).c_str());
+    CHECK(bare.number(share_link::kPort) == 443);
+    CHECK(bare.get(share_link::kSecurity).empty());
+    CHECK(bare.get(share_link::kNetwork) == "tcp");
+    check_round_trip(bare);
+
+    CHECK(!parses(("vmess://" + base64(R"({"add":"example.com","id":"uuid-1"})")).c_str()));
+    CHECK(!parses("vmess://not*base64"));
+}
+
+void shadowsocks_forms_round_trip() {
+    // SIP002: base64url userinfo, unpadded
+    std::string sip002 = "ss://" + base64("aes-256-gcm:secret:with:colons", true, false) +
+                         "@example.com:8388#office%20ss";
+    share_link::Link link = parsed(sip002.c_str());
+    CHECK(link.scheme == share_link::kShadowsocks);
+    CHECK(link.get(share_link::kMethod) == "aes-256-gcm");
+    CHECK(link.get(share_link::kPassword) == "secret:with:colons");
+    CHECK(link.get(share_link::kAddress) == "example.com");
+    CHECK(link.number(share_link::kPort) == 8388);
+    CHECK(link.get(share_link::kName) == "office ss");
+    check_round_trip(link);
+
+    // Legacy: the whole method:password@host:port in base64
+    std::string legacy = "ss://" + base64("chacha20-ietf-poly1305:p@ss@[2001:db8::1]:8388") + "#legacy";
+    share_link::Link old = parsed(legacy.c_str());
+    CHECK(old.get(share_link::kMethod) == "chacha20-ietf-poly1305");
+    CHECK(old.get(share_link::kPassword) == "p@ss");
+    CHECK(old.get(share_link::kAddress) == "2001:db8::1");
+    CHECK(old.number(share_link::kPort) == 8388);
+    check_round_trip(old);
+
+    // 2022 ciphers: plain percent-encoded userinfo
+    share_link::Link blake = parsed("ss://2022-blake3-aes-128-gcm:a2V5%3D@10.0.0.2:443");
+    CHECK(blake.get(share_link::kMethod) == "2022-blake3-aes-128-gcm");
+    CHECK(blake.get(share_link::kPassword) == "a2V5=");
+    check_round_trip(blake);
+
+    CHECK(!parses(("ss://" + base64("aes-256-gcm") + "@example.com:8388").c_str()));
+    CHECK(!parses("ss://example.com:8388"));
+}
+
+void reality_round_trips_with_its_port() {
+    share_link::Link link = parsed("reality://uuid-1@example.com?pbk=key");
+    std::string uri;
+    share_link::generate(link, uri);
+    share_link::Link again = parsed(uri.c_str());
+    CHECK(again.scheme == share_link::kReality);
+    CHECK(again.number(share_link::kPort) == 443);
+    CHECK(again.get(share_link::kPublicKey) == "key");
+}
+
+} // namespace
+
+int main() {
+    reality_defaults_to_443();
+    other_schemes_require_a_port();
+    reality_round_trips_with_its_port();
+    vmess_base64_json_round_trips();
+    shadowsocks_forms_round_trip();
+    return 0;
+}
@@ -0,0 +1,345 @@
+#ifndef HIDDIFYNG_TEST_STAND_INS_H
+#define HIDDIFYNG_TEST_STAND_INS_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * In-process stand-ins for the servers the probers talk to
+ *
+ * Each stand-in listens on an ephemeral loopback port and serves every
+ * connection on its own thread. A connection ends when its handler returns;
+ * the destructor shuts the rest down and joins them, so a test can leave a
+ * stand-in mid-transfer.
+ */
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition);   \
+            std::exit(1);                                                                   \
+        }                                                                                   \
+    } while (0)
+
+namespace stand_ins {
+
+inline bool read_exact(int fd, void* data, size_t size) {
+    auto* out = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = recv(fd, out, size, 0);
+        if (n <= 0) return false;
+        out += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+inline bool write_all(int fd, const void* data, size_t size) {
+    auto* in = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = send(fd, in, size, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        in += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+inline bool write_all(int fd, const std::string& data) {
+    return write_all(fd, data.data(), data.size());
+}
+
+/** Listening TCP socket on address:0; sets port */
+inline int listen_on(const char* address, int backlog, int& port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    CHECK(fd >= 0);
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in bound{};
+    bound.sin_family = AF_INET;
+    CHECK(inet_pton(AF_INET, address, &bound.sin_addr) == 1);
+    CHECK(bind(fd, reinterpret_cast<sockaddr*>(&bound), sizeof(bound)) == 0);
+    CHECK(listen(fd, backlog) == 0);
+    socklen_t length = sizeof(bound);
+    CHECK(getsockname(fd, reinterpret_cast<sockaddr*>(&bound), &length) == 0);
+    port = ntohs(bound.sin_port);
+    return fd;
+}
+
+/** A loopback port nothing listens on */
+inline int closed_port() {
+    int port = 0;
+    close(listen_on("127.0.0.1", 1, port));
+    return port;
+}
+
+/** Accept loop plus one thread per connection */
+class Server {
+public:
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    virtual ~Server() { stop(); }
+
+    int port() const { return port_; }
+
+protected:
+    Server() { listen_fd_ = listen_on("127.0.0.1", 64, port_); }
+
+    /** Start accepting; call from the most derived constructor */
+    void start() { accept_thread_ = std::thread([this] { accept_loop(); }); }
+
+    /** Stop and join; call from the most derived destructor */
+    void stop() {
+        if (stopping_.exchange(true)) return;
+        shutdown(listen_fd_, SHUT_RDWR);
+        if (accept_thread_.joinable()) accept_thread_.join();
+        close(listen_fd_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int fd : clients_) shutdown(fd, SHUT_RDWR);
+        for (std::thread& thread : threads_) thread.join();
+        for (int fd : clients_) close(fd);
+    }
+
+    bool stopping() const { return stopping_; }
+
+    virtual void serve(int fd) = 0;
+
+private:
+    void accept_loop() {
+        for (;;) {
+            int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) return;
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                close(fd);
+                return;
+            }
+            clients_.push_back(fd);
+            // Shut down, not closed: stop() may still shut it down again, and
+            // the descriptor must not be reused before then
+            threads_.emplace_back([this, fd] {
+                serve(fd);
+                shutdown(fd, SHUT_RDWR);
+            });
+        }
+    }
+
+    int listen_fd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::thread accept_thread_;
+    std::mutex mutex_;
+    std::vector<int> clients_;
+    std::vector<std::thread> threads_;
+};
+
+/**
+ * SOCKS5 inbound that answers the tunneled HTTP request itself
+ *
+ *   /generate_204  204 No Content
+ *   /rate/<kbps>   200 with an endless body paced in 10 ms chunks
+ *   /bytes/<n>     200 with n bytes, then close
+ *   anything else  200 with a two-byte body
+ */
+class Socks5 : public Server {
+public:
+    enum Mode {
+        kServe,
+        kRefuseConnect,  // CONNECT reply 5: connection refused by the target
+        kRejectAuth,     // no acceptable method
+        kSilent,         // accepts the CONNECT, then never answers the request
+    };
+
+    explicit Socks5(Mode mode) : mode_(mode) { start(); }
+    ~Socks5() override { stop(); }
+
+protected:
+    void serve(int fd) override {
+        unsigned char greeting[2];
+        if (!read_exact(fd, greeting, 2)) return;
+        std::string methods(greeting[1], '\0');
+        if (!read_exact(fd, &methods[0], methods.size())) return;
+        if (mode_ == kRejectAuth) {
+            write_all(fd, "\x05\xff", 2);
+            return;
+        }
+        if (!write_all(fd, "\x05\x00", 2)) return;
+
+        unsigned char request[4];
+        if (!read_exact(fd, request, 4)) return;
+        size_t address = request[3] == 1 ? 4 : request[3] == 4 ? 16 : 0;
+        if (request[3] == 3) {
+            unsigned char length;
+            if (!read_exact(fd, &length, 1)) return;
+            address = length;
+        }
+        std::string skipped(address + 2, '\0');
+        if (!read_exact(fd, &skipped[0], skipped.size())) return;
+        if (mode_ == kRefuseConnect) {
+            write_all(fd, "\x05\x05\x00\x01\x00\x00\x00\x00\x00\x00", 10);
+            return;
+        }
+        if (!write_all(fd, "\x05\x00\x00\x01\x00\x00\x00\x00\x00\x00", 10)) return;
+
+        std::string input;
+        char buffer[1024];
+        while (input.find("\r\n\r\n") == std::string::npos) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) return;
+            input.append(buffer, static_cast<size_t>(n));
+        }
+        if (mode_ == kSilent) {
+            while (recv(fd, buffer, sizeof(buffer), 0) > 0) {}
+            return;
+        }
+        size_t start = input.find(' ') + 1;
+        respond(fd, input.substr(start, input.find(' ', start) - start));
+    }
+
+private:
+    void respond(int fd, const std::string& path) {
+        if (path == "/generate_204") {
+            write_all(fd, "HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n");
+        } else if (path.compare(0, 6, "/rate/") == 0) {
+            // Chunks per 10 ms tick, at least one byte
+            size_t chunk = std::max<size_t>(1, std::stoul(path.substr(6)) * 1000 / 8 / 100);
+            std::string body(chunk, 'x');
+            if (!write_all(fd, "HTTP/1.1 200 OK\r\nContent-Length: 1000000000\r\n\r\n")) return;
+            auto tick = std::chrono::steady_clock::now();
+            while (!stopping() && write_all(fd, body)) {
+                tick += std::chrono::milliseconds(10);
+                std::this_thread::sleep_until(tick);
+            }
+        } else if (path.compare(0, 7, "/bytes/") == 0) {
+            std::string body(std::stoul(path.substr(7)), 'x');
+            write_all(fd, "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) +
+                          "\r\n\r\n" + body);
+        } else {
+            write_all(fd, "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nhi");
+        }
+    }
+
+    Mode mode_;
+};
+
+/**
+ * UDP DNS server with fixed A records of the given TTL; every other A or
+ * AAAA question gets an empty NOERROR answer, and names without records get
+ * NXDOMAIN. Counts the questions asked per name
+ */
+class Dns {
+public:
+    explicit Dns(std::map<std::string, std::vector<std::string>> records, uint32_t ttl = 300)
+        : records_(std::move(records)), ttl_(ttl) {
+        fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        CHECK(fd_ >= 0);
+        sockaddr_in bound{};
+        bound.sin_family = AF_INET;
+        bound.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        CHECK(bind(fd_, reinterpret_cast<sockaddr*>(&bound), sizeof(bound)) == 0);
+        socklen_t length = sizeof(bound);
+        CHECK(getsockname(fd_, reinterpret_cast<sockaddr*>(&bound), &length) == 0);
+        port_ = ntohs(bound.sin_port);
+        thread_ = std::thread([this] { loop(); });
+    }
+
+    ~Dns() {
+        stopping_ = true;
+        thread_.join();
+        close(fd_);
+    }
+
+    Dns(const Dns&) = delete;
+    Dns& operator=(const Dns&) = delete;
+
+    /** "127.0.0.1:port", for dns_resolver::set_servers */
+    std::string server() const { return "127.0.0.1:" + std::to_string(port_); }
+
+    /** Questions received for a name, any type */
+    int queries(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = queries_.find(name);
+        return found == queries_.end() ? 0 : found->second;
+    }
+
+private:
+    void loop() {
+        unsigned char query[512];
+        while (!stopping_) {
+            pollfd ready{fd_, POLLIN, 0};
+            if (poll(&ready, 1, 20) <= 0) continue;
+            sockaddr_in from{};
+            socklen_t from_length = sizeof(from);
+            ssize_t n = recvfrom(fd_, query, sizeof(query), 0,
+                                 reinterpret_cast<sockaddr*>(&from), &from_length);
+            if (n < 12) continue;
+
+            // One question: labels, then type and class
+            std::string name;
+            size_t offset = 12;
+            while (offset < static_cast<size_t>(n) && query[offset] != 0) {
+                size_t label = query[offset];
+                if (!name.empty()) name += '.';
+                name.append(reinterpret_cast<char*>(query) + offset + 1, label);
+                offset += 1 + label;
+            }
+            offset += 1;
+            if (offset + 4 > static_cast<size_t>(n)) continue;
+            int type = query[offset] << 8 | query[offset + 1];
+            size_t question_end = offset + 4;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                queries_[name]++;
+            }
+
+            auto found = records_.find(name);
+            std::string reply(reinterpret_cast<char*>(query), question_end);
+            reply[2] = static_cast<char>(0x81);  // response, recursion desired
+            reply[3] = static_cast<char>(found == records_.end() ? 0x83 : 0x80);  // NXDOMAIN or NOERROR
+            reply[6] = reply[7] = reply[8] = reply[9] = reply[10] = reply[11] = 0;
+            if (found != records_.end() && type == 1) {
+                reply[7] = static_cast<char>(found->second.size());
+                for (const std::string& address : found->second) {
+                    in_addr raw{};
+                    CHECK(inet_pton(AF_INET, address.c_str(), &raw) == 1);
+                    // Name pointer to the question, A, IN, TTL, 4 bytes
+                    reply.append("\xc0\x0c\x00\x01\x00\x01", 6);
+                    uint32_t ttl = htonl(ttl_);
+                    reply.append(reinterpret_cast<char*>(&ttl), 4);
+                    reply.append("\x00\x04", 2);
+                    reply.append(reinterpret_cast<char*>(&raw), 4);
+                }
+            }
+            sendto(fd_, reply.data(), reply.size(), 0, reinterpret_cast<sockaddr*>(&from), from_length);
+        }
+    }
+
+    std::map<std::string, std::vector<std::string>> records_;
+    uint32_t ttl_;
+    std::mutex mutex_;
+    std::map<std::string, int> queries_;
+    int fd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+};
+
+} // namespace stand_ins
+
+#endif // HIDDIFYNG_TEST_STAND_INS_H
@@ -0,0 +1,79 @@
+#include "url_tester.h"
+#include "stand_ins.h"
+
+/**
+ * url_tester's body budget against paced stand-in bodies: goodput has to
+ * come out near the pacing rate whether the byte or the time budget ends
+ * the read, and bodies too short to time must not count as measured
+ */
+namespace {
+
+using stand_ins::Socks5;
+
+double kbps(const url_tester::Result& result) {
+    return result.body_bytes * 8.0 * 1e6 / static_cast<double>(result.body_ns);
+}
+
+void byte_budget_measures_the_paced_rate() {
+    Socks5 inbound(Socks5::kServe);
+    url_tester::Options options;
+    options.url = "http://speed.test/rate/4000";
+    options.body_bytes = 256 * 1024;
+    options.body_ms = 3000;
+    std::vector<url_tester::Result> results = url_tester::run({inbound.port()}, options);
+
+    CHECK(results.size() == 1);
+    CHECK(results[0].status == url_tester::kOk);
+    CHECK(results[0].http_status == 200);
+    CHECK(results[0].successes == 1);
+    CHECK(results[0].body_bytes >= 16 * 1024);
+    CHECK(results[0].body_bytes <= 256 * 1024);
+    CHECK(results[0].body_ns > 0);
+    CHECK(kbps(results[0]) > 2500 && kbps(results[0]) < 6000);
+}
+
+void time_budget_ends_a_slow_body() {
+    Socks5 inbound(Socks5::kServe);
+    url_tester::Options options;
+    options.url = "http://speed.test/rate/800";
+    options.body_bytes = 16 * 1024 * 1024;
+    options.body_ms = 500;
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<url_tester::Result> results = url_tester::run({inbound.port()}, options);
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    CHECK(results.size() == 1);
+    CHECK(results[0].status == url_tester::kOk);
+    CHECK(results[0].body_bytes >= 16 * 1024);
+    CHECK(kbps(results[0]) > 500 && kbps(results[0]) < 1200);
+    CHECK(elapsed < std::chrono::milliseconds(1500));
+}
+
+void short_or_empty_bodies_are_not_measured() {
+    Socks5 inbound(Socks5::kServe);
+    url_tester::Options options;
+    options.body_bytes = 256 * 1024;
+
+    options.url = "http://speed.test/bytes/1000";
+    std::vector<url_tester::Result> short_body = url_tester::run({inbound.port()}, options);
+    CHECK(short_body.size() == 1);
+    CHECK(short_body[0].status == url_tester::kBadResponse);
+    CHECK(short_body[0].successes == 0);
+
+    // A body budget needs a 200 or 206
+    options.url = "http://speed.test/generate_204";
+    std::vector<url_tester::Result> no_body = url_tester::run({inbound.port()}, options);
+    CHECK(no_body.size() == 1);
+    CHECK(no_body[0].status == url_tester::kBadResponse);
+    CHECK(no_body[0].http_status == 204);
+}
+
+} // namespace
+
+int main() {
+    byte_budget_measures_the_paced_rate();
+    time_budget_ends_a_slow_body();
+    short_or_empty_bodies_are_not_measured();
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "tls_prober.h"
+#include "stand_ins.h"
+
+/**
+ * tls_prober::run against a stand-in that answers the ClientHello with a
+ * scripted, unencrypted server flight. Pauses between the server's records
+ * have to show up in the phase the prober attributes them to: TLS 1.2 ends
+ * at ServerHelloDone, TLS 1.3 at the last record before the line goes
+ * quiet, and anything that is not a ServerHello fails the handshake
+ */
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr int64_t kMs = 1000000;
+constexpr char kSni[] = "probe.example.com";
+
+std::string record(uint8_t type, const std::string& body) {
+    std::string out{static_cast<char>(type), 0x03, 0x03,
+                    static_cast<char>(body.size() >> 8), static_cast<char>(body.size() & 0xff)};
+    return out + body;
+}
+
+std::string handshake(uint8_t type, const std::string& body) {
+    std::string out{static_cast<char>(type), 0, static_cast<char>(body.size() >> 8),
+                    static_cast<char>(body.size() & 0xff)};
+    return out + body;
+}
+
+/** TLS 1.2 version field, zero random, no session id; supported_versions for 1.3 */
+std::string server_hello(uint16_t cipher, bool tls13) {
+    std::string body{0x03, 0x03};
+    body.append(32, '\0');
+    body.push_back(0);
+    body.push_back(static_cast<char>(cipher >> 8));
+    body.push_back(static_cast<char>(cipher & 0xff));
+    body.push_back(0);
+    if (tls13) body.append({0x00, 0x06, 0x00, 0x2b, 0x00, 0x02, 0x03, 0x04});
+    return handshake(2, body);
+}
+
+class TlsServer : public stand_ins::Server {
+public:
+    enum Mode {
+        kTls12,  // ServerHello, 30 ms, Certificate + ServerHelloDone
+        kTls13,  // ServerHello + CCS, then two encrypted records 5 ms apart, then silence
+        kAlert,  // handshake_failure instead of a ServerHello
+        kSilent, // reads the hello and never answers
+    };
+
+    explicit TlsServer(Mode mode) : mode_(mode) { start(); }
+    ~TlsServer() override { stop(); }
+
+    /** Whether a ClientHello carrying kSni arrived */
+    bool saw_sni() const { return saw_sni_; }
+
+protected:
+    void serve(int fd) override {
+        unsigned char header[5];
+        if (!stand_ins::read_exact(fd, header, 5) || header[0] != 22) return;
+        std::string hello((header[3] << 8) | header[4], '\0');
+        if (!stand_ins::read_exact(fd, &hello[0], hello.size()) || hello[0] != 1) return;
+        if (hello.find(kSni) != std::string::npos) saw_sni_ = true;
+
+        // Lets the prober tell the first byte from the connect
+        std::this_thread::sleep_for(20ms);
+        switch (mode_) {
+            case kTls12:
+                stand_ins::write_all(fd, record(22, server_hello(0xc02f, false)));
+                std::this_thread::sleep_for(30ms);
+                stand_ins::write_all(fd, record(22, handshake(11, std::string(3, '\0')) +
+                                                     handshake(14, "")));
+                break;
+            case kTls13:
+                stand_ins::write_all(fd, record(22, server_hello(0x1301, true)) + record(20, "\x01"));
+                // Closer together than the prober's quiet period of RTT + 20 ms
+                for (int i = 0; i < 2; i++) {
+                    std::this_thread::sleep_for(5ms);
+                    stand_ins::write_all(fd, record(23, std::string(64, 'e')));
+                }
+                break;
+            case kAlert:
+                stand_ins::write_all(fd, record(21, "\x02\x28"));
+                break;
+            case kSilent:
+                break;
+        }
+        // Hold the connection until the prober closes it
+        char buffer[256];
+        while (!stopping() && recv(fd, buffer, sizeof(buffer), 0) > 0) {}
+    }
+
+private:
+    Mode mode_;
+    std::atomic<bool> saw_sni_{false};
+};
+
+tls_prober::Result probe(int port, int timeout_ms = 3000) {
+    tls_prober::Options options;
+    options.timeout_ms = timeout_ms;
+    std::vector<tls_prober::Result> results =
+        tls_prober::run({{"127.0.0.1", port, kSni, "chrome"}}, options);
+    CHECK(results.size() == 1);
+    return results[0];
+}
+
+void tls12_flight_ends_at_server_hello_done() {
+    TlsServer server(TlsServer::kTls12);
+    tls_prober::Result result = probe(server.port());
+
+    CHECK(server.saw_sni());
+    CHECK(result.status == tls_prober::kOk);
+    CHECK(result.version == 0x0303);
+    CHECK(result.cipher == 0xc02f);
+    // Phases are stamped when the prober wakes, so a busy host can only make them
+    // later; each has to be at least as late as the stand-in's pauses put it
+    CHECK(result.connect_ns > 0);
+    CHECK(result.first_byte_ns >= result.connect_ns + 20 * kMs);
+    CHECK(result.server_hello_ns >= result.first_byte_ns);
+    CHECK(result.handshake_ns >= result.connect_ns + 50 * kMs);
+    CHECK(result.handshake_ns >= result.server_hello_ns);
+    CHECK(result.handshake_ns < 500 * kMs);
+}
+
+void tls13_flight_ends_at_the_last_record() {
+    TlsServer server(TlsServer::kTls13);
+    auto started = std::chrono::steady_clock::now();
+    tls_prober::Result result = probe(server.port());
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    CHECK(result.status == tls_prober::kOk);
+    CHECK(result.version == 0x0304);
+    CHECK(result.cipher == 0x1301);
+    CHECK(result.server_hello_ns >= result.connect_ns + 20 * kMs);
+    CHECK(result.handshake_ns >= result.connect_ns + 25 * kMs);
+    CHECK(result.handshake_ns >= result.server_hello_ns);
+    // The quiet period closes the flight long before the timeout
+    CHECK(elapsed < 1s);
+}
+
+void failures_are_classified() {
+    TlsServer alert(TlsServer::kAlert);
+    CHECK(probe(alert.port()).status == tls_prober::kHandshakeFailed);
+
+    TlsServer silent(TlsServer::kSilent);
+    tls_prober::Result timed_out = probe(silent.port(), 300);
+    CHECK(timed_out.status == tls_prober::kTimeout);
+    CHECK(timed_out.connect_ns > 0);
+    CHECK(timed_out.server_hello_ns == 0);
+
+    CHECK(probe(stand_ins::closed_port()).status == tls_prober::kRefused);
+}
+
+} // namespace
+
+int main() {
+    tls12_flight_ends_at_server_hello_done();
+    tls13_flight_ends_at_the_last_record();
+    failures_are_classified();
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include "udp_prober.h"
+#include "stand_ins.h"
+
+/**
+ * udp_prober::run against a stand-in QUIC endpoint that answers probes
+ * with Version Negotiation, drops every fourth one and holds every other
+ * answer back 10 ms: received, min/max and the mean swing between
+ * consecutive answered probes have to come out of that pattern
+ */
+namespace {
+
+using Clock = std::chrono::steady_clock;
+constexpr int64_t kMs = 1000000;
+
+class QuicResponder {
+public:
+    static constexpr uint32_t kVersion = 0x00000001;
+
+    QuicResponder() {
+        fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        CHECK(fd_ >= 0);
+        sockaddr_in bound{};
+        bound.sin_family = AF_INET;
+        bound.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        CHECK(bind(fd_, reinterpret_cast<sockaddr*>(&bound), sizeof(bound)) == 0);
+        socklen_t length = sizeof(bound);
+        CHECK(getsockname(fd_, reinterpret_cast<sockaddr*>(&bound), &length) == 0);
+        port_ = ntohs(bound.sin_port);
+        thread_ = std::thread([this] { loop(); });
+    }
+
+    ~QuicResponder() {
+        stopping_ = true;
+        thread_.join();
+        close(fd_);
+    }
+
+    QuicResponder(const QuicResponder&) = delete;
+    QuicResponder& operator=(const QuicResponder&) = delete;
+
+    int port() const { return port_; }
+
+private:
+    struct Pending {
+        Clock::time_point due;
+        std::string reply;
+        sockaddr_in to;
+    };
+
+    void loop() {
+        std::vector<Pending> pending;
+        unsigned char packet[1500];
+        while (!stopping_ || !pending.empty()) {
+            auto now = Clock::now();
+            for (auto it = pending.begin(); it != pending.end();) {
+                if (it->due > now) {
+                    ++it;
+                    continue;
+                }
+                sendto(fd_, it->reply.data(), it->reply.size(), 0,
+                       reinterpret_cast<sockaddr*>(&it->to), sizeof(it->to));
+                it = pending.erase(it);
+            }
+            if (stopping_) break;
+
+            pollfd ready{fd_, POLLIN, 0};
+            if (poll(&ready, 1, 1) <= 0) continue;
+            sockaddr_in from{};
+            socklen_t from_length = sizeof(from);
+            ssize_t n = recvfrom(fd_, packet, sizeof(packet), 0,
+                                 reinterpret_cast<sockaddr*>(&from), &from_length);
+            // Long header: flags, version, DCID length + DCID, SCID length + SCID
+            if (n < 7 || (packet[0] & 0x80) == 0) continue;
+            size_t dcid_length = packet[5];
+            size_t scid_at = 6 + dcid_length;
+            if (static_cast<size_t>(n) < scid_at + 1 + packet[scid_at]) continue;
+            size_t scid_length = packet[scid_at];
+            std::string dcid(reinterpret_cast<char*>(packet) + 6, dcid_length);
+            std::string scid(reinterpret_cast<char*>(packet) + scid_at + 1, scid_length);
+
+            // The prober's SCID is its stamp; the sample number is its third word
+            uint32_t sample = 0;
+            if (scid_length >= 12) memcpy(&sample, scid.data() + 8, sizeof(sample));
+            if (sample % 4 == 3) continue;
+
+            std::string reply{static_cast<char>(0x80), 0, 0, 0, 0};
+            reply.push_back(static_cast<char>(scid_length));
+            reply += scid;
+            reply.push_back(static_cast<char>(dcid_length));
+            reply += dcid;
+            uint32_t version = htonl(kVersion);
+            reply.append(reinterpret_cast<char*>(&version), sizeof(version));
+            auto delay = sample % 2 == 1 ? std::chrono::milliseconds(10) : std::chrono::milliseconds(0);
+            pending.push_back({Clock::now() + delay, reply, from});
+        }
+    }
+
+    int fd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+};
+
+/** A loopback UDP port nothing is bound to */
+int closed_udp_port() {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    CHECK(fd >= 0);
+    sockaddr_in bound{};
+    bound.sin_family = AF_INET;
+    bound.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK(bind(fd, reinterpret_cast<sockaddr*>(&bound), sizeof(bound)) == 0);
+    socklen_t length = sizeof(bound);
+    CHECK(getsockname(fd, reinterpret_cast<sockaddr*>(&bound), &length) == 0);
+    close(fd);
+    return ntohs(bound.sin_port);
+}
+
+void loss_and_jitter_follow_the_pattern() {
+    QuicResponder responder;
+    udp_prober::Options options;
+    options.count = 8;
+    options.interval_ms = 20;
+    options.timeout_ms = 300;
+
+    std::vector<udp_prober::Result> results = udp_prober::run(
+        {{"127.0.0.1", responder.port()}, {"127.0.0.1", closed_udp_port()}, {"127.0.0.1", 0}},
+        options);
+    CHECK(results.size() == 3);
+
+    // Samples 3 and 7 are dropped; odd samples answer 10 ms late
+    const udp_prober::Result& result = results[0];
+    CHECK(result.index == 0);
+    CHECK(result.status == udp_prober::kOk);
+    CHECK(result.sent == 8);
+    CHECK(result.received == 6);
+    CHECK(result.quic_version == QuicResponder::kVersion);
+    CHECK(result.min_ns > 0);
+    CHECK(result.min_ns < 5 * kMs);
+    CHECK(result.max_ns >= 10 * kMs);
+    CHECK(result.min_ns <= result.avg_ns && result.avg_ns <= result.max_ns);
+    // Answered in order 0 1 2 4 5 6: four 10 ms swings and one of about zero
+    CHECK(result.jitter_ns >= 6 * kMs);
+    CHECK(result.jitter_ns <= 12 * kMs);
+
+    CHECK(results[1].status == udp_prober::kRefused);
+    CHECK(results[1].received == 0);
+    CHECK(results[2].status == udp_prober::kError);
+}
+
+} // namespace
+
+int main() {
+    loss_and_jitter_follow_the_pattern();
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "url_tester.h"
+#include "stand_ins.h"
+
+/**
+ * url_tester::run against SOCKS5 stand-ins: one inbound per outcome in a
+ * single sweep, then the timeout path on its own
+ */
+namespace {
+
+using stand_ins::Socks5;
+
+void sweep_classifies_each_inbound() {
+    Socks5 ok(Socks5::kServe);
+    Socks5 refused(Socks5::kRefuseConnect);
+    Socks5 rejected(Socks5::kRejectAuth);
+    int closed = stand_ins::closed_port();
+
+    url_tester::Options options;
+    options.url = "http://connectivity.test/generate_204";
+    options.samples = 3;
+    options.timeout_ms = 2000;
+    std::vector<url_tester::Result> results =
+        url_tester::run({ok.port(), refused.port(), rejected.port(), closed}, options);
+
+    CHECK(results.size() == 4);
+    for (size_t i = 0; i < results.size(); i++) CHECK(results[i].index == i);
+
+    CHECK(results[0].status == url_tester::kOk);
+    CHECK(results[0].http_status == 204);
+    CHECK(results[0].successes == 3);
+    CHECK(results[0].attempts == 3);
+    CHECK(results[0].best_ns > 0);
+    CHECK(results[0].best_ns <= results[0].mean_ns);
+    CHECK(results[0].mean_ns < 2000 * 1000000ll);
+
+    CHECK(results[1].status == url_tester::kProxyFailed);
+    CHECK(results[1].successes == 0);
+    CHECK(results[2].status == url_tester::kProxyFailed);
+    CHECK(results[3].status == url_tester::kRefused);
+}
+
+void non_204_is_a_bad_response() {
+    Socks5 ok(Socks5::kServe);
+    url_tester::Options options;
+    options.url = "http://connectivity.test/";
+    std::vector<url_tester::Result> results = url_tester::run({ok.port()}, options);
+
+    CHECK(results.size() == 1);
+    CHECK(results[0].status == url_tester::kBadResponse);
+    CHECK(results[0].http_status == 200);
+    CHECK(results[0].successes == 0);
+}
+
+void silent_inbound_times_out() {
+    Socks5 silent(Socks5::kSilent);
+    url_tester::Options options;
+    options.url = "http://connectivity.test/generate_204";
+    options.timeout_ms = 300;
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<url_tester::Result> results = url_tester::run({silent.port()}, options);
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    CHECK(results.size() == 1);
+    CHECK(results[0].status == url_tester::kTimeout);
+    CHECK(elapsed >= std::chrono::milliseconds(300));
+    CHECK(elapsed < std::chrono::milliseconds(2000));
+}
+
+void rejects_non_http_urls() {
+    url_tester::Options options;
+    options.url = "https://connectivity.test/generate_204";
+    CHECK(url_tester::run({1080}, options).empty());
+}
+
+} // namespace
+
+int main() {
+    sweep_classifies_each_inbound();
+    non_204_is_a_bad_response();
+    silent_inbound_times_out();
+    rejects_non_http_urls();
+    return 0;
+}